@@ -123,6 +123,24 @@ long sandbox_i2c_rtc_get_set_base_time(struct udevice *dev, long base_time);
 
 int sandbox_usb_keyb_add_string(struct udevice *dev, const char *str);
 
+/**
+ * sandbox_flash_stall_write() - Stall the data phase of the next write
+ *
+ * The USB flash emulator refuses the data of the next write command with a
+ * stall and reports the failure in the CSW which follows.
+ *
+ * @dev:	USB flash emulator
+ */
+void sandbox_flash_stall_write(struct udevice *dev);
+
+/**
+ * sandbox_flash_get_resets() - Get the number of Bulk-Only resets
+ *
+ * @dev:	USB flash emulator
+ * Return: number of Bulk-Only Mass Storage Resets received since probe
+ */
+int sandbox_flash_get_resets(struct udevice *dev);
+
 /**
  * sandbox_osd_get_mem() - get the internal memory of a sandbox OSD
  *
@@ -1290,15 +1290,90 @@ int calculate_hash(const void *data, int data_len, const char *name,
 	return 0;
 }
 
+/* Maximum number of hash nodes of an image which are calculated together */
+#define FIT_HASH_MULTI		4
+
+/**
+ * struct fit_hash_values - hash values calculated before checking hash nodes
+ *
+ * @count: Number of hash values calculated
+ * @noffset: Offset of the hash node for each value
+ * @algo: Hash algorithm for each value
+ * @value: Each hash value, with space for FIT_MAX_HASH_LEN bytes
+ */
+struct fit_hash_values {
+	int count;
+	int noffset[FIT_HASH_MULTI];
+	struct hash_algo *algo[FIT_HASH_MULTI];
+	u8 *value[FIT_HASH_MULTI];
+};
+
+/**
+ * fit_image_calc_hashes() - Calculate the hashes of an image in one pass
+ *
+ * Where an image has more than one hash node, e.g. for both crc32 and sha256,
+ * this reads the image data once to calculate all the values, rather than
+ * once per node. The values are then used by fit_image_check_hash().
+ *
+ * Nothing is calculated if there is only one hash node, or if any problem is
+ * found, so that fit_image_check_hash() calculates the hash and reports any
+ * error as normal.
+ *
+ * @fit: FIT to check
+ * @image_noffset: Offset of image node
+ * @data: Image data
+ * @size: Size of image data in bytes
+ * @vals: Returns the values calculated
+ * @buf: Buffer to hold the values, FIT_HASH_MULTI * FIT_MAX_HASH_LEN bytes
+ */
+static void fit_image_calc_hashes(const void *fit, int image_noffset,
+				  const void *data, size_t size,
+				  struct fit_hash_values *vals, u8 *buf)
+{
+#if !defined(USE_HOSTCC) && !defined(CONFIG_DM_HASH)
+	int noffset;
+
+	vals->count = 0;
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+		int n = vals->count;
+		const char *algo;
+		int ignore;
+
+		if (strncmp(name, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (fit_image_hash_get_algo(fit, noffset, &algo))
+			continue;
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (ignore || hash_lookup_algo(algo, &vals->algo[n]))
+			continue;
+
+		vals->noffset[n] = noffset;
+		vals->value[n] = buf + n * FIT_MAX_HASH_LEN;
+		if (++vals->count == FIT_HASH_MULTI)
+			break;
+	}
+
+	if (vals->count < 2 ||
+	    hash_multi_block(vals->algo, vals->count, data, size, vals->value))
+		vals->count = 0;
+#else
+	vals->count = 0;
+#endif
+}
+
 static int fit_image_check_hash(const void *fit, int noffset, const void *data,
-				size_t size, char **err_msgp)
+				size_t size, const struct fit_hash_values *vals,
+				char **err_msgp)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(uint8_t, value, FIT_MAX_HASH_LEN);
+	const uint8_t *calc = value;
 	int value_len;
 	const char *algo;
 	uint8_t *fit_value;
 	int fit_value_len;
 	int ignore;
+	int i;
 
 	*err_msgp = NULL;
 
@@ -1322,7 +1397,12 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		return -1;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	for (i = 0; i < vals->count && vals->noffset[i] != noffset; i++)
+		;
+	if (i < vals->count) {
+		calc = vals->value[i];
+		value_len = vals->algo[i]->digest_size;
+	} else if (calculate_hash(data, size, algo, value, &value_len)) {
 		*err_msgp = "Unsupported hash algorithm";
 		return -1;
 	}
@@ -1330,7 +1410,7 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	if (value_len != fit_value_len) {
 		*err_msgp = "Bad hash value len";
 		return -1;
-	} else if (memcmp(value, fit_value, value_len) != 0) {
+	} else if (memcmp(calc, fit_value, value_len) != 0) {
 		*err_msgp = "Bad hash value";
 		return -1;
 	}
@@ -1342,6 +1422,8 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       const void *key_blob, const void *data,
 			       size_t size)
 {
+	ALLOC_CACHE_ALIGN_BUFFER(u8, hash_buf, FIT_HASH_MULTI * FIT_MAX_HASH_LEN);
+	struct fit_hash_values vals;
 	int		noffset = 0;
 	char		*err_msg = "";
 	int verify_all = 1;
@@ -1355,6 +1437,8 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 		goto error;
 	}
 
+	fit_image_calc_hashes(fit, image_noffset, data, size, &vals, hash_buf);
+
 	/* Process all hash subnodes of the component image node */
 	fdt_for_each_subnode(noffset, fit, image_noffset) {
 		const char *name = fit_get_name(fit, noffset, NULL);
@@ -1367,7 +1451,7 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 		if (!strncmp(name, FIT_HASH_NODENAME,
 			     strlen(FIT_HASH_NODENAME))) {
 			if (fit_image_check_hash(fit, noffset, data, size,
-						 &err_msg))
+						 &vals, &err_msg))
 				goto error;
 			puts("+ ");
 		} else if (FIT_IMAGE_ENABLE_VERIFY && verify_all &&
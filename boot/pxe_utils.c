@@ -6,6 +6,7 @@
 
 #define LOG_CATEGORY	LOGC_BOOT
 
+#include <bootstage.h>
 #include <command.h>
 #include <dm.h>
 #include <env.h>
@@ -188,38 +189,6 @@ int get_pxelinux_path(struct pxe_context *ctx, const char *file,
 	return get_pxe_file(ctx, path, pxefile_addr_r);
 }
 
-/**
- * get_relfile_envaddr() - read a file to an address in an env var
- *
- * Wrapper to make it easier to store the file at file_path in the location
- * specified by envaddr_name. file_path will be joined to the bootfile path,
- * if any is specified.
- *
- * @ctx: PXE context
- * @file_path: File path to read (relative to the PXE file)
- * @envaddr_name: Name of environment variable which contains the address to
- *	load to
- * @filesizep: Returns the file size in bytes
- * Returns 1 on success, -ENOENT if @envaddr_name does not exist as an
- *	environment variable, -EINVAL if its format is not valid hex, or other
- *	value < 0 on other error
- */
-static int get_relfile_envaddr(struct pxe_context *ctx, const char *file_path,
-			       const char *envaddr_name, ulong *filesizep)
-{
-	unsigned long file_addr;
-	char *envaddr;
-
-	envaddr = from_env(envaddr_name);
-	if (!envaddr)
-		return -ENOENT;
-
-	if (strict_strtoul(envaddr, 16, &file_addr) < 0)
-		return -EINVAL;
-
-	return get_relfile(ctx, file_path, file_addr, filesizep);
-}
-
 /**
  * label_create() - crate a new PXE label
  *
@@ -346,22 +315,230 @@ static void label_boot_kaslrseed(void)
 }
 
 /**
- * label_boot_fdtoverlay() - Loads fdt overlays specified in 'fdtoverlays'
- * or 'devicetree-overlay'
+ * enum pxe_file_id - Files which may be loaded to boot a label
+ *
+ * Files are loaded in this order, smallest first, so that a missing FDT or
+ * initrd is noticed before any time is spent retrieving the kernel. Overlays
+ * follow the FDT so that they can be applied to it straight away.
+ *
+ * @PXE_FILE_FDT: Devicetree, from 'fdt' or 'fdtdir'
+ * @PXE_FILE_OVERLAY: Devicetree overlay, from 'fdtoverlays'
+ * @PXE_FILE_INITRD: Initial ramdisk
+ * @PXE_FILE_KERNEL: Kernel, or FIT
+ */
+enum pxe_file_id {
+	PXE_FILE_FDT,
+	PXE_FILE_OVERLAY,
+	PXE_FILE_INITRD,
+	PXE_FILE_KERNEL,
+
+	PXE_FILE_COUNT,
+};
+
+/**
+ * struct pxe_file_info - Fixed information about each type of file
+ *
+ * @name: Name used in messages
+ * @stage: Name of the bootstage record marked once the file is loaded
+ * @envaddr: Environment variable holding the load address
+ */
+static const struct pxe_file_info {
+	const char *name;
+	const char *stage;
+	const char *envaddr;
+} pxe_file_info[PXE_FILE_COUNT] = {
+	[PXE_FILE_FDT]		= { "FDT", "pxe_fdt", "fdt_addr_r" },
+	[PXE_FILE_OVERLAY]	= { "overlay", "pxe_fdtoverlay",
+				    "fdtoverlay_addr_r" },
+	[PXE_FILE_INITRD]	= { "initrd", "pxe_initrd", "ramdisk_addr_r" },
+	[PXE_FILE_KERNEL]	= { "kernel", "pxe_kernel", "kernel_addr_r" },
+};
+
+/**
+ * struct pxe_file - A file to be loaded for a label
+ *
+ * @id: Type of file
+ * @path: Path to the file (relative to the PXE file), NULL if not needed
+ * @addr: Address to load the file to
+ * @size: Size of the file once loaded, 0 if not loaded
+ */
+struct pxe_file {
+	enum pxe_file_id id;
+	const char *path;
+	ulong addr;
+	ulong size;
+};
+
+/**
+ * label_plan_file() - Add a file to the list of those to load
+ *
+ * @file: Entry to fill in
+ * @id: Type of file
+ * @path: Path to the file (relative to the PXE file)
+ * Returns 0 on success, -ENOENT if the load-address environment variable does
+ *	not exist, -EINVAL if its format is not valid hex
+ */
+static int label_plan_file(struct pxe_file *file, enum pxe_file_id id,
+			   const char *path)
+{
+	char *envaddr;
+
+	envaddr = from_env(pxe_file_info[id].envaddr);
+	if (!envaddr)
+		return -ENOENT;
+	if (strict_strtoul(envaddr, 16, &file->addr) < 0)
+		return -EINVAL;
+	file->id = id;
+	file->path = path;
+
+	return 0;
+}
+
+/**
+ * label_load_file() - Load a file planned by label_plan_file()
  *
  * @ctx: PXE context
+ * @file: File to load
+ * Returns 1 for success, or < 0 on error
+ */
+static int label_load_file(struct pxe_context *ctx, struct pxe_file *file)
+{
+	int ret;
+
+	ret = get_relfile(ctx, file->path, file->addr, &file->size);
+	if (ret < 0) {
+		file->size = 0;
+		return ret;
+	}
+	bootstage_mark_name(BOOTSTAGE_ID_ALLOC, pxe_file_info[file->id].stage);
+
+	return ret;
+}
+
+/**
+ * label_check_overlap() - Check that no loaded file overwrote another
+ *
+ * Overlays all share one load address, since each is applied before the next
+ * is loaded, so they are not checked against each other.
+ *
+ * @files: List of files for the label
+ * @count: Number of files in @files
+ * Returns 0 if all files are intact, -EINVAL if two of them overlap
+ */
+static int label_check_overlap(const struct pxe_file *files, int count)
+{
+	int i, j;
+
+	for (i = 0; i < count; i++) {
+		const struct pxe_file *a = &files[i];
+
+		for (j = i + 1; a->size && j < count; j++) {
+			const struct pxe_file *b = &files[j];
+
+			if (a->id == PXE_FILE_OVERLAY &&
+			    b->id == PXE_FILE_OVERLAY)
+				continue;
+			if (b->size && a->addr < b->addr + b->size &&
+			    b->addr < a->addr + a->size) {
+				printf("%s at %lx (%lx bytes) overlaps %s at %lx (%lx bytes)\n",
+				       pxe_file_info[a->id].name, a->addr,
+				       a->size, pxe_file_info[b->id].name,
+				       b->addr, b->size);
+				return -EINVAL;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * label_count_overlays() - Count the overlays given by 'fdtoverlays'
+ *
  * @label: Label to process
+ * Returns number of overlay filenames in the label
+ */
+static int label_count_overlays(struct pxe_label *label)
+{
+	const char *p = label->fdtoverlays;
+	int count = 0;
+
+	if (!IS_ENABLED(CONFIG_OF_LIBFDT_OVERLAY) || !p)
+		return 0;
+
+	while (*p) {
+		while (*p == ' ')
+			p++;
+		if (!*p)
+			break;
+		count++;
+		while (*p && *p != ' ')
+			p++;
+	}
+
+	return count;
+}
+
+/**
+ * label_plan_overlays() - Add the overlays in 'fdtoverlays' to the files
+ *
+ * The overlay filenames point into a copy of 'fdtoverlays', which is returned
+ * so that the caller can free it after booting fails.
+ *
+ * If the overlays cannot be planned they are left out, with a message, and the
+ * label is booted without them.
+ *
+ * @label: Label to process
+ * @overlays: Entries to fill in, label_count_overlays() of them
+ * @listp: Returns the copy of 'fdtoverlays', or NULL if none
+ * Returns 0 on success, -ENOMEM if out of memory
+ */
+static int label_plan_overlays(struct pxe_label *label,
+			       struct pxe_file *overlays, char **listp)
+{
+	char *list, *p, *name;
+	int i = 0;
+
+	*listp = NULL;
+	if (!label_count_overlays(label))
+		return 0;
+
+	list = strdup(label->fdtoverlays);
+	if (!list)
+		return -ENOMEM;
+	*listp = list;
+
+	p = list;
+	while ((name = strsep(&p, " "))) {
+		if (!*name)
+			continue;
+		if (label_plan_file(&overlays[i], PXE_FILE_OVERLAY, name) < 0) {
+			printf("Invalid fdtoverlay_addr_r for loading overlays\n");
+			while (i--)
+				overlays[i].path = NULL;
+			return 0;
+		}
+		i++;
+	}
+
+	return 0;
+}
+
+/**
+ * label_boot_fdtoverlay() - Load and apply the overlays planned by
+ * label_plan_overlays()
+ *
+ * @ctx: PXE context
+ * @overlays: Overlays to apply, in order
+ * @count: Number of entries in @overlays
  */
 #ifdef CONFIG_OF_LIBFDT_OVERLAY
 static void label_boot_fdtoverlay(struct pxe_context *ctx,
-				  struct pxe_label *label)
+				  struct pxe_file *overlays, int count)
 {
-	char *fdtoverlay = label->fdtoverlays;
 	struct fdt_header *working_fdt;
-	char *fdtoverlay_addr_env;
-	ulong fdtoverlay_addr;
 	ulong fdt_addr;
-	int err;
+	int err, i;
 
 	/* Get the main fdt and map it */
 	fdt_addr = hextoul(env_get("fdt_addr_r"), NULL);
@@ -370,78 +547,132 @@ static void label_boot_fdtoverlay(struct pxe_context *ctx,
 	if (err)
 		return;
 
-	/* Get the specific overlay loading address */
-	fdtoverlay_addr_env = env_get("fdtoverlay_addr_r");
-	if (!fdtoverlay_addr_env) {
-		printf("Invalid fdtoverlay_addr_r for loading overlays\n");
-		return;
-	}
-
-	fdtoverlay_addr = hextoul(fdtoverlay_addr_env, NULL);
-
 	/* Cycle over the overlay files and apply them in order */
-	do {
+	for (i = 0; i < count; i++) {
+		struct pxe_file *file = &overlays[i];
 		struct fdt_header *blob;
-		char *overlayfile;
-		char *end;
-		int len;
 
-		/* Drop leading spaces */
-		while (*fdtoverlay == ' ')
-			++fdtoverlay;
-
-		/* Copy a single filename if multiple provided */
-		end = strstr(fdtoverlay, " ");
-		if (end) {
-			len = (int)(end - fdtoverlay);
-			overlayfile = malloc(len + 1);
-			strncpy(overlayfile, fdtoverlay, len);
-			overlayfile[len] = '\0';
-		} else
-			overlayfile = fdtoverlay;
-
-		if (!strlen(overlayfile))
-			goto skip_overlay;
-
-		/* Load overlay file */
-		err = get_relfile_envaddr(ctx, overlayfile, "fdtoverlay_addr_r",
-					  NULL);
+		if (!file->path)
+			continue;
+
+		err = label_load_file(ctx, file);
 		if (err < 0) {
-			printf("Failed loading overlay %s\n", overlayfile);
-			goto skip_overlay;
+			printf("Failed loading overlay %s\n", file->path);
+			continue;
 		}
 
 		/* Resize main fdt */
 		fdt_shrink_to_minimum(working_fdt, 8192);
 
-		blob = map_sysmem(fdtoverlay_addr, 0);
+		blob = map_sysmem(file->addr, 0);
 		err = fdt_check_header(blob);
 		if (err) {
-			printf("Invalid overlay %s, skipping\n",
-			       overlayfile);
-			goto skip_overlay;
+			printf("Invalid overlay %s, skipping\n", file->path);
+			continue;
 		}
 
 		err = fdt_overlay_apply_verbose(working_fdt, blob);
 		if (err) {
 			printf("Failed to apply overlay %s, skipping\n",
-			       overlayfile);
-			goto skip_overlay;
+			       file->path);
+			continue;
 		}
-
-skip_overlay:
-		if (end)
-			free(overlayfile);
-	} while ((fdtoverlay = strstr(fdtoverlay, " ")));
+	}
 }
 #endif
 
+/**
+ * label_fdt_file() - Work out which FDT file to load for a label
+ *
+ * @label: Label to process
+ * @fdtfilep: Returns the FDT file, or NULL if none should be loaded
+ * @fdtfilefreep: Returns memory allocated for the filename, to be freed by
+ *	the caller, or NULL if none
+ * Returns 0 on success, -ENOMEM if out of memory
+ */
+static int label_fdt_file(struct pxe_label *label, char **fdtfilep,
+			  char **fdtfilefreep)
+{
+	*fdtfilep = NULL;
+	*fdtfilefreep = NULL;
+
+	if (label->fdt) {
+		if (IS_ENABLED(CONFIG_SUPPORT_PASSING_ATAGS)) {
+			if (strcmp("-", label->fdt))
+				*fdtfilep = label->fdt;
+		} else {
+			*fdtfilep = label->fdt;
+		}
+	} else if (label->fdtdir) {
+		char *f1, *f2, *f3, *f4, *slash;
+		char *fdtfile;
+		int len;
+
+		f1 = env_get("fdtfile");
+		if (f1) {
+			f2 = "";
+			f3 = "";
+			f4 = "";
+		} else {
+			/*
+			 * For complex cases where this code doesn't
+			 * generate the correct filename, the board
+			 * code should set $fdtfile during early boot,
+			 * or the boot scripts should set $fdtfile
+			 * before invoking "pxe" or "sysboot".
+			 */
+			f1 = env_get("soc");
+			f2 = "-";
+			f3 = env_get("board");
+			f4 = ".dtb";
+			if (!f1) {
+				f1 = "";
+				f2 = "";
+			}
+			if (!f3) {
+				f2 = "";
+				f3 = "";
+			}
+		}
+
+		len = strlen(label->fdtdir);
+		if (!len)
+			slash = "./";
+		else if (label->fdtdir[len - 1] != '/')
+			slash = "/";
+		else
+			slash = "";
+
+		len = strlen(label->fdtdir) + strlen(slash) +
+			strlen(f1) + strlen(f2) + strlen(f3) +
+			strlen(f4) + 1;
+		fdtfile = malloc(len);
+		if (!fdtfile) {
+			printf("malloc fail (FDT filename)\n");
+			return -ENOMEM;
+		}
+
+		snprintf(fdtfile, len, "%s%s%s%s%s%s",
+			 label->fdtdir, slash, f1, f2, f3, f4);
+		*fdtfilep = fdtfile;
+		*fdtfilefreep = fdtfile;
+	}
+
+	return 0;
+}
+
 /**
  * label_boot() - Boot according to the contents of a pxe_label
  *
  * If we can't boot for any reason, we return.  A successful boot never
  * returns.
  *
+ * All the files needed by the label are worked out first, along with their
+ * load addresses, so that a bad configuration is reported before anything is
+ * retrieved. The files are then loaded in the order given by enum pxe_file_id,
+ * with any overlays applied as soon as the FDT is loaded, and checked for
+ * overlap before booting.
+ *
  * The kernel will be stored in the location given by the 'kernel_addr_r'
  * environment variable.
  *
@@ -460,6 +691,7 @@ static int label_boot(struct pxe_context *ctx, struct pxe_label *label)
 {
 	char *bootm_argv[] = { "bootm", NULL, NULL, NULL, NULL };
 	char *zboot_argv[] = { "zboot", NULL, "0", NULL, NULL };
+	struct pxe_file *files, *fdt, *overlays, *initrd, *kernel, *file;
 	char *kernel_addr = NULL;
 	char *initrd_addr_str = NULL;
 	char initrd_filesize[10];
@@ -467,9 +699,12 @@ static int label_boot(struct pxe_context *ctx, struct pxe_label *label)
 	char mac_str[29] = "";
 	char ip_str[68] = "";
 	char *fit_addr = NULL;
+	char *fdtfilefree = NULL;
+	char *overlaylist = NULL;
+	char *fdtfile = NULL;
 	int bootm_argc = 2;
 	int zboot_argc = 3;
-	int len = 0;
+	int noverlays, count;
 	ulong kernel_addr_r;
 	void *buf;
 
@@ -489,11 +724,119 @@ static int label_boot(struct pxe_context *ctx, struct pxe_label *label)
 		return 1;
 	}
 
-	if (get_relfile_envaddr(ctx, label->kernel, "kernel_addr_r",
-				NULL) < 0) {
+	/* The FDT, then each overlay, then the initrd, then the kernel */
+	noverlays = label_count_overlays(label);
+	count = noverlays + PXE_FILE_COUNT - 1;
+	files = calloc(count, sizeof(*files));
+	if (!files) {
+		printf("malloc fail (file list)\n");
+		return 1;
+	}
+	fdt = &files[0];
+	overlays = fdt + 1;
+	initrd = overlays + noverlays;
+	kernel = initrd + 1;
+
+	if (label_plan_file(kernel, PXE_FILE_KERNEL, label->kernel) < 0) {
 		printf("Skipping %s for failure retrieving kernel\n",
 		       label->name);
-		return 1;
+		goto cleanup;
+	}
+
+	/* For FIT, the label can be identical to kernel one */
+	if (label->initrd && strcmp(label->kernel_label, label->initrd) &&
+	    label_plan_file(initrd, PXE_FILE_INITRD, label->initrd) < 0) {
+		printf("Skipping %s for failure retrieving initrd\n",
+		       label->name);
+		goto cleanup;
+	}
+
+	/*
+	 * fdt usage is optional:
+	 * It handles the following scenarios.
+	 *
+	 * Scenario 1: If fdt_addr_r specified and "fdt" or "fdtdir" label is
+	 * defined in pxe file, retrieve fdt blob from server. Pass fdt_addr_r to
+	 * bootm, and adjust argc appropriately.
+	 *
+	 * If retrieve fails and no exact fdt blob is specified in pxe file with
+	 * "fdt" label, try Scenario 2.
+	 *
+	 * Scenario 2: If there is an fdt_addr specified, pass it along to
+	 * bootm, and adjust argc appropriately.
+	 *
+	 * Scenario 3: If there is an fdtcontroladdr specified, pass it along to
+	 * bootm, and adjust argc appropriately, unless the image type is fitImage.
+	 *
+	 * Scenario 4: fdt blob is not available.
+	 */
+	bootm_argv[3] = env_get("fdt_addr_r");
+
+	/* For FIT, the label can be identical to kernel one */
+	if (label->fdt && !strcmp(label->kernel_label, label->fdt)) {
+		bootm_argv[3] = NULL;
+	/* if fdt label is defined then get fdt from server */
+	} else if (bootm_argv[3]) {
+		if (label_fdt_file(label, &fdtfile, &fdtfilefree))
+			goto cleanup;
+		if (!fdtfile) {
+			bootm_argv[3] = NULL;
+		} else if (label_plan_file(fdt, PXE_FILE_FDT, fdtfile) < 0) {
+			if (label->fdt) {
+				printf("Skipping %s for failure retrieving FDT\n",
+				       label->name);
+				goto cleanup;
+			}
+			bootm_argv[3] = NULL;
+			printf("Skipping fdtdir %s for failure retrieving dts\n",
+			       label->fdtdir);
+		}
+		if (fdtfile &&
+		    label_plan_overlays(label, overlays, &overlaylist)) {
+			printf("malloc fail (overlay list)\n");
+			goto cleanup;
+		}
+	}
+
+	if (fdt->path && label_load_file(ctx, fdt) < 0) {
+		if (label->fdt) {
+			printf("Skipping %s for failure retrieving FDT\n",
+			       label->name);
+			goto cleanup;
+		}
+		bootm_argv[3] = NULL;
+		printf("Skipping fdtdir %s for failure retrieving dts\n",
+		       label->fdtdir);
+	}
+
+	/* Start on the FDT as soon as it is here */
+	if (fdtfile) {
+		struct fdt_header *blob;
+
+		if (label->kaslrseed)
+			label_boot_kaslrseed();
+
+#ifdef CONFIG_OF_LIBFDT_OVERLAY
+		label_boot_fdtoverlay(ctx, overlays, noverlays);
+#endif
+		/* Overlays may have enlarged it */
+		blob = map_sysmem(fdt->addr, 0);
+		if (fdt->size && !fdt_check_header(blob))
+			fdt->size = max_t(ulong, fdt->size, fdt_totalsize(blob));
+		unmap_sysmem(blob);
+	}
+
+	for (file = initrd; file <= kernel; file++) {
+		if (file->path && label_load_file(ctx, file) < 0) {
+			printf("Skipping %s for failure retrieving %s\n",
+			       label->name, pxe_file_info[file->id].name);
+			goto cleanup;
+		}
+	}
+
+	if (label_check_overlap(files, count)) {
+		printf("Skipping %s\n", label->name);
+		goto cleanup;
 	}
 
 	kernel_addr = env_get("kernel_addr_r");
@@ -504,23 +847,21 @@ static int label_boot(struct pxe_context *ctx, struct pxe_label *label)
 		fit_addr = malloc(len);
 		if (!fit_addr) {
 			printf("malloc fail (FIT address)\n");
-			return 1;
+			goto cleanup;
 		}
 		snprintf(fit_addr, len, "%s%s", kernel_addr, label->config);
 		kernel_addr = fit_addr;
 	}
 
+	if (label->fdt && !strcmp(label->kernel_label, label->fdt))
+		bootm_argv[3] = kernel_addr;
+
 	/* For FIT, the label can be identical to kernel one */
 	if (label->initrd && !strcmp(label->kernel_label, label->initrd)) {
 		initrd_addr_str =  kernel_addr;
 	} else if (label->initrd) {
-		ulong size;
-		if (get_relfile_envaddr(ctx, label->initrd, "ramdisk_addr_r",
-					&size) < 0) {
-			printf("Skipping %s for failure retrieving initrd\n",
-			       label->name);
-			goto cleanup;
-		}
+		ulong size = initrd->size;
+
 		strcpy(initrd_filesize, simple_xtoa(size));
 		initrd_addr_str = env_get("ramdisk_addr_r");
 		size = snprintf(initrd_str, sizeof(initrd_str), "%s:%lx",
@@ -571,126 +912,6 @@ static int label_boot(struct pxe_context *ctx, struct pxe_label *label)
 		printf("append: %s\n", finalbootargs);
 	}
 
-	/*
-	 * fdt usage is optional:
-	 * It handles the following scenarios.
-	 *
-	 * Scenario 1: If fdt_addr_r specified and "fdt" or "fdtdir" label is
-	 * defined in pxe file, retrieve fdt blob from server. Pass fdt_addr_r to
-	 * bootm, and adjust argc appropriately.
-	 *
-	 * If retrieve fails and no exact fdt blob is specified in pxe file with
-	 * "fdt" label, try Scenario 2.
-	 *
-	 * Scenario 2: If there is an fdt_addr specified, pass it along to
-	 * bootm, and adjust argc appropriately.
-	 *
-	 * Scenario 3: If there is an fdtcontroladdr specified, pass it along to
-	 * bootm, and adjust argc appropriately, unless the image type is fitImage.
-	 *
-	 * Scenario 4: fdt blob is not available.
-	 */
-	bootm_argv[3] = env_get("fdt_addr_r");
-
-	/* For FIT, the label can be identical to kernel one */
-	if (label->fdt && !strcmp(label->kernel_label, label->fdt)) {
-		bootm_argv[3] = kernel_addr;
-	/* if fdt label is defined then get fdt from server */
-	} else if (bootm_argv[3]) {
-		char *fdtfile = NULL;
-		char *fdtfilefree = NULL;
-
-		if (label->fdt) {
-			if (IS_ENABLED(CONFIG_SUPPORT_PASSING_ATAGS)) {
-				if (strcmp("-", label->fdt))
-					fdtfile = label->fdt;
-			} else {
-				fdtfile = label->fdt;
-			}
-		} else if (label->fdtdir) {
-			char *f1, *f2, *f3, *f4, *slash;
-
-			f1 = env_get("fdtfile");
-			if (f1) {
-				f2 = "";
-				f3 = "";
-				f4 = "";
-			} else {
-				/*
-				 * For complex cases where this code doesn't
-				 * generate the correct filename, the board
-				 * code should set $fdtfile during early boot,
-				 * or the boot scripts should set $fdtfile
-				 * before invoking "pxe" or "sysboot".
-				 */
-				f1 = env_get("soc");
-				f2 = "-";
-				f3 = env_get("board");
-				f4 = ".dtb";
-				if (!f1) {
-					f1 = "";
-					f2 = "";
-				}
-				if (!f3) {
-					f2 = "";
-					f3 = "";
-				}
-			}
-
-			len = strlen(label->fdtdir);
-			if (!len)
-				slash = "./";
-			else if (label->fdtdir[len - 1] != '/')
-				slash = "/";
-			else
-				slash = "";
-
-			len = strlen(label->fdtdir) + strlen(slash) +
-				strlen(f1) + strlen(f2) + strlen(f3) +
-				strlen(f4) + 1;
-			fdtfilefree = malloc(len);
-			if (!fdtfilefree) {
-				printf("malloc fail (FDT filename)\n");
-				goto cleanup;
-			}
-
-			snprintf(fdtfilefree, len, "%s%s%s%s%s%s",
-				 label->fdtdir, slash, f1, f2, f3, f4);
-			fdtfile = fdtfilefree;
-		}
-
-		if (fdtfile) {
-			int err = get_relfile_envaddr(ctx, fdtfile,
-						      "fdt_addr_r", NULL);
-
-			free(fdtfilefree);
-			if (err < 0) {
-				bootm_argv[3] = NULL;
-
-				if (label->fdt) {
-					printf("Skipping %s for failure retrieving FDT\n",
-					       label->name);
-					goto cleanup;
-				}
-
-				if (label->fdtdir) {
-					printf("Skipping fdtdir %s for failure retrieving dts\n",
-						label->fdtdir);
-				}
-			}
-
-			if (label->kaslrseed)
-				label_boot_kaslrseed();
-
-#ifdef CONFIG_OF_LIBFDT_OVERLAY
-			if (label->fdtoverlays)
-				label_boot_fdtoverlay(ctx, label);
-#endif
-		} else {
-			bootm_argv[3] = NULL;
-		}
-	}
-
 	bootm_argv[1] = kernel_addr;
 	zboot_argv[1] = kernel_addr;
 
@@ -752,6 +973,9 @@ static int label_boot(struct pxe_context *ctx, struct pxe_label *label)
 	unmap_sysmem(buf);
 
 cleanup:
+	free(overlaylist);
+	free(fdtfilefree);
+	free(files);
 	free(fit_addr);
 
 	return 1;
@@ -15,6 +15,17 @@ static int do_bootstage_report(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+static int do_bootstage_initcalls(struct cmd_tbl *cmdtp, int flag, int argc,
+				  char *const argv[])
+{
+	bootstage_timing_report(BIT(BOOTSTAGE_TIMING_INITCALL) |
+				BIT(BOOTSTAGE_TIMING_EVENT));
+
+	return 0;
+}
+#endif
+
 #if IS_ENABLED(CONFIG_BOOTSTAGE_STASH)
 static int get_base_size(int argc, char *const argv[], ulong *basep,
 			 ulong *sizep)
@@ -63,6 +74,9 @@ static int do_bootstage_stash(struct cmd_tbl *cmdtp, int flag, int argc,
 
 static struct cmd_tbl cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+	U_BOOT_CMD_MKENT(initcalls, 1, 1, do_bootstage_initcalls, "", ""),
+#endif
 #if IS_ENABLED(CONFIG_BOOTSTAGE_STASH)
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
@@ -94,6 +108,9 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	"Boot stage command",
 	" - check boot progress and timing\n"
 	"report                      - Print a report\n"
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+	"initcalls                   - Show initcall times, slowest first\n"
+#endif
 #if IS_ENABLED(CONFIG_BOOTSTAGE_STASH)
 	"stash [<start> [<size>]]    - Stash data into memory\n"
 	"unstash [<start> [<size>]]  - Unstash data from memory\n"
@@ -67,9 +67,10 @@ static int do_cyclic_list(struct cmd_tbl *cmdtp, int flag, int argc,
 	hlist_for_each_entry_safe(cyclic, tmp, cyclic_get_list(), list) {
 		cnt = cyclic->run_cnt * 1000000ULL * 100ULL;
 		freq = lldiv(cnt, timer_get_us() - cyclic->start_time_us);
-		printf("function: %s, cpu-time: %lld us, frequency: %lld.%02d times/s\n",
+		printf("function: %s, cpu-time: %lld us, frequency: %lld.%02d times/s, runs: %lld, max: %lld us\n",
 		       cyclic->name, cyclic->cpu_time_us,
-		       lldiv(freq, 100), do_div(freq, 100));
+		       lldiv(freq, 100), do_div(freq, 100), cyclic->run_cnt,
+		       cyclic->max_cpu_time_us);
 	}
 
 	return 0;
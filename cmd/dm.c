@@ -6,6 +6,7 @@
  * Marek Vasut <marex@denx.de>
  */
 
+#include <bootstage.h>
 #include <command.h>
 #include <dm/root.h>
 #include <dm/util.h>
@@ -47,6 +48,16 @@ static int do_dm_dump_mem(struct cmd_tbl *cmdtp, int flag, int argc,
 }
 #endif /* DM_STATS */
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+static int do_dm_probe_times(struct cmd_tbl *cmdtp, int flag, int argc,
+			     char *const argv[])
+{
+	bootstage_timing_report(BIT(BOOTSTAGE_TIMING_PROBE));
+
+	return 0;
+}
+#endif
+
 static int do_dm_dump_static_driver_info(struct cmd_tbl *cmdtp, int flag,
 					 int argc, char * const argv[])
 {
@@ -111,11 +122,22 @@ static int do_dm_dump_uclass(struct cmd_tbl *cmdtp, int flag, int argc,
 #define DM_MEM
 #endif
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+#define DM_PROBE_TIMES_HELP \
+	"dm probe-times   Show device probe times, slowest first\n"
+#define DM_PROBE_TIMES	\
+	U_BOOT_SUBCMD_MKENT(probe-times, 1, 1, do_dm_probe_times),
+#else
+#define DM_PROBE_TIMES_HELP
+#define DM_PROBE_TIMES
+#endif
+
 U_BOOT_LONGHELP(dm,
 	"compat        Dump list of drivers with compatibility strings\n"
 	"dm devres        Dump list of device resources for each device\n"
 	"dm drivers       Dump list of drivers with uclass and instances\n"
 	DM_MEM_HELP
+	DM_PROBE_TIMES_HELP
 	"dm static        Dump list of drivers with static platform data\n"
 	"dm tree [-s][-e][name]   Dump tree of driver model devices (-s=sort)\n"
 	"dm uclass [-e][name]     Dump list of instances for each uclass");
@@ -125,6 +147,7 @@ U_BOOT_CMD_WITH_SUBCMDS(dm, "Driver model low level access", dm_help_text,
 	U_BOOT_SUBCMD_MKENT(devres, 1, 1, do_dm_dump_devres),
 	U_BOOT_SUBCMD_MKENT(drivers, 1, 1, do_dm_dump_drivers),
 	DM_MEM
+	DM_PROBE_TIMES
 	U_BOOT_SUBCMD_MKENT(static, 1, 1, do_dm_dump_static_driver_info),
 	U_BOOT_SUBCMD_MKENT(tree, 4, 1, do_dm_dump_tree),
 	U_BOOT_SUBCMD_MKENT(uclass, 3, 1, do_dm_dump_uclass));
@@ -77,6 +77,7 @@ static int do_fat_fsinfo(struct cmd_tbl *cmdtp, int flag, int argc,
 		return 1;
 
 	dev = dev_desc->devnum;
+	fs_flush();
 	if (fat_set_blk_dev(dev_desc, &info) != 0) {
 		printf("\n** Unable to use %s %d:%d for fatinfo **\n",
 			argv[1], dev, part);
@@ -5,6 +5,7 @@
  * Inspired by cmd_ext_common.c, cmd_fat.c.
  */
 
+#include <blk.h>
 #include <command.h>
 #include <fs.h>
 
@@ -110,3 +111,39 @@ U_BOOT_CMD(
 	fstypes, 1, 1, do_fstypes_wrapper,
 	"List supported filesystem types", ""
 );
+
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+static int do_fs_flush(struct cmd_tbl *cmdtp, int flag, int argc,
+		       char *const argv[])
+{
+	fs_flush();
+
+	return 0;
+}
+
+static int do_fs_stats(struct cmd_tbl *cmdtp, int flag, int argc,
+		       char *const argv[])
+{
+	struct fs_mount_stats stats;
+
+	fs_mount_get_stats(&stats);
+	if (stats.desc)
+		printf("Mounted: %s %d:%d (%s)\n",
+		       blk_get_uclass_name(stats.desc->uclass_id),
+		       stats.desc->devnum, stats.part, stats.name);
+	else
+		printf("Mounted: none\n");
+	printf("Hits: %lu, misses: %lu, invalidations: %lu\n", stats.hits,
+	       stats.misses, stats.invalidations);
+
+	return 0;
+}
+
+U_BOOT_LONGHELP(fs,
+	"flush - unmount the filesystem kept mounted between commands\n"
+	"fs stats - show the mounted filesystem and mount cache statistics");
+
+U_BOOT_CMD_WITH_SUBCMDS(fs, "filesystem mount cache", fs_help_text,
+	U_BOOT_SUBCMD_MKENT(flush, 1, 1, do_fs_flush),
+	U_BOOT_SUBCMD_MKENT(stats, 1, 1, do_fs_stats));
+#endif
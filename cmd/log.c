@@ -374,6 +374,21 @@ static int do_log_rec(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(LOG_BINARY)
+static int do_log_dump(struct cmd_tbl *cmdtp, int flag, int argc,
+		       char *const argv[])
+{
+	if (log_binary_dump()) {
+		printf("No binary log\n");
+		return CMD_RET_FAILURE;
+	}
+	if (argc > 1 && !strcmp(argv[1], "-c"))
+		log_binary_clear();
+
+	return 0;
+}
+#endif
+
 U_BOOT_LONGHELP(log,
 	"level [<level>] - get/set log level\n"
 	"categories - list log categories\n"
@@ -403,7 +418,11 @@ U_BOOT_LONGHELP(log,
 	"\tc=category, l=level, F=file, L=line number, f=function, m=msg\n"
 	"\tor 'default', or 'all' for all\n"
 	"log rec <category> <level> <file> <line> <func> <message> - "
-		"output a log record");
+		"output a log record"
+#if CONFIG_IS_ENABLED(LOG_BINARY)
+	"\nlog dump [-c] - show the binary log, then clear it if -c is given"
+#endif
+	);
 
 U_BOOT_CMD_WITH_SUBCMDS(log, "log system", log_help_text,
 	U_BOOT_SUBCMD_MKENT(level, 2, 1, do_log_level),
@@ -415,4 +434,7 @@ U_BOOT_CMD_WITH_SUBCMDS(log, "log system", log_help_text,
 	U_BOOT_SUBCMD_MKENT(filter-remove, 4, 1, do_log_filter_remove),
 	U_BOOT_SUBCMD_MKENT(format, 2, 1, do_log_format),
 	U_BOOT_SUBCMD_MKENT(rec, 7, 1, do_log_rec),
+#if CONFIG_IS_ENABLED(LOG_BINARY)
+	U_BOOT_SUBCMD_MKENT(dump, 2, 1, do_log_dump),
+#endif
 );
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Show information about the malloc() heap
+ */
+
+#include <command.h>
+#include <display_options.h>
+#include <malloc.h>
+#include <mapmem.h>
+
+static int do_malloc_info(struct cmd_tbl *cmdtp, int flag, int argc,
+			  char *const argv[])
+{
+	struct mallinfo info = mallinfo();
+
+	printf("Heap:   %lx, size ", (ulong)map_to_sysmem((void *)mem_malloc_start));
+	print_size(mem_malloc_end - mem_malloc_start, "\n");
+	printf("Top:    ");
+	print_size(mem_malloc_brk - mem_malloc_start, "\n");
+	printf("In use: ");
+	print_size(info.uordblks, "\n");
+	printf("Free:   ");
+	print_size(info.fordblks, "\n");
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)) {
+		putc('\n');
+		malloc_slab_info();
+	}
+
+	return 0;
+}
+
+U_BOOT_LONGHELP(malloc,
+	"info - show heap usage and slab-cache statistics");
+
+U_BOOT_CMD_WITH_SUBCMDS(malloc, "malloc information", malloc_help_text,
+	U_BOOT_SUBCMD_MKENT(info, 1, 1, do_malloc_info));
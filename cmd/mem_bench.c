@@ -0,0 +1,422 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Memory bandwidth and latency benchmark
+ */
+
+#include <command.h>
+#include <console.h>
+#include <cpu_func.h>
+#include <getopt.h>
+#include <mapmem.h>
+#include <time.h>
+#include <vsprintf.h>
+#include <linux/kernel.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
+
+/* Distance between the loads of the pointer chase, at least a cache line */
+#define BENCH_STRIDE	64
+#define BENCH_MIN_SIZE	SZ_4K
+#define BENCH_TIME_MS	100
+
+enum bench_op {
+	BENCH_READ,
+	BENCH_WRITE,
+	BENCH_COPY,
+	BENCH_CHASE,
+	BENCH_KERN_COPY,
+	BENCH_KERN_SET,
+};
+
+/**
+ * struct bench_kernel - a memory copy and fill implementation
+ *
+ * @name: Name shown in the results
+ * @copy: memcpy()-like function
+ * @set: memset()-like function
+ */
+struct bench_kernel {
+	const char *name;
+	void *(*copy)(void *dest, const void *src, size_t count);
+	void *(*set)(void *s, int c, size_t count);
+};
+
+/**
+ * struct bench_ctx - state of a benchmark run
+ *
+ * @buf: Start of the test area, which is 2 * @size bytes long
+ * @size: Number of bytes handled by one pass
+ * @min_us: Minimum time to run each measurement for
+ * @kern: Kernel used for BENCH_KERN_COPY and BENCH_KERN_SET
+ */
+struct bench_ctx {
+	void *buf;
+	ulong size;
+	ulong min_us;
+	const struct bench_kernel *kern;
+};
+
+/* Stops the compiler from optimising away the loads */
+static volatile ulong bench_sink;
+
+static void *bench_copy_byte(void *dest, const void *src, size_t count)
+{
+	const u8 *s8 = src;
+	u8 *d8 = dest;
+
+	while (count--)
+		*d8++ = *s8++;
+
+	return dest;
+}
+
+static void *bench_set_byte(void *s, int c, size_t count)
+{
+	u8 *s8 = s;
+
+	while (count--)
+		*s8++ = c;
+
+	return s;
+}
+
+/* The algorithm used by the generic memcpy() in lib/string.c */
+static void *bench_copy_word(void *dest, const void *src, size_t count)
+{
+	ulong *dl = dest;
+	const ulong *sl = src;
+
+	if (!(((ulong)dest | (ulong)src) & (sizeof(ulong) - 1))) {
+		while (count >= sizeof(ulong)) {
+			*dl++ = *sl++;
+			count -= sizeof(ulong);
+		}
+	}
+	bench_copy_byte(dl, sl, count);
+
+	return dest;
+}
+
+/* The algorithm used by the generic memset() in lib/string.c */
+static void *bench_set_word(void *s, int c, size_t count)
+{
+	ulong *sl = s;
+	ulong cl = (u8)c * (~0UL / 0xff);
+
+	if (!((ulong)s & (sizeof(ulong) - 1))) {
+		while (count >= sizeof(ulong)) {
+			*sl++ = cl;
+			count -= sizeof(ulong);
+		}
+	}
+	bench_set_byte(sl, c, count);
+
+	return s;
+}
+
+/*
+ * Like the word kernels but with four independent words in flight per loop,
+ * which lets the CPU overlap the loads and stores
+ */
+static void *bench_copy_unroll(void *dest, const void *src, size_t count)
+{
+	ulong *dl = dest;
+	const ulong *sl = src;
+
+	if (!(((ulong)dest | (ulong)src) & (sizeof(ulong) - 1))) {
+		while (count >= 4 * sizeof(ulong)) {
+			ulong a = sl[0], b = sl[1], c = sl[2], d = sl[3];
+
+			dl[0] = a;
+			dl[1] = b;
+			dl[2] = c;
+			dl[3] = d;
+			dl += 4;
+			sl += 4;
+			count -= 4 * sizeof(ulong);
+		}
+	}
+
+	bench_copy_word(dl, sl, count);
+
+	return dest;
+}
+
+static void *bench_set_unroll(void *s, int c, size_t count)
+{
+	ulong *sl = s;
+	ulong cl = (u8)c * (~0UL / 0xff);
+
+	if (!((ulong)s & (sizeof(ulong) - 1))) {
+		while (count >= 4 * sizeof(ulong)) {
+			sl[0] = cl;
+			sl[1] = cl;
+			sl[2] = cl;
+			sl[3] = cl;
+			sl += 4;
+			count -= 4 * sizeof(ulong);
+		}
+	}
+
+	bench_set_word(sl, c, count);
+
+	return s;
+}
+
+static const struct bench_kernel bench_kernels[] = {
+	{ "byte", bench_copy_byte, bench_set_byte },
+	{ "word", bench_copy_word, bench_set_word },
+	{ "unroll", bench_copy_unroll, bench_set_unroll },
+#ifdef __HAVE_ARCH_MEMCPY
+	{ "arch", memcpy, memset },
+#else
+	{ "string", memcpy, memset },
+#endif
+};
+
+static ulong bench_read(const ulong *p, ulong size)
+{
+	const ulong *end = (void *)p + size;
+	ulong sum = 0;
+
+	for (; p < end; p += 4)
+		sum += p[0] + p[1] + p[2] + p[3];
+
+	return sum;
+}
+
+/*
+ * Link the BENCH_STRIDE slots of the first @size bytes into a single random
+ * cycle (Sattolo's algorithm), so that each load depends on the previous one
+ * and the hardware prefetchers cannot guess the next address
+ */
+static void *bench_chase_setup(void *buf, ulong size)
+{
+	ulong n = size / BENCH_STRIDE, i, j, tmp;
+	u32 seed = 0x2545f491;
+	ulong *slot;
+
+	for (i = 0; i < n; i++)
+		*(ulong *)(buf + i * BENCH_STRIDE) = i;
+	for (i = n - 1; i > 0; i--) {
+		seed = seed * 1103515245 + 12345;
+		j = (seed >> 8) % i;
+		slot = buf + i * BENCH_STRIDE;
+		tmp = *slot;
+		*slot = *(ulong *)(buf + j * BENCH_STRIDE);
+		*(ulong *)(buf + j * BENCH_STRIDE) = tmp;
+	}
+	for (i = 0; i < n; i++) {
+		slot = buf + i * BENCH_STRIDE;
+		*slot = (ulong)buf + *slot * BENCH_STRIDE;
+	}
+
+	return buf;
+}
+
+static void *bench_chase(void *p, ulong hops)
+{
+	while (hops--)
+		p = *(void **)p;
+
+	return p;
+}
+
+static void bench_pass(struct bench_ctx *ctx, enum bench_op op)
+{
+	void *dst = ctx->buf + ctx->size;
+
+	switch (op) {
+	case BENCH_READ:
+		bench_sink += bench_read(ctx->buf, ctx->size);
+		break;
+	case BENCH_WRITE:
+		memset(ctx->buf, 0xa5, ctx->size);
+		break;
+	case BENCH_COPY:
+		memcpy(dst, ctx->buf, ctx->size);
+		break;
+	case BENCH_CHASE:
+		bench_sink = (ulong)bench_chase(ctx->buf,
+						ctx->size / BENCH_STRIDE);
+		break;
+	case BENCH_KERN_COPY:
+		ctx->kern->copy(dst, ctx->buf, ctx->size);
+		break;
+	case BENCH_KERN_SET:
+		ctx->kern->set(ctx->buf, 0x5a, ctx->size);
+		break;
+	}
+}
+
+/**
+ * bench_measure() - time an operation
+ *
+ * The operation is repeated over the whole buffer until at least
+ * @ctx->min_us microseconds have passed.
+ *
+ * @ctx: Benchmark state
+ * @op: Operation to measure
+ * @passesp: Returns the number of passes made
+ * Return: time taken in microseconds, at least 1
+ */
+static ulong bench_measure(struct bench_ctx *ctx, enum bench_op op,
+			   ulong *passesp)
+{
+	ulong start, us, passes = 0;
+
+	/* warm up so that a cached run does not include the first misses */
+	bench_pass(ctx, op);
+	start = timer_get_us();
+	do {
+		bench_pass(ctx, op);
+		passes++;
+		us = timer_get_us() - start;
+	} while (us < ctx->min_us);
+	*passesp = passes;
+
+	return max(us, 1UL);
+}
+
+/* Return the bandwidth of an operation in MB/s */
+static ulong bench_rate(struct bench_ctx *ctx, enum bench_op op)
+{
+	ulong passes, us;
+
+	us = bench_measure(ctx, op, &passes);
+
+	return div_u64((u64)ctx->size * passes, us);
+}
+
+static void bench_show_size(ulong size)
+{
+	char buf[16];
+
+	if (!(size % SZ_1M))
+		snprintf(buf, sizeof(buf), "%lu MiB", size / SZ_1M);
+	else if (!(size % SZ_1K))
+		snprintf(buf, sizeof(buf), "%lu KiB", size / SZ_1K);
+	else
+		snprintf(buf, sizeof(buf), "%lu B", size);
+	printf("%9s", buf);
+}
+
+static void bench_memory(struct bench_ctx *ctx)
+{
+	ulong passes, us, tenths;
+	u64 hops;
+
+	bench_show_size(ctx->size);
+	printf(" %10lu", bench_rate(ctx, BENCH_READ));
+	printf(" %10lu", bench_rate(ctx, BENCH_WRITE));
+	printf(" %10lu", bench_rate(ctx, BENCH_COPY));
+
+	bench_chase_setup(ctx->buf, ctx->size);
+	us = bench_measure(ctx, BENCH_CHASE, &passes);
+	hops = (u64)ctx->size / BENCH_STRIDE * passes;
+	tenths = div64_u64((u64)us * 10000, hops);
+	printf(" %8lu.%lu\n", tenths / 10, tenths % 10);
+}
+
+static void bench_kernels_show(struct bench_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bench_kernels); i++) {
+		ctx->kern = &bench_kernels[i];
+		if (i)
+			printf("%9s", "");
+		else
+			bench_show_size(ctx->size);
+		printf("  %-8s %10lu %10lu\n", ctx->kern->name,
+		       bench_rate(ctx, BENCH_KERN_COPY),
+		       bench_rate(ctx, BENCH_KERN_SET));
+	}
+}
+
+static int do_mem_bench(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	struct bench_ctx ctx = { .min_us = BENCH_TIME_MS * 1000 };
+	ulong addr, size, min_size = BENCH_MIN_SIZE;
+	bool uncached = false, kernels = false;
+	struct getopt_state gs;
+	int dcache, opt, ret = CMD_RET_SUCCESS;
+
+	getopt_init_state(&gs);
+	while ((opt = getopt(&gs, argc, argv, "ukt:")) > 0) {
+		switch (opt) {
+		case 'u':
+			uncached = true;
+			break;
+		case 'k':
+			kernels = true;
+			break;
+		case 't':
+			ctx.min_us = dectoul(gs.arg, NULL) * 1000;
+			break;
+		default:
+			return CMD_RET_USAGE;
+		}
+	}
+	argc -= gs.index;
+	argv += gs.index;
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	addr = hextoul(argv[0], NULL);
+	size = rounddown(hextoul(argv[1], NULL), BENCH_STRIDE);
+	if (argc > 2)
+		min_size = hextoul(argv[2], NULL);
+	min_size = max(rounddown(min(min_size, size), BENCH_STRIDE),
+		       (ulong)BENCH_STRIDE);
+	if (!size || !IS_ALIGNED(addr, sizeof(ulong))) {
+		printf("Invalid address or size\n");
+		return CMD_RET_FAILURE;
+	}
+
+	dcache = dcache_status();
+	if (uncached && dcache)
+		dcache_disable();
+
+	ctx.buf = map_sysmem(addr, size * 2);
+	printf("Benchmarking %lx bytes at %lx, data cache %s\n", size * 2,
+	       addr, dcache_status() ? "on" : "off");
+	if (kernels)
+		printf("%9s  %-8s %10s %10s\n", "size", "kernel", "copy MB/s",
+		       "set MB/s");
+	else
+		printf("%9s %10s %10s %10s %10s\n", "size", "read MB/s",
+		       "write MB/s", "copy MB/s", "latency ns");
+
+	for (ctx.size = min_size;; ctx.size = min(ctx.size * 2, size)) {
+		if (ctrlc()) {
+			ret = CMD_RET_FAILURE;
+			break;
+		}
+		if (kernels)
+			bench_kernels_show(&ctx);
+		else
+			bench_memory(&ctx);
+		if (ctx.size == size)
+			break;
+	}
+	unmap_sysmem(ctx.buf);
+
+	if (uncached && dcache)
+		dcache_enable();
+
+	return ret;
+}
+
+U_BOOT_LONGHELP(mem,
+	"bench [-u] [-k] [-t <ms>] <addr> <size> [<minsize>]\n"
+	"    - measure read, write and copy bandwidth and load latency over\n"
+	"      2 x <size> bytes at <addr>, for sizes doubling from <minsize>\n"
+	"      (default 1000) up to <size>\n"
+	"      -u  run with the data cache disabled\n"
+	"      -k  compare the copy and fill implementations instead\n"
+	"      -t  minimum time for each measurement (default 100 ms)");
+
+U_BOOT_CMD_WITH_SUBCMDS(mem, "memory utilities", mem_help_text,
+	U_BOOT_SUBCMD_MKENT(bench, 9, 0, do_mem_bench));
@@ -9,6 +9,7 @@
 #include <dm/uclass.h>
 #include <net.h>
 #include <linux/compat.h>
+#include <linux/math64.h>
 #include <linux/ethtool.h>
 
 static int do_net_list(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
@@ -26,6 +27,30 @@ static int do_net_list(struct cmd_tbl *cmdtp, int flag, int argc, char *const ar
 	return CMD_RET_SUCCESS;
 }
 
+static void show_net_stats(void)
+{
+	const struct net_stats *st = &net_stats;
+
+	printf("polls:          %lu\n", st->polls);
+	printf("rx packets:     %lu", st->rx_packets);
+	if (st->polls)
+		printf(" (%lu.%02lu per poll)",
+		       st->rx_packets / st->polls,
+		       st->rx_packets * 100 / st->polls % 100);
+	printf("\n");
+	printf("largest batch:  %u\n", st->rx_max_batch);
+	printf("full batches:   %lu\n", st->rx_full);
+	printf("rx budget:      %u\n", st->rx_budget);
+	printf("rx errors:      %lu\n", st->rx_errors);
+	printf("rx dropped:     %lu\n", st->rx_dropped);
+	printf("loops:          %lu\n", st->loops);
+	printf("loop time:      %llu us", st->loop_us);
+	if (st->loops)
+		printf(" (%llu us avg, %lu us max)",
+		       div_u64(st->loop_us, st->loops), st->loop_max_us);
+	printf("\n");
+}
+
 static int do_net_stats(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 {
 	int nstats, err, i, off;
@@ -33,8 +58,10 @@ static int do_net_stats(struct cmd_tbl *cmdtp, int flag, int argc, char *const a
 	u64 *values;
 	u8 *strings;
 
-	if (argc < 2)
-		return CMD_RET_USAGE;
+	if (argc < 2) {
+		show_net_stats();
+		return CMD_RET_SUCCESS;
+	}
 
 	err = uclass_get_device_by_name(UCLASS_ETH, argv[1], &dev);
 	if (err) {
@@ -103,4 +130,5 @@ static int do_net(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 
 U_BOOT_CMD(net, 3, 1, do_net, "NET sub-system",
 	   "list - list available devices\n"
-	   "stats <device> - dump statistics for specified device\n");
+	   "stats [<device>] - dump statistics for specified device, or for\n"
+	   "    packet reception if none is given\n");
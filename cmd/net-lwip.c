@@ -27,9 +27,13 @@ U_BOOT_CMD(dns, 3, 1, do_dns, "lookup the IP of a hostname",
 #endif
 
 #if defined(CONFIG_CMD_WGET)
-U_BOOT_CMD(wget, 3, 1, do_wget,
+U_BOOT_CMD(wget, CONFIG_SYS_MAXARGS, 1, do_wget,
 	   "boot image via network using HTTP/HTTPS protocol",
 	   "[loadAddress] url\n"
-	   "wget [loadAddress] [host:]path"
+	   "wget [loadAddress] [host:]path\n"
+	   "wget -j connections [loadAddress] url\n"
+	   "    - fetch url as byte ranges on several connections\n"
+	   "wget loadAddress url loadAddress url [...]\n"
+	   "    - fetch files from one server over a single connection"
 );
 #endif
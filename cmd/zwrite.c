@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Write a compressed image to a block device
+ */
+
+#include <blk.h>
+#include <command.h>
+#include <display_options.h>
+#include <image.h>
+#include <mapmem.h>
+#include <part.h>
+#include <vsprintf.h>
+#include <zwrite.h>
+#include <linux/math64.h>
+#include <linux/sizes.h>
+
+static int do_zwrite(struct cmd_tbl *cmdtp, int flag, int argc,
+		     char *const argv[])
+{
+	struct zwrite_stats stats;
+	struct blk_desc *desc;
+	ulong addr, len, wbuf = SZ_1M, offs = 0;
+	uint flags = 0;
+	void *buf;
+	int ret;
+
+	while (argc > 1 && *argv[1] == '-') {
+		if (!strcmp(argv[1], "-s"))
+			flags |= ZWRITE_ZERO_SKIP;
+		else if (!strcmp(argv[1], "-e"))
+			flags |= ZWRITE_ZERO_ERASE;
+		else
+			return CMD_RET_USAGE;
+		argc--;
+		argv++;
+	}
+	if (argc < 5)
+		return CMD_RET_USAGE;
+
+	if (blk_get_device_by_str(argv[1], argv[2], &desc) < 0)
+		return CMD_RET_FAILURE;
+	addr = hextoul(argv[3], NULL);
+	len = hextoul(argv[4], NULL);
+	if (argc > 5)
+		wbuf = hextoul(argv[5], NULL);
+	if (argc > 6)
+		offs = hextoul(argv[6], NULL);
+
+	buf = map_sysmem(addr, len);
+	ret = zwrite(buf, len, desc, wbuf, offs, flags, &stats);
+	unmap_sysmem(buf);
+	if (ret) {
+		printf("zwrite failed (err=%d) after %llu bytes\n", ret,
+		       stats.out_size);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("%s: %llu bytes from %llu, " LBAF " blocks written",
+	       genimg_get_comp_short_name(stats.comp), stats.out_size,
+	       stats.in_size, stats.blks_written);
+	if (flags)
+		printf(", " LBAF " zero blocks %s", stats.blks_zero,
+		       flags & ZWRITE_ZERO_SKIP ? "skipped" : "erased");
+	puts("\n");
+	printf("%llu bytes written in %lu ms", stats.out_size, stats.time_ms);
+	if (stats.time_ms > 0) {
+		puts(" (");
+		print_size(div_u64(stats.out_size, stats.time_ms) * 1000, "/s");
+		puts(")");
+	}
+	puts("\n");
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	zwrite, 9, 0, do_zwrite,
+	"decompress an image and write it to a block device",
+	"[-s | -e] <interface> <dev> <addr> <len> [wbuf=100000 [offs=0]]\n"
+	"  - decompress the gzip, zstd, lzma or lz4 image at <addr> and write\n"
+	"    it to the device in chunks of <wbuf> bytes, starting at byte\n"
+	"    offset <offs> (all values in hex)\n"
+	"  -s  skip all-zero blocks (the target already reads as zero)\n"
+	"  -e  erase all-zero blocks instead of writing them"
+);
@@ -61,6 +61,7 @@ static struct tag_name {
 	{ BLOBLISTT_U_BOOT_SPL_HANDOFF, "SPL hand-off" },
 	{ BLOBLISTT_VBE, "VBE" },
 	{ BLOBLISTT_U_BOOT_VIDEO, "SPL video handoff" },
+	{ BLOBLISTT_U_BOOT_LOG, "Binary log" },
 
 	/* BLOBLISTT_VENDOR_AREA */
 };
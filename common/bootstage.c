@@ -24,6 +24,10 @@ DECLARE_GLOBAL_DATA_PTR;
 
 enum {
 	RECORD_COUNT = CONFIG_VAL(BOOTSTAGE_RECORD_COUNT),
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+	TIMING_COUNT = CONFIG_BOOTSTAGE_TIMING_COUNT,
+	TIMING_DEPTH = 16,	/* maximum nesting tracked for self time */
+#endif
 };
 
 struct bootstage_record {
@@ -34,10 +38,43 @@ struct bootstage_record {
 	enum bootstage_id id;
 };
 
+/* Flags for each timing record */
+enum bootstage_timing_flags {
+	BOOTSTAGE_TIMINGF_DONE	= 1 << 0,	/* Timing is complete */
+};
+
+/**
+ * struct bootstage_timing - timing of a single initcall or device probe
+ *
+ * @start_us: Time when this started
+ * @time_us: Total time taken, including nested records
+ * @self_us: Time taken excluding nested records. Until the record is done,
+ *	this holds the total time of the nested records
+ * @type: Type of record (enum bootstage_timing_t)
+ * @depth: Nesting depth, 0 for the outermost records
+ * @flags: Flags (enum bootstage_timing_flags)
+ * @name: Name of the record
+ */
+struct bootstage_timing {
+	u32 start_us;
+	u32 time_us;
+	u32 self_us;
+	u8 type;
+	u8 depth;
+	u8 flags;
+	char name[25];
+};
+
 struct bootstage_data {
 	uint rec_count;
 	uint next_id;
 	struct bootstage_record record[RECORD_COUNT];
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+	uint timing_count;	/* number of records, including any not stored */
+	uint timing_depth;	/* current nesting depth */
+	int timing_stack[TIMING_DEPTH];	/* record at each depth */
+	struct bootstage_timing timing[TIMING_COUNT];
+#endif
 };
 
 enum {
@@ -220,6 +257,143 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+/**
+ * timing_can_start() - Check whether the boot timer can be read yet
+ *
+ * With driver model, timer_get_boot_us() may probe the timer, which would
+ * come back here and recurse, so wait until the timer is set up.
+ *
+ * Return: true if timer_get_boot_us() can be used
+ */
+static bool timing_can_start(void)
+{
+#if CONFIG_IS_ENABLED(TIMER)
+	return gd->timer;
+#else
+	return true;
+#endif
+}
+
+int bootstage_timing_start(enum bootstage_timing_t type, const char *name)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_timing *tim;
+	int rec;
+
+	if (!data)
+		return -ENOENT;
+	if (!timing_can_start())
+		return -EAGAIN;
+	rec = data->timing_count++;
+	if (rec >= TIMING_COUNT)
+		return -ENOSPC;
+
+	tim = &data->timing[rec];
+	strlcpy(tim->name, name, sizeof(tim->name));
+	tim->type = type;
+	tim->depth = min_t(uint, data->timing_depth, U8_MAX);
+	tim->flags = 0;
+	tim->time_us = 0;
+	tim->self_us = 0;
+	if (data->timing_depth < TIMING_DEPTH)
+		data->timing_stack[data->timing_depth] = rec;
+	data->timing_depth++;
+	tim->start_us = timer_get_boot_us();
+
+	return rec;
+}
+
+void bootstage_timing_end(int rec)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_timing *tim;
+	uint depth;
+
+	if (!data || rec < 0 || rec >= TIMING_COUNT)
+		return;
+	tim = &data->timing[rec];
+	tim->time_us = timer_get_boot_us() - tim->start_us;
+	tim->self_us = tim->time_us - min(tim->self_us, tim->time_us);
+	tim->flags |= BOOTSTAGE_TIMINGF_DONE;
+
+	/*
+	 * Go back to this record's depth, even if something nested inside it
+	 * did not finish, then charge our time to the parent
+	 */
+	depth = tim->depth;
+	data->timing_depth = depth;
+	if (depth && depth <= TIMING_DEPTH)
+		data->timing[data->timing_stack[depth - 1]].self_us +=
+			tim->time_us;
+}
+
+void bootstage_timing_clear(void)
+{
+	struct bootstage_data *data = gd->bootstage;
+
+	if (!data)
+		return;
+	data->timing_count = 0;
+	data->timing_depth = 0;
+}
+
+static int h_cmp_timing(const void *v1, const void *v2)
+{
+	const struct bootstage_timing *tim1 = *(struct bootstage_timing **)v1;
+	const struct bootstage_timing *tim2 = *(struct bootstage_timing **)v2;
+
+	if (tim1->self_us != tim2->self_us)
+		return tim1->self_us < tim2->self_us ? 1 : -1;
+
+	return tim1 < tim2 ? -1 : 1;
+}
+
+void bootstage_timing_report(uint types)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_timing **list;
+	ulong total = 0;
+	int count, i, n;
+
+	if (!data) {
+		printf("Bootstage not available\n");
+		return;
+	}
+	count = min_t(uint, data->timing_count, TIMING_COUNT);
+	list = calloc(count, sizeof(*list));
+	if (count && !list) {
+		printf("Out of memory\n");
+		return;
+	}
+	for (i = 0, n = 0; i < count; i++) {
+		struct bootstage_timing *tim = &data->timing[i];
+
+		if ((types & BIT(tim->type)) &&
+		    (tim->flags & BOOTSTAGE_TIMINGF_DONE)) {
+			list[n++] = tim;
+			total += tim->self_us;
+		}
+	}
+	qsort(list, n, sizeof(*list), h_cmp_timing);
+
+	printf("Timing in microseconds (%d records):\n", n);
+	printf("%11s%11s  %s\n", "Self", "Total", "Name");
+	for (i = 0; i < n; i++) {
+		print_grouped_ull(list[i]->self_us, BOOTSTAGE_DIGITS);
+		print_grouped_ull(list[i]->time_us, BOOTSTAGE_DIGITS);
+		printf("  %s\n", list[i]->name);
+	}
+	print_grouped_ull(total, BOOTSTAGE_DIGITS);
+	printf("%11s  (total)\n", "");
+	if (data->timing_count > TIMING_COUNT)
+		printf("Overflowed timing table by %d entries\n"
+		       "Please increase CONFIG_BOOTSTAGE_TIMING_COUNT\n",
+		       data->timing_count - TIMING_COUNT);
+	free(list);
+}
+#endif /* BOOTSTAGE_TIMING */
+
 /**
  * Get a record name as a printable string
  *
@@ -260,6 +434,54 @@ static uint32_t print_time_record(struct bootstage_record *rec, uint32_t prev)
 }
 
 #ifdef CONFIG_OF_LIBFDT
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+/**
+ * add_timing_devicetree() - Add the timing records to a device tree
+ *
+ * Each record becomes a subnode of a 'timing' node, with properties for the
+ * name, type, start time, total time, self time and nesting depth
+ *
+ * @blob: Device tree blob
+ * @parent: Offset of the bootstage node
+ * Return: 0 on success, -EINVAL on failure
+ */
+static int add_timing_devicetree(struct fdt_header *blob, int parent)
+{
+	static const char *const type_name[BOOTSTAGE_TIMING_COUNT] = {
+		"initcall", "event", "probe",
+	};
+	struct bootstage_data *data = gd->bootstage;
+	int timing;
+	int i;
+
+	timing = fdt_add_subnode(blob, parent, "timing");
+	if (timing < 0)
+		return -EINVAL;
+
+	/* Add in reverse order, as above */
+	for (i = min_t(uint, data->timing_count, TIMING_COUNT) - 1; i >= 0;
+	     i--) {
+		struct bootstage_timing *tim = &data->timing[i];
+		int node;
+
+		if (!(tim->flags & BOOTSTAGE_TIMINGF_DONE))
+			continue;
+		node = fdt_add_subnode(blob, timing, simple_itoa(i));
+		if (node < 0 ||
+		    fdt_setprop_string(blob, node, "name", tim->name) ||
+		    fdt_setprop_string(blob, node, "type",
+				       type_name[tim->type]) ||
+		    fdt_setprop_u32(blob, node, "start", tim->start_us) ||
+		    fdt_setprop_u32(blob, node, "total", tim->time_us) ||
+		    fdt_setprop_u32(blob, node, "self", tim->self_us) ||
+		    fdt_setprop_u32(blob, node, "depth", tim->depth))
+			return -EINVAL;
+	}
+
+	return 0;
+}
+#endif
+
 /**
  * Add all bootstage timings to a device tree.
  *
@@ -312,7 +534,11 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 			return -EINVAL;
 	}
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+	return add_timing_devicetree(blob, bootstage);
+#else
 	return 0;
+#endif
 }
 
 int bootstage_fdt_add_report(void)
@@ -83,6 +83,8 @@
 #include <cli.h>
 #include <cli_hush.h>
 #include <command.h>        /* find_cmd */
+#include <env_internal.h>
+#include <search.h>
 #include <asm/global_data.h>
 #endif
 #ifndef __U_BOOT__
@@ -306,6 +308,49 @@ static int do_repeat = 0;
 static struct variables *top_vars = NULL ;
 #endif /*__U_BOOT__ */
 
+#if CONFIG_IS_ENABLED(HUSH_PARSE_CACHE)
+/**
+ * struct parse_cache_entry - A parsed script kept so it can be run again
+ *
+ * @text: Script text, or NULL if this entry is not in use
+ * @hash: Hash of @text, to speed up lookups
+ * @flag: Parse flags (FLAG_...) used, since these affect the result
+ * @list: Parsed list
+ * @busy: Number of runs of this list currently in progress. A busy list must
+ *	not be freed, nor run again by recursion, since running a 'for' loop
+ *	updates the list as it goes
+ * @last_used: Value of parse_cache_seq when this entry was last run
+ */
+struct parse_cache_entry {
+	char *text;
+	uint hash;
+	int flag;
+	struct pipe *list;
+	int busy;
+	uint last_used;
+};
+
+/**
+ * struct var_cache_entry - A remembered environment-variable lookup
+ *
+ * @name: Variable name, empty if this entry is not in use
+ * @value: Value of the variable, NULL if it is not set
+ * @change_count: Value of env_htab.change_count when @value was looked up
+ */
+struct var_cache_entry {
+	char name[32];
+	char *value;
+	uint change_count;
+};
+
+#define VAR_CACHE_SIZE	32
+
+static struct parse_cache_entry parse_cache[CONFIG_HUSH_PARSE_CACHE_SIZE];
+static struct var_cache_entry var_cache[VAR_CACHE_SIZE];
+static uint parse_cache_seq;
+static bool parse_cache_disabled;
+#endif
+
 #define B_CHUNK (100)
 #define B_NOSPAC 1
 
@@ -1535,6 +1580,7 @@ static int run_pipe_real(struct pipe *pi)
 	struct child_prog *child;
 	struct built_in_command *x;
 	char *p;
+	int sp;
 # if __GNUC__
 	/* Avoid longjmp clobbering */
 	(void) &i;
@@ -1547,6 +1593,7 @@ static int run_pipe_real(struct pipe *pi)
 	int flag = do_repeat ? CMD_FLAG_REPEAT : 0;
 	struct child_prog *child;
 	char *p;
+	int sp;
 # if __GNUC__
 	/* Avoid longjmp clobbering */
 	(void) &i;
@@ -1613,6 +1660,8 @@ static int run_pipe_real(struct pipe *pi)
 			}
 			return EXIT_SUCCESS;   /* don't worry about errors in set_local_var() yet */
 		}
+		/* keep the list intact, so that it can be run again */
+		sp = child->sp;
 		for (i = 0; is_assignment(child->argv[i]); i++) {
 			p = insert_var_value(child->argv[i]);
 #ifndef __U_BOOT__
@@ -1621,11 +1670,11 @@ static int run_pipe_real(struct pipe *pi)
 			set_local_var(p, 0);
 #endif
 			if (p != child->argv[i]) {
-				child->sp--;
+				sp--;
 				free(p);
 			}
 		}
-		if (child->sp) {
+		if (sp) {
 			char * str = NULL;
 
 			str = make_string(child->argv + i,
@@ -1757,6 +1806,7 @@ static int run_list_real(struct pipe *pi)
 	char *save_name = NULL;
 	char **list = NULL;
 	char **save_list = NULL;
+	struct pipe *for_pipe = NULL;
 	struct pipe *rpipe;
 	int flag_rep = 0;
 #ifndef __U_BOOT__
@@ -1796,7 +1846,8 @@ static int run_list_real(struct pipe *pi)
 				/* check Ctrl-C */
 				ctrlc();
 				if ((had_ctrlc())) {
-					return 1;
+					rcode = 1;
+					goto out;
 				}
 #endif
 				flag_restore = 0;
@@ -1826,6 +1877,7 @@ static int run_list_real(struct pipe *pi)
 					pi->progs->argv[0]);
 				save_list = list;
 				save_name = pi->progs->argv[0];
+				for_pipe = pi;
 				pi->progs->argv[0] = NULL;
 				flag_rep = 1;
 			}
@@ -1895,7 +1947,8 @@ static int run_list_real(struct pipe *pi)
 #else
 		if (rcode < -1) {
 			last_return_code = -rcode - 2;
-			return -2;	/* exit */
+			rcode = -2;	/* exit */
+			goto out;
 		}
 		last_return_code = rcode;
 #endif
@@ -1915,6 +1968,17 @@ static int run_list_real(struct pipe *pi)
 		checkjobs(NULL);
 #endif
 	}
+#ifdef __U_BOOT__
+out:
+	/* if we left a 'for' loop early, put its variable name back */
+	if (list) {
+		free(for_pipe->progs->argv[0]);
+		while (*list)
+			free(*list++);
+		free(save_list);
+		for_pipe->progs->argv[0] = save_name;
+	}
+#endif
 	return rcode;
 }
 
@@ -2754,6 +2818,33 @@ static int parse_group(o_string *dest, struct p_context *ctx,
 }
 #endif
 
+#if CONFIG_IS_ENABLED(HUSH_PARSE_CACHE)
+/*
+ * Look up an environment variable, remembering the result until the
+ * environment next changes. The slot is selected by the address of the name,
+ * which does not change while a cached list is run, so there is no need to
+ * hash the name on each lookup.
+ */
+static char *env_get_cached(const char *name)
+{
+	struct var_cache_entry *ent;
+
+	if (parse_cache_disabled || !(gd->flags & GD_FLG_ENV_READY) ||
+	    strlen(name) >= sizeof(ent->name))
+		return env_get(name);
+
+	ent = &var_cache[(ulong)name % VAR_CACHE_SIZE];
+	if (!*ent->name || ent->change_count != env_htab.change_count ||
+	    strcmp(ent->name, name)) {
+		strcpy(ent->name, name);
+		ent->value = env_get(name);
+		ent->change_count = env_htab.change_count;
+	}
+
+	return ent->value;
+}
+#endif
+
 /* basically useful version until someone wants to get fancier,
  * see the bash man page under "Parameter Expansion" */
 static char *lookup_param(char *src)
@@ -2783,7 +2874,11 @@ static char *lookup_param(char *src)
 		}
 	}
 
+#if CONFIG_IS_ENABLED(HUSH_PARSE_CACHE)
+	p = env_get_cached(src);
+#else
 	p = env_get(src);
+#endif
 	if (!p)
 		p = get_local_var(src);
 
@@ -3251,6 +3346,175 @@ static int parse_stream_outer(struct in_str *inp, int flag)
 #endif /* __U_BOOT__ */
 }
 
+#if CONFIG_IS_ENABLED(HUSH_PARSE_CACHE)
+static uint parse_cache_hash(const char *s)
+{
+	uint hash = 0;
+
+	while (*s)
+		hash = hash * 31 + *s++;
+
+	return hash;
+}
+
+static void parse_cache_drop(struct parse_cache_entry *ent)
+{
+	free_pipe_list(ent->list, 0);
+	free(ent->text);
+	ent->text = NULL;
+	ent->list = NULL;
+}
+
+static struct parse_cache_entry *parse_cache_find(const char *s, uint hash,
+						  int flag)
+{
+	struct parse_cache_entry *ent;
+
+	for (ent = parse_cache; ent < parse_cache + ARRAY_SIZE(parse_cache);
+	     ent++) {
+		if (ent->text && ent->hash == hash && ent->flag == flag &&
+		    !strcmp(ent->text, s))
+			return ent;
+	}
+
+	return NULL;
+}
+
+/* Find a free entry, dropping the least recently used one if needed */
+static struct parse_cache_entry *parse_cache_alloc(void)
+{
+	struct parse_cache_entry *ent, *lru = NULL;
+
+	for (ent = parse_cache; ent < parse_cache + ARRAY_SIZE(parse_cache);
+	     ent++) {
+		if (!ent->text)
+			return ent;
+		if (!ent->busy &&
+		    (!lru || (int)(ent->last_used - lru->last_used) < 0))
+			lru = ent;
+	}
+	if (lru)
+		parse_cache_drop(lru);
+
+	return lru;
+}
+
+/*
+ * Parse the first list in a string, without running it. This does the same
+ * as parse_stream_outer() with FLAG_EXIT_FROM_LOOP. Returns NULL on error.
+ */
+static struct pipe *parse_string_list(const char *s, int flag)
+{
+	struct in_str input;
+	struct p_context ctx;
+	o_string temp = NULL_O_STRING;
+	char *p = NULL;
+	int rcode;
+
+	if (!(p = strchr(s, '\n')) || *++p) {
+		p = xmalloc(strlen(s) + 2);
+		strcpy(p, s);
+		strcat(p, "\n");
+		s = p;
+	} else {
+		p = NULL;
+	}
+	setup_string_in_str(&input, s);
+
+	ctx.type = flag;
+	initialize_context(&ctx);
+	update_ifs_map();
+	if (!(flag & FLAG_PARSE_SEMICOLON) || (flag & FLAG_REPARSING))
+		mapset((uchar *)";$&|", 0);
+	rcode = parse_stream(&temp, &ctx, &input,
+			     flag & FLAG_CONT_ON_NEWLINE ? -1 : '\n');
+	if (rcode != 1 && ctx.old_flag != 0)
+		syntax();
+	if (rcode != 1 && ctx.old_flag == 0) {
+		done_word(&temp, &ctx);
+		done_pipe(&ctx, PIPE_SEQ);
+	} else {
+		if (ctx.old_flag != 0)
+			free(ctx.stack);
+		if (input.__promptme == 0)
+			printf("<INTERRUPT>\n");
+		free_pipe_list(ctx.list_head, 0);
+		ctx.list_head = NULL;
+		flag_repeat = 0;
+	}
+	b_free(&temp);
+	free(p);
+
+	return ctx.list_head;
+}
+
+/*
+ * Run a string, using the cached list if it has been parsed before. A string
+ * which is already running (e.g. a variable which runs itself) is parsed
+ * again, since its list cannot be run twice at once.
+ */
+static int parse_string_cached(const char *s, int flag)
+{
+	struct parse_cache_entry *ent;
+	struct pipe *list;
+	uint hash;
+	int code;
+
+	hash = parse_cache_hash(s);
+	ent = parse_cache_find(s, hash, flag);
+	if (!ent) {
+		list = parse_string_list(s, flag);
+		if (!list)
+			return 1;
+		ent = parse_cache_alloc();
+		if (ent) {
+			ent->text = strdup(s);
+			if (!ent->text)
+				ent = NULL;
+		}
+		if (ent) {
+			ent->hash = hash;
+			ent->flag = flag;
+			ent->list = list;
+		} else {
+			code = run_list(list);
+		}
+	} else if (ent->busy) {
+		list = parse_string_list(s, flag);
+		if (!list)
+			return 1;
+		code = run_list(list);
+		ent = NULL;
+	}
+	if (ent) {
+		ent->busy++;
+		ent->last_used = ++parse_cache_seq;
+		code = run_list_real(ent->list);
+		ent->busy--;
+	}
+
+	if (code == -2)		/* exit */
+		return last_return_code;
+	if (code == -1)
+		flag_repeat = 0;
+
+	return code != 0;
+}
+
+void hush_parse_cache_enable(bool enable)
+{
+	struct parse_cache_entry *ent;
+
+	for (ent = parse_cache; ent < parse_cache + ARRAY_SIZE(parse_cache);
+	     ent++) {
+		if (ent->text && !ent->busy)
+			parse_cache_drop(ent);
+	}
+	memset(var_cache, '\0', sizeof(var_cache));
+	parse_cache_disabled = !enable;
+}
+#endif /* HUSH_PARSE_CACHE */
+
 #ifndef __U_BOOT__
 static int parse_string_outer(const char *s, int flag)
 #else
@@ -3265,6 +3529,10 @@ int parse_string_outer(const char *s, int flag)
 		return 1;
 	if (!*s)
 		return 0;
+#if CONFIG_IS_ENABLED(HUSH_PARSE_CACHE)
+	if ((flag & FLAG_EXIT_FROM_LOOP) && !parse_cache_disabled)
+		return parse_string_cached(s, flag);
+#endif
 	if (!(p = strchr(s, '\n')) || *++p) {
 		p = xmalloc(strlen(s) + 2);
 		strcpy(p, s);
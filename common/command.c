@@ -15,10 +15,13 @@
 #include <env.h>
 #include <image.h>
 #include <log.h>
+#include <malloc.h>
 #include <mapmem.h>
+#include <sort.h>
 #include <time.h>
 #include <asm/global_data.h>
 #include <linux/ctype.h>
+#include <linux/log2.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -126,10 +129,118 @@ struct cmd_tbl *find_cmd_tbl(const char *cmd, struct cmd_tbl *table,
 	return NULL;	/* not found or ambiguous command */
 }
 
+#if CONFIG_IS_ENABLED(CMDLINE_HASH)
+/*
+ * Index of the command linker list: a hash table for exact matches, with
+ * linear probing, and the commands sorted by name, for abbreviations. Only
+ * built after relocation, since it is kept in BSS.
+ */
+static struct cmd_tbl **cmd_hash_table;
+static struct cmd_tbl **cmd_sorted;
+static int cmd_sorted_count;
+static uint cmd_hash_mask;
+
+static uint cmd_hash(const char *name, int len)
+{
+	uint hash = 0;
+
+	while (len--)
+		hash = hash * 31 + *name++;
+
+	return hash;
+}
+
+static int h_cmp_cmd(const void *v1, const void *v2)
+{
+	const struct cmd_tbl *const *cmd1 = v1, *const *cmd2 = v2;
+
+	return strcmp((*cmd1)->name, (*cmd2)->name);
+}
+
+static int cmd_index_build(struct cmd_tbl *table, int count)
+{
+	uint size, slot;
+	int i;
+
+	size = __roundup_pow_of_two(count * 2);
+	cmd_hash_table = calloc(size, sizeof(*cmd_hash_table));
+	cmd_sorted = malloc(count * sizeof(*cmd_sorted));
+	if (!cmd_hash_table || !cmd_sorted) {
+		free(cmd_hash_table);
+		free(cmd_sorted);
+		cmd_hash_table = NULL;
+		return -ENOMEM;
+	}
+	cmd_hash_mask = size - 1;
+
+	for (i = 0; i < count; i++) {
+		struct cmd_tbl *cmdtp = &table[i];
+
+		slot = cmd_hash(cmdtp->name, strlen(cmdtp->name)) &
+			cmd_hash_mask;
+		while (cmd_hash_table[slot])
+			slot = (slot + 1) & cmd_hash_mask;
+		cmd_hash_table[slot] = cmdtp;
+		cmd_sorted[i] = cmdtp;
+	}
+	qsort(cmd_sorted, count, sizeof(*cmd_sorted), h_cmp_cmd);
+	cmd_sorted_count = count;
+
+	return 0;
+}
+
+/* Same as find_cmd_tbl(), but using the index */
+static struct cmd_tbl *find_cmd_index(const char *cmd)
+{
+	struct cmd_tbl *cmdtp;
+	int len, low, high;
+	const char *p;
+	uint slot;
+
+	if (!cmd)
+		return NULL;
+	len = ((p = strchr(cmd, '.')) == NULL) ? strlen(cmd) : (p - cmd);
+
+	slot = cmd_hash(cmd, len) & cmd_hash_mask;
+	for (; (cmdtp = cmd_hash_table[slot]);
+	     slot = (slot + 1) & cmd_hash_mask) {
+		if (!strncmp(cmd, cmdtp->name, len) && !cmdtp->name[len])
+			return cmdtp;	/* full match */
+	}
+
+	/* find the first name starting with cmd, then check it is unique */
+	low = 0;
+	high = cmd_sorted_count;
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (strncmp(cmd_sorted[mid]->name, cmd, len) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (low == cmd_sorted_count || strncmp(cmd_sorted[low]->name, cmd, len))
+		return NULL;
+	if (low + 1 < cmd_sorted_count &&
+	    !strncmp(cmd_sorted[low + 1]->name, cmd, len))
+		return NULL;	/* ambiguous */
+
+	return cmd_sorted[low];
+}
+#endif /* CMDLINE_HASH */
+
 struct cmd_tbl *find_cmd(const char *cmd)
 {
 	struct cmd_tbl *start = ll_entry_start(struct cmd_tbl, cmd);
 	const int len = ll_entry_count(struct cmd_tbl, cmd);
+
+#if CONFIG_IS_ENABLED(CMDLINE_HASH)
+	if (gd->flags & GD_FLG_RELOC) {
+		if (cmd_hash_table || !cmd_index_build(start, len))
+			return find_cmd_index(cmd);
+	}
+#endif
+
 	return find_cmd_tbl(cmd, start, len);
 }
 
@@ -27,6 +27,32 @@ struct hlist_head *cyclic_get_list(void)
 	return (struct hlist_head *)&gd->cyclic_list;
 }
 
+/**
+ * cyclic_queue() - Insert a cyclic function into the list by deadline
+ *
+ * The list is kept sorted by @next_call so that schedule() only needs to look
+ * at the first entry to know whether anything is due. Entries with the same
+ * deadline keep their insertion order.
+ *
+ * @cyclic: Cyclic function to insert
+ */
+static void cyclic_queue(struct cyclic_info *cyclic)
+{
+	struct cyclic_info *pos, *last = NULL;
+
+	hlist_for_each_entry(pos, cyclic_get_list(), list) {
+		if (time_before64(cyclic->next_call, pos->next_call)) {
+			hlist_add_before(&cyclic->list, &pos->list);
+			return;
+		}
+		last = pos;
+	}
+	if (last)
+		hlist_add_after(&last->list, &cyclic->list);
+	else
+		hlist_add_head(&cyclic->list, cyclic_get_list());
+}
+
 void cyclic_register(struct cyclic_info *cyclic, cyclic_func_t func,
 		     uint64_t delay_us, const char *name)
 {
@@ -37,7 +63,7 @@ void cyclic_register(struct cyclic_info *cyclic, cyclic_func_t func,
 	cyclic->name = name;
 	cyclic->delay_us = delay_us;
 	cyclic->start_time_us = timer_get_us();
-	hlist_add_head(&cyclic->list, cyclic_get_list());
+	cyclic_queue(cyclic);
 }
 
 void cyclic_unregister(struct cyclic_info *cyclic)
@@ -45,44 +71,80 @@ void cyclic_unregister(struct cyclic_info *cyclic)
 	hlist_del(&cyclic->list);
 }
 
-static void cyclic_run(void)
+/**
+ * cyclic_take_due() - Move all functions which are due onto a separate list
+ *
+ * Since the list is sorted, the due functions form its head. Splitting them
+ * off means each one runs at most once per call to cyclic_run(), even if its
+ * new deadline has already passed by the time it is queued again.
+ *
+ * @due: Returns the functions which are due, in deadline order
+ * @now: Current time in us
+ */
+static void cyclic_take_due(struct hlist_head *due, uint64_t now)
 {
-	struct cyclic_info *cyclic;
-	struct hlist_node *tmp;
-	uint64_t now, cpu_time;
+	struct hlist_head *head = cyclic_get_list();
+	struct hlist_node **pprev = &head->first;
 
-	/* Prevent recursion */
-	if (gd->flags & GD_FLG_CYCLIC_RUNNING)
+	while (*pprev &&
+	       time_after_eq64(now, hlist_entry(*pprev, struct cyclic_info,
+						list)->next_call))
+		pprev = &(*pprev)->next;
+
+	if (pprev == &head->first) {
+		INIT_HLIST_HEAD(due);
 		return;
+	}
+	due->first = head->first;
+	due->first->pprev = &due->first;
+	head->first = *pprev;
+	if (head->first)
+		head->first->pprev = &head->first;
+	*pprev = NULL;
+}
+
+static void cyclic_run(uint64_t now)
+{
+	struct cyclic_info *cyclic;
+	struct hlist_head due;
+	uint64_t start, cpu_time;
 
 	gd->flags |= GD_FLG_CYCLIC_RUNNING;
-	hlist_for_each_entry_safe(cyclic, tmp, cyclic_get_list(), list) {
+	cyclic_take_due(&due, now);
+	while (!hlist_empty(&due)) {
+		cyclic = hlist_entry(due.first, struct cyclic_info, list);
+
+		/* Call cyclic function and account it's cpu-time */
+		start = timer_get_us();
+		cyclic->func(cyclic);
+		cpu_time = timer_get_us() - start;
+		cyclic->run_cnt++;
+		cyclic->cpu_time_us += cpu_time;
+		if (cpu_time > cyclic->max_cpu_time_us)
+			cyclic->max_cpu_time_us = cpu_time;
+
+		/* Check if cpu-time exceeds max allowed time */
+		if ((cpu_time > CONFIG_CYCLIC_MAX_CPU_TIME_US) &&
+		    (!cyclic->already_warned)) {
+			pr_err("cyclic function %s took too long: %lldus vs %dus max\n",
+			       cyclic->name, cpu_time,
+			       CONFIG_CYCLIC_MAX_CPU_TIME_US);
+
+			/*
+			 * Don't disable this function, just warn once
+			 * about this exceeding CPU time usage
+			 */
+			cyclic->already_warned = true;
+		}
+
 		/*
-		 * Check if this cyclic function needs to get called, e.g.
-		 * do not call the cyclic func too often
+		 * The function may have unregistered itself, or others on the
+		 * due list, so only requeue it if it is still there
 		 */
-		now = timer_get_us();
-		if (time_after_eq64(now, cyclic->next_call)) {
-			/* Call cyclic function and account it's cpu-time */
-			cyclic->next_call = now + cyclic->delay_us;
-			cyclic->func(cyclic);
-			cyclic->run_cnt++;
-			cpu_time = timer_get_us() - now;
-			cyclic->cpu_time_us += cpu_time;
-
-			/* Check if cpu-time exceeds max allowed time */
-			if ((cpu_time > CONFIG_CYCLIC_MAX_CPU_TIME_US) &&
-			    (!cyclic->already_warned)) {
-				pr_err("cyclic function %s took too long: %lldus vs %dus max\n",
-				       cyclic->name, cpu_time,
-				       CONFIG_CYCLIC_MAX_CPU_TIME_US);
-
-				/*
-				 * Don't disable this function, just warn once
-				 * about this exceeding CPU time usage
-				 */
-				cyclic->already_warned = true;
-			}
+		if (due.first == &cyclic->list) {
+			hlist_del(&cyclic->list);
+			cyclic->next_call = start + cyclic->delay_us;
+			cyclic_queue(cyclic);
 		}
 	}
 	gd->flags &= ~GD_FLG_CYCLIC_RUNNING;
@@ -90,6 +152,9 @@ static void cyclic_run(void)
 
 void schedule(void)
 {
+	struct hlist_node *first;
+	uint64_t now;
+
 	/* The HW watchdog is not integrated into the cyclic IF (yet) */
 	if (IS_ENABLED(CONFIG_HW_WATCHDOG))
 		hw_watchdog_reset();
@@ -98,8 +163,21 @@ void schedule(void)
 	 * schedule() might get called very early before the cyclic IF is
 	 * ready. Make sure to only call cyclic_run() when it's initalized.
 	 */
-	if (gd)
-		cyclic_run();
+	if (!gd)
+		return;
+
+	/* Prevent recursion */
+	first = cyclic_get_list()->first;
+	if (!first || (gd->flags & GD_FLG_CYCLIC_RUNNING))
+		return;
+
+	/* Only the first function can be due, since the list is sorted */
+	now = timer_get_us();
+	if (time_before64(now, hlist_entry(first, struct cyclic_info,
+					   list)->next_call))
+		return;
+
+	cyclic_run(now);
 }
 
 int cyclic_unregister_all(void)
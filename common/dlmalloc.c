@@ -19,6 +19,7 @@
 #include <mapmem.h>
 #include <string.h>
 #include <asm/io.h>
+#include <linux/list.h>
 #include <valgrind/memcheck.h>
 
 #ifdef DEBUG
@@ -570,6 +571,9 @@ static mbinptr av_[NAV * 2 + 2] = {
 #ifdef CONFIG_SYS_MALLOC_DEFAULT_TO_INIT
 static void malloc_init(void);
 #endif
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+static void slab_reset(void);
+#endif
 
 ulong mem_malloc_start = 0;
 ulong mem_malloc_end = 0;
@@ -607,6 +611,9 @@ void mem_malloc_init(ulong start, ulong size)
 #ifdef CONFIG_SYS_MALLOC_DEFAULT_TO_INIT
 	malloc_init();
 #endif
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	slab_reset();
+#endif
 
 	debug("using memory %#lx-%#lx for malloc()\n", mem_malloc_start,
 	      mem_malloc_end);
@@ -1180,6 +1187,295 @@ static void malloc_extend_top(nb) INTERNAL_SIZE_T nb;
 
 /* Main public routines */
 
+/*
+  Slab caches for small requests
+
+    Driver model allocates a great many small, fixed-size objects. To
+    avoid searching the bins for each one, requests of up to SLAB_MAX_SIZE
+    bytes are served from a small set of size classes. Each class keeps
+    pages of equal-sized slots, allocated from the main heap as normal
+    chunks.
+
+    Each slot starts with a tag word, placed where a chunk's size field
+    would be, so a slab object can be freed with free() like any other.
+    The tag has IS_SLAB set, which is never set in a chunk size since
+    those are multiples of MALLOC_ALIGNMENT. The rest of the tag is the
+    offset of the object from the start of its page, where the page
+    header is. Free slots are kept on a list within each page and a page
+    is returned to the heap when it becomes empty, unless it is the only
+    page in its class with free slots.
+*/
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+
+STATIC_IF_MCHECK Void_t *mALLOc_impl(size_t bytes);
+STATIC_IF_MCHECK void fREe_impl(Void_t *mem);
+
+#define IS_SLAB		0x4
+#define SLAB_TAG_SHIFT	3
+#define SLAB_PAGE_SIZE	4096
+
+/* Size of each class in units of MALLOC_ALIGNMENT, including the tag */
+static const u8 slab_units[] = { 2, 3, 4, 6, 8, 12, 16 };
+
+#define SLAB_COUNT	ARRAY_SIZE(slab_units)
+#define SLAB_MAX_UNITS	16
+#define SLAB_MAX_SIZE	(SLAB_MAX_UNITS * MALLOC_ALIGNMENT - SIZE_SZ)
+
+struct slab_cache;
+
+/**
+ * struct slab_page - header at the start of each slab page
+ *
+ * @sibling: Node in the cache's list of pages with free slots
+ * @cache: Cache which owns this page
+ * @free: First free object, each holding a pointer to the next
+ * @unused: Tag word of the first slot never handed out, or NULL if all slots
+ *	have been used at least once
+ * @inuse: Number of objects allocated from this page
+ */
+struct slab_page {
+	struct list_head sibling;
+	struct slab_cache *cache;
+	void *free;
+	char *unused;
+	uint inuse;
+};
+
+/* Offset of the first object in a page, leaving room for its tag */
+#define SLAB_FIRST_OBJ	\
+	((sizeof(struct slab_page) + SIZE_SZ + MALLOC_ALIGN_MASK) & \
+	 ~MALLOC_ALIGN_MASK)
+
+/**
+ * struct slab_cache - a size class of slab objects
+ *
+ * @partial: Pages which have free slots
+ * @slot: Size of each slot in bytes, including the tag word
+ * @inuse: Number of objects currently allocated
+ * @peak: Largest value seen for @inuse
+ * @pages: Number of pages currently held
+ * @allocs: Total number of objects allocated
+ * @frees: Total number of objects freed
+ */
+struct slab_cache {
+	struct list_head partial;
+	uint slot;
+	ulong inuse;
+	ulong peak;
+	ulong pages;
+	ulong allocs;
+	ulong frees;
+};
+
+static struct slab_cache slab_caches[SLAB_COUNT];
+static u8 slab_index[SLAB_MAX_UNITS + 1];	/* units -> cache index */
+static ulong slab_page_bytes;	/* size of all slab pages, as chunks */
+static bool slab_ready;
+static bool slab_disabled;
+
+static void slab_reset(void)
+{
+	slab_ready = false;
+}
+
+static void slab_init(void)
+{
+	int i, units;
+
+	for (i = 0, units = 0; i < SLAB_COUNT; i++) {
+		struct slab_cache *cache = &slab_caches[i];
+
+		memset(cache, '\0', sizeof(*cache));
+		INIT_LIST_HEAD(&cache->partial);
+		cache->slot = slab_units[i] * MALLOC_ALIGNMENT;
+		for (; units <= slab_units[i]; units++)
+			slab_index[units] = i;
+	}
+	slab_page_bytes = 0;
+	slab_ready = true;
+}
+
+static bool slab_owns(Void_t *mem)
+{
+	ulong addr = (ulong)mem;
+
+	return addr > mem_malloc_start && addr < mem_malloc_end &&
+		(((INTERNAL_SIZE_T *)mem)[-1] & IS_SLAB);
+}
+
+static struct slab_page *slab_page_of(Void_t *mem)
+{
+	INTERNAL_SIZE_T tag = ((INTERNAL_SIZE_T *)mem)[-1];
+
+	return (struct slab_page *)((char *)mem - (tag >> SLAB_TAG_SHIFT));
+}
+
+static struct slab_page *slab_new_page(struct slab_cache *cache)
+{
+	struct slab_page *page;
+
+	/* The page does not count against the caller's malloc() limit */
+	if (CONFIG_IS_ENABLED(UNIT_TEST) && malloc_testing)
+		malloc_max_allocs++;
+	page = mALLOc_impl(SLAB_PAGE_SIZE);
+	if (!page)
+		return NULL;
+	page->cache = cache;
+	page->free = NULL;
+	page->unused = (char *)page + SLAB_FIRST_OBJ - SIZE_SZ;
+	page->inuse = 0;
+	list_add(&page->sibling, &cache->partial);
+	cache->pages++;
+	slab_page_bytes += chunksize(mem2chunk(page));
+
+	return page;
+}
+
+static Void_t *slab_alloc(size_t bytes)
+{
+	struct slab_cache *cache;
+	struct slab_page *page;
+	char *mem;
+
+	if (slab_disabled)
+		return NULL;
+	if (!slab_ready)
+		slab_init();
+
+	cache = &slab_caches[slab_index[(bytes + SIZE_SZ + MALLOC_ALIGN_MASK) /
+					MALLOC_ALIGNMENT]];
+	if (list_empty(&cache->partial)) {
+		page = slab_new_page(cache);
+		if (!page)
+			return NULL;
+	} else {
+		page = list_first_entry(&cache->partial, struct slab_page,
+					sibling);
+	}
+
+	if (page->free) {
+		mem = page->free;
+		page->free = *(void **)mem;
+	} else {
+		mem = page->unused + SIZE_SZ;
+		((INTERNAL_SIZE_T *)mem)[-1] =
+			(mem - (char *)page) << SLAB_TAG_SHIFT | IS_SLAB;
+		page->unused += cache->slot;
+		if (page->unused + cache->slot > (char *)page + SLAB_PAGE_SIZE)
+			page->unused = NULL;
+	}
+	page->inuse++;
+	if (!page->free && !page->unused)
+		list_del_init(&page->sibling);
+
+	cache->allocs++;
+	if (++cache->inuse > cache->peak)
+		cache->peak = cache->inuse;
+
+	return mem;
+}
+
+static void slab_free(Void_t *mem)
+{
+	struct slab_page *page = slab_page_of(mem);
+	struct slab_cache *cache = page->cache;
+	bool was_full = !page->free && !page->unused;
+
+	*(void **)mem = page->free;
+	page->free = mem;
+	page->inuse--;
+	cache->inuse--;
+	cache->frees++;
+
+	if (was_full) {
+		list_add(&page->sibling, &cache->partial);
+	} else if (!page->inuse && !list_is_singular(&cache->partial)) {
+		list_del(&page->sibling);
+		cache->pages--;
+		slab_page_bytes -= chunksize(mem2chunk(page));
+		fREe_impl(page);
+	}
+}
+
+/*
+ * Allocate a chunk from the heap, bypassing the slab caches. This is used by
+ * memalign(), which splits the chunk it is given.
+ */
+static Void_t *malloc_no_slab(size_t bytes)
+{
+	bool disabled = slab_disabled;
+	Void_t *mem;
+
+	slab_disabled = true;
+	mem = mALLOc_impl(bytes);
+	slab_disabled = disabled;
+
+	return mem;
+}
+
+static size_t slab_usable_size(Void_t *mem)
+{
+	return slab_page_of(mem)->cache->slot - SIZE_SZ;
+}
+
+static Void_t *slab_realloc(Void_t *oldmem, size_t bytes)
+{
+	size_t size = slab_usable_size(oldmem);
+	Void_t *newmem;
+
+	if (bytes <= size)
+		return oldmem;
+
+	newmem = mALLOc_impl(bytes);
+	if (!newmem)
+		return NULL;
+	memcpy(newmem, oldmem, size);
+	slab_free(oldmem);
+
+	return newmem;
+}
+
+/* Number of bytes held in slab pages which are not allocated to objects */
+static ulong slab_spare_bytes(void)
+{
+	ulong used = 0;
+	int i;
+
+	if (!slab_ready)
+		return 0;
+	for (i = 0; i < SLAB_COUNT; i++)
+		used += slab_caches[i].inuse * slab_caches[i].slot;
+
+	return slab_page_bytes - used;
+}
+
+void malloc_slab_enable(bool enable)
+{
+	slab_disabled = !enable;
+}
+
+void malloc_slab_info(void)
+{
+	int i;
+
+	printf("%6s  %8s  %8s  %6s  %10s  %10s\n", "Size", "In use", "Peak",
+	       "Pages", "Allocs", "Frees");
+	for (i = 0; slab_ready && i < SLAB_COUNT; i++) {
+		struct slab_cache *cache = &slab_caches[i];
+
+		printf("%6lu  %8lu  %8lu  %6lu  %10lu  %10lu\n",
+		       (ulong)(cache->slot - SIZE_SZ), cache->inuse,
+		       cache->peak, cache->pages, cache->allocs, cache->frees);
+	}
+	printf("Pages: %lu bytes, %lu bytes spare%s\n", slab_page_bytes,
+	       slab_spare_bytes(), slab_disabled ? " (disabled)" : "");
+}
+
+#else
+#define malloc_no_slab	mALLOc_impl
+#endif /* SYS_MALLOC_SLAB */
+
 /*
   Malloc Algorthim:
 
@@ -1279,6 +1575,15 @@ Void_t* mALLOc_impl(bytes) size_t bytes;
   if (bytes > CONFIG_SYS_MALLOC_LEN || (long)bytes < 0)
      return NULL;
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  if (bytes <= SLAB_MAX_SIZE) {
+    Void_t *mem = slab_alloc(bytes);
+
+    if (mem)
+      return mem;
+  }
+#endif
+
   nb = request2size(bytes);  /* padded request size; */
 
   /* Check for exact match in a bin */
@@ -1549,6 +1854,13 @@ void fREe_impl(mem) Void_t* mem;
   if (mem == NULL)                              /* free(0) has no effect */
     return;
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  if (slab_owns(mem)) {
+    slab_free(mem);
+    return;
+  }
+#endif
+
   p = mem2chunk(mem);
   hd = p->size;
 
@@ -1707,6 +2019,11 @@ Void_t* rEALLOc_impl(oldmem, bytes) Void_t* oldmem; size_t bytes;
       return NULL;
   }
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  if (slab_owns(oldmem))
+    return slab_realloc(oldmem, bytes);
+#endif
+
   newp    = oldp    = mem2chunk(oldmem);
   newsize = oldsize = chunksize(oldp);
 
@@ -1935,7 +2252,7 @@ Void_t* mEMALIGn_impl(alignment, bytes) size_t alignment; size_t bytes;
   /* Call malloc with worst case padding to hit alignment. */
 
   nb = request2size(bytes);
-  m  = (char*)(mALLOc_impl(nb + alignment + MINSIZE));
+  m  = (char*)(malloc_no_slab(nb + alignment + MINSIZE));
 
   /*
   * The attempt to over-allocate (with a size large enough to guarantee the
@@ -1951,7 +2268,7 @@ Void_t* mEMALIGn_impl(alignment, bytes) size_t alignment; size_t bytes;
      * Use bytes not nb, since mALLOc internally calls request2size too, and
      * each call increases the size to allocate, to account for the header.
      */
-    m  = (char*)(mALLOc_impl(bytes));
+    m  = (char*)(malloc_no_slab(bytes));
     /* Aligned -> return it */
     if ((((unsigned long)(m)) % alignment) == 0)
       return m;
@@ -1962,7 +2279,7 @@ Void_t* mEMALIGn_impl(alignment, bytes) size_t alignment; size_t bytes;
     fREe_impl(m);
     /* Add in extra bytes to match misalignment of unexpanded allocation */
     extra = alignment - (((unsigned long)(m)) % alignment);
-    m  = (char*)(mALLOc_impl(bytes + extra));
+    m  = (char*)(malloc_no_slab(bytes + extra));
     /*
      * m might not be the same as before. Validate that the previous value of
      * extra still works for the current value of m.
@@ -2115,6 +2432,12 @@ Void_t* cALLOc_impl(n, elem_size) size_t n; size_t elem_size;
 		memset(mem, 0, sz);
 		return mem;
 	}
+#endif
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+    if (slab_owns(mem)) {
+      memset(mem, '\0', sz);
+      return mem;
+    }
 #endif
     p = mem2chunk(mem);
 
@@ -2343,6 +2666,10 @@ size_t malloc_usable_size(mem) Void_t* mem;
   mchunkptr p;
   if (mem == NULL)
     return 0;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  else if (slab_owns(mem))
+    return slab_usable_size(mem);
+#endif
   else
   {
     p = mem2chunk(mem);
@@ -2388,6 +2715,11 @@ static void malloc_update_mallinfo(void)
     }
   }
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  /* Count spare slab slots as free, so that only objects appear in use */
+  avail += slab_spare_bytes();
+#endif
+
   current_mallinfo.ordblks = navail;
   current_mallinfo.uordblks = sbrked_mem - avail;
   current_mallinfo.fordblks = avail;
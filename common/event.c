@@ -14,6 +14,7 @@
 #include <log.h>
 #include <linker_lists.h>
 #include <malloc.h>
+#include <time.h>
 #include <asm/global_data.h>
 #include <linux/errno.h>
 #include <linux/list.h>
@@ -65,36 +66,98 @@ const char *event_type_name(enum event_t type)
 #endif
 }
 
-static int notify_static(struct event *ev)
+/**
+ * event_index_spies() - Work out where the static spies for each event are
+ *
+ * Linker-list entries are sorted by name and the name of each spy starts with
+ * its event type, so the spies for each type are normally next to each other.
+ * Record where each group starts, so that sending an event only looks at the
+ * spies for that event. If a group turns out not to be contiguous, that type
+ * falls back to scanning the whole list.
+ *
+ * @state: Event state to update
+ */
+static void event_index_spies(struct event_state *state)
 {
 	struct evspy_info *start =
 		ll_entry_start(struct evspy_info, evspy_info);
 	const int n_ents = ll_entry_count(struct evspy_info, evspy_info);
-	struct evspy_info *spy;
+	u16 last[EVT_COUNT];
+	int i;
+
+	for (i = 0; i < EVT_COUNT; i++)
+		state->dispatch[i].count = 0;
+
+	for (i = 0; i < n_ents; i++) {
+		struct event_dispatch *disp;
+		int type = start[i].type;
+
+		if (type >= EVT_COUNT)
+			continue;
+		disp = &state->dispatch[type];
+		if (!disp->count) {
+			disp->start = i;
+		} else if (disp->count == EVENT_DISPATCH_SCAN) {
+			continue;
+		} else if (last[type] != i - 1) {
+			log_debug("Spies for event %x are not contiguous\n",
+				  type);
+			disp->count = EVENT_DISPATCH_SCAN;
+			continue;
+		}
+		disp->count++;
+		last[type] = i;
+	}
+	state->indexed = true;
+}
 
-	for (spy = start; spy != start + n_ents; spy++) {
+static int notify_spy(struct evspy_info *spy, struct event *ev)
+{
+	int ret;
+
+	log_debug("Sending event %x/%s to spy '%s'\n", ev->type,
+		  event_type_name(ev->type), event_spy_id(spy));
+	if (spy->flags & EVSPYF_SIMPLE) {
+		const struct evspy_info_simple *simple;
+
+		simple = (struct evspy_info_simple *)spy;
+		ret = simple->func();
+	} else {
+		ret = spy->func(NULL, ev);
+	}
+
+	/*
+	 * TODO: Handle various return codes to
+	 *
+	 * - claim an event (no others will see it)
+	 * - return an error from the event
+	 */
+	if (ret)
+		return log_msg_ret("spy", ret);
+
+	return 0;
+}
+
+static int notify_static(struct event_dispatch *disp, struct event *ev)
+{
+	struct evspy_info *start =
+		ll_entry_start(struct evspy_info, evspy_info);
+	const int n_ents = ll_entry_count(struct evspy_info, evspy_info);
+	struct evspy_info *spy, *end;
+	int ret;
+
+	if (disp->count == EVENT_DISPATCH_SCAN) {
+		end = start + n_ents;
+	} else {
+		start += disp->start;
+		end = start + disp->count;
+	}
+
+	for (spy = start; spy != end; spy++) {
 		if (spy->type == ev->type) {
-			int ret;
-
-			log_debug("Sending event %x/%s to spy '%s'\n", ev->type,
-				  event_type_name(ev->type), event_spy_id(spy));
-			if (spy->flags & EVSPYF_SIMPLE) {
-				const struct evspy_info_simple *simple;
-
-				simple = (struct evspy_info_simple *)spy;
-				ret = simple->func();
-			} else {
-				ret = spy->func(NULL, ev);
-			}
-
-			/*
-			 * TODO: Handle various return codes to
-			 *
-			 * - claim an event (no others will see it)
-			 * - return an error from the event
-			 */
+			ret = notify_spy(spy, ev);
 			if (ret)
-				return log_msg_ret("spy", ret);
+				return ret;
 		}
 	}
 
@@ -103,42 +166,74 @@ static int notify_static(struct event *ev)
 
 static int notify_dynamic(struct event *ev)
 {
+#if CONFIG_IS_ENABLED(EVENT_DYNAMIC)
 	struct event_state *state = gd_event_state();
 	struct event_spy *spy, *next;
 
-	list_for_each_entry_safe(spy, next, &state->spy_head, sibling_node) {
-		if (spy->type == ev->type) {
-			int ret;
-
-			log_debug("Sending event %x/%s to spy '%s'\n", ev->type,
-				  event_type_name(ev->type), spy->id);
-			ret = spy->func(spy->ctx, ev);
-
-			/*
-			 * TODO: Handle various return codes to
-			 *
-			 * - claim an event (no others will see it)
-			 * - return an error from the event
-			 */
-			if (ret)
-				return log_msg_ret("spy", ret);
-		}
+	list_for_each_entry_safe(spy, next, &state->spy_head[ev->type],
+				 sibling_node) {
+		int ret;
+
+		log_debug("Sending event %x/%s to spy '%s'\n", ev->type,
+			  event_type_name(ev->type), spy->id);
+		ret = spy->func(spy->ctx, ev);
+
+		/*
+		 * TODO: Handle various return codes to
+		 *
+		 * - claim an event (no others will see it)
+		 * - return an error from the event
+		 */
+		if (ret)
+			return log_msg_ret("spy", ret);
 	}
+#endif
 
 	return 0;
 }
 
+/**
+ * event_can_time() - Check whether the time taken by spies can be measured
+ *
+ * Events are sent while devices, including the timer, are being probed, so
+ * only read the timer once it is known to be running.
+ *
+ * Return: true if timer_get_us() can be used
+ */
+static bool event_can_time(void)
+{
+	if (!CONFIG_IS_ENABLED(EVENT_DEBUG) || !(gd->flags & GD_FLG_RELOC))
+		return false;
+#if CONFIG_IS_ENABLED(TIMER)
+	return gd->timer;
+#else
+	return true;
+#endif
+}
+
 int event_notify(enum event_t type, void *data, int size)
 {
+	struct event_state *state = gd_event_state();
+	struct event_dispatch *disp;
 	struct event event;
+	__maybe_unused ulong start = 0;
 	int ret;
 
+	if (type >= EVT_COUNT)
+		return log_msg_ret("type", -EINVAL);
 	event.type = type;
 	if (size > sizeof(event.data))
 		return log_msg_ret("size", -E2BIG);
 	memcpy(&event.data, data, size);
 
-	ret = notify_static(&event);
+	if (!state->indexed)
+		event_index_spies(state);
+	disp = &state->dispatch[type];
+	disp->calls++;
+	if (event_can_time())
+		start = timer_get_us();
+
+	ret = notify_static(disp, &event);
 	if (ret)
 		return log_msg_ret("sta", ret);
 
@@ -147,6 +242,10 @@ int event_notify(enum event_t type, void *data, int size)
 		if (ret)
 			return log_msg_ret("dyn", ret);
 	}
+#if CONFIG_IS_ENABLED(EVENT_DEBUG)
+	if (start)
+		disp->time_us += timer_get_us() - start;
+#endif
 
 	return 0;
 }
@@ -161,8 +260,10 @@ void event_show_spy_list(void)
 	struct evspy_info *start =
 		ll_entry_start(struct evspy_info, evspy_info);
 	const int n_ents = ll_entry_count(struct evspy_info, evspy_info);
+	struct event_state *state = gd_event_state();
 	struct evspy_info *spy;
 	const int size = sizeof(ulong) * 2;
+	int i;
 
 	printf("Seq  %-24s  %*s  %s\n", "Type", size, "Function", "ID");
 	for (spy = start; spy != start + n_ents; spy++) {
@@ -170,6 +271,27 @@ void event_show_spy_list(void)
 		       spy->type, event_type_name(spy->type), size, spy->func,
 		       event_spy_id(spy));
 	}
+
+	if (!state->indexed)
+		event_index_spies(state);
+	printf("\n%-24s  %5s  %8s  %10s\n", "Type", "Spies", "Calls",
+	       "Time (us)");
+	for (i = 0; i < EVT_COUNT; i++) {
+		struct event_dispatch *disp = &state->dispatch[i];
+		ulong time_us = 0;
+
+		if (!disp->calls)
+			continue;
+#if CONFIG_IS_ENABLED(EVENT_DEBUG)
+		time_us = disp->time_us;
+#endif
+		printf("%-3x %-20s  ", i, event_type_name(i));
+		if (disp->count == EVENT_DISPATCH_SCAN)
+			printf("%5s", "-");
+		else
+			printf("%5d", disp->count);
+		printf("  %8u  %10lu\n", disp->calls, time_us);
+	}
 }
 
 #if CONFIG_IS_ENABLED(EVENT_DYNAMIC)
@@ -183,6 +305,9 @@ int event_register(const char *id, enum event_t type, event_handler_t func, void
 	struct event_state *state = gd_event_state();
 	struct event_spy *spy;
 
+	if (type >= EVT_COUNT)
+		return log_msg_ret("type", -EINVAL);
+
 	spy = malloc(sizeof(*spy));
 	if (!spy)
 		return log_msg_ret("alloc", -ENOMEM);
@@ -191,7 +316,7 @@ int event_register(const char *id, enum event_t type, event_handler_t func, void
 	spy->type = type;
 	spy->func = func;
 	spy->ctx = ctx;
-	list_add_tail(&spy->sibling_node, &state->spy_head);
+	list_add_tail(&spy->sibling_node, &state->spy_head[type]);
 
 	return 0;
 }
@@ -200,9 +325,13 @@ int event_uninit(void)
 {
 	struct event_state *state = gd_event_state();
 	struct event_spy *spy, *next;
+	int i;
 
-	list_for_each_entry_safe(spy, next, &state->spy_head, sibling_node)
-		spy_free(spy);
+	for (i = 0; i < EVT_COUNT; i++) {
+		list_for_each_entry_safe(spy, next, &state->spy_head[i],
+					 sibling_node)
+			spy_free(spy);
+	}
 
 	return 0;
 }
@@ -210,8 +339,10 @@ int event_uninit(void)
 int event_init(void)
 {
 	struct event_state *state = gd_event_state();
+	int i;
 
-	INIT_LIST_HEAD(&state->spy_head);
+	for (i = 0; i < EVT_COUNT; i++)
+		INIT_LIST_HEAD(&state->spy_head[i]);
 
 	return 0;
 }
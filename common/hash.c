@@ -17,9 +17,11 @@
 #include <mapmem.h>
 #include <hw_sha.h>
 #include <asm/cache.h>
+#include <watchdog.h>
 #include <asm/global_data.h>
 #include <asm/io.h>
 #include <linux/errno.h>
+#include <linux/sizes.h>
 #else
 #include "mkimage.h"
 #include <linux/compiler_attributes.h>
@@ -403,6 +405,66 @@ int hash_block(const char *algo_name, const void *data, unsigned int len,
 	return 0;
 }
 
+/*
+ * Amount of data passed to each algorithm in turn, small enough that it is
+ * still in the data cache when the next algorithm reads it
+ */
+#define HASH_MULTI_CHUNK	SZ_16K
+
+int hash_multi_block(struct hash_algo *const algos[], int count,
+		     const void *data, ulong len, u8 *const outputs[])
+{
+	void *ctx[HASH_MULTI_MAX];
+	const u8 *buf = data;
+	ulong done = 0;
+	int ret = 0;
+	int i;
+
+	if (count > HASH_MULTI_MAX)
+		return -E2BIG;
+
+	for (i = 0; i < count; i++) {
+		struct hash_algo *algo = algos[i];
+
+		/* fall back to a separate pass if progressive hashing fails */
+		if (!algo->hash_init || algo->hash_init(algo, &ctx[i])) {
+			ctx[i] = NULL;
+			algo->hash_func_ws(data, len, outputs[i],
+					   algo->chunk_size);
+		}
+	}
+
+	do {
+		uint chunk = min_t(ulong, len - done, HASH_MULTI_CHUNK);
+		int is_last = done + chunk == len;
+
+		for (i = 0; i < count; i++) {
+			struct hash_algo *algo = algos[i];
+
+			if (!ctx[i])
+				continue;
+			if (algo->hash_update(algo, ctx[i], buf + done, chunk,
+					      is_last)) {
+				/* the context has been freed */
+				ctx[i] = NULL;
+				ret = -EIO;
+			}
+		}
+		done += chunk;
+		schedule();
+	} while (done < len);
+
+	for (i = 0; i < count; i++) {
+		struct hash_algo *algo = algos[i];
+
+		if (ctx[i] && algo->hash_finish(algo, ctx[i], outputs[i],
+						algo->digest_size))
+			ret = -EIO;
+	}
+
+	return ret;
+}
+
 #if !defined(CONFIG_XPL_BUILD) && (defined(CONFIG_CMD_HASH) || \
 	defined(CONFIG_CMD_SHA1SUM) || defined(CONFIG_CMD_CRC32)) || \
 	defined(CONFIG_CMD_MD5SUM)
@@ -527,6 +589,67 @@ static void hash_show(struct hash_algo *algo, ulong addr, ulong len, uint8_t *ou
 		printf("%02x", output[i]);
 }
 
+/**
+ * hash_command_multi() - Show the digests of a region for several algorithms
+ *
+ * The data is read only once, however many algorithms are given.
+ *
+ * @algo_names: Comma-separated list of algorithm names, e.g. "sha1,sha256"
+ * @addr: Address of region to hash
+ * @len: Length of region in bytes
+ * Return: CMD_RET_SUCCESS if OK, other CMD_RET_... value on error
+ */
+static int hash_command_multi(const char *algo_names, ulong addr, ulong len)
+{
+	struct hash_algo *algos[HASH_MULTI_MAX];
+	u8 *outputs[HASH_MULTI_MAX];
+	const char *p, *end;
+	int count = 0;
+	u8 *output;
+	void *buf;
+	int ret;
+	int i;
+
+	for (p = algo_names; *p; p = *end ? end + 1 : end) {
+		char name[16];
+
+		end = strchrnul(p, ',');
+		if (count == HASH_MULTI_MAX) {
+			printf("Too many hash algorithms (max %d)\n",
+			       HASH_MULTI_MAX);
+			return CMD_RET_USAGE;
+		}
+		strlcpy(name, p, min_t(size_t, end - p + 1, sizeof(name)));
+		if (hash_lookup_algo(name, &algos[count])) {
+			printf("Unknown hash algorithm '%s'\n", name);
+			return CMD_RET_USAGE;
+		}
+		count++;
+	}
+
+	output = memalign(ARCH_DMA_MINALIGN, count * HASH_MAX_DIGEST_SIZE);
+	if (!output)
+		return CMD_RET_FAILURE;
+	for (i = 0; i < count; i++)
+		outputs[i] = output + i * HASH_MAX_DIGEST_SIZE;
+
+	buf = map_sysmem(addr, len);
+	ret = hash_multi_block(algos, count, buf, len, outputs);
+	unmap_sysmem(buf);
+
+	for (i = 0; !ret && i < count; i++) {
+		hash_show(algos[i], addr, len, outputs[i]);
+		printf("\n");
+	}
+	free(output);
+	if (ret) {
+		printf("Hash failed (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
 int hash_command(const char *algo_name, int flags, struct cmd_tbl *cmdtp,
 		 int flag, int argc, char *const argv[])
 {
@@ -538,7 +661,14 @@ int hash_command(const char *algo_name, int flags, struct cmd_tbl *cmdtp,
 	addr = hextoul(*argv++, NULL);
 	len = hextoul(*argv++, NULL);
 
-	if (multi_hash()) {
+	if (multi_hash() && strchr(algo_name, ',')) {
+		if (argc > 2 || (flags & HASH_FLAG_VERIFY)) {
+			puts("Cannot verify or store several hashes\n");
+			return CMD_RET_USAGE;
+		}
+
+		return hash_command_multi(algo_name, addr, len);
+	} else if (multi_hash()) {
 		struct hash_algo *algo;
 		u8 *output;
 		uint8_t vsum[HASH_MAX_DIGEST_SIZE];
@@ -208,6 +208,8 @@ static int log_dispatch(struct log_rec *rec, const char *fmt, va_list args)
 {
 	struct log_device *ldev;
 	char buf[CONFIG_SYS_CBSIZE];
+	bool raw = false;
+	va_list raw_args;
 
 	/*
 	 * When a log driver writes messages (e.g. via the network stack) this
@@ -219,10 +221,15 @@ static int log_dispatch(struct log_rec *rec, const char *fmt, va_list args)
 
 	/* Emit message */
 	gd->processing_msg = true;
+	rec->fmt = fmt;
+	va_copy(raw_args, args);
+	rec->args = &raw_args;
 	list_for_each_entry(ldev, &gd->log_head, sibling_node) {
 		if ((ldev->flags & LOGDF_ENABLE) &&
 		    log_passes_filters(ldev, rec)) {
-			if (!rec->msg) {
+			if (ldev->flags & LOGDF_RAW) {
+				raw = true;
+			} else if (!rec->msg) {
 				int len;
 
 				len = vsnprintf(buf, sizeof(buf), fmt, args);
@@ -232,6 +239,11 @@ static int log_dispatch(struct log_rec *rec, const char *fmt, va_list args)
 			ldev->drv->emit(ldev, rec);
 		}
 	}
+	va_end(raw_args);
+
+	/* Nothing was formatted, so use the format string to detect '\n' */
+	if (raw && !rec->msg)
+		gd->log_cont = *fmt && fmt[strlen(fmt) - 1] != '\n';
 	gd->processing_msg = false;
 	return 0;
 }
@@ -0,0 +1,550 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Log to a binary ring buffer in the bloblist
+ *
+ * Records are stored without being formatted: just the address of the format
+ * string and the raw arguments. Formatting happens only when the ring is
+ * dumped, so logging costs little more than copying a few words.
+ */
+
+#include <bloblist.h>
+#include <errno.h>
+#include <log.h>
+#include <time.h>
+#include <asm/global_data.h>
+#include <asm/sections.h>
+#include <linux/ctype.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Largest record, including the header */
+#define LOGB_MAX_REC	512
+
+/* Longest string argument to copy, including the terminator */
+#define LOGB_MAX_STR	128
+
+/* Longest function name to copy, including the terminator */
+#define LOGB_MAX_FUNC	48
+
+/* Longest conversion specification, e.g. "%-08.4llx" */
+#define LOGB_MAX_SPEC	16
+
+/* Space for a specification once '*' width and precision are filled in */
+#define LOGB_MAX_SPEC_STR	(LOGB_MAX_SPEC + 2 * sizeof("-2147483648"))
+
+/**
+ * enum logb_arg_t - type of argument needed by a conversion specification
+ *
+ * @LOGB_ARG_NONE: No argument, e.g. "%%"
+ * @LOGB_ARG_INT: int, or something promoted to int
+ * @LOGB_ARG_LONG: long
+ * @LOGB_ARG_LLONG: long long
+ * @LOGB_ARG_SIZE: size_t or ptrdiff_t
+ * @LOGB_ARG_PTR: pointer, printed as an address
+ * @LOGB_ARG_STR: nul-terminated string
+ * @LOGB_ARG_UNSUPP: anything else, e.g. "%pU", which must be formatted
+ *	straight away
+ */
+enum logb_arg_t {
+	LOGB_ARG_NONE,
+	LOGB_ARG_INT,
+	LOGB_ARG_LONG,
+	LOGB_ARG_LLONG,
+	LOGB_ARG_SIZE,
+	LOGB_ARG_PTR,
+	LOGB_ARG_STR,
+	LOGB_ARG_UNSUPP,
+};
+
+/**
+ * struct logb_spec - a parsed conversion specification
+ *
+ * @len: Number of characters in the specification, including the '%'
+ * @type: Type of the argument
+ * @signed_int: true if an integer argument is signed
+ * @star_width: true if the width is given by an int argument
+ * @star_prec: true if the precision is given by an int argument
+ */
+struct logb_spec {
+	int len;
+	enum logb_arg_t type;
+	bool signed_int;
+	bool star_width;
+	bool star_prec;
+};
+
+/**
+ * logb_parse() - Parse a conversion specification
+ *
+ * @p: Pointer to the '%'
+ * @spec: Returns the parsed specification
+ */
+static void logb_parse(const char *p, struct logb_spec *spec)
+{
+	const char *start = p++;
+	int lcount = 0;
+	bool size = false;
+
+	memset(spec, '\0', sizeof(*spec));
+	while (*p && strchr("-+ #0", *p))
+		p++;
+	if (*p == '*') {
+		spec->star_width = true;
+		p++;
+	}
+	while (isdigit(*p))
+		p++;
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->star_prec = true;
+			p++;
+		}
+		while (isdigit(*p))
+			p++;
+	}
+	for (; *p && strchr("hlLqzZtj", *p); p++) {
+		if (*p == 'l')
+			lcount++;
+		else if (strchr("Lqj", *p))
+			lcount = 2;
+		else if (strchr("zZt", *p))
+			size = true;
+	}
+
+	switch (*p) {
+	case '%':
+		spec->type = LOGB_ARG_NONE;
+		break;
+	case 'd':
+	case 'i':
+		spec->signed_int = true;
+		fallthrough;
+	case 'u':
+	case 'x':
+	case 'X':
+	case 'o':
+	case 'c':
+		if (size)
+			spec->type = LOGB_ARG_SIZE;
+		else if (lcount >= 2)
+			spec->type = LOGB_ARG_LLONG;
+		else if (lcount)
+			spec->type = LOGB_ARG_LONG;
+		else
+			spec->type = LOGB_ARG_INT;
+		break;
+	case 'p':
+		/* Extensions like %pU dereference the pointer */
+		spec->type = isalnum(p[1]) ? LOGB_ARG_UNSUPP : LOGB_ARG_PTR;
+		break;
+	case 's':
+		spec->type = LOGB_ARG_STR;
+		break;
+	default:
+		spec->type = LOGB_ARG_UNSUPP;
+		break;
+	}
+	if (*p)
+		p++;
+	spec->len = p - start;
+	if (spec->len >= LOGB_MAX_SPEC)
+		spec->type = LOGB_ARG_UNSUPP;
+}
+
+/* Convert between run-time and link-time addresses */
+static ulong logb_reloc_off(void)
+{
+	return gd->flags & GD_FLG_RELOC ? gd->reloc_off : 0;
+}
+
+/**
+ * logb_fmt_in_image() - Check that a format string is part of U-Boot
+ *
+ * Only the address of the format string is stored, so it must still be there
+ * when the record is dumped. A string built at run time is not.
+ *
+ * @fmt: Format string
+ * Return: true if @fmt lies within the U-Boot image
+ */
+static bool logb_fmt_in_image(const char *fmt)
+{
+	ulong start = (ulong)_start;
+
+	return (ulong)fmt >= start && (ulong)fmt < start + gd->mon_len;
+}
+
+static struct log_binary_hdr *logb_get(bool create)
+{
+	struct log_binary_hdr *hdr;
+
+	if (!gd->bloblist)
+		return NULL;
+	hdr = bloblist_find(BLOBLISTT_U_BOOT_LOG, 0);
+	if (!hdr && create) {
+		hdr = bloblist_add(BLOBLISTT_U_BOOT_LOG,
+				   sizeof(*hdr) + CONFIG_LOG_BINARY_SIZE, 3);
+		if (!hdr)
+			return NULL;
+		hdr->magic = LOG_BINARY_MAGIC;
+		hdr->size = ALIGN_DOWN(CONFIG_LOG_BINARY_SIZE, sizeof(u64));
+	}
+	if (hdr && hdr->magic != LOG_BINARY_MAGIC)
+		return NULL;
+
+	return hdr;
+}
+
+static struct log_binary_rec *logb_at(struct log_binary_hdr *hdr, uint ofs)
+{
+	return (void *)(hdr + 1) + ofs;
+}
+
+/* Move @ofs past the wrap marker, if there is one */
+static uint logb_unwrap(struct log_binary_hdr *hdr, uint ofs)
+{
+	if (ofs >= hdr->size || !logb_at(hdr, ofs)->size)
+		return 0;
+
+	return ofs;
+}
+
+/* Discard the oldest record, leaving @head at the start of the next one */
+static void logb_evict(struct log_binary_hdr *hdr)
+{
+	hdr->head += logb_at(hdr, hdr->head)->size;
+	hdr->dropped++;
+	if (--hdr->count)
+		hdr->head = logb_unwrap(hdr, hdr->head);
+}
+
+/**
+ * logb_alloc() - Make space for a new record at the tail of the ring
+ *
+ * Oldest records are discarded as needed.
+ *
+ * @hdr: Ring header
+ * @size: Size of record, a multiple of 8
+ * Return: pointer to the space for the record
+ */
+static struct log_binary_rec *logb_alloc(struct log_binary_hdr *hdr, uint size)
+{
+	uint pos;
+
+	if (!hdr->count)
+		hdr->head = hdr->tail = 0;
+	pos = hdr->tail;
+	if (pos + size > hdr->size) {
+		/* Records between @pos and the end are lost when we wrap */
+		while (hdr->count && hdr->head >= pos)
+			logb_evict(hdr);
+		if (pos < hdr->size)
+			logb_at(hdr, pos)->size = 0;
+		pos = 0;
+	}
+	while (hdr->count && hdr->head >= pos && hdr->head < pos + size)
+		logb_evict(hdr);
+	if (!hdr->count)
+		hdr->head = pos;
+	hdr->tail = pos + size;
+	hdr->count++;
+
+	return logb_at(hdr, pos);
+}
+
+/**
+ * logb_pack() - Copy the arguments used by a format string
+ *
+ * @fmt: Format string
+ * @args: Arguments for @fmt
+ * @buf: Buffer for the arguments
+ * @size: Size of @buf in bytes
+ * Return: number of bytes used in @buf, or -E2BIG if there is not enough
+ *	space, or -ENOTSUPP if @fmt uses a conversion which cannot be deferred
+ */
+static int logb_pack(const char *fmt, va_list args, u8 *buf, int size)
+{
+	u8 *ptr = buf, *end = buf + size;
+	struct logb_spec spec;
+	const char *p;
+
+	for (p = fmt; *p; p++) {
+		if (*p != '%')
+			continue;
+		logb_parse(p, &spec);
+		p += spec.len - 1;
+		if (spec.type == LOGB_ARG_UNSUPP)
+			return -ENOTSUPP;
+		if (spec.type == LOGB_ARG_NONE)
+			continue;
+		if (end - ptr < sizeof(u64) * 3)
+			return -E2BIG;
+		if (spec.star_width) {
+			*(s64 *)ptr = va_arg(args, int);
+			ptr += sizeof(u64);
+		}
+		if (spec.star_prec) {
+			*(s64 *)ptr = va_arg(args, int);
+			ptr += sizeof(u64);
+		}
+
+		switch (spec.type) {
+		case LOGB_ARG_INT:
+			if (spec.signed_int)
+				*(s64 *)ptr = va_arg(args, int);
+			else
+				*(u64 *)ptr = va_arg(args, uint);
+			break;
+		case LOGB_ARG_LONG:
+			if (spec.signed_int)
+				*(s64 *)ptr = va_arg(args, long);
+			else
+				*(u64 *)ptr = va_arg(args, ulong);
+			break;
+		case LOGB_ARG_LLONG:
+			*(u64 *)ptr = va_arg(args, unsigned long long);
+			break;
+		case LOGB_ARG_SIZE:
+			*(u64 *)ptr = va_arg(args, size_t);
+			break;
+		case LOGB_ARG_PTR:
+			*(u64 *)ptr = (ulong)va_arg(args, void *);
+			break;
+		case LOGB_ARG_STR: {
+			const char *str = va_arg(args, const char *);
+			int len;
+
+			if (!str)
+				str = "(null)";
+			len = min(strnlen(str, LOGB_MAX_STR - 1),
+				  (size_t)(end - ptr - 1));
+			memcpy(ptr, str, len);
+			ptr[len] = '\0';
+			ptr += ALIGN(len + 1, sizeof(u64)) - sizeof(u64);
+			break;
+		}
+		default:
+			break;
+		}
+		ptr += sizeof(u64);
+	}
+
+	return ptr - buf;
+}
+
+static int log_binary_emit(struct log_device *ldev, struct log_rec *rec)
+{
+	struct log_binary_hdr *hdr;
+	struct log_binary_rec *brec;
+	u64 buf[LOGB_MAX_REC / sizeof(u64)];
+	struct log_binary_rec *tmp = (void *)buf;
+	int space = sizeof(buf) - sizeof(*tmp);
+	const char *func = rec->func ?: "";
+	char *text;
+	va_list args;
+	int len, func_len;
+
+	hdr = logb_get(true);
+	if (!hdr)
+		return -ENOSPC;
+
+	tmp->level = rec->level;
+	tmp->flags = rec->flags;
+	tmp->cat = rec->cat;
+	tmp->line = rec->line;
+	tmp->time_us = 0;
+	if (!CONFIG_IS_ENABLED(TIMER) || gd->timer)
+		tmp->time_us = timer_get_us();
+	tmp->fmt = (ulong)rec->fmt - logb_reloc_off();
+
+	/* The name may not be in the image, e.g. with 'log rec', so copy it */
+	len = strnlen(func, LOGB_MAX_FUNC - 1);
+	func_len = ALIGN(len + 1, sizeof(u64));
+	memcpy(tmp->args, func, len);
+	tmp->args[len] = '\0';
+	text = (char *)tmp->args + func_len;
+	space -= func_len;
+
+	len = -EFAULT;
+	if (logb_fmt_in_image(rec->fmt)) {
+		va_copy(args, *rec->args);
+		len = logb_pack(rec->fmt, args, (u8 *)text, space);
+		va_end(args);
+	}
+	if (len < 0) {
+		/* Fall back to storing the text */
+		tmp->flags |= LOGBF_TEXT;
+		if (rec->msg) {
+			strlcpy(text, rec->msg, space);
+		} else {
+			va_copy(args, *rec->args);
+			vsnprintf(text, space, rec->fmt, args);
+			va_end(args);
+		}
+		len = strlen(text) + 1;
+	}
+	tmp->size = ALIGN(sizeof(*tmp) + func_len + len, sizeof(u64));
+	if (tmp->size > hdr->size) {
+		hdr->dropped++;
+		return -E2BIG;
+	}
+
+	brec = logb_alloc(hdr, tmp->size);
+	memcpy(brec, tmp, tmp->size);
+
+	return 0;
+}
+
+/**
+ * logb_format() - Format a record's message
+ *
+ * @brec: Record to format
+ * @args: Start of the arguments, after the function name
+ * @buf: Buffer for the message
+ * @size: Size of @buf
+ */
+static void logb_format(struct log_binary_rec *brec, const u8 *args, char *buf,
+			int size)
+{
+	const u8 *ptr = args, *end = (u8 *)brec + brec->size;
+	char *out = buf, *out_end = buf + size;
+	const char *fmt, *p;
+	struct logb_spec spec;
+
+	if (brec->flags & LOGBF_TEXT) {
+		strlcpy(buf, (char *)args, min_t(int, size, end - args));
+		return;
+	}
+
+	fmt = (const char *)(ulong)(brec->fmt + logb_reloc_off());
+	for (p = fmt; *p && out < out_end - 1; p++) {
+		char spec_str[LOGB_MAX_SPEC_STR];
+		u64 val;
+
+		if (*p != '%') {
+			*out++ = *p;
+			continue;
+		}
+		logb_parse(p, &spec);
+		if (spec.type == LOGB_ARG_NONE) {
+			*out++ = '%';
+			p += spec.len - 1;
+			continue;
+		}
+		if (spec.type == LOGB_ARG_UNSUPP || ptr >= end)
+			break;
+
+		/* Put any '*' values into the specification itself */
+		if (spec.star_width || spec.star_prec) {
+			const char *s = p, *s_end = p + spec.len;
+			char *d = spec_str, *d_end = spec_str + sizeof(spec_str);
+
+			for (; s < s_end && d < d_end - 1; s++) {
+				if (*s == '*' && ptr < end) {
+					d += snprintf(d, d_end - d, "%d",
+						      (int)*(s64 *)ptr);
+					d = min(d, d_end - 1);
+					ptr += sizeof(u64);
+				} else {
+					*d++ = *s;
+				}
+			}
+			*d = '\0';
+			if (ptr >= end)
+				break;
+		} else {
+			strlcpy(spec_str, p, spec.len + 1);
+		}
+		p += spec.len - 1;
+
+		val = *(u64 *)ptr;
+		switch (spec.type) {
+		case LOGB_ARG_INT:
+			snprintf(out, out_end - out, spec_str, (int)val);
+			break;
+		case LOGB_ARG_LONG:
+			snprintf(out, out_end - out, spec_str, (long)val);
+			break;
+		case LOGB_ARG_LLONG:
+			snprintf(out, out_end - out, spec_str, (long long)val);
+			break;
+		case LOGB_ARG_SIZE:
+			snprintf(out, out_end - out, spec_str, (size_t)val);
+			break;
+		case LOGB_ARG_PTR:
+			snprintf(out, out_end - out, spec_str,
+				 (void *)(ulong)val);
+			break;
+		case LOGB_ARG_STR: {
+			const char *str = (const char *)ptr;
+
+			snprintf(out, out_end - out, spec_str, str);
+			ptr += ALIGN(strnlen(str, end - ptr) + 1, sizeof(u64)) -
+				sizeof(u64);
+			break;
+		}
+		default:
+			break;
+		}
+		ptr += sizeof(u64);
+		out += strlen(out);
+	}
+	*out = '\0';
+}
+
+int log_binary_dump(void)
+{
+	struct log_binary_hdr *hdr;
+	char buf[CONFIG_SYS_CBSIZE];
+	uint ofs, i;
+
+	hdr = logb_get(false);
+	if (!hdr)
+		return -ENOENT;
+
+	printf("Binary log: %u records, %u dropped\n", hdr->count,
+	       hdr->dropped);
+	for (i = 0, ofs = hdr->head; i < hdr->count; i++) {
+		struct log_binary_rec *brec;
+		const char *func;
+
+		ofs = logb_unwrap(hdr, ofs);
+		brec = logb_at(hdr, ofs);
+		ofs += brec->size;
+
+		func = (const char *)brec->args;
+		logb_format(brec, brec->args + ALIGN(strlen(func) + 1, sizeof(u64)),
+			    buf, sizeof(buf));
+		if (!(brec->flags & LOGRECF_CONT)) {
+			printf("%5llu.%06llu %s.%s,", brec->time_us / 1000000,
+			       brec->time_us % 1000000,
+			       log_get_level_name(brec->level),
+			       log_get_cat_name(brec->cat));
+			if (*func)
+				printf(" %s()", func);
+			putc(' ');
+		}
+		puts(buf);
+	}
+
+	return 0;
+}
+
+void log_binary_clear(void)
+{
+	struct log_binary_hdr *hdr;
+
+	hdr = logb_get(false);
+	if (hdr) {
+		hdr->head = 0;
+		hdr->tail = 0;
+		hdr->count = 0;
+		hdr->dropped = 0;
+	}
+}
+
+LOG_DRIVER(binary) = {
+	.name	= "binary",
+	.emit	= log_binary_emit,
+	.flags	= LOGDF_ENABLE | LOGDF_RAW,
+};
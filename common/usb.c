@@ -292,6 +292,55 @@ int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 		return -EIO;
 }
 
+/*-------------------------------------------------------------------
+ * submits several bulk messages, and waits for all of them. The host
+ * controller may run them back to back, otherwise they are sent one by
+ * one. Stops at the first message which fails; the ones after it keep
+ * the status USB_ST_NOT_PROC. dev->status and dev->act_len are those of
+ * the last message processed. returns 0 if Ok or negative if Error.
+ * synchronous behavior
+ */
+int usb_bulk_queue(struct usb_device *dev, struct usb_bulk_req *reqs,
+		   int count, int timeout)
+{
+	int ret = -ENOSYS;
+	int i;
+
+	if (count < 1 || count > USB_BULK_QUEUE_MAX)
+		return -EINVAL;
+	for (i = 0; i < count; i++) {
+		if (reqs[i].length < 0)
+			return -EINVAL;
+		reqs[i].act_len = 0;
+		reqs[i].status = USB_ST_NOT_PROC;
+	}
+
+	if (CONFIG_IS_ENABLED(DM_USB))
+		ret = submit_bulk_queue(dev, reqs, count);
+	if (ret == -ENOSYS) {
+		for (i = 0; i < count; i++) {
+			ret = usb_bulk_msg(dev, reqs[i].pipe, reqs[i].buffer,
+					   reqs[i].length, &reqs[i].act_len,
+					   timeout);
+			reqs[i].status = dev->status;
+			if (ret)
+				return ret;
+		}
+		return 0;
+	}
+	if (ret)
+		return ret;
+
+	for (i = 0; i < count; i++) {
+		dev->status = reqs[i].status;
+		dev->act_len = reqs[i].act_len;
+		if (dev->status)
+			return -EIO;
+	}
+
+	return 0;
+}
+
 /*-------------------------------------------------------------------
  * Max Packet stuff
  */
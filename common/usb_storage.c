@@ -39,12 +39,14 @@
 #include <log.h>
 #include <mapmem.h>
 #include <memalign.h>
+#include <time.h>
 #include <asm/byteorder.h>
 #include <asm/cache.h>
 #include <asm/processor.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <linux/delay.h>
+#include <linux/math64.h>
 
 #include <part.h>
 #include <usb.h>
@@ -73,6 +75,19 @@ static int usb_max_devs; /* number of highest available usb device */
 static struct blk_desc usb_dev_desc[USB_MAX_STOR_DEV];
 #endif
 
+/**
+ * struct us_stats - Transfer statistics for a mass-storage device
+ *
+ * @cmds: Number of READ or WRITE commands sent
+ * @bytes: Number of bytes transferred
+ * @us: Time taken by the transfers, in microseconds
+ */
+struct us_stats {
+	ulong cmds;
+	u64 bytes;
+	u64 us;
+};
+
 struct us_data;
 typedef int (*trans_cmnd)(struct scsi_cmd *cb, struct us_data *data);
 typedef int (*trans_reset)(struct us_data *data);
@@ -101,6 +116,7 @@ struct us_data {
 	trans_cmnd	transport;		/* transport routine */
 	unsigned short	max_xfer_blk;		/* maximum transfer blocks */
 	bool		cmd12;			/* use 12-byte commands (RBC/UFI) */
+	struct us_stats	stats[2];		/* read and write statistics */
 };
 
 #if !CONFIG_IS_ENABLED(BLK)
@@ -133,6 +149,49 @@ static void usb_show_progress(void)
 	debug(".");
 }
 
+/**
+ * usb_stor_account() - Add a transfer to a device's statistics
+ *
+ * @ss: Device which did the transfer
+ * @write: true for a write, false for a read
+ * @cmds: Number of commands sent
+ * @bytes: Number of bytes transferred
+ * @start: Time the transfer started, from timer_get_us()
+ */
+static void usb_stor_account(struct us_data *ss, bool write, ulong cmds,
+			     u64 bytes, ulong start)
+{
+	struct us_stats *st = &ss->stats[write];
+
+	st->cmds += cmds;
+	st->bytes += bytes;
+	st->us += timer_get_us() - start;
+}
+
+/**
+ * usb_stor_show_stats() - Show transfer statistics for a device
+ *
+ * @udev: USB device to show, which may have several LUNs
+ */
+static void usb_stor_show_stats(struct usb_device *udev)
+{
+	struct us_data *ss = udev->privptr;
+	int i;
+
+	if (!ss)
+		return;
+	printf("            Max transfer: %u blocks\n", ss->max_xfer_blk);
+	for (i = 0; i < ARRAY_SIZE(ss->stats); i++) {
+		const struct us_stats *st = &ss->stats[i];
+
+		if (!st->cmds)
+			continue;
+		printf("            %s: %lu commands, %llu KiB, %llu KiB/s\n",
+		       i ? "Write" : "Read", st->cmds, st->bytes >> 10,
+		       div64_u64(st->bytes * 1000000 >> 10, max(st->us, 1ULL)));
+	}
+}
+
 /*******************************************************************************
  * show info on storage devices; 'usb start/init' must be invoked earlier
  * as we only retrieve structures populated during devices initialization
@@ -150,6 +209,8 @@ int usb_stor_info(void)
 
 		printf("  Device %d: ", desc->devnum);
 		dev_print(desc);
+		if (!desc->lun)
+			usb_stor_show_stats(dev_get_parent_priv(dev_get_parent(dev)));
 		count++;
 	}
 #else
@@ -159,6 +220,8 @@ int usb_stor_info(void)
 		for (i = 0; i < usb_max_devs; i++) {
 			printf("  Device %d: ", i);
 			dev_print(&usb_dev_desc[i]);
+			if (!usb_dev_desc[i].lun)
+				usb_stor_show_stats(usb_dev_desc[i].priv);
 		}
 		return 0;
 	}
@@ -545,13 +608,9 @@ static int usb_stor_CB_reset(struct us_data *us)
  * Set up the command for a BBB device. Note that the actual SCSI
  * command is copied into cbw.CBWCDB.
  */
-static int usb_stor_BBB_comdat(struct scsi_cmd *srb, struct us_data *us)
+static int usb_stor_BBB_setup(struct scsi_cmd *srb, struct umass_bbb_cbw *cbw)
 {
-	int result;
-	int actlen;
 	int dir_in;
-	unsigned int pipe;
-	ALLOC_CACHE_ALIGN_BUFFER(struct umass_bbb_cbw, cbw, 1);
 
 	dir_in = US_DIRECTION(srb->cmd[0]);
 
@@ -560,6 +619,8 @@ static int usb_stor_BBB_comdat(struct scsi_cmd *srb, struct us_data *us)
 		dir_in, srb->lun, srb->cmdlen, srb->cmd, srb->datalen,
 		srb->pdata);
 	if (srb->cmdlen) {
+		int result;
+
 		for (result = 0; result < srb->cmdlen; result++)
 			printf("cmd[%d] %#x ", result, srb->cmd[result]);
 		printf("\n");
@@ -571,9 +632,6 @@ static int usb_stor_BBB_comdat(struct scsi_cmd *srb, struct us_data *us)
 		return -1;
 	}
 
-	/* always OUT to the ep */
-	pipe = usb_sndbulkpipe(us->pusb_dev, us->ep_out);
-
 	cbw->dCBWSignature = cpu_to_le32(CBWSIGNATURE);
 	cbw->dCBWTag = cpu_to_le32(CBWTag++);
 	cbw->dCBWDataTransferLength = cpu_to_le32(srb->datalen);
@@ -584,6 +642,25 @@ static int usb_stor_BBB_comdat(struct scsi_cmd *srb, struct us_data *us)
 	/* DST SRC LEN!!! */
 
 	memcpy(cbw->CBWCDB, srb->cmd, srb->cmdlen);
+
+	return 0;
+}
+
+/* Send the command for a BBB device */
+static int usb_stor_BBB_comdat(struct scsi_cmd *srb, struct us_data *us)
+{
+	int result;
+	int actlen;
+	unsigned int pipe;
+	ALLOC_CACHE_ALIGN_BUFFER(struct umass_bbb_cbw, cbw, 1);
+
+	result = usb_stor_BBB_setup(srb, cbw);
+	if (result < 0)
+		return result;
+
+	/* always OUT to the ep */
+	pipe = usb_sndbulkpipe(us->pusb_dev, us->ep_out);
+
 	result = usb_bulk_msg(us->pusb_dev, pipe, cbw, UMASS_BBB_CBW_SIZE,
 			      &actlen, USB_CNTL_TIMEOUT * 5);
 	if (result < 0)
@@ -722,14 +799,60 @@ static int usb_stor_BBB_transport(struct scsi_cmd *srb, struct us_data *us)
 	int result, retry;
 	int dir_in;
 	int actlen, data_actlen;
+	bool queued = false;
 	unsigned int pipe, pipein, pipeout;
 	ALLOC_CACHE_ALIGN_BUFFER(struct umass_bbb_csw, csw, 1);
+	ALLOC_CACHE_ALIGN_BUFFER(struct umass_bbb_cbw, cbw, 1);
+	struct usb_bulk_req req[3];
 #ifdef BBB_XPORT_TRACE
 	unsigned char *ptr;
 	int index;
 #endif
 
 	dir_in = US_DIRECTION(srb->cmd[0]);
+	pipein = usb_rcvbulkpipe(us->pusb_dev, us->ep_in);
+	pipeout = usb_sndbulkpipe(us->pusb_dev, us->ep_out);
+
+	/*
+	 * Once the device is ready, hand all three phases to the host
+	 * controller together so that it can run them back to back. Errors
+	 * are then dealt with as if the phases had been sent one by one.
+	 */
+	if (srb->datalen && (us->flags & USB_READY)) {
+		debug("COMMAND, DATA and STATUS phases\n");
+		if (usb_stor_BBB_setup(srb, cbw) < 0)
+			return USB_STOR_TRANSPORT_FAILED;
+		req[0] = (struct usb_bulk_req){
+			.pipe = pipeout,
+			.buffer = cbw,
+			.length = UMASS_BBB_CBW_SIZE,
+		};
+		req[1] = (struct usb_bulk_req){
+			.pipe = dir_in ? pipein : pipeout,
+			.buffer = srb->pdata,
+			.length = srb->datalen,
+		};
+		req[2] = (struct usb_bulk_req){
+			.pipe = pipein,
+			.buffer = csw,
+			.length = UMASS_BBB_CSW_SIZE,
+		};
+		result = usb_bulk_queue(us->pusb_dev, req, ARRAY_SIZE(req),
+					USB_CNTL_TIMEOUT * 5);
+		if (req[0].status) {
+			debug("failed to send CBW status %ld\n",
+			      us->pusb_dev->status);
+			usb_stor_BBB_reset(us);
+			return USB_STOR_TRANSPORT_FAILED;
+		}
+		queued = true;
+		data_actlen = req[1].act_len;
+		if (req[1].status)
+			goto data_done;
+		actlen = req[2].act_len;
+		retry = 0;
+		goto status_done;
+	}
 
 	/* COMMAND phase */
 	debug("COMMAND phase\n");
@@ -742,8 +865,6 @@ static int usb_stor_BBB_transport(struct scsi_cmd *srb, struct us_data *us)
 	}
 	if (!(us->flags & USB_READY))
 		mdelay(5);
-	pipein = usb_rcvbulkpipe(us->pusb_dev, us->ep_in);
-	pipeout = usb_sndbulkpipe(us->pusb_dev, us->ep_out);
 	/* DATA phase + error handling */
 	data_actlen = 0;
 	/* no data, go immediately to the STATUS phase */
@@ -757,12 +878,22 @@ static int usb_stor_BBB_transport(struct scsi_cmd *srb, struct us_data *us)
 
 	result = usb_bulk_msg(us->pusb_dev, pipe, srb->pdata, srb->datalen,
 			      &data_actlen, USB_CNTL_TIMEOUT * 5);
+data_done:
 	/* special handling of STALL in DATA phase */
 	if ((result < 0) && (us->pusb_dev->status & USB_ST_STALLED)) {
 		debug("DATA:stall\n");
 		/* clear the STALL on the endpoint */
 		result = usb_stor_BBB_clear_endpt_stall(us,
 					dir_in ? us->ep_in : us->ep_out);
+		/*
+		 * After a stalled OUT data phase the CSW may already have
+		 * arrived on the other endpoint; do not wait for another one
+		 */
+		if (result >= 0 && queued && !req[2].status) {
+			actlen = req[2].act_len;
+			retry = 0;
+			goto status_done;
+		}
 		if (result >= 0)
 			/* continue on to STATUS phase */
 			goto st;
@@ -785,7 +916,7 @@ again:
 	debug("STATUS phase\n");
 	result = usb_bulk_msg(us->pusb_dev, pipein, csw, UMASS_BBB_CSW_SIZE,
 				&actlen, USB_CNTL_TIMEOUT*5);
-
+status_done:
 	/* special handling of STALL in STATUS phase */
 	if ((result < 0) && (retry < 1) &&
 	    (us->pusb_dev->status & USB_ST_STALLED)) {
@@ -971,8 +1102,12 @@ static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 	 * Windows 7 limiting transfers to 128 sectors for both USB2 and USB3
 	 * and Apple Mac OS X 10.11 limiting transfers to 256 sectors for USB2
 	 * and 2048 for USB3 devices.
+	 *
+	 * SuperSpeed devices are recent enough not to have this problem, and
+	 * at their speed the fixed cost of each command is significant, so
+	 * follow Mac OS X (and Linux) and allow 2048 sectors for them.
 	 */
-	unsigned short blk = 240;
+	unsigned short blk = udev->speed >= USB_SPEED_SUPER ? 2048 : 240;
 
 #if CONFIG_IS_ENABLED(DM_USB)
 	size_t size;
@@ -1149,6 +1284,8 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	unsigned short smallblks;
 	struct usb_device *udev;
 	struct us_data *ss;
+	ulong start_us;
+	ulong cmds = 0;
 	int retry;
 	struct scsi_cmd *srb = &usb_ccb;
 #if CONFIG_IS_ENABLED(BLK)
@@ -1182,6 +1319,8 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	debug("\nusb_read: dev %d startblk " LBAF ", blccnt " LBAF " buffer %lx\n",
 	      block_dev->devnum, start, blks, buf_addr);
 
+	start_us = timer_get_us();
+
 	do {
 		/* XXX need some comment here */
 		retry = 2;
@@ -1195,6 +1334,7 @@ retry_it:
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
+		cmds++;
 		if (usb_read_10(srb, ss, start, smallblks)) {
 			debug("Read ERROR\n");
 			ss->flags &= ~USB_READY;
@@ -1211,6 +1351,8 @@ retry_it:
 
 	debug("usb_read: end startblk " LBAF ", blccnt %x buffer %lx\n",
 	      start, smallblks, buf_addr);
+	usb_stor_account(ss, false, cmds, (u64)blkcnt * block_dev->blksz,
+			 start_us);
 
 	usb_lock_async(udev, 0);
 	usb_disable_asynch(0); /* asynch transfer allowed */
@@ -1232,6 +1374,8 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 	unsigned short smallblks;
 	struct usb_device *udev;
 	struct us_data *ss;
+	ulong start_us;
+	ulong cmds = 0;
 	int retry;
 	struct scsi_cmd *srb = &usb_ccb;
 #if CONFIG_IS_ENABLED(BLK)
@@ -1267,6 +1411,8 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 	debug("\nusb_write: dev %d startblk " LBAF ", blccnt " LBAF " buffer %lx\n",
 	      block_dev->devnum, start, blks, buf_addr);
 
+	start_us = timer_get_us();
+
 	do {
 		/* If write fails retry for max retry count else
 		 * return with number of blocks written successfully.
@@ -1282,6 +1428,7 @@ retry_it:
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
+		cmds++;
 		if (usb_write_10(srb, ss, start, smallblks)) {
 			debug("Write ERROR\n");
 			ss->flags &= ~USB_READY;
@@ -1298,6 +1445,8 @@ retry_it:
 
 	debug("usb_write: end startblk " LBAF ", blccnt %x buffer %lx\n",
 	      start, smallblks, buf_addr);
+	usb_stor_account(ss, true, cmds, (u64)blkcnt * block_dev->blksz,
+			 start_us);
 
 	usb_lock_async(udev, 0);
 	usb_disable_asynch(0); /* asynch transfer allowed */
@@ -680,6 +680,14 @@ int part_get_info_by_name(struct blk_desc *desc, const char *name,
 		return -ENOSYS;
 	}
 
+	if (part_drv->find_name) {
+		i = part_drv->find_name(desc, name);
+		if (i > 0 && !part_drv->get_info(desc, i, info))
+			return i;
+		if (i != -ENOSYS)
+			return -ENOENT;
+	}
+
 	for (i = 1; i < part_drv->max_entries; i++) {
 		ret = part_drv->get_info(desc, i, info);
 		if (ret != 0) {
@@ -28,9 +28,13 @@
 #include <dm/ofnode.h>
 #include <linux/compiler.h>
 #include <linux/ctype.h>
+#include <linux/list.h>
+#include <linux/log2.h>
 #include <linux/printk.h>
 #include <u-boot/crc.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 /* GUID for basic data partitons */
 #if CONFIG_IS_ENABLED(EFI_PARTITION)
 static const efi_guid_t partition_basic_data_guid = PARTITION_BASIC_DATA_GUID;
@@ -189,6 +193,233 @@ static void prepare_backup_gpt_header(gpt_header *gpt_h)
 	gpt_h->header_crc32 = cpu_to_le32(calc_crc32);
 }
 
+#if CONFIG_IS_ENABLED(EFI_PARTITION_CACHE)
+/**
+ * struct gpt_cache - validated GPT of a block device
+ *
+ * @desc: Block device
+ * @hwpart: Hardware partition which was selected when the GPT was read
+ * @lba: Size of the device in blocks when the GPT was read
+ * @head: GPT header which was found to be valid
+ * @pte: Partition entries
+ * @names: Name of each partition entry, as returned by part_get_info()
+ * @hash: Open-addressing hash table of partition numbers (1 = first), indexed
+ *	by name; 0 marks an empty slot
+ * @hash_mask: Number of slots in @hash, minus one
+ * @sibling: Node in gpt_caches
+ */
+struct gpt_cache {
+	struct blk_desc *desc;
+	int hwpart;
+	lbaint_t lba;
+	gpt_header head;
+	gpt_entry *pte;
+	char (*names)[PART_NAME_LEN];
+	u16 *hash;
+	uint hash_mask;
+	struct list_head sibling;
+};
+
+static LIST_HEAD(gpt_caches);
+
+static uint gpt_name_hash(const char *name)
+{
+	uint hash = 0;
+
+	while (*name)
+		hash = hash * 31 + *name++;
+
+	return hash;
+}
+
+static void gpt_cache_free(struct gpt_cache *cache)
+{
+	list_del(&cache->sibling);
+	free(cache->pte);
+	free(cache->names);
+	free(cache->hash);
+	free(cache);
+}
+
+static struct gpt_cache *gpt_cache_find(struct blk_desc *desc)
+{
+	struct gpt_cache *cache;
+
+	list_for_each_entry(cache, &gpt_caches, sibling) {
+		if (cache->desc == desc && cache->hwpart == desc->hwpart &&
+		    cache->lba == desc->lba)
+			return cache;
+	}
+
+	return NULL;
+}
+
+/* Index the partition names, so that the first of each name is found */
+static int gpt_cache_index(struct gpt_cache *cache)
+{
+	uint count = le32_to_cpu(cache->head.num_partition_entries);
+	uint size, i;
+
+	if (count > U16_MAX)
+		return -E2BIG;
+	size = roundup_pow_of_two(count * 2);
+	cache->names = calloc(count, PART_NAME_LEN);
+	cache->hash = calloc(size, sizeof(*cache->hash));
+	if (!cache->names || !cache->hash)
+		return -ENOMEM;
+	cache->hash_mask = size - 1;
+
+	for (i = 0; i < count; i++) {
+		char *name = cache->names[i];
+		uint slot;
+
+		if (!is_pte_valid(&cache->pte[i]))
+			continue;
+		snprintf(name, PART_NAME_LEN, "%s",
+			 print_efiname(&cache->pte[i]));
+		for (slot = gpt_name_hash(name);; slot++) {
+			u16 *part = &cache->hash[slot & cache->hash_mask];
+
+			if (!*part)
+				*part = i + 1;
+			if (!strcmp(cache->names[*part - 1], name))
+				break;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Cache a GPT which was just validated. This takes over @pte, unless NULL is
+ * returned.
+ */
+static struct gpt_cache *gpt_cache_add(struct blk_desc *desc,
+				       gpt_header *gpt_head, gpt_entry *pte)
+{
+	struct gpt_cache *cache;
+
+	/* the cache would be lost on relocation */
+	if (!(gd->flags & GD_FLG_RELOC))
+		return NULL;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+	cache->desc = desc;
+	cache->hwpart = desc->hwpart;
+	cache->lba = desc->lba;
+	memcpy(&cache->head, gpt_head, sizeof(cache->head));
+	cache->pte = pte;
+	list_add(&cache->sibling, &gpt_caches);
+	if (gpt_cache_index(cache)) {
+		cache->pte = NULL;
+		gpt_cache_free(cache);
+		return NULL;
+	}
+
+	return cache;
+}
+
+/* Check whether the blocks may hold part of the GPT */
+static bool gpt_cache_overlaps(struct gpt_cache *cache, lbaint_t start,
+			       lbaint_t blkcnt)
+{
+	if (cache->hwpart != cache->desc->hwpart)
+		return false;
+
+	return start < le64_to_cpu(cache->head.first_usable_lba) ||
+	       start + blkcnt - 1 > le64_to_cpu(cache->head.last_usable_lba);
+}
+
+void part_cache_invalidate(struct blk_desc *desc, lbaint_t start,
+			   lbaint_t blkcnt)
+{
+	struct gpt_cache *cache, *next;
+
+	list_for_each_entry_safe(cache, next, &gpt_caches, sibling) {
+		if (desc && cache->desc != desc)
+			continue;
+		if (blkcnt && !gpt_cache_overlaps(cache, start, blkcnt))
+			continue;
+		gpt_cache_free(cache);
+	}
+}
+
+/**
+ * get_valid_gpt() - get the validated GPT header and PTEs of a device
+ *
+ * This is find_valid_gpt(), using the cached GPT where possible.
+ *
+ * @desc: Block device
+ * @gpt_head: Returns the GPT header; must hold a block
+ * @pgpt_pte: Returns the PTEs, which must be released with put_gpt_pte()
+ * Return: 1 if a valid GPT was found, 0 if not
+ */
+static int get_valid_gpt(struct blk_desc *desc, gpt_header *gpt_head,
+			 gpt_entry **pgpt_pte)
+{
+	struct gpt_cache *cache;
+
+	cache = gpt_cache_find(desc);
+	if (!cache) {
+		if (find_valid_gpt(desc, gpt_head, pgpt_pte) != 1)
+			return 0;
+		cache = gpt_cache_add(desc, gpt_head, *pgpt_pte);
+		if (!cache)
+			return 1;
+	}
+	memcpy(gpt_head, &cache->head, sizeof(cache->head));
+	*pgpt_pte = cache->pte;
+
+	return 1;
+}
+
+static void put_gpt_pte(struct blk_desc *desc, gpt_entry *pte)
+{
+	struct gpt_cache *cache = gpt_cache_find(desc);
+
+	if (!cache || cache->pte != pte)
+		free(pte);
+}
+
+static int part_find_name_efi(struct blk_desc *desc, const char *name)
+{
+	ALLOC_CACHE_ALIGN_BUFFER_PAD(gpt_header, gpt_head, 1, desc->blksz);
+	struct gpt_cache *cache;
+	gpt_entry *gpt_pte;
+	uint slot;
+
+	if (get_valid_gpt(desc, gpt_head, &gpt_pte) != 1)
+		return -ENOENT;
+	cache = gpt_cache_find(desc);
+	if (!cache || cache->pte != gpt_pte) {
+		free(gpt_pte);
+		return -ENOSYS;
+	}
+
+	for (slot = gpt_name_hash(name);; slot++) {
+		u16 part = cache->hash[slot & cache->hash_mask];
+
+		if (!part)
+			return -ENOENT;
+		if (!strcmp(cache->names[part - 1], name))
+			return part;
+	}
+}
+#else
+static int get_valid_gpt(struct blk_desc *desc, gpt_header *gpt_head,
+			 gpt_entry **pgpt_pte)
+{
+	return find_valid_gpt(desc, gpt_head, pgpt_pte);
+}
+
+static void put_gpt_pte(struct blk_desc *desc, gpt_entry *pte)
+{
+	free(pte);
+}
+#endif
+
 #if CONFIG_IS_ENABLED(EFI_PARTITION)
 /*
  * Public Functions (include/part.h)
@@ -205,14 +436,14 @@ int get_disk_guid(struct blk_desc *desc, char *guid)
 	unsigned char *guid_bin;
 
 	/* This function validates AND fills in the GPT header and PTE */
-	if (find_valid_gpt(desc, gpt_head, &gpt_pte) != 1)
+	if (get_valid_gpt(desc, gpt_head, &gpt_pte) != 1)
 		return -EINVAL;
 
 	guid_bin = gpt_head->disk_guid.b;
 	uuid_bin_to_str(guid_bin, guid, UUID_STR_FORMAT_GUID);
 
-	/* Remember to free pte */
-	free(gpt_pte);
+	/* Remember to release pte */
+	put_gpt_pte(desc, gpt_pte);
 	return 0;
 }
 
@@ -224,7 +455,7 @@ static void __maybe_unused part_print_efi(struct blk_desc *desc)
 	unsigned char *uuid;
 
 	/* This function validates AND fills in the GPT header and PTE */
-	if (find_valid_gpt(desc, gpt_head, &gpt_pte) != 1)
+	if (get_valid_gpt(desc, gpt_head, &gpt_pte) != 1)
 		return;
 
 	debug("%s: gpt-entry at %p\n", __func__, gpt_pte);
@@ -253,8 +484,8 @@ static void __maybe_unused part_print_efi(struct blk_desc *desc)
 		printf("\tguid:\t%pUl\n", uuid);
 	}
 
-	/* Remember to free pte */
-	free(gpt_pte);
+	/* Remember to release pte */
+	put_gpt_pte(desc, gpt_pte);
 	return;
 }
 
@@ -271,13 +502,13 @@ static int __maybe_unused part_get_info_efi(struct blk_desc *desc, int part,
 	}
 
 	/* This function validates AND fills in the GPT header and PTE */
-	if (find_valid_gpt(desc, gpt_head, &gpt_pte) != 1)
+	if (get_valid_gpt(desc, gpt_head, &gpt_pte) != 1)
 		return -EINVAL;
 
 	if (part > le32_to_cpu(gpt_head->num_partition_entries) ||
 	    !is_pte_valid(&gpt_pte[part - 1])) {
 		log_debug("Invalid partition number %d\n", part);
-		free(gpt_pte);
+		put_gpt_pte(desc, gpt_pte);
 		return -EPERM;
 	}
 
@@ -307,8 +538,8 @@ static int __maybe_unused part_get_info_efi(struct blk_desc *desc, int part,
 	log_debug("start 0x" LBAF ", size 0x" LBAF ", name %s\n", info->start,
 		  info->size, info->name);
 
-	/* Remember to free pte */
-	free(gpt_pte);
+	/* Remember to release pte */
+	put_gpt_pte(desc, gpt_pte);
 	return 0;
 }
 
@@ -383,6 +614,8 @@ int write_gpt_table(struct blk_desc *desc, gpt_header *gpt_h, gpt_entry *gpt_e)
 	u32 calc_crc32;
 
 	debug("max lba: %x\n", (u32)desc->lba);
+	part_cache_invalidate(desc, 0, 0);
+
 	/* Setup the Protective MBR */
 	if (set_protective_mbr(desc) < 0)
 		goto err;
@@ -740,6 +973,7 @@ static int write_one_gpt_table(struct blk_desc *desc, gpt_header *gpt_h,
 	lbaint_t start;
 	int ret = 0;
 
+	part_cache_invalidate(desc, 0, 0);
 	start = le64_to_cpu(gpt_h->my_lba);
 	if (blk_dwrite(desc, start, 1, gpt_h) != 1) {
 		ret = -1;
@@ -918,6 +1152,8 @@ int write_mbr_and_gpt_partitions(struct blk_desc *desc, void *buf)
 				   le32_to_cpu(gpt_h->sizeof_partition_entry)),
 				  desc);
 
+	part_cache_invalidate(desc, 0, 0);
+
 	/* write MBR */
 	lba = 0;	/* MBR is always at 0 */
 	cnt = 1;	/* MBR (1 block) */
@@ -1213,4 +1449,7 @@ U_BOOT_PART_TYPE(a_efi) = {
 	.get_info	= part_get_info_ptr(part_get_info_efi),
 	.print		= part_print_ptr(part_print_efi),
 	.test		= part_test_efi,
+#if CONFIG_IS_ENABLED(EFI_PARTITION_CACHE)
+	.find_name	= part_find_name_efi,
+#endif
 };
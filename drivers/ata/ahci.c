@@ -30,6 +30,7 @@
 #include <ahci.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
+#include "ahci_ncq.h"
 
 static int ata_io_flush(struct ahci_uc_priv *uc_priv, u8 port);
 
@@ -52,6 +53,8 @@ static int ata_io_flush(struct ahci_uc_priv *uc_priv, u8 port);
 #define WAIT_MS_LINKUP	200
 
 #define AHCI_CAP_S64A BIT(31)
+#define AHCI_CAP_SNCQ BIT(30)
+#define AHCI_CAP_NCS(cap)	((((cap) >> 8) & 0x1f) + 1)
 
 __weak void __iomem *ahci_port_base(void __iomem *base, u32 port)
 {
@@ -384,11 +387,9 @@ static int ahci_init_one(struct ahci_uc_priv *uc_priv, struct udevice *dev)
 
 #define MAX_DATA_BYTE_COUNT  (4*1024*1024)
 
-static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
+static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, struct ahci_sg *ahci_sg,
 			unsigned char *buf, int buf_len)
 {
-	struct ahci_ioports *pp = &(uc_priv->port[port]);
-	struct ahci_sg *ahci_sg = pp->cmd_tbl_sg;
 	phys_addr_t pa = virt_to_phys(buf);
 	u32 sg_count;
 	int i;
@@ -418,18 +419,23 @@ static int ahci_fill_sg(struct ahci_uc_priv *uc_priv, u8 port,
 	return sg_count;
 }
 
-static void ahci_fill_cmd_slot(struct ahci_ioports *pp, u32 opts)
+static void ahci_fill_cmd_hdr(struct ahci_cmd_hdr *hdr, ulong tbl, u32 opts)
 {
-	phys_addr_t pa = virt_to_phys((void *)pp->cmd_tbl);
+	phys_addr_t pa = virt_to_phys((void *)tbl);
 
-	pp->cmd_slot->opts = cpu_to_le32(opts);
-	pp->cmd_slot->status = 0;
-	pp->cmd_slot->tbl_addr = cpu_to_le32(lower_32_bits(pa));
+	hdr->opts = cpu_to_le32(opts);
+	hdr->status = 0;
+	hdr->tbl_addr = cpu_to_le32(lower_32_bits(pa));
 #ifdef CONFIG_PHYS_64BIT
-	pp->cmd_slot->tbl_addr_hi = cpu_to_le32(upper_32_bits(pa));
+	hdr->tbl_addr_hi = cpu_to_le32(upper_32_bits(pa));
 #endif
 }
 
+static void ahci_fill_cmd_slot(struct ahci_ioports *pp, u32 opts)
+{
+	ahci_fill_cmd_hdr(pp->cmd_slot, pp->cmd_tbl, opts);
+}
+
 static int wait_spinup(void __iomem *port_mmio)
 {
 	ulong start;
@@ -476,7 +482,7 @@ static int ahci_port_start(struct ahci_uc_priv *uc_priv, u8 port)
 	pp->cmd_slot =
 		(struct ahci_cmd_hdr *)(uintptr_t)virt_to_phys((void *)mem);
 	debug("cmd_slot = %p\n", pp->cmd_slot);
-	mem += (AHCI_CMD_SLOT_SZ + 224);
+	mem += AHCI_CMD_SLOT_SZ * AHCI_MAX_CMD_SLOT;
 
 	/*
 	 * Second item: Received-FIS area
@@ -544,7 +550,7 @@ static int ahci_device_data_io(struct ahci_uc_priv *uc_priv, u8 port, u8 *fis,
 
 	memcpy((unsigned char *)pp->cmd_tbl, fis, fis_len);
 
-	sg_count = ahci_fill_sg(uc_priv, port, buf, buf_len);
+	sg_count = ahci_fill_sg(uc_priv, pp->cmd_tbl_sg, buf, buf_len);
 	opts = (fis_len >> 2) | (sg_count << 16) | (is_write << 6);
 	ahci_fill_cmd_slot(pp, opts);
 
@@ -567,6 +573,153 @@ static int ahci_device_data_io(struct ahci_uc_priv *uc_priv, u8 port, u8 *fis,
 	return 0;
 }
 
+/*
+ * Stop and restart the command list engine, so that the port accepts
+ * commands again after one of them failed
+ */
+static void ahci_port_restart(void __iomem *port_mmio)
+{
+	u32 cmd = readl(port_mmio + PORT_CMD) & ~PORT_CMD_START;
+
+	writel_with_flush(cmd, port_mmio + PORT_CMD);
+	waiting_for_cmd_completed(port_mmio + PORT_CMD, 500, PORT_CMD_LIST_ON);
+
+	if (readl(port_mmio + PORT_TFDATA) & (ATA_BUSY | ATA_DRQ)) {
+		writel_with_flush(cmd | PORT_CMD_CLO, port_mmio + PORT_CMD);
+		waiting_for_cmd_completed(port_mmio + PORT_CMD, 500,
+					  PORT_CMD_CLO);
+	}
+
+	writel(readl(port_mmio + PORT_SCR_ERR), port_mmio + PORT_SCR_ERR);
+	writel(readl(port_mmio + PORT_IRQ_STAT), port_mmio + PORT_IRQ_STAT);
+	writel_with_flush(cmd | PORT_CMD_START, port_mmio + PORT_CMD);
+}
+
+/*
+ * Work out how many commands can be queued on a port and allocate a command
+ * table for each. NCQ is left disabled if the controller or the drive lacks
+ * it, or if the drive can only take one command at a time.
+ */
+static void ahci_ncq_init(struct ahci_uc_priv *uc_priv, u8 port)
+{
+	struct ahci_ioports *pp = &uc_priv->port[port];
+	u16 *id = uc_priv->ataid[port];
+	u32 depth;
+	void *mem;
+
+	if (!IS_ENABLED(CONFIG_SCSI_AHCI_NCQ) || pp->ncq_depth)
+		return;
+	if (!(uc_priv->cap & AHCI_CAP_SNCQ) || !ata_id_has_ncq(id))
+		return;
+
+	depth = min_t(u32, AHCI_CAP_NCS(uc_priv->cap), ata_id_queue_depth(id));
+	depth = min_t(u32, depth, AHCI_MAX_CMD_SLOT);
+	if (depth < 2)
+		return;
+
+	mem = memalign(128, depth * AHCI_CMD_TBL_SZ);
+	if (!mem) {
+		printf("%s: No mem for NCQ tables\n", __func__);
+		return;
+	}
+	memset(mem, '\0', depth * AHCI_CMD_TBL_SZ);
+	pp->ncq_tbl = virt_to_phys(mem);
+	pp->ncq_depth = depth;
+	debug("scsi_ahci: port %d: NCQ depth %u\n", port, depth);
+}
+
+/*
+ * After a queued command fails the drive aborts all the others and refuses
+ * any more until its NCQ error log has been read. Restart the port, then read
+ * the log so that the drive accepts commands again.
+ */
+static void ahci_ncq_recover(struct ahci_uc_priv *uc_priv, u8 port)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(u8, log, ATA_SECT_SIZE);
+	u8 fis[AHCI_NCQ_FIS_LEN];
+
+	ahci_port_restart(uc_priv->port[port].port_mmio);
+
+	memset(fis, '\0', sizeof(fis));
+	fis[0] = 0x27;		/* Host to device FIS. */
+	fis[1] = 1 << 7;	/* Command FIS. */
+	fis[2] = ATA_CMD_READ_LOG_EXT;
+	fis[4] = ATA_LOG_SATA_NCQ;
+	fis[12] = 1;		/* one page */
+	if (ahci_device_data_io(uc_priv, port, fis, sizeof(fis), log,
+				ATA_SECT_SIZE, 0)) {
+		debug("scsi_ahci: port %d: cannot read NCQ error log\n", port);
+		return;
+	}
+	debug("scsi_ahci: port %d: NCQ error on tag %d, status %x error %x\n",
+	      port, log[0] & 0x1f, log[2], log[3]);
+}
+
+/*
+ * Queue READ/WRITE FPDMA QUEUED commands of up to MAX_SATA_BLOCKS_READ_WRITE
+ * blocks each, one per slot, and wait for them all to complete.
+ *
+ * Returns the number of blocks transferred, or -ve on error
+ */
+static int ahci_ncq_data_io(struct ahci_uc_priv *uc_priv, u8 port,
+			    lbaint_t lba, u8 *buf, u32 blocks, u8 is_write)
+{
+	struct ahci_ioports *pp = &uc_priv->port[port];
+	void __iomem *port_mmio = pp->port_mmio;
+	u32 counts[AHCI_MAX_CMD_SLOT];
+	u32 done = 0, mask;
+	ulong start;
+	int tag;
+
+	mask = ahci_ncq_split(blocks, pp->ncq_depth, MAX_SATA_BLOCKS_READ_WRITE,
+			      counts);
+	for (tag = 0; tag < pp->ncq_depth && (mask & BIT(tag)); tag++) {
+		ulong tbl = pp->ncq_tbl + tag * AHCI_CMD_TBL_SZ;
+		int sg_count;
+
+		ahci_ncq_fill_fis((u8 *)tbl, lba + done, counts[tag], tag,
+				  is_write);
+		sg_count = ahci_fill_sg(uc_priv,
+					(struct ahci_sg *)(tbl + AHCI_CMD_TBL_HDR),
+					buf + done * ATA_SECT_SIZE,
+					counts[tag] * ATA_SECT_SIZE);
+		if (sg_count < 0)
+			return -EINVAL;
+		ahci_fill_cmd_hdr(&pp->cmd_slot[tag], tbl,
+				  (AHCI_NCQ_FIS_LEN >> 2) | (sg_count << 16) |
+				  (is_write << 6));
+		done += counts[tag];
+	}
+
+	ahci_dcache_flush_sata_cmd(pp);
+	ahci_dcache_flush_range(pp->ncq_tbl, tag * AHCI_CMD_TBL_SZ);
+	ahci_dcache_flush_range((unsigned long)buf, done * ATA_SECT_SIZE);
+
+	writel(readl(port_mmio + PORT_IRQ_STAT), port_mmio + PORT_IRQ_STAT);
+	writel_with_flush(mask, port_mmio + PORT_SCR_ACT);
+	writel_with_flush(mask, port_mmio + PORT_CMD_ISSUE);
+
+	start = get_timer(0);
+	while ((readl(port_mmio + PORT_SCR_ACT) |
+		readl(port_mmio + PORT_CMD_ISSUE)) & mask) {
+		if (readl(port_mmio + PORT_IRQ_STAT) & PORT_IRQ_TF_ERR) {
+			debug("scsi_ahci: NCQ error, tfd %x\n",
+			      readl(port_mmio + PORT_TFDATA));
+			ahci_ncq_recover(uc_priv, port);
+			return -EIO;
+		}
+		if (get_timer(start) > WAIT_MS_DATAIO) {
+			printf("timeout exit!\n");
+			ahci_ncq_recover(uc_priv, port);
+			return -ETIMEDOUT;
+		}
+	}
+
+	ahci_dcache_invalidate_range((unsigned long)buf, done * ATA_SECT_SIZE);
+
+	return done;
+}
+
 static char *ata_id_strcpy(u16 *target, u16 *src, int len)
 {
 	int i;
@@ -638,6 +791,7 @@ static int ata_scsiop_inquiry(struct ahci_uc_priv *uc_priv,
 	memcpy(&pccb->pdata[8], "ATA     ", 8);
 	ata_id_strcpy((u16 *)&pccb->pdata[16], &idbuf[ATA_ID_PROD], 16);
 	ata_id_strcpy((u16 *)&pccb->pdata[32], &idbuf[ATA_ID_FW_REV], 4);
+	ahci_ncq_init(uc_priv, port);
 
 #ifdef DEBUG
 	ata_dump_id(idbuf);
@@ -686,6 +840,43 @@ static int ata_scsiop_read_write(struct ahci_uc_priv *uc_priv,
 	debug("scsi_ahci: %s %u blocks starting from lba 0x" LBAFU "\n",
 	      is_write ?  "write" : "read", blocks, lba);
 
+	/* Use NCQ when the request needs more than one command */
+	if (uc_priv->port[pccb->target].ncq_depth &&
+	    blocks > MAX_SATA_BLOCKS_READ_WRITE) {
+		if (blocks * ATA_SECT_SIZE > user_buffer_size) {
+			printf("scsi_ahci: Error: buffer too small.\n");
+			return -EIO;
+		}
+
+		while (blocks) {
+			int ret;
+
+			ret = ahci_ncq_data_io(uc_priv, pccb->target, lba,
+					       user_buffer, blocks, is_write);
+			if (ret < 0) {
+				debug("scsi_ahci: SCSI %s10 NCQ failure (err=%d)\n",
+				      is_write ? "WRITE" : "READ", ret);
+				break;
+			}
+			user_buffer += ret * ATA_SECT_SIZE;
+			user_buffer_size -= ret * ATA_SECT_SIZE;
+			blocks -= ret;
+			lba += ret;
+		}
+
+		if (!blocks) {
+			/* one flush covers all the queued writes */
+			if (is_write && ata_io_flush(uc_priv, pccb->target))
+				return -EIO;
+			return 0;
+		}
+
+		/*
+		 * A batch failed: send it and the rest of the transfer one
+		 * command at a time
+		 */
+	}
+
 	/* Preset the FIS */
 	memset(fis, 0, sizeof(fis));
 	fis[0] = 0x27;		 /* Host to device FIS. */
@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Setting up native command queuing (NCQ) commands for AHCI
+ */
+
+#ifndef __AHCI_NCQ_H
+#define __AHCI_NCQ_H
+
+#include <libata.h>
+#include <linux/bitops.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/types.h>
+
+/* Size of a register host-to-device FIS, in bytes */
+#define AHCI_NCQ_FIS_LEN	20
+
+/**
+ * ahci_ncq_fill_fis() - Set up a READ/WRITE FPDMA QUEUED command
+ *
+ * Unlike READ/WRITE DMA EXT the block count goes in the features registers
+ * and the tag in the upper bits of the count register.
+ *
+ * @fis: Returns the register host-to-device FIS (AHCI_NCQ_FIS_LEN bytes)
+ * @lba: First block to transfer
+ * @count: Number of blocks to transfer, 1 to 65535
+ * @tag: Command slot which holds the command, 0 to 31
+ * @is_write: true to write to the drive, false to read from it
+ */
+static inline void ahci_ncq_fill_fis(u8 *fis, u64 lba, u32 count, int tag,
+				     bool is_write)
+{
+	memset(fis, '\0', AHCI_NCQ_FIS_LEN);
+	fis[0] = 0x27;		/* Host to device FIS. */
+	fis[1] = 1 << 7;	/* Command FIS. */
+	fis[2] = is_write ? ATA_CMD_FPDMA_WRITE : ATA_CMD_FPDMA_READ;
+	fis[3] = count & 0xff;	/* the count goes in the features */
+	fis[4] = lba & 0xff;
+	fis[5] = (lba >> 8) & 0xff;
+	fis[6] = (lba >> 16) & 0xff;
+	fis[7] = 1 << 6;	/* device reg: set LBA mode */
+	fis[8] = (lba >> 24) & 0xff;
+	fis[9] = (lba >> 32) & 0xff;
+	fis[10] = (lba >> 40) & 0xff;
+	fis[11] = (count >> 8) & 0xff;
+	fis[12] = tag << 3;
+}
+
+/**
+ * ahci_ncq_split() - Share out a transfer between the command slots
+ *
+ * Slots are used in order from 0, each taking up to @max blocks, until either
+ * the transfer or the slots run out.
+ *
+ * @blocks: Number of blocks left to transfer
+ * @depth: Number of slots available, at most 32
+ * @max: Largest number of blocks for one command
+ * @counts: Returns the number of blocks for each slot used; must have room
+ *	for @depth entries
+ * Return: mask of the slots used, for PxSACT and PxCI
+ */
+static inline u32 ahci_ncq_split(u32 blocks, u32 depth, u32 max, u32 *counts)
+{
+	u32 mask = 0;
+	int tag;
+
+	for (tag = 0; blocks && tag < depth; tag++) {
+		counts[tag] = min(blocks, max);
+		blocks -= counts[tag];
+		mask |= BIT(tag);
+	}
+
+	return mask;
+}
+
+#endif
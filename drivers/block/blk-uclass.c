@@ -8,6 +8,7 @@
 
 #include <blk.h>
 #include <dm.h>
+#include <fs.h>
 #include <log.h>
 #include <malloc.h>
 #include <part.h>
@@ -322,11 +323,15 @@ int blk_show_device(enum uclass_id uclass_id, int devnum)
 int blk_select_hwpart(struct udevice *dev, int hwpart)
 {
 	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_desc *desc;
 
 	if (!ops)
 		return -ENOSYS;
 	if (!ops->select_hwpart)
 		return 0;
+	desc = dev_get_uclass_plat(dev);
+	if (desc->hwpart != hwpart)
+		part_cache_invalidate(desc, 0, 0);
 
 	return ops->select_hwpart(dev, hwpart);
 }
@@ -478,6 +483,8 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		return -ENOSYS;
 
 	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	part_cache_invalidate(desc, start, blkcnt);
+	fs_invalidate(desc);
 
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
@@ -510,6 +517,8 @@ long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
 		return -ENOSYS;
 
 	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	part_cache_invalidate(desc, start, blkcnt);
+	fs_invalidate(desc);
 
 	return ops->erase(dev, start, blkcnt);
 }
@@ -865,9 +874,20 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+
+	part_cache_invalidate(desc, 0, 0);
+	fs_invalidate(desc);
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
 	.per_device_plat_auto	= sizeof(struct blk_desc),
 };
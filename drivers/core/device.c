@@ -8,6 +8,7 @@
  * Pavel Herrmann <morpheus.ibis@gmail.com>
  */
 
+#include <bootstage.h>
 #include <cpu_func.h>
 #include <errno.h>
 #include <event.h>
@@ -478,17 +479,11 @@ static int device_get_dma_constraints(struct udevice *dev)
 	return 0;
 }
 
-int device_probe(struct udevice *dev)
+static int device_do_probe(struct udevice *dev)
 {
 	const struct driver *drv;
 	int ret;
 
-	if (!dev)
-		return -EINVAL;
-
-	if (dev_get_flags(dev) & DM_FLAG_ACTIVATED)
-		return 0;
-
 	ret = device_notify(dev, EVT_DM_PRE_PROBE);
 	if (ret)
 		return ret;
@@ -616,6 +611,27 @@ fail:
 	return ret;
 }
 
+int device_probe(struct udevice *dev)
+{
+	int timing, ret;
+
+	if (!dev)
+		return -EINVAL;
+
+	if (dev_get_flags(dev) & DM_FLAG_ACTIVATED)
+		return 0;
+
+	if (!CONFIG_IS_ENABLED(BOOTSTAGE_TIMING))
+		return device_do_probe(dev);
+
+	/* Parents are probed inside this, so are timed as nested records */
+	timing = bootstage_timing_start(BOOTSTAGE_TIMING_PROBE, dev->name);
+	ret = device_do_probe(dev);
+	bootstage_timing_end(timing);
+
+	return ret;
+}
+
 void *dev_get_plat(const struct udevice *dev)
 {
 	if (!dev) {
@@ -29,6 +29,7 @@
 #include <linux/ctype.h>
 #include <linux/err.h>
 #include <linux/ioport.h>
+#include <linux/log2.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -47,6 +48,15 @@ static struct device_node *of_stdout;
 /* pointer to options given after the alias (separated by :) or NULL if none */
 static const char *of_stdout_options;
 
+/* nodes of the tree at of_phandles_root by phandle, see of_phandle_scan() */
+static struct device_node **of_phandles;
+
+/* tree indexed in of_phandles */
+static struct device_node *of_phandles_root;
+
+/* number of entries in of_phandles, minus one */
+static uint of_phandles_mask;
+
 /**
  * struct alias_prop - Alias property in 'aliases' node
  *
@@ -445,6 +455,27 @@ struct device_node *of_find_node_by_prop_value(struct device_node *from,
 	return np;
 }
 
+/* Look up a phandle of the control tree in the index, if there is one */
+static bool of_phandle_lookup(phandle handle, struct device_node **npp)
+{
+	struct device_node *np;
+	uint slot;
+
+	if (!CONFIG_IS_ENABLED(OF_PHANDLE_INDEX) || !gd->of_root)
+		return false;
+	if (of_phandles_root != gd->of_root && of_phandle_scan())
+		return false;
+
+	for (slot = handle; (np = of_phandles[slot & of_phandles_mask]);
+	     slot++) {
+		if (np->phandle == handle)
+			break;
+	}
+	*npp = np;
+
+	return true;
+}
+
 struct device_node *of_find_node_by_phandle(struct device_node *root,
 					    phandle handle)
 {
@@ -453,6 +484,9 @@ struct device_node *of_find_node_by_phandle(struct device_node *root,
 	if (!handle)
 		return NULL;
 
+	if ((!root || root == gd->of_root) && of_phandle_lookup(handle, &np))
+		return np;
+
 	for_each_of_allnodes_from(root, np)
 		if (np->phandle == handle)
 			break;
@@ -935,6 +969,58 @@ struct device_node *of_get_stdout(void)
 	return of_stdout;
 }
 
+int of_phandle_scan(void)
+{
+	struct device_node **phandles, *np;
+	uint size, count = 0;
+
+	if (!CONFIG_IS_ENABLED(OF_PHANDLE_INDEX))
+		return 0;
+
+	of_phandle_invalidate(NULL);
+	for_each_of_allnodes(np) {
+		if (np->phandle)
+			count++;
+	}
+
+	/* leave at least half of the slots empty, to keep probes short */
+	size = roundup_pow_of_two(count * 2 + 1);
+	phandles = calloc(size, sizeof(*phandles));
+	if (!phandles)
+		return -ENOMEM;
+
+	/* a search finds the first node with a phandle, so keep that one */
+	for_each_of_allnodes(np) {
+		uint slot;
+
+		if (!np->phandle)
+			continue;
+		for (slot = np->phandle;; slot++) {
+			struct device_node **entry = &phandles[slot & (size - 1)];
+
+			if (!*entry)
+				*entry = np;
+			if ((*entry)->phandle == np->phandle)
+				break;
+		}
+	}
+	of_phandles = phandles;
+	of_phandles_root = gd->of_root;
+	of_phandles_mask = size - 1;
+
+	return 0;
+}
+
+void of_phandle_invalidate(const struct device_node *root)
+{
+	if (root && root != of_phandles_root)
+		return;
+
+	free(of_phandles);
+	of_phandles = NULL;
+	of_phandles_root = NULL;
+}
+
 int of_write_prop(struct device_node *np, const char *propname, int len,
 		  const void *value)
 {
@@ -1074,7 +1160,7 @@ int of_remove_property(struct device_node *np, struct property *prop)
 int of_remove_node(struct device_node *to_remove)
 {
 	struct device_node *parent = to_remove->parent;
-	struct device_node *np, *prev;
+	struct device_node *np, *prev, *root;
 
 	if (!parent)
 		return -EPERM;
@@ -1087,6 +1173,11 @@ int of_remove_node(struct device_node *to_remove)
 	if (!np)
 		return -EFAULT;
 
+	/* drop the phandle index of the tree; it is rebuilt when next used */
+	for (root = parent; root->parent; root = root->parent)
+		;
+	of_phandle_invalidate(root);
+
 	/* if there is a previous node, link it to this one's sibling */
 	if (prev)
 		prev->sibling = np->sibling;
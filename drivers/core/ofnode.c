@@ -19,6 +19,7 @@
 #include <dm/util.h>
 #include <linux/err.h>
 #include <linux/ioport.h>
+#include <linux/log2.h>
 #include <asm/global_data.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -705,6 +706,106 @@ int ofnode_get_path(ofnode node, char *buf, int buflen)
 	}
 }
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_INDEX)
+/**
+ * struct oftree_phandle - entry in the phandle index of the control FDT
+ *
+ * @phandle: Phandle of the node, 0 if the slot is empty
+ * @offset: Offset of the node
+ */
+struct oftree_phandle {
+	u32 phandle;
+	int offset;
+};
+
+/* phandle index of oftree_phandles_fdt, see oftree_phandle_offset() */
+static struct oftree_phandle *oftree_phandles;
+static const void *oftree_phandles_fdt;
+static uint oftree_phandles_mask;
+
+static int oftree_phandle_scan(const void *fdt)
+{
+	struct oftree_phandle *phandles;
+	uint size, count = 0;
+	int offset;
+
+	oftree_phandle_invalidate(oftree_phandles_fdt);
+	for (offset = fdt_next_node(fdt, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(fdt, offset, NULL)) {
+		if (fdt_get_phandle(fdt, offset))
+			count++;
+	}
+
+	size = roundup_pow_of_two(count * 2 + 1);
+	phandles = calloc(size, sizeof(*phandles));
+	if (!phandles)
+		return -ENOMEM;
+
+	/* keep the first node with each phandle, as a search would */
+	for (offset = fdt_next_node(fdt, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(fdt, offset, NULL)) {
+		u32 phandle = fdt_get_phandle(fdt, offset);
+		uint slot;
+
+		if (!phandle)
+			continue;
+		for (slot = phandle;; slot++) {
+			struct oftree_phandle *ent = &phandles[slot & (size - 1)];
+
+			if (!ent->phandle) {
+				ent->phandle = phandle;
+				ent->offset = offset;
+			}
+			if (ent->phandle == phandle)
+				break;
+		}
+	}
+	oftree_phandles = phandles;
+	oftree_phandles_fdt = fdt;
+	oftree_phandles_mask = size - 1;
+
+	return 0;
+}
+
+void oftree_phandle_invalidate(const void *fdt)
+{
+	if (fdt != oftree_phandles_fdt)
+		return;
+
+	free(oftree_phandles);
+	oftree_phandles = NULL;
+	oftree_phandles_fdt = NULL;
+}
+
+int oftree_phandle_offset(const void *fdt, uint phandle)
+{
+	struct oftree_phandle *ent;
+	int offset;
+	uint slot;
+
+	if (fdt != gd->fdt_blob || !(gd->flags & GD_FLG_RELOC) || !phandle ||
+	    phandle == ~0U ||
+	    (fdt != oftree_phandles_fdt && oftree_phandle_scan(fdt)))
+		return fdt_node_offset_by_phandle(fdt, phandle);
+
+	for (slot = phandle;; slot++) {
+		ent = &oftree_phandles[slot & oftree_phandles_mask];
+		if (!ent->phandle || ent->phandle == phandle)
+			break;
+	}
+
+	/* check the node in case the tree was changed without telling us */
+	if (ent->phandle && fdt_get_phandle(fdt, ent->offset) == phandle)
+		return ent->offset;
+
+	offset = fdt_node_offset_by_phandle(fdt, phandle);
+	if (offset >= 0)
+		oftree_phandle_invalidate(fdt);
+
+	return offset;
+}
+#endif
+
 ofnode ofnode_get_by_phandle(uint phandle)
 {
 	ofnode node;
@@ -712,8 +813,7 @@ ofnode ofnode_get_by_phandle(uint phandle)
 	if (of_live_active())
 		node = np_to_ofnode(of_find_node_by_phandle(NULL, phandle));
 	else
-		node.of_offset = fdt_node_offset_by_phandle(gd->fdt_blob,
-							    phandle);
+		node.of_offset = oftree_phandle_offset(gd->fdt_blob, phandle);
 
 	return node;
 }
@@ -726,8 +826,8 @@ ofnode oftree_get_by_phandle(oftree tree, uint phandle)
 		node = np_to_ofnode(of_find_node_by_phandle(tree.np, phandle));
 	else
 		node = ofnode_from_tree_offset(tree,
-			fdt_node_offset_by_phandle(oftree_lookup_fdt(tree),
-						   phandle));
+			oftree_phandle_offset(oftree_lookup_fdt(tree),
+					      phandle));
 
 	return node;
 }
@@ -1623,6 +1723,8 @@ int ofnode_write_prop(ofnode node, const char *propname, const void *value,
 			free(newval);
 		return ret;
 	} else {
+		oftree_phandle_invalidate(ofnode_to_fdt(node));
+
 		return fdt_setprop(ofnode_to_fdt(node), ofnode_to_offset(node),
 				   propname, value, len);
 	}
@@ -1687,6 +1789,8 @@ int ofnode_delete_prop(ofnode node, const char *propname)
 			return of_remove_property(ofnode_to_np(node), prop);
 		return 0;
 	} else {
+		oftree_phandle_invalidate(ofnode_to_fdt(node));
+
 		return fdt_delprop(ofnode_to_fdt(node), ofnode_to_offset(node),
 				   propname);
 	}
@@ -1891,6 +1995,7 @@ int ofnode_add_subnode(ofnode node, const char *name, ofnode *subnodep)
 		int poffset = ofnode_to_offset(node);
 		int offset;
 
+		oftree_phandle_invalidate(fdt);
 		offset = fdt_add_subnode(fdt, poffset, name);
 		if (offset == -FDT_ERR_EXISTS) {
 			offset = fdt_subnode_offset(fdt, poffset, name);
@@ -1918,6 +2023,7 @@ int ofnode_delete(ofnode *nodep)
 		void *fdt = ofnode_to_fdt(node);
 		int offset = ofnode_to_offset(node);
 
+		oftree_phandle_invalidate(fdt);
 		ret = fdt_del_node(fdt, offset);
 		if (ret)
 			ret = -EFAULT;
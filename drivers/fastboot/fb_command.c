@@ -10,8 +10,11 @@
 #include <fastboot-internal.h>
 #include <fb_mmc.h>
 #include <fb_nand.h>
+#include <image-sparse.h>
 #include <part.h>
 #include <stdlib.h>
+#include <time.h>
+#include <u-boot/crc.h>
 #include <vsprintf.h>
 #include <linux/printk.h>
 
@@ -30,6 +33,26 @@ static u32 fastboot_bytes_received;
  */
 static u32 fastboot_bytes_expected;
 
+/**
+ * download_start - time at which the current download started, in ms
+ */
+static ulong download_start;
+
+/**
+ * download_crc - CRC32 of the data received so far, if FASTBOOT_MMC_VERIFY
+ */
+static u32 download_crc;
+
+/**
+ * flash_sparse - statistics of the last sparse flash, reported as INFO
+ */
+static struct sparse_storage flash_sparse;
+
+/**
+ * flash_sparse_next - next statistic of @flash_sparse to report
+ */
+static int flash_sparse_next;
+
 static void okay(char *, char *);
 static void getvar(char *, char *);
 static void download(char *, char *);
@@ -43,6 +66,7 @@ static void oem_partconf(char *, char *);
 static void oem_bootbus(char *, char *);
 static void oem_console(char *, char *);
 static void oem_board(char *, char *);
+static void oem_stream(char *, char *);
 static void run_ucmd(char *, char *);
 static void run_acmd(char *, char *);
 
@@ -118,6 +142,10 @@ static const struct {
 		.command = "oem board",
 		.dispatch = CONFIG_IS_ENABLED(FASTBOOT_OEM_BOARD, (oem_board), (NULL))
 	},
+	[FASTBOOT_COMMAND_OEM_STREAM] = {
+		.command = "oem stream",
+		.dispatch = CONFIG_IS_ENABLED(FASTBOOT_MMC_STREAM, (oem_stream), (NULL))
+	},
 	[FASTBOOT_COMMAND_UCMD] = {
 		.command = "UCmd",
 		.dispatch = CONFIG_IS_ENABLED(FASTBOOT_UUU_SUPPORT, (run_ucmd), (NULL))
@@ -163,12 +191,50 @@ int fastboot_handle_command(char *cmd_string, char *response)
 	return -1;
 }
 
+void fastboot_flash_sparse_okay(const struct sparse_storage *sparse,
+				char *response)
+{
+	memcpy(flash_sparse.stats, sparse->stats, sizeof(flash_sparse.stats));
+	flash_sparse_next = 0;
+	fastboot_response(FASTBOOT_MULTIRESPONSE_START, response, NULL);
+}
+
+/**
+ * flash_sparse_info() - Send the next sparse flash statistic
+ *
+ * @response: Pointer to fastboot response buffer
+ */
+static void flash_sparse_info(char *response)
+{
+	char line[FASTBOOT_RESPONSE_LEN - 4];
+	int type;
+
+	for (type = flash_sparse_next; type < SPARSE_STAT_COUNT; type++) {
+		if (flash_sparse.stats[type].chunks)
+			break;
+	}
+	if (type == SPARSE_STAT_COUNT) {
+		fastboot_okay(NULL, response);
+		return;
+	}
+
+	sparse_stat_format(&flash_sparse, type, line, sizeof(line));
+	fastboot_response("INFO", response, "%s", line);
+	flash_sparse_next = type + 1;
+}
+
 void fastboot_multiresponse(int cmd, char *response)
 {
 	switch (cmd) {
 	case FASTBOOT_COMMAND_GETVAR:
 		fastboot_getvar_all(response);
 		break;
+	case FASTBOOT_COMMAND_FLASH:
+		if (CONFIG_IS_ENABLED(FASTBOOT_FLASH))
+			flash_sparse_info(response);
+		else
+			fastboot_fail("Unknown multiresponse command", response);
+		break;
 	case FASTBOOT_COMMAND_OEM_CONSOLE:
 		if (CONFIG_IS_ENABLED(FASTBOOT_CMD_OEM_CONSOLE)) {
 			char buf[FASTBOOT_RESPONSE_LEN] = { 0 };
@@ -207,6 +273,30 @@ static void okay(char *cmd_parameter, char *response)
 	fastboot_okay(NULL, response);
 }
 
+/**
+ * print_rate() - Print how long a transfer took and its rate
+ *
+ * @bytes: Number of bytes transferred
+ * @start: Time at which the transfer started, from get_timer()
+ */
+static void print_rate(u32 bytes, ulong start)
+{
+	ulong ms = max(get_timer(start), 1UL);
+	ulong rate = bytes / ms;	/* kB/s */
+
+	printf(" in %lu ms (%lu.%02lu MB/s)\n", ms, rate / 1000,
+	       rate % 1000 / 10);
+}
+
+u32 fastboot_image_crc32(const void *buffer, u32 size)
+{
+	if (IS_ENABLED(CONFIG_FASTBOOT_MMC_VERIFY) &&
+	    buffer == fastboot_buf_addr && size == image_size)
+		return download_crc;
+
+	return crc32(0, buffer, size);
+}
+
 /**
  * getvar() - Read a config/version variable
  *
@@ -226,6 +316,7 @@ static void getvar(char *cmd_parameter, char *response)
  */
 static void download(char *cmd_parameter, char *response)
 {
+	int stream = 0;
 	char *tmp;
 
 	if (!cmd_parameter) {
@@ -244,11 +335,19 @@ static void download(char *cmd_parameter, char *response)
 	 *
 	 * where cmd_parameter is an 8 digit hexadecimal number
 	 */
-	if (fastboot_bytes_expected > fastboot_buf_size) {
+	if (IS_ENABLED(CONFIG_FASTBOOT_MMC_STREAM))
+		stream = fastboot_mmc_stream_start(fastboot_bytes_expected,
+						   response);
+	if (stream < 0) {
+		fastboot_bytes_expected = 0;
+	} else if (!stream && fastboot_bytes_expected > fastboot_buf_size) {
+		/* only a streamed image can wrap around the buffer */
 		fastboot_fail(cmd_parameter, response);
 	} else {
 		printf("Starting download of %d bytes\n",
 		       fastboot_bytes_expected);
+		download_start = get_timer(0);
+		download_crc = 0;
 		fastboot_response("DATA", response, "%s", cmd_parameter);
 	}
 }
@@ -274,6 +373,9 @@ u32 fastboot_data_remaining(void)
  * response. fastboot_bytes_received is updated to indicate the number
  * of bytes that have been transferred.
  *
+ * An image streamed to MMC may be larger than the buffer, which then wraps
+ * around.
+ *
  * On completion sets image_size and ${filesize} to the total size of the
  * downloaded image.
  */
@@ -283,6 +385,7 @@ void fastboot_data_download(const void *fastboot_data,
 {
 #define BYTES_PER_DOT	0x20000
 	u32 pre_dot_num, now_dot_num;
+	u32 pos, len;
 
 	if (fastboot_data_len == 0 ||
 	    (fastboot_bytes_received + fastboot_data_len) >
@@ -291,9 +394,22 @@ void fastboot_data_download(const void *fastboot_data,
 			      response);
 		return;
 	}
+	if (fastboot_bytes_received + fastboot_data_len > fastboot_buf_size &&
+	    (!IS_ENABLED(CONFIG_FASTBOOT_MMC_STREAM) ||
+	     fastboot_mmc_stream_reserve(fastboot_buf_addr,
+					 fastboot_bytes_received,
+					 fastboot_data_len))) {
+		fastboot_fail("Image too large for download buffer", response);
+		return;
+	}
 	/* Download data to fastboot_buf_addr */
-	memcpy(fastboot_buf_addr + fastboot_bytes_received,
-	       fastboot_data, fastboot_data_len);
+	pos = fastboot_bytes_received % fastboot_buf_size;
+	len = min(fastboot_data_len, fastboot_buf_size - pos);
+	memcpy(fastboot_buf_addr + pos, fastboot_data, len);
+	memcpy(fastboot_buf_addr, fastboot_data + len, fastboot_data_len - len);
+	if (IS_ENABLED(CONFIG_FASTBOOT_MMC_VERIFY))
+		download_crc = crc32(download_crc, fastboot_data,
+				     fastboot_data_len);
 
 	pre_dot_num = fastboot_bytes_received / BYTES_PER_DOT;
 	fastboot_bytes_received += fastboot_data_len;
@@ -318,13 +434,27 @@ void fastboot_data_complete(char *response)
 {
 	/* Download complete. Respond with "OKAY" */
 	fastboot_okay(NULL, response);
-	printf("\ndownloading of %d bytes finished\n", fastboot_bytes_received);
+	printf("\ndownloading of %d bytes finished", fastboot_bytes_received);
+	print_rate(fastboot_bytes_received, download_start);
 	image_size = fastboot_bytes_received;
 	env_set_hex("filesize", image_size);
 	fastboot_bytes_expected = 0;
 	fastboot_bytes_received = 0;
 }
 
+void fastboot_data_flush(void)
+{
+	if (!IS_ENABLED(CONFIG_FASTBOOT_MMC_STREAM))
+		return;
+
+	/* once the download is complete, its size is in image_size */
+	if (fastboot_bytes_expected)
+		fastboot_mmc_stream_write(fastboot_buf_addr,
+					  fastboot_bytes_received, false);
+	else
+		fastboot_mmc_stream_write(fastboot_buf_addr, image_size, true);
+}
+
 /**
  * flash() - write the downloaded image to the indicated partition.
  *
@@ -336,6 +466,8 @@ void fastboot_data_complete(char *response)
  */
 static void __maybe_unused flash(char *cmd_parameter, char *response)
 {
+	ulong start = get_timer(0);
+
 	if (IS_ENABLED(CONFIG_FASTBOOT_FLASH_MMC))
 		fastboot_mmc_flash_write(cmd_parameter, fastboot_buf_addr,
 					 image_size, response);
@@ -343,6 +475,11 @@ static void __maybe_unused flash(char *cmd_parameter, char *response)
 	if (IS_ENABLED(CONFIG_FASTBOOT_FLASH_NAND))
 		fastboot_nand_flash_write(cmd_parameter, fastboot_buf_addr,
 					  image_size, response);
+
+	if (strncmp(response, "FAIL", 4)) {
+		printf("flashing of %d bytes finished", image_size);
+		print_rate(image_size, start);
+	}
 }
 
 /**
@@ -572,3 +709,17 @@ static void __maybe_unused oem_board(char *cmd_parameter, char *response)
 {
 	fastboot_oem_board(cmd_parameter, (void *)fastboot_buf_addr, image_size, response);
 }
+
+/**
+ * oem_stream() - Execute the OEM stream command
+ *
+ * @cmd_parameter: Pointer to partition name
+ * @response: Pointer to fastboot response buffer
+ *
+ * The next raw image downloaded is written to the partition while it is
+ * received.
+ */
+static void __maybe_unused oem_stream(char *cmd_parameter, char *response)
+{
+	fastboot_mmc_stream_select(cmd_parameter, response);
+}
@@ -12,10 +12,13 @@
 #include <image-sparse.h>
 #include <image.h>
 #include <log.h>
+#include <memalign.h>
 #include <part.h>
 #include <mmc.h>
 #include <div64.h>
 #include <linux/compat.h>
+#include <linux/sizes.h>
+#include <u-boot/crc.h>
 #include <android_image.h>
 
 #define BOOT_PARTITION_NAME "boot"
@@ -164,6 +167,68 @@ static lbaint_t fb_mmc_sparse_reserve(struct sparse_storage *info,
 	return blkcnt;
 }
 
+static struct mmc *fb_mmc_sparse_zero_erase_mmc(struct blk_desc *dev_desc)
+{
+	struct mmc *mmc;
+
+	if (dev_desc->uclass_id != UCLASS_MMC)
+		return NULL;
+	mmc = find_mmc_device(dev_desc->devnum);
+
+	/* only eMMC says whether erased blocks read back as zeroes */
+	if (!mmc || IS_SD(mmc) || !mmc->ext_csd ||
+	    mmc->ext_csd[EXT_CSD_ERASED_MEM_CONT])
+		return NULL;
+
+	return mmc;
+}
+
+static lbaint_t fb_mmc_sparse_erase(struct sparse_storage *info,
+		lbaint_t blk, lbaint_t blkcnt)
+{
+	struct fb_mmc_sparse *sparse = info->priv;
+
+	return fb_mmc_blk_write(sparse->dev_desc, blk, blkcnt, NULL);
+}
+
+/**
+ * fb_mmc_verify() - Check that an image was written correctly
+ *
+ * @dev_desc: Device the image was written to
+ * @start: First block of the image
+ * @buffer: Image which was written
+ * @bytes: Size of the image in bytes
+ * Return: 0 if the data read back matches, -ENOMEM if out of memory, -EIO
+ *	on a read error, -EBADMSG if the data does not match
+ */
+static int fb_mmc_verify(struct blk_desc *dev_desc, lbaint_t start,
+			 const void *buffer, u32 bytes)
+{
+	lbaint_t chunk = SZ_1M / dev_desc->blksz;
+	u32 crc = 0;
+	u32 done;
+	void *buf;
+
+	buf = malloc_cache_aligned(chunk * dev_desc->blksz);
+	if (!buf)
+		return -ENOMEM;
+
+	for (done = 0; done < bytes; done += chunk * dev_desc->blksz) {
+		u32 len = min_t(u32, bytes - done, chunk * dev_desc->blksz);
+		lbaint_t blks = DIV_ROUND_UP(len, dev_desc->blksz);
+
+		if (blk_dread(dev_desc, start, blks, buf) != blks) {
+			free(buf);
+			return -EIO;
+		}
+		crc = crc32(crc, buf, len);
+		start += blks;
+	}
+	free(buf);
+
+	return crc == fastboot_image_crc32(buffer, bytes) ? 0 : -EBADMSG;
+}
+
 static void write_raw_image(struct blk_desc *dev_desc,
 			    struct disk_partition *info, const char *part_name,
 			    void *buffer, u32 download_bytes, char *response)
@@ -191,11 +256,234 @@ static void write_raw_image(struct blk_desc *dev_desc,
 		return;
 	}
 
+	if (IS_ENABLED(CONFIG_FASTBOOT_MMC_VERIFY) &&
+	    fb_mmc_verify(dev_desc, info->start, buffer, download_bytes)) {
+		pr_err("verify failed on device %d\n", dev_desc->devnum);
+		fastboot_fail("failed verifying written data", response);
+		return;
+	}
+
 	printf("........ wrote " LBAFU " bytes to '%s'\n", blkcnt * info->blksz,
 	       part_name);
 	fastboot_okay(NULL, response);
 }
 
+#if IS_ENABLED(CONFIG_FASTBOOT_MMC_STREAM)
+/**
+ * enum fb_mmc_stream_state - State of an image written while it downloads
+ *
+ * @FB_MMC_STREAM_IDLE: No partition chosen
+ * @FB_MMC_STREAM_SELECTED: Partition chosen for the next download
+ * @FB_MMC_STREAM_ACTIVE: Download in progress, being written
+ * @FB_MMC_STREAM_DONE: Download written, waiting for the 'flash' command
+ */
+enum fb_mmc_stream_state {
+	FB_MMC_STREAM_IDLE,
+	FB_MMC_STREAM_SELECTED,
+	FB_MMC_STREAM_ACTIVE,
+	FB_MMC_STREAM_DONE,
+};
+
+/**
+ * struct fb_mmc_stream - Image written while it downloads
+ *
+ * @state: Current state
+ * @name: Partition given to 'oem stream'
+ * @dev_desc: Device holding the partition
+ * @info: Partition to write to
+ * @blks: Number of blocks written so far
+ * @ring: Number of blocks the download buffer holds before it wraps
+ * @bytes: Size of the image, once downloaded
+ * @err: 0, or -EIO if a write failed
+ */
+static struct fb_mmc_stream {
+	enum fb_mmc_stream_state state;
+	char name[PART_NAME_LEN];
+	struct blk_desc *dev_desc;
+	struct disk_partition info;
+	lbaint_t blks;
+	lbaint_t ring;
+	u32 bytes;
+	int err;
+} fb_stream;
+
+void fastboot_mmc_stream_select(const char *part_name, char *response)
+{
+	fb_stream.state = FB_MMC_STREAM_IDLE;
+	if (part_name && strlen(part_name) >= sizeof(fb_stream.name)) {
+		fastboot_fail("partition name too long", response);
+		return;
+	}
+	if (fastboot_mmc_get_part_info(part_name, &fb_stream.dev_desc,
+				       &fb_stream.info, response) < 0)
+		return;
+
+	strlcpy(fb_stream.name, part_name, sizeof(fb_stream.name));
+	fb_stream.state = FB_MMC_STREAM_SELECTED;
+	fastboot_okay(NULL, response);
+}
+
+int fastboot_mmc_stream_start(u32 size, char *response)
+{
+	ulong blksz = fb_stream.info.blksz;
+
+	if (fb_stream.state != FB_MMC_STREAM_SELECTED) {
+		fb_stream.state = FB_MMC_STREAM_IDLE;
+		return 0;
+	}
+	fb_stream.state = FB_MMC_STREAM_IDLE;
+	if (DIV_ROUND_UP(size, blksz) > fb_stream.info.size) {
+		pr_err("too large for partition: '%s'\n", fb_stream.name);
+		fastboot_fail("too large for partition", response);
+		return -EFBIG;
+	}
+
+	/* a larger image wraps around the buffer, a whole block at a time */
+	if (size <= fastboot_buf_size) {
+		fb_stream.ring = DIV_ROUND_UP(size, blksz);
+	} else if (fastboot_buf_size % blksz ||
+		   fastboot_buf_size < 2 * blksz) {
+		pr_err("download buffer cannot hold whole blocks\n");
+		fastboot_fail("too large for download buffer", response);
+		return -EFBIG;
+	} else {
+		fb_stream.ring = fastboot_buf_size / blksz;
+	}
+
+	printf("Streaming to '%s'\n", fb_stream.name);
+	fb_stream.blks = 0;
+	fb_stream.err = 0;
+	fb_stream.state = FB_MMC_STREAM_ACTIVE;
+
+	return 1;
+}
+
+/**
+ * fb_mmc_stream_blks() - Write received blocks from the download buffer
+ *
+ * @buffer: Download buffer
+ * @blks: Number of blocks of the image to have written once done
+ */
+static void fb_mmc_stream_blks(const void *buffer, lbaint_t blks)
+{
+	ulong blksz = fb_stream.info.blksz;
+	lbaint_t pos, cur;
+
+	while (!fb_stream.err && fb_stream.blks < blks) {
+		pos = fb_stream.blks % fb_stream.ring;
+		cur = min3(blks - fb_stream.blks, fb_stream.ring - pos,
+			   (lbaint_t)FASTBOOT_MAX_BLK_WRITE);
+		if (blk_dwrite(fb_stream.dev_desc,
+			       fb_stream.info.start + fb_stream.blks, cur,
+			       buffer + pos * blksz) != cur)
+			fb_stream.err = -EIO;
+		fb_stream.blks += cur;
+	}
+}
+
+int fastboot_mmc_stream_reserve(const void *buffer, u32 bytes, u32 len)
+{
+	ulong blksz = fb_stream.info.blksz;
+
+	if (fb_stream.state != FB_MMC_STREAM_ACTIVE)
+		return -ENOSPC;
+
+	/* write out early anything the new data would overwrite */
+	if (bytes + len - fb_stream.blks * blksz > fastboot_buf_size)
+		fb_mmc_stream_blks(buffer, bytes / blksz);
+	if (fb_stream.err)
+		return fb_stream.err;
+	if (bytes + len - fb_stream.blks * blksz > fastboot_buf_size)
+		return -ENOSPC;
+
+	return 0;
+}
+
+void fastboot_mmc_stream_write(const void *buffer, u32 bytes, bool last)
+{
+	lbaint_t chunk, blks;
+
+	if (fb_stream.state != FB_MMC_STREAM_ACTIVE)
+		return;
+
+	/* sparse images are only written by the 'flash' command */
+	if (!fb_stream.blks && bytes >= sizeof(sparse_header_t) &&
+	    is_sparse_image((void *)buffer)) {
+		puts("Sparse image, not streaming it\n");
+		fb_stream.state = FB_MMC_STREAM_IDLE;
+		return;
+	}
+
+	/* write whole chunks until the last one */
+	if (last) {
+		blks = DIV_ROUND_UP(bytes, fb_stream.info.blksz);
+	} else {
+		chunk = max_t(lbaint_t, CONFIG_FASTBOOT_MMC_STREAM_CHUNK /
+			      fb_stream.info.blksz, 1);
+		blks = bytes / fb_stream.info.blksz;
+		blks -= (blks - fb_stream.blks) % chunk;
+	}
+
+	fb_mmc_stream_blks(buffer, blks);
+
+	if (last) {
+		fb_stream.bytes = bytes;
+		fb_stream.state = FB_MMC_STREAM_DONE;
+	}
+}
+
+/**
+ * fb_mmc_stream_flash() - Complete a 'flash' command for a streamed image
+ *
+ * @cmd: Named partition to write image to
+ * @buffer: Pointer to image data
+ * @bytes: Size of image data
+ * @response: Pointer to fastboot response buffer
+ * Return: true if the image was streamed and @response is set, false if
+ *	the image must be written now
+ */
+static bool fb_mmc_stream_flash(const char *cmd, void *buffer, u32 bytes,
+				char *response)
+{
+	struct blk_desc *dev_desc = fb_stream.dev_desc;
+
+	if (fb_stream.state != FB_MMC_STREAM_DONE || fb_stream.bytes != bytes) {
+		fb_stream.state = FB_MMC_STREAM_IDLE;
+		if (bytes <= fastboot_buf_size)
+			return false;
+
+		/* the buffer only ever held part of an image this large */
+		fastboot_fail("image is not in the download buffer", response);
+		return true;
+	}
+	fb_stream.state = FB_MMC_STREAM_IDLE;
+
+	if (strcmp(cmd, fb_stream.name)) {
+		pr_err("image was already written to '%s'\n", fb_stream.name);
+		fastboot_fail("image was streamed to another partition",
+			      response);
+		return true;
+	}
+	if (fb_stream.err) {
+		pr_err("failed writing to device %d\n", dev_desc->devnum);
+		fastboot_fail("failed writing to device", response);
+		return true;
+	}
+	if (IS_ENABLED(CONFIG_FASTBOOT_MMC_VERIFY) &&
+	    fb_mmc_verify(dev_desc, fb_stream.info.start, buffer, bytes)) {
+		pr_err("verify failed on device %d\n", dev_desc->devnum);
+		fastboot_fail("failed verifying written data", response);
+		return true;
+	}
+
+	printf("........ wrote " LBAFU " bytes to '%s'\n",
+	       fb_stream.blks * fb_stream.info.blksz, cmd);
+	fastboot_okay(NULL, response);
+
+	return true;
+}
+#endif
+
 #if defined(CONFIG_FASTBOOT_MMC_BOOT_SUPPORT) || \
 	defined(CONFIG_FASTBOOT_MMC_USER_SUPPORT)
 static int fb_mmc_erase_mmc_hwpart(struct blk_desc *dev_desc)
@@ -512,6 +800,11 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 	struct blk_desc *dev_desc;
 	struct disk_partition info = {0};
 
+#if IS_ENABLED(CONFIG_FASTBOOT_MMC_STREAM)
+	if (fb_mmc_stream_flash(cmd, download_buffer, download_bytes, response))
+		return;
+#endif
+
 #ifdef CONFIG_FASTBOOT_MMC_BOOT_SUPPORT
 	if (strcmp(cmd, CONFIG_FASTBOOT_MMC_BOOT1_NAME) == 0) {
 		dev_desc = fastboot_mmc_get_dev(response);
@@ -610,7 +903,8 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 
 	if (is_sparse_image(download_buffer)) {
 		struct fb_mmc_sparse sparse_priv;
-		struct sparse_storage sparse;
+		struct sparse_storage sparse = {};
+		struct mmc *mmc;
 		int err;
 
 		sparse_priv.dev_desc = dev_desc;
@@ -622,6 +916,13 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		sparse.reserve = fb_mmc_sparse_reserve;
 		sparse.mssg = fastboot_fail;
 
+		/* zero-filled chunks can be erased where that gives zeroes */
+		mmc = fb_mmc_sparse_zero_erase_mmc(dev_desc);
+		if (mmc) {
+			sparse.erase = fb_mmc_sparse_erase;
+			sparse.erase_grp = mmc->erase_grp_size;
+		}
+
 		printf("Flashing sparse image at offset " LBAFU "\n",
 		       sparse.start);
 
@@ -629,7 +930,7 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
 		err = write_sparse_image(&sparse, cmd, download_buffer,
 					 response);
 		if (!err)
-			fastboot_okay(NULL, response);
+			fastboot_flash_sparse_okay(&sparse, response);
 	} else {
 		write_raw_image(dev_desc, &info, cmd, download_buffer,
 				download_bytes, response);
@@ -8,6 +8,7 @@
 #include <blk.h>
 
 #include <fastboot.h>
+#include <fastboot-internal.h>
 #include <image-sparse.h>
 
 #include <linux/printk.h>
@@ -189,7 +190,7 @@ void fastboot_nand_flash_write(const char *cmd, void *download_buffer,
 
 	if (is_sparse_image(download_buffer)) {
 		struct fb_nand_sparse sparse_priv;
-		struct sparse_storage sparse;
+		struct sparse_storage sparse = {};
 
 		sparse_priv.mtd = mtd;
 		sparse_priv.part = part;
@@ -208,7 +209,7 @@ void fastboot_nand_flash_write(const char *cmd, void *download_buffer,
 		ret = write_sparse_image(&sparse, cmd, download_buffer,
 					 response);
 		if (!ret)
-			fastboot_okay(NULL, response);
+			fastboot_flash_sparse_okay(&sparse, response);
 	} else {
 		printf("Flashing raw image at offset 0x%llx\n",
 		       part->offset);
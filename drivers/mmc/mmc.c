@@ -11,6 +11,7 @@
 #include <blk.h>
 #include <command.h>
 #include <dm.h>
+#include <fs.h>
 #include <log.h>
 #include <dm/device-internal.h>
 #include <errno.h>
@@ -2717,6 +2718,9 @@ static int mmc_startup(struct mmc *mmc)
 
 	/* fill in device description */
 	bdesc = mmc_get_blk_desc(mmc);
+	/* the card may have been changed, so drop anything cached from it */
+	part_cache_invalidate(bdesc, 0, 0);
+	fs_invalidate(bdesc);
 	bdesc->lun = 0;
 	bdesc->hwpart = 0;
 	bdesc->type = 0;
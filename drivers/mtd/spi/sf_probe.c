@@ -40,8 +40,12 @@ static int spi_nor_create_read_dirmap(struct spi_nor *nor)
 		op->dummy.nbytes *= 2;
 
 	nor->dirmap.rdesc = spi_mem_dirmap_create(nor->spi, &info);
-	if (IS_ERR(nor->dirmap.rdesc))
-		return PTR_ERR(nor->dirmap.rdesc);
+	if (IS_ERR(nor->dirmap.rdesc)) {
+		int ret = PTR_ERR(nor->dirmap.rdesc);
+
+		nor->dirmap.rdesc = NULL;
+		return ret;
+	}
 
 	return 0;
 }
@@ -66,8 +70,12 @@ static int spi_nor_create_write_dirmap(struct spi_nor *nor)
 		op->addr.nbytes = 0;
 
 	nor->dirmap.wdesc = spi_mem_dirmap_create(nor->spi, &info);
-	if (IS_ERR(nor->dirmap.wdesc))
-		return PTR_ERR(nor->dirmap.wdesc);
+	if (IS_ERR(nor->dirmap.wdesc)) {
+		int ret = PTR_ERR(nor->dirmap.wdesc);
+
+		nor->dirmap.wdesc = NULL;
+		return ret;
+	}
 
 	return 0;
 }
@@ -100,14 +108,19 @@ static int spi_flash_probe_slave(struct spi_flash *flash)
 	if (ret)
 		goto err_read_id;
 
+	/*
+	 * A missing mapping is not fatal: reads and writes then go through
+	 * spi_mem_exec_op() as usual
+	 */
 	if (CONFIG_IS_ENABLED(SPI_DIRMAP)) {
 		ret = spi_nor_create_read_dirmap(flash);
 		if (ret)
-			return ret;
+			log_debug("No read dirmap (err=%d)\n", ret);
 
 		ret = spi_nor_create_write_dirmap(flash);
 		if (ret)
-			return ret;
+			log_debug("No write dirmap (err=%d)\n", ret);
+		ret = 0;
 	}
 
 	if (CONFIG_IS_ENABLED(SPI_FLASH_MTD))
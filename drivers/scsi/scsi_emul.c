@@ -39,6 +39,17 @@ int sb_scsi_emul_command(struct scsi_emul_info *info,
 	}
 	case SCSI_TST_U_RDY:
 		break;
+	case SCSI_REQ_SENSE: {
+		u8 *resp = info->buff;
+
+		/* fixed-format sense data, with nothing to report */
+		info->alloc_len = req->cmd[4];
+		memset(resp, '\0', 18);
+		resp[0] = 0x70;
+		resp[7] = 10;
+		info->buff_used = 18;
+		break;
+	}
 	case SCSI_RD_CAPAC: {
 		struct scsi_read_capacity_resp *resp = (void *)info->buff;
 		uint blocks;
@@ -601,9 +601,14 @@ EXPORT_SYMBOL_GPL(spi_mem_dirmap_create);
  */
 void spi_mem_dirmap_destroy(struct spi_mem_dirmap_desc *desc)
 {
-	struct udevice *bus = desc->slave->dev->parent;
-	struct dm_spi_ops *ops = spi_get_ops(bus);
+	struct udevice *bus;
+	struct dm_spi_ops *ops;
+
+	if (!desc)
+		return;
 
+	bus = desc->slave->dev->parent;
+	ops = spi_get_ops(bus);
 	if (!desc->nodirmap && ops->mem_ops && ops->mem_ops->dirmap_destroy)
 		ops->mem_ops->dirmap_destroy(desc);
 
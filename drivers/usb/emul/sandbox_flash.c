@@ -13,6 +13,7 @@
 #include <scsi.h>
 #include <scsi_emul.h>
 #include <usb.h>
+#include <asm/test.h>
 
 /*
  * This driver emulates a flash stick using the UFI command specification and
@@ -40,6 +41,8 @@ enum {
  *
  * @eminfo:	emulator state
  * @error:	true if there is an error condition
+ * @stall_write:	true to stall the data phase of the next write
+ * @resets:	Number of Bulk-Only Mass Storage Resets received
  * @tag:	Tag value from last command
  * @fd:		File descriptor of backing file
  * @file_size:	Size of file in bytes
@@ -48,6 +51,8 @@ enum {
 struct sandbox_flash_priv {
 	struct scsi_emul_info eminfo;
 	bool error;
+	bool stall_write;
+	int resets;
 	u32 tag;
 	int fd;
 	struct umass_bbb_csw status;
@@ -130,6 +135,20 @@ static void *flash_desc_list[] = {
 	NULL,
 };
 
+void sandbox_flash_stall_write(struct udevice *dev)
+{
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+
+	priv->stall_write = true;
+}
+
+int sandbox_flash_get_resets(struct udevice *dev)
+{
+	struct sandbox_flash_priv *priv = dev_get_priv(dev);
+
+	return priv->resets;
+}
+
 static int sandbox_flash_control(struct udevice *dev, struct usb_device *udev,
 				 unsigned long pipe, void *buff, int len,
 				 struct devrequest *setup)
@@ -148,6 +167,20 @@ static int sandbox_flash_control(struct udevice *dev, struct usb_device *udev,
 			debug("request=%x\n", setup->request);
 			break;
 		}
+	} else if (pipe == usb_sndctrlpipe(udev, 0)) {
+		switch (setup->request) {
+		case US_BBB_RESET:
+			priv->error = false;
+			priv->eminfo.phase = SCSIPH_START;
+			priv->resets++;
+			return 0;
+		case USB_REQ_CLEAR_FEATURE:
+			/* the only feature is ENDPOINT_HALT, from a stall */
+			return 0;
+		default:
+			debug("request=%x\n", setup->request);
+			break;
+		}
 	}
 	debug("pipe=%lx\n", pipe);
 
@@ -243,6 +276,15 @@ static int sandbox_flash_bulk(struct udevice *dev, struct usb_device *udev,
 			priv->tag = cbw->dCBWTag;
 			if (!info->write_len)
 				return 0;
+			if (priv->stall_write) {
+				/* refuse the data and report that in the CSW */
+				priv->stall_write = false;
+				priv->status.bCSWStatus = CSWSTATUS_FAILED;
+				priv->status.dCSWDataResidue =
+					info->write_len * info->block_size;
+				info->phase = SCSIPH_STATUS;
+				return -EPIPE;
+			}
 			if (priv->fd != -1) {
 				ulong bytes_written;
 
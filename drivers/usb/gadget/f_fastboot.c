@@ -483,6 +483,9 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 
 	req->actual = 0;
 	usb_ep_queue(ep, req, 0);
+
+	/* write to storage while the next packet arrives */
+	fastboot_data_flush();
 }
 
 static void do_exit_on_complete(struct usb_ep *ep, struct usb_request *req)
@@ -92,7 +92,11 @@ static int sandbox_submit_bulk(struct udevice *bus, struct usb_device *udev,
 	if (ret)
 		return ret;
 	ret = usb_emul_bulk(emul, udev, pipe, buffer, length);
-	if (ret < 0) {
+	if (ret == -EPIPE) {
+		debug("stalled\n");
+		udev->status = USB_ST_STALLED;
+		udev->act_len = 0;
+	} else if (ret < 0) {
 		debug("ret=%d\n", ret);
 		udev->status = ret;
 		udev->act_len = 0;
@@ -104,6 +108,40 @@ static int sandbox_submit_bulk(struct udevice *bus, struct usb_device *udev,
 	return ret;
 }
 
+/*
+ * Carry out the transfers in turn, as a controller with all of them queued
+ * would: a failure halts the endpoint, so the transfers after it on that
+ * endpoint are not carried out, but those on other endpoints still are.
+ */
+static int sandbox_submit_bulk_queue(struct udevice *bus,
+				     struct usb_device *udev,
+				     struct usb_bulk_req *reqs, int count)
+{
+	struct usb_bulk_req *req;
+	struct udevice *emul;
+	ulong halted = 0;
+	int ret;
+
+	ret = usb_emul_find(bus, reqs[0].pipe, udev->portnr, &emul);
+	if (ret)
+		return ret;
+
+	for (req = reqs; req < reqs + count; req++) {
+		int ep_index = usb_pipe_ep_index(req->pipe);
+
+		if (halted & BIT(ep_index))
+			continue;
+		sandbox_submit_bulk(bus, udev, req->pipe, req->buffer,
+				    req->length);
+		req->status = udev->status;
+		req->act_len = udev->act_len;
+		if (req->status)
+			halted |= BIT(ep_index);
+	}
+
+	return 0;
+}
+
 static int sandbox_submit_int(struct udevice *bus, struct usb_device *udev,
 			      unsigned long pipe, void *buffer, int length,
 			      int interval, bool nonblock)
@@ -164,6 +202,7 @@ static int sandbox_usb_probe(struct udevice *dev)
 static const struct dm_usb_ops sandbox_usb_ops = {
 	.control	= sandbox_submit_control,
 	.bulk		= sandbox_submit_bulk,
+	.bulk_queue	= sandbox_submit_bulk_queue,
 	.interrupt	= sandbox_submit_int,
 	.alloc_device	= sandbox_alloc_device,
 };
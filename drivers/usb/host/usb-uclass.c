@@ -91,6 +91,18 @@ int submit_bulk_msg(struct usb_device *udev, unsigned long pipe, void *buffer,
 	return ops->bulk(bus, udev, pipe, buffer, length);
 }
 
+int submit_bulk_queue(struct usb_device *udev, struct usb_bulk_req *reqs,
+		      int count)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+
+	if (!ops->bulk_queue)
+		return -ENOSYS;
+
+	return ops->bulk_queue(bus, udev, reqs, count);
+}
+
 struct int_queue *create_int_queue(struct usb_device *udev,
 		unsigned long pipe, int queuesize, int elementsize,
 		void *buffer, int interval)
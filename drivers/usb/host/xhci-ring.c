@@ -624,19 +624,71 @@ static void record_transfer_result(struct usb_device *udev,
 }
 
 /**** Bulk and Control transfer methods ****/
+
+/* A bulk TD handed to the xHC, see queue_bulk_td() */
+struct xhci_bulk_td {
+	int ep_index;
+	int num_trbs;
+	struct xhci_segment *seg;
+	union xhci_trb *trb;
+	dma_addr_t last_trb;
+	bool done;
+};
+
 /**
- * Queues up the BULK Request
+ * Works out the number of TRBs needed for a bulk transfer
+ *
+ * @param buf_64	DMA address of the buffer
+ * @param length	length of the buffer
+ * Return: number of TRBs
+ */
+static int bulk_num_trbs(u64 buf_64, int length)
+{
+	int running_total;
+	int num_trbs = 0;
+
+	/*
+	 * How much data is (potentially) left before the 64KB boundary?
+	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
+	 * that the buffer should not span 64KB boundary. if so
+	 * we send request in more than 1 TRB by chaining them.
+	 */
+	running_total = TRB_MAX_BUFF_SIZE -
+			(lower_32_bits(buf_64) & (TRB_MAX_BUFF_SIZE - 1));
+	running_total &= TRB_MAX_BUFF_SIZE - 1;
+
+	/*
+	 * If there's some data on this 64KB chunk, or we have to send a
+	 * zero-length transfer, we need at least one TRB
+	 */
+	if (running_total != 0 || length == 0)
+		num_trbs++;
+
+	/* How many more 64KB chunks to transfer, how many more TRBs? */
+	while (running_total < length) {
+		num_trbs++;
+		running_total += TRB_MAX_BUFF_SIZE;
+	}
+
+	return num_trbs;
+}
+
+/**
+ * Queues up a bulk TD and gives it to the hardware
  *
  * @param udev		pointer to the USB device structure
  * @param pipe		contains the DIR_IN or OUT , devnum
  * @param length	length of the buffer
  * @param buffer	buffer to be read/written based on the request
- * Return: returns 0 if successful else -1 on failure
+ * @param buf_64	DMA address of the buffer
+ * @param td		returns where the TD was queued
+ * Return: 0 if successful else error code on failure
  */
-int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
-			int length, void *buffer)
+static int queue_bulk_td(struct usb_device *udev, unsigned long pipe,
+			 int length, void *buffer, u64 buf_64,
+			 struct xhci_bulk_td *td)
 {
-	int num_trbs = 0;
+	int num_trbs;
 	struct xhci_generic_trb *start_trb;
 	bool first_trb = false;
 	int start_cycle;
@@ -648,7 +700,6 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	struct xhci_virt_device *virt_dev;
 	struct xhci_ep_ctx *ep_ctx;
 	struct xhci_ring *ring;		/* EP transfer ring */
-	union xhci_trb *event;
 
 	int running_total, trb_buff_len;
 	bool more_trbs_coming = true;
@@ -656,14 +707,7 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	u64 addr;
 	int ret;
 	u32 trb_fields[4];
-	u64 buf_64 = xhci_dma_map(ctrl, buffer, length);
-	dma_addr_t last_transfer_trb_addr;
-	int available_length;
 
-	debug("dev=%p, pipe=%lx, buffer=%p, length=%d\n",
-		udev, pipe, buffer, length);
-
-	available_length = length;
 	ep_index = usb_pipe_ep_index(pipe);
 	virt_dev = ctrl->devs[slot_id];
 
@@ -672,41 +716,13 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 
 	ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
 
-	/*
-	 * If the endpoint was halted due to a prior error, resume it before
-	 * the next transfer. It is the responsibility of the upper layer to
-	 * have dealt with whatever caused the error.
-	 */
-	if ((le32_to_cpu(ep_ctx->ep_info) & EP_STATE_MASK) == EP_STATE_HALTED)
-		reset_ep(udev, ep_index);
-
 	ring = virt_dev->eps[ep_index].ring;
 	if (!ring)
 		return -EINVAL;
 
-	/*
-	 * How much data is (potentially) left before the 64KB boundary?
-	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
-	 * that the buffer should not span 64KB boundary. if so
-	 * we send request in more than 1 TRB by chaining them.
-	 */
-	running_total = TRB_MAX_BUFF_SIZE -
-			(lower_32_bits(buf_64) & (TRB_MAX_BUFF_SIZE - 1));
-	trb_buff_len = running_total;
-	running_total &= TRB_MAX_BUFF_SIZE - 1;
-
-	/*
-	 * If there's some data on this 64KB chunk, or we have to send a
-	 * zero-length transfer, we need at least one TRB
-	 */
-	if (running_total != 0 || length == 0)
-		num_trbs++;
-
-	/* How many more 64KB chunks to transfer, how many more TRBs? */
-	while (running_total < length) {
-		num_trbs++;
-		running_total += TRB_MAX_BUFF_SIZE;
-	}
+	num_trbs = bulk_num_trbs(buf_64, length);
+	trb_buff_len = TRB_MAX_BUFF_SIZE -
+		       (lower_32_bits(buf_64) & (TRB_MAX_BUFF_SIZE - 1));
 
 	/*
 	 * XXX: Calling routine prepare_ring() called in place of
@@ -718,6 +734,12 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	if (ret < 0)
 		return ret;
 
+	td->ep_index = ep_index;
+	td->num_trbs = num_trbs;
+	td->seg = ring->enq_seg;
+	td->trb = ring->enqueue;
+	td->done = false;
+
 	/*
 	 * Don't give the first TRB to the hardware (by toggling the cycle bit)
 	 * until we've finished creating all the other TRBs.  The ring's cycle
@@ -730,12 +752,6 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	maxpacketsize = usb_maxpacket(udev, pipe);
 
 	/* How much data is in the first TRB? */
-	/*
-	 * How much data is (potentially) left before the 64KB boundary?
-	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
-	 * that the buffer should not span 64KB boundary. if so
-	 * we send request in more than 1 TRB by chaining them.
-	 */
 	addr = buf_64;
 
 	if (trb_buff_len > length)
@@ -788,7 +804,8 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		trb_fields[2] = length_field;
 		trb_fields[3] = field | TRB_TYPE(TRB_NORMAL);
 
-		last_transfer_trb_addr = queue_trb(ctrl, ring, (num_trbs > 1), trb_fields);
+		td->last_trb = queue_trb(ctrl, ring, (num_trbs > 1),
+					 trb_fields);
 
 		--num_trbs;
 
@@ -803,6 +820,58 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 
 	giveback_first_trb(udev, ep_index, start_cycle, start_trb);
 
+	return 0;
+}
+
+/**
+ * Queues up the BULK Request
+ *
+ * @param udev		pointer to the USB device structure
+ * @param pipe		contains the DIR_IN or OUT , devnum
+ * @param length	length of the buffer
+ * @param buffer	buffer to be read/written based on the request
+ * Return: returns 0 if successful else -1 on failure
+ */
+int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
+			int length, void *buffer)
+{
+	u32 field = 0;
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	int slot_id = udev->slot_id;
+	int ep_index;
+	struct xhci_virt_device *virt_dev;
+	struct xhci_ep_ctx *ep_ctx;
+	struct xhci_bulk_td td;
+	union xhci_trb *event;
+
+	int ret;
+	u64 buf_64 = xhci_dma_map(ctrl, buffer, length);
+	int available_length;
+
+	debug("dev=%p, pipe=%lx, buffer=%p, length=%d\n",
+		udev, pipe, buffer, length);
+
+	available_length = length;
+	ep_index = usb_pipe_ep_index(pipe);
+	virt_dev = ctrl->devs[slot_id];
+
+	xhci_inval_cache((uintptr_t)virt_dev->out_ctx->bytes,
+			 virt_dev->out_ctx->size);
+
+	ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
+
+	/*
+	 * If the endpoint was halted due to a prior error, resume it before
+	 * the next transfer. It is the responsibility of the upper layer to
+	 * have dealt with whatever caused the error.
+	 */
+	if ((le32_to_cpu(ep_ctx->ep_info) & EP_STATE_MASK) == EP_STATE_HALTED)
+		reset_ep(udev, ep_index);
+
+	ret = queue_bulk_td(udev, pipe, length, buffer, buf_64, &td);
+	if (ret)
+		return ret;
+
 again:
 	event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
 	if (!event) {
@@ -814,7 +883,7 @@ again:
 	}
 
 	if ((uintptr_t)(le64_to_cpu(event->trans_event.buffer)) !=
-	    (uintptr_t)last_transfer_trb_addr) {
+	    (uintptr_t)td.last_trb) {
 		available_length -=
 			(int)EVENT_TRB_LEN(le32_to_cpu(event->trans_event.transfer_len));
 		xhci_acknowledge_event(ctrl);
@@ -833,6 +902,248 @@ again:
 	return (udev->status != USB_ST_NOT_PROC) ? 0 : -1;
 }
 
+/**
+ * Works out how much of a TD is covered by its TRBs up to a given one
+ *
+ * @param ctrl		Host controller data structure
+ * @param ring		EP transfer ring holding the TD
+ * @param td		TD to check
+ * @param addr		DMA address of a TRB in the TD
+ * Return: length of the TRBs up to and including that one, -1 if it is not
+ *	part of the TD
+ */
+static int bulk_td_length(struct xhci_ctrl *ctrl, struct xhci_ring *ring,
+			  struct xhci_bulk_td *td, dma_addr_t addr)
+{
+	struct xhci_segment *seg = td->seg;
+	union xhci_trb *trb = td->trb;
+	int len = 0;
+	int i;
+
+	for (i = 0; i < td->num_trbs; i++, trb++) {
+		while (last_trb(ctrl, ring, seg, trb)) {
+			seg = seg->next;
+			trb = seg->trbs;
+		}
+		len += TRB_LEN(le32_to_cpu(trb->generic.field[2]));
+		if (xhci_trb_virt_to_dma(seg, trb) == addr)
+			return len;
+	}
+
+	return -1;
+}
+
+/**
+ * Matches a transfer event to a TD from xhci_bulk_queue() and records the
+ * result of the TD if the event completes it. The event is acknowledged.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param reqs		requests that were queued
+ * @param tds		TDs that were queued
+ * @param count		number of TDs
+ * @param event		transfer event to handle
+ * Return: index of the TD completed by the event, -1 if none
+ */
+static int bulk_td_event(struct usb_device *udev, struct usb_bulk_req *reqs,
+			 struct xhci_bulk_td *tds, int count,
+			 union xhci_trb *event)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	xhci_comp_code comp;
+	dma_addr_t addr;
+	int ep_index;
+	int i, len;
+	u32 field;
+
+	addr = le64_to_cpu(event->trans_event.buffer);
+	field = le32_to_cpu(event->trans_event.flags);
+	BUG_ON(TRB_TO_SLOT_ID(field) != udev->slot_id);
+	ep_index = TRB_TO_EP_INDEX(field);
+
+	/* The TDs on an endpoint complete in the order queued */
+	for (i = 0; i < count; i++) {
+		if (!tds[i].done && tds[i].ep_index == ep_index)
+			break;
+	}
+	len = -1;
+	if (i < count)
+		len = bulk_td_length(ctrl, virt_dev->eps[ep_index].ring,
+				     &tds[i], addr);
+
+	/*
+	 * Skip events which are not for a TD we are waiting for. A short
+	 * packet ends the TD even when it is not on the last TRB.
+	 */
+	comp = GET_COMP_CODE(le32_to_cpu(event->trans_event.transfer_len));
+	if (len < 0 || (addr != tds[i].last_trb && comp == COMP_SUCCESS)) {
+		xhci_acknowledge_event(ctrl);
+		return -1;
+	}
+
+	record_transfer_result(udev, event, len);
+	xhci_acknowledge_event(ctrl);
+	tds[i].done = true;
+	reqs[i].status = udev->status;
+	reqs[i].act_len = udev->act_len;
+
+	return i;
+}
+
+/**
+ * Stops the endpoints that still have TDs from xhci_bulk_queue(). TDs on a
+ * halted endpoint are left; they are thrown away when the endpoint is reset
+ * before its next transfer.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param tds		TDs that were queued
+ * @param count		number of TDs
+ * Return: none
+ */
+static void bulk_cancel(struct usb_device *udev, struct xhci_bulk_td *tds,
+			int count)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	struct xhci_ep_ctx *ep_ctx;
+	u32 stopped = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		int ep_index = tds[i].ep_index;
+
+		if (tds[i].done || (stopped & BIT(ep_index)))
+			continue;
+		stopped |= BIT(ep_index);
+
+		xhci_inval_cache((uintptr_t)virt_dev->out_ctx->bytes,
+				 virt_dev->out_ctx->size);
+		ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
+		if ((le32_to_cpu(ep_ctx->ep_info) & EP_STATE_MASK) !=
+		    EP_STATE_HALTED)
+			abort_td(udev, ep_index);
+	}
+}
+
+/**
+ * Queues up several BULK Requests and waits for all of them
+ *
+ * All the TDs are given to the hardware before waiting, so that e.g. the
+ * command, data and status stages of a mass-storage command follow each
+ * other without a round trip through software. Processing stops at the first
+ * request that fails. Later requests are aborted and keep the status
+ * USB_ST_NOT_PROC, unless they had already completed on another endpoint,
+ * e.g. the status stage after a stalled OUT data stage.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param reqs		requests to carry out, in order
+ * @param count		number of requests, at most USB_BULK_QUEUE_MAX
+ * Return: 0 if the requests were processed (check their status), -ENOSYS
+ *	if they do not fit on the transfer rings together, else error code on
+ *	failure
+ */
+int xhci_bulk_queue(struct usb_device *udev, struct usb_bulk_req *reqs,
+		    int count)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	struct xhci_bulk_td tds[USB_BULK_QUEUE_MAX];
+	u64 buf_64[USB_BULK_QUEUE_MAX];
+	struct xhci_ep_ctx *ep_ctx;
+	union xhci_trb *event;
+	int queued, pending;
+	int i, j, ret;
+	int ep_index;
+
+	if (count < 1 || count > USB_BULK_QUEUE_MAX)
+		return -EINVAL;
+
+	for (i = 0; i < count; i++) {
+		buf_64[i] = xhci_dma_map(ctrl, reqs[i].buffer, reqs[i].length);
+		reqs[i].act_len = 0;
+		reqs[i].status = USB_ST_NOT_PROC;
+	}
+
+	/* Each endpoint has a single segment, which must hold all its TDs */
+	for (i = 0; i < count; i++) {
+		int num_trbs = 0;
+
+		for (j = 0; j < count; j++) {
+			if (usb_pipe_ep_index(reqs[j].pipe) ==
+			    usb_pipe_ep_index(reqs[i].pipe))
+				num_trbs += bulk_num_trbs(buf_64[j],
+							  reqs[j].length);
+		}
+		if (num_trbs > TRBS_PER_SEGMENT - 2) {
+			ret = -ENOSYS;
+			goto out;
+		}
+	}
+
+	/* Resume any endpoint halted by an earlier error, as xhci_bulk_tx() */
+	xhci_inval_cache((uintptr_t)virt_dev->out_ctx->bytes,
+			 virt_dev->out_ctx->size);
+	for (i = 0; i < count; i++) {
+		ep_index = usb_pipe_ep_index(reqs[i].pipe);
+		ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
+		if ((le32_to_cpu(ep_ctx->ep_info) & EP_STATE_MASK) ==
+		    EP_STATE_HALTED)
+			reset_ep(udev, ep_index);
+	}
+
+	for (queued = 0; queued < count; queued++) {
+		ret = queue_bulk_td(udev, reqs[queued].pipe,
+				    reqs[queued].length, reqs[queued].buffer,
+				    buf_64[queued], &tds[queued]);
+		if (ret)
+			break;
+	}
+	if (!queued)
+		goto out;
+
+	for (pending = queued; pending;) {
+		event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
+		if (!event) {
+			debug("XHCI bulk queue timed out, aborting...\n");
+			for (i = 0; tds[i].done; i++)
+				;
+			reqs[i].status = USB_ST_NAK_REC;
+			break;
+		}
+
+		i = bulk_td_event(udev, reqs, tds, queued, event);
+		if (i < 0)
+			continue;
+		pending--;
+		if (reqs[i].status)
+			break;
+	}
+
+	/*
+	 * TDs on other endpoints may have completed already. Take their events
+	 * now, since stopping the endpoints would throw them away.
+	 */
+	while (pending && event_ready(ctrl)) {
+		event = ctrl->event_ring->dequeue;
+		if (TRB_FIELD_TO_TYPE(le32_to_cpu(event->event_cmd.flags)) !=
+		    TRB_TRANSFER)
+			break;
+		if (bulk_td_event(udev, reqs, tds, queued, event) >= 0)
+			pending--;
+	}
+	if (pending)
+		bulk_cancel(udev, tds, queued);
+	ret = 0;
+
+out:
+	for (i = 0; i < count; i++) {
+		xhci_inval_cache((uintptr_t)reqs[i].buffer, reqs[i].length);
+		xhci_dma_unmap(ctrl, buf_64[i], reqs[i].length);
+	}
+
+	return ret;
+}
+
 /**
  * Queues up the Control Transfer Request
  *
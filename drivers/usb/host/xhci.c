@@ -1333,6 +1333,23 @@ static int xhci_submit_bulk_msg(struct udevice *dev, struct usb_device *udev,
 	return _xhci_submit_bulk_msg(udev, pipe, buffer, length);
 }
 
+static int xhci_submit_bulk_queue(struct udevice *dev, struct usb_device *udev,
+				  struct usb_bulk_req *reqs, int count)
+{
+	int i;
+
+	debug("%s: dev='%s', udev=%p\n", __func__, dev->name, udev);
+	for (i = 0; i < count; i++) {
+		if (usb_pipetype(reqs[i].pipe) != PIPE_BULK) {
+			printf("non-bulk pipe (type=%lu)",
+			       usb_pipetype(reqs[i].pipe));
+			return -EINVAL;
+		}
+	}
+
+	return xhci_bulk_queue(udev, reqs, count);
+}
+
 static int xhci_submit_int_msg(struct udevice *dev, struct usb_device *udev,
 			       unsigned long pipe, void *buffer, int length,
 			       int interval, bool nonblock)
@@ -1477,6 +1494,7 @@ int xhci_deregister(struct udevice *dev)
 struct dm_usb_ops xhci_usb_ops = {
 	.control = xhci_submit_control_msg,
 	.bulk = xhci_submit_bulk_msg,
+	.bulk_queue = xhci_submit_bulk_queue,
 	.interrupt = xhci_submit_int_msg,
 	.alloc_device = xhci_alloc_device,
 	.update_hub_device = xhci_update_hub_device,
@@ -14,6 +14,7 @@
 #include <log.h>
 #include <sort.h>
 #include <asm/global_data.h>
+#include <linux/log2.h>
 #include <linux/printk.h>
 #include <linux/stddef.h>
 #include <search.h>
@@ -253,6 +254,21 @@ char *from_env(const char *envvar)
 	return ret;
 }
 
+/* Copy a value (of length res) into buf, truncating it if needed */
+static int env_copy_value(const char *name, const char *value, unsigned res,
+			  char *buf, unsigned len)
+{
+	memcpy(buf, value, min(len, res + 1));
+
+	if (len <= res) {
+		buf[len - 1] = '\0';
+		printf("env_buf [%u bytes] too small for value of \"%s\"\n",
+		       len, name);
+	}
+
+	return res;
+}
+
 static int env_get_from_linear(const char *env, const char *name, char *buf,
 			       unsigned len)
 {
@@ -266,7 +282,6 @@ static int env_get_from_linear(const char *env, const char *name, char *buf,
 
 	for (p = env; *p != '\0'; p = end + 1) {
 		const char *value;
-		unsigned res;
 
 		for (end = p; *end != '\0'; ++end)
 			if (end - env >= CONFIG_ENV_SIZE)
@@ -276,20 +291,80 @@ static int env_get_from_linear(const char *env, const char *name, char *buf,
 			continue;
 		value = &p[name_len + 1];
 
-		res = end - value;
-		memcpy(buf, value, min(len, res + 1));
+		return env_copy_value(name, value, end - value, buf, len);
+	}
 
-		if (len <= res) {
-			buf[len - 1] = '\0';
-			printf("env_buf [%u bytes] too small for value of \"%s\"\n",
-			       len, name);
-		}
+	return -1;
+}
+
+#if CONFIG_IS_ENABLED(ENV_DEFAULT_HASH)
+/*
+ * Hash table of the variables in default_environment, with linear probing.
+ * Each slot holds the offset of a 'name=value' string plus one, or 0 if empty.
+ */
+static uint *env_default_table;
+static uint env_default_mask;
+
+static uint env_default_hash(const char *name, size_t len)
+{
+	uint hash = 0;
+
+	while (len--)
+		hash = hash * 31 + *name++;
+
+	return hash;
+}
+
+static int env_default_build(void)
+{
+	const char *p;
+	uint count, slot;
 
-		return res;
+	for (count = 0, p = default_environment; *p; p += strlen(p) + 1)
+		count++;
+	env_default_mask = __roundup_pow_of_two(max(count * 2, 2U)) - 1;
+	env_default_table = calloc(env_default_mask + 1,
+				   sizeof(*env_default_table));
+	if (!env_default_table)
+		return -ENOMEM;
+
+	for (p = default_environment; *p; p += strlen(p) + 1) {
+		const char *eq = strchr(p, '=');
+
+		if (!eq)
+			continue;
+		slot = env_default_hash(p, eq - p) & env_default_mask;
+		while (env_default_table[slot])
+			slot = (slot + 1) & env_default_mask;
+		env_default_table[slot] = p - default_environment + 1;
+	}
+
+	return 0;
+}
+
+static int env_get_default_hashed(const char *name, char *buf, unsigned len)
+{
+	size_t name_len;
+	uint slot;
+
+	if (!name || !*name)
+		return -1;
+	name_len = strlen(name);
+
+	slot = env_default_hash(name, name_len) & env_default_mask;
+	for (; env_default_table[slot]; slot = (slot + 1) & env_default_mask) {
+		const char *p = default_environment +
+			env_default_table[slot] - 1;
+
+		if (!strncmp(name, p, name_len) && p[name_len] == '=') {
+			p += name_len + 1;
+			return env_copy_value(name, p, strlen(p), buf, len);
+		}
 	}
 
 	return -1;
 }
+#endif /* ENV_DEFAULT_HASH */
 
 /*
  * Look up variable from environment for restricted C runtime env.
@@ -365,6 +440,13 @@ char *env_get_default(const char *name)
  */
 int env_get_default_into(const char *name, char *buf, unsigned int len)
 {
+#if CONFIG_IS_ENABLED(ENV_DEFAULT_HASH)
+	if (gd->flags & GD_FLG_RELOC) {
+		if (env_default_table || !env_default_build())
+			return env_get_default_hashed(name, buf, len);
+	}
+#endif
+
 	return env_get_from_linear(default_environment, name, buf, len);
 }
 
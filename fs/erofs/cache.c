@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Cache of decompressed physical clusters and compressed index blocks.
+ *
+ * Both caches are tied to the currently mounted filesystem: they survive
+ * erofs_close() so that a later command on the same image can reuse them,
+ * and are dropped as soon as a different filesystem is probed.
+ */
+#include "internal.h"
+
+#define Z_EROFS_PCACHE_SLOTS	16
+#define Z_EROFS_ICACHE_SLOTS	8
+
+struct z_erofs_pcache_entry {
+	erofs_nid_t nid;
+	erofs_off_t la, pa;
+	u64 llen;
+	char *data;
+	ulong stamp;
+};
+
+struct z_erofs_icache_entry {
+	erofs_blk_t blkaddr;
+	bool valid;
+	ulong stamp;
+	char data[EROFS_MAX_BLOCK_SIZE];
+};
+
+static struct z_erofs_cache {
+	/* identity of the filesystem the cached data belongs to */
+	const void *dev;
+	u64 part_start;
+	u8 uuid[16];
+	u64 build_time;
+	u32 build_time_nsec;
+	u32 checksum;
+
+	ulong clock;
+	ulong bytes;
+	struct z_erofs_pcache_entry pcl[Z_EROFS_PCACHE_SLOTS];
+	struct z_erofs_icache_entry *idx;
+} zcache;
+
+static void erofs_cache_drop(void)
+{
+	int i;
+
+	for (i = 0; i < Z_EROFS_PCACHE_SLOTS; i++) {
+		free(zcache.pcl[i].data);
+		zcache.pcl[i].data = NULL;
+	}
+	zcache.bytes = 0;
+
+	if (zcache.idx) {
+		for (i = 0; i < Z_EROFS_ICACHE_SLOTS; i++)
+			zcache.idx[i].valid = false;
+	}
+}
+
+void erofs_cache_mount(const void *dev, u64 part_start)
+{
+	if (zcache.dev == dev && zcache.part_start == part_start &&
+	    !memcmp(zcache.uuid, sbi.uuid, sizeof(sbi.uuid)) &&
+	    zcache.build_time == sbi.build_time &&
+	    zcache.build_time_nsec == sbi.build_time_nsec &&
+	    zcache.checksum == sbi.checksum)
+		return;
+
+	erofs_cache_drop();
+	zcache.dev = dev;
+	zcache.part_start = part_start;
+	memcpy(zcache.uuid, sbi.uuid, sizeof(sbi.uuid));
+	zcache.build_time = sbi.build_time;
+	zcache.build_time_nsec = sbi.build_time_nsec;
+	zcache.checksum = sbi.checksum;
+}
+
+const char *z_erofs_pcache_lookup(erofs_nid_t nid,
+				  struct erofs_map_blocks *map)
+{
+	struct z_erofs_pcache_entry *e;
+	int i;
+
+	for (i = 0; i < Z_EROFS_PCACHE_SLOTS; i++) {
+		e = &zcache.pcl[i];
+		if (e->data && e->nid == nid && e->la == map->m_la &&
+		    e->pa == map->m_pa && e->llen == map->m_llen) {
+			e->stamp = ++zcache.clock;
+			return e->data;
+		}
+	}
+	return NULL;
+}
+
+static struct z_erofs_pcache_entry *z_erofs_pcache_evict(void)
+{
+	struct z_erofs_pcache_entry *e, *victim = NULL;
+	int i;
+
+	for (i = 0; i < Z_EROFS_PCACHE_SLOTS; i++) {
+		e = &zcache.pcl[i];
+		if (!e->data)
+			continue;
+		if (!victim || e->stamp < victim->stamp)
+			victim = e;
+	}
+	if (victim) {
+		zcache.bytes -= victim->llen;
+		free(victim->data);
+		victim->data = NULL;
+	}
+	return victim;
+}
+
+char *z_erofs_pcache_alloc(erofs_nid_t nid, struct erofs_map_blocks *map)
+{
+	const ulong budget = CONFIG_FS_EROFS_ZIP_CACHE_SIZE;
+	struct z_erofs_pcache_entry *e = NULL;
+	int i;
+
+	if (map->m_llen > budget)
+		return NULL;
+
+	while (zcache.bytes + map->m_llen > budget)
+		z_erofs_pcache_evict();
+
+	for (i = 0; i < Z_EROFS_PCACHE_SLOTS; i++) {
+		if (!zcache.pcl[i].data) {
+			e = &zcache.pcl[i];
+			break;
+		}
+	}
+	if (!e)
+		e = z_erofs_pcache_evict();
+
+	e->data = malloc(map->m_llen);
+	if (!e->data)
+		return NULL;
+
+	e->nid = nid;
+	e->la = map->m_la;
+	e->pa = map->m_pa;
+	e->llen = map->m_llen;
+	e->stamp = ++zcache.clock;
+	zcache.bytes += e->llen;
+	return e->data;
+}
+
+void z_erofs_pcache_discard(char *data)
+{
+	int i;
+
+	for (i = 0; i < Z_EROFS_PCACHE_SLOTS; i++) {
+		if (zcache.pcl[i].data == data) {
+			zcache.bytes -= zcache.pcl[i].llen;
+			free(data);
+			zcache.pcl[i].data = NULL;
+			return;
+		}
+	}
+}
+
+int z_erofs_icache_read(erofs_blk_t blkaddr, char *buf)
+{
+	struct z_erofs_icache_entry *e;
+	int i;
+
+	if (!zcache.idx)
+		return -ENOENT;
+
+	for (i = 0; i < Z_EROFS_ICACHE_SLOTS; i++) {
+		e = &zcache.idx[i];
+		if (e->valid && e->blkaddr == blkaddr) {
+			e->stamp = ++zcache.clock;
+			memcpy(buf, e->data, erofs_blksiz());
+			return 0;
+		}
+	}
+	return -ENOENT;
+}
+
+void z_erofs_icache_insert(erofs_blk_t blkaddr, const char *buf)
+{
+	struct z_erofs_icache_entry *e, *victim;
+	int i;
+
+	if (!zcache.idx) {
+		zcache.idx = calloc(Z_EROFS_ICACHE_SLOTS, sizeof(*zcache.idx));
+		if (!zcache.idx)
+			return;
+	}
+
+	victim = &zcache.idx[0];
+	for (i = 0; i < Z_EROFS_ICACHE_SLOTS; i++) {
+		e = &zcache.idx[i];
+		if (!e->valid) {
+			victim = e;
+			break;
+		}
+		if (e->stamp < victim->stamp)
+			victim = e;
+	}
+
+	memcpy(victim->data, buf, erofs_blksiz());
+	victim->blkaddr = blkaddr;
+	victim->stamp = ++zcache.clock;
+	victim->valid = true;
+}
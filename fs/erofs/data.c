@@ -271,6 +271,46 @@ int z_erofs_read_one_data(struct erofs_inode *inode,
 	return 0;
 }
 
+/*
+ * Serve a part of a compressed extent through the pcluster cache: the whole
+ * extent is decompressed once and later partial reads are plain copies.
+ */
+static int z_erofs_read_cached(struct erofs_inode *inode,
+			       struct erofs_map_blocks *map, char *raw,
+			       char *buffer, erofs_off_t skip,
+			       erofs_off_t length, bool trimmed)
+{
+	const char *cached;
+	char *out;
+	int ret;
+
+	cached = z_erofs_pcache_lookup(inode->nid, map);
+	if (cached) {
+		memcpy(buffer, cached + skip, length - skip);
+		return 0;
+	}
+
+	/* full extents are decompressed in place, without a bounce copy */
+	if (!skip && !trimmed)
+		return z_erofs_read_one_data(inode, map, raw, buffer, 0,
+					     length, false);
+
+	out = z_erofs_pcache_alloc(inode->nid, map);
+	if (!out)
+		return z_erofs_read_one_data(inode, map, raw, buffer, skip,
+					     length, trimmed);
+
+	ret = z_erofs_read_one_data(inode, map, raw, out, 0, map->m_llen,
+				    false);
+	if (ret < 0) {
+		z_erofs_pcache_discard(out);
+		return ret;
+	}
+
+	memcpy(buffer, out + skip, length - skip);
+	return 0;
+}
+
 static int z_erofs_read_data(struct erofs_inode *inode, char *buffer,
 			     erofs_off_t size, erofs_off_t offset)
 {
@@ -327,9 +367,15 @@ static int z_erofs_read_data(struct erofs_inode *inode, char *buffer,
 			}
 		}
 
-		ret = z_erofs_read_one_data(inode, &map, raw,
-					    buffer + end - offset, skip, length,
-					    trimmed);
+		if (!(map.m_flags & EROFS_MAP_FRAGMENT) &&
+		    map.m_algorithmformat < Z_EROFS_COMPRESSION_MAX)
+			ret = z_erofs_read_cached(inode, &map, raw,
+						  buffer + end - offset, skip,
+						  length, trimmed);
+		else
+			ret = z_erofs_read_one_data(inode, &map, raw,
+						    buffer + end - offset, skip,
+						    length, trimmed);
 		if (ret < 0)
 			break;
 	}
@@ -41,6 +41,7 @@ int erofs_probe(struct blk_desc *fs_dev_desc,
 	if (ret)
 		goto error;
 
+	erofs_cache_mount(fs_dev_desc, fs_partition->start);
 	return 0;
 error:
 	ctxt.cur_dev = NULL;
@@ -375,6 +375,39 @@ int z_erofs_fill_inode(struct erofs_inode *vi);
 int z_erofs_map_blocks_iter(struct erofs_inode *vi,
 			    struct erofs_map_blocks *map, int flags);
 
+/* cache.c */
+#if IS_ENABLED(CONFIG_FS_EROFS_ZIP_CACHE)
+void erofs_cache_mount(const void *dev, u64 part_start);
+const char *z_erofs_pcache_lookup(erofs_nid_t nid,
+				  struct erofs_map_blocks *map);
+char *z_erofs_pcache_alloc(erofs_nid_t nid, struct erofs_map_blocks *map);
+void z_erofs_pcache_discard(char *data);
+int z_erofs_icache_read(erofs_blk_t blkaddr, char *buf);
+void z_erofs_icache_insert(erofs_blk_t blkaddr, const char *buf);
+#else
+static inline void erofs_cache_mount(const void *dev, u64 part_start) {}
+static inline const char *z_erofs_pcache_lookup(erofs_nid_t nid,
+						struct erofs_map_blocks *map)
+{
+	return NULL;
+}
+
+static inline char *z_erofs_pcache_alloc(erofs_nid_t nid,
+					 struct erofs_map_blocks *map)
+{
+	return NULL;
+}
+
+static inline void z_erofs_pcache_discard(char *data) {}
+static inline int z_erofs_icache_read(erofs_blk_t blkaddr, char *buf)
+{
+	return -ENOENT;
+}
+
+static inline void z_erofs_icache_insert(erofs_blk_t blkaddr,
+					 const char *buf) {}
+#endif
+
 #ifdef EUCLEAN
 #define EFSCORRUPTED	EUCLEAN		/* Filesystem is corrupted */
 #else
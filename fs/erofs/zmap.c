@@ -121,10 +121,16 @@ static int z_erofs_reload_indexes(struct z_erofs_maprecorder *m,
 	if (map->index == eblk)
 		return 0;
 
+	if (!z_erofs_icache_read(eblk, mpage)) {
+		map->index = eblk;
+		return 0;
+	}
+
 	ret = erofs_blk_read(mpage, eblk, 1);
 	if (ret < 0)
 		return -EIO;
 
+	z_erofs_icache_insert(eblk, mpage);
 	map->index = eblk;
 
 	return 0;
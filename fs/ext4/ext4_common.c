@@ -2313,7 +2313,11 @@ int ext4fs_open(const char *filename, loff_t *len)
 	if (ext4fs_root == NULL)
 		return -1;
 
-	ext4fs_file = NULL;
+	/* the filesystem may stay mounted, so drop any previous file */
+	if (ext4fs_file) {
+		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
+		ext4fs_file = NULL;
+	}
 	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
 				  FILETYPE_REG);
 	if (status == 0)
@@ -421,15 +421,163 @@ const char *fs_get_type_name(void)
 	return fs_get_info(fs_type)->name;
 }
 
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/**
+ * struct fs_mount - filesystem kept mounted by fs_close()
+ *
+ * The filesystem drivers only support one mounted filesystem at a time, so
+ * only the most recently used one is kept.
+ *
+ * @desc: Block device holding the filesystem, NULL if none is mounted
+ * @hwpart: Hardware partition of @desc which was selected
+ * @lba: Size of @desc in blocks, to help detect a changed medium
+ * @part: Partition number
+ * @partition: Partition information, to detect a changed partition table
+ * @fstype: Filesystem type (FS_TYPE_...)
+ * @stale: The device changed while the filesystem was in use, so fs_close()
+ *	must unmount it
+ * @stats: Statistics
+ */
+struct fs_mount {
+	struct blk_desc *desc;
+	int hwpart;
+	lbaint_t lba;
+	int part;
+	struct disk_partition partition;
+	int fstype;
+	bool stale;
+	struct fs_mount_stats stats;
+};
+
+static struct fs_mount fs_mount;
+
+static bool fs_mount_same(struct blk_desc *desc, int part,
+			  const struct disk_partition *info)
+{
+	const struct disk_partition *mnt = &fs_mount.partition;
+
+	return desc && desc == fs_mount.desc &&
+	       desc->hwpart == fs_mount.hwpart && desc->lba == fs_mount.lba &&
+	       part == fs_mount.part && info->start == mnt->start &&
+	       info->size == mnt->size && info->blksz == mnt->blksz &&
+	       !strncmp((char *)info->name, (char *)mnt->name, PART_NAME_LEN) &&
+	       (!CONFIG_IS_ENABLED(PARTITION_UUIDS) ||
+		!strcmp(disk_partition_uuid(info), disk_partition_uuid(mnt)));
+}
+
+static void fs_mount_drop(void)
+{
+	if (!fs_mount.desc)
+		return;
+
+	fs_get_info(fs_mount.fstype)->close();
+	fs_mount.desc = NULL;
+}
+
+/*
+ * Called before looking up a partition. An earlier user which did not call
+ * fs_close() is finished with now, so that its filesystem can be kept.
+ */
+static void fs_mount_start(void)
+{
+	if (fs_type != FS_TYPE_ANY)
+		fs_close();
+}
+
+/*
+ * Use the mounted filesystem if it is on the partition which was just looked
+ * up and of the right type. Otherwise unmount it, since probing overwrites
+ * the state of the filesystem drivers.
+ */
+static bool fs_mount_reuse(int part, int fstype)
+{
+	if (fs_mount_same(fs_dev_desc, part, &fs_partition) &&
+	    (fstype == FS_TYPE_ANY || fstype == fs_mount.fstype)) {
+		fs_type = fs_mount.fstype;
+		fs_dev_part = part;
+		fs_mount.stats.hits++;
+		return true;
+	}
+	fs_mount_drop();
+	fs_mount.stats.misses++;
+
+	return false;
+}
+
+/* Check whether fs_close() should leave the current filesystem mounted */
+static bool fs_mount_keep(struct fstype_info *info)
+{
+	if (fs_type == FS_TYPE_ANY)
+		return false;
+
+	if (fs_mount.stale || !fs_dev_desc || info->null_dev_desc_ok) {
+		if (fs_mount.stale)
+			fs_mount.stats.invalidations++;
+		fs_mount.stale = false;
+		fs_mount.desc = NULL;
+		return false;
+	}
+
+	fs_mount.desc = fs_dev_desc;
+	fs_mount.hwpart = fs_dev_desc->hwpart;
+	fs_mount.lba = fs_dev_desc->lba;
+	fs_mount.part = fs_dev_part;
+	fs_mount.partition = fs_partition;
+	fs_mount.fstype = fs_type;
+
+	return true;
+}
+
+void fs_invalidate(struct blk_desc *desc)
+{
+	/* in use, so unmount it when the operation completes */
+	if (fs_type != FS_TYPE_ANY) {
+		if (!desc || desc == fs_dev_desc)
+			fs_mount.stale = true;
+		return;
+	}
+
+	if (fs_mount.desc && (!desc || desc == fs_mount.desc)) {
+		fs_mount.stats.invalidations++;
+		fs_mount_drop();
+	}
+}
+
+void fs_mount_get_stats(struct fs_mount_stats *stats)
+{
+	*stats = fs_mount.stats;
+	stats->desc = fs_mount.desc;
+	stats->part = fs_mount.part;
+	stats->name = fs_get_info(fs_mount.fstype)->name;
+}
+#else
+static inline void fs_mount_start(void)
+{
+}
+
+static inline bool fs_mount_reuse(int part, int fstype)
+{
+	return false;
+}
+
+static inline bool fs_mount_keep(struct fstype_info *info)
+{
+	return false;
+}
+#endif
+
 int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 {
 	struct fstype_info *info;
 	int part, i;
 
+	fs_mount_start();
 	part = part_get_info_by_dev_and_name_or_num(ifname, dev_part_str, &fs_dev_desc,
 						    &fs_partition, 1);
 	if (part < 0)
 		return -1;
+	if (fs_mount_reuse(part, fstype))
+		return 0;
 
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
@@ -455,6 +603,7 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 	struct fstype_info *info;
 	int ret, i;
 
+	fs_mount_start();
 	if (part >= 1)
 		ret = part_get_info(desc, part, &fs_partition);
 	else
@@ -462,6 +611,8 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 	if (ret)
 		return ret;
 	fs_dev_desc = desc;
+	if (fs_mount_reuse(part, FS_TYPE_ANY))
+		return 0;
 
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
@@ -478,7 +629,8 @@ void fs_close(void)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	info->close();
+	if (!fs_mount_keep(info))
+		info->close();
 
 	fs_type = FS_TYPE_ANY;
 }
@@ -614,6 +766,7 @@ int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 		log_err("** Unable to write file %s **\n", filename);
 		ret = -1;
 	}
+	fs_invalidate(fs_dev_desc);
 	fs_close();
 
 	return ret;
@@ -679,6 +832,7 @@ int fs_unlink(const char *filename)
 
 	ret = info->unlink(filename);
 
+	fs_invalidate(fs_dev_desc);
 	fs_close();
 
 	return ret;
@@ -692,6 +846,7 @@ int fs_mkdir(const char *dirname)
 
 	ret = info->mkdir(dirname);
 
+	fs_invalidate(fs_dev_desc);
 	fs_close();
 
 	return ret;
@@ -708,6 +863,7 @@ int fs_ln(const char *fname, const char *target)
 		log_err("** Unable to create link %s -> %s **\n", fname, target);
 		ret = -1;
 	}
+	fs_invalidate(fs_dev_desc);
 	fs_close();
 
 	return ret;
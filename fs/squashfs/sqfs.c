@@ -11,6 +11,7 @@
 #include <div64.h>
 #include <errno.h>
 #include <fs.h>
+#include <fs_internal.h>
 #include <linux/types.h>
 #include <asm/byteorder.h>
 #include <linux/compat.h>
@@ -20,6 +21,7 @@
 #include <squashfs.h>
 #include <part.h>
 
+#include "sqfs_cache.h"
 #include "sqfs_decompressor.h"
 #include "sqfs_filesystem.h"
 #include "sqfs_utils.h"
@@ -109,8 +111,10 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	unsigned char *metadata_buffer, *metadata, *table;
 	struct squashfs_fragment_block_entry *entries;
 	struct squashfs_super_block *sblk = ctxt.sblk;
+	struct sqfs_cache_entry *cached;
 	unsigned long dest_len;
 	int block, offset, ret;
+	size_t index_len;
 	u16 header;
 
 	metadata_buffer = NULL;
@@ -120,6 +124,17 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	if (inode_fragment_index >= get_unaligned_le32(&sblk->fragments))
 		return -EINVAL;
 
+	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
+	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
+
+	cached = sqfs_cache_get(SQFS_CACHE_FRAG_INDEX,
+				get_unaligned_le64(&sblk->fragment_table_start));
+	if (cached) {
+		start_block = get_unaligned_le64(cached->data + block *
+						 sizeof(u64));
+		goto lookup_metadata;
+	}
+
 	start = get_unaligned_le64(&sblk->fragment_table_start);
 	end = get_unaligned_le64(&sblk->id_table_start);
 	exp_tbl = get_unaligned_le64(&sblk->export_table_start);
@@ -144,9 +159,6 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 		goto out;
 	}
 
-	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
-	offset = SQFS_FRAGMENT_INDEX_OFFSET(inode_fragment_index);
-
 	/*
 	 * Get the start offset of the metadata block that contains the right
 	 * fragment block entry
@@ -154,6 +166,21 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	start_block = get_unaligned_le64(table + table_offset + block *
 					 sizeof(u64));
 
+	index_len = min_t(size_t, DIV_ROUND_UP(get_unaligned_le32(&sblk->fragments),
+					       SQFS_MAX_ENTRIES) * sizeof(u64),
+			  n_blks * ctxt.cur_dev->blksz - table_offset);
+	sqfs_cache_put(SQFS_CACHE_FRAG_INDEX,
+		       get_unaligned_le64(&sblk->fragment_table_start),
+		       table + table_offset, index_len);
+
+lookup_metadata:
+	cached = sqfs_cache_get(SQFS_CACHE_METABLOCK, start_block);
+	if (cached) {
+		*e = ((struct squashfs_fragment_block_entry *)cached->data)[offset];
+		ret = SQFS_COMPRESSED_BLOCK(e->size);
+		goto out;
+	}
+
 	start = start_block / ctxt.cur_dev->blksz;
 	n_blks = sqfs_calc_n_blks(cpu_to_le64(start_block),
 				  sblk->fragment_table_start, &table_offset);
@@ -197,6 +224,9 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 		memcpy(entries, metadata, SQFS_METADATA_SIZE(header));
 	}
 
+	sqfs_cache_put(SQFS_CACHE_METABLOCK, start_block, entries,
+		       SQFS_METADATA_BLOCK_SIZE);
+
 	*e = entries[offset];
 	ret = SQFS_COMPRESSED_BLOCK(e->size);
 
@@ -715,11 +745,23 @@ static int sqfs_read_inode_table(unsigned char **inode_table)
 	struct squashfs_super_block *sblk = ctxt.sblk;
 	u64 start, n_blks, table_offset, table_size;
 	int j, ret = 0, metablks_count;
+	struct sqfs_cache_entry *cached;
 	unsigned char *src_table, *itb;
 	u32 src_len, dest_offset = 0;
 	unsigned long dest_len = 0;
 	bool compressed;
 
+	cached = sqfs_cache_get(SQFS_CACHE_INODE_TABLE,
+				get_unaligned_le64(&sblk->inode_table_start));
+	if (cached) {
+		*inode_table = malloc(cached->len);
+		if (!*inode_table)
+			return -ENOMEM;
+
+		memcpy(*inode_table, cached->data, cached->len);
+		return 0;
+	}
+
 	table_size = get_unaligned_le64(&sblk->directory_table_start) -
 		get_unaligned_le64(&sblk->inode_table_start);
 	start = get_unaligned_le64(&sblk->inode_table_start) /
@@ -791,6 +833,10 @@ static int sqfs_read_inode_table(unsigned char **inode_table)
 		src_table += src_len + SQFS_HEADER_SIZE;
 	}
 
+	sqfs_cache_put(SQFS_CACHE_INODE_TABLE,
+		       get_unaligned_le64(&sblk->inode_table_start), *inode_table,
+		       metablks_count * SQFS_METADATA_BLOCK_SIZE);
+
 free_itb:
 	free(itb);
 
@@ -802,6 +848,7 @@ static int sqfs_read_directory_table(unsigned char **dir_table, u32 **pos_list)
 	u64 start, n_blks, table_offset, table_size;
 	struct squashfs_super_block *sblk = ctxt.sblk;
 	int j, ret = 0, metablks_count = -1;
+	struct sqfs_cache_entry *cached;
 	unsigned char *src_table, *dtb;
 	u32 src_len, dest_offset = 0;
 	unsigned long dest_len = 0;
@@ -809,6 +856,25 @@ static int sqfs_read_directory_table(unsigned char **dir_table, u32 **pos_list)
 
 	*dir_table = NULL;
 	*pos_list = NULL;
+
+	cached = sqfs_cache_get(SQFS_CACHE_DIR_TABLE,
+				get_unaligned_le64(&sblk->directory_table_start));
+	if (cached && cached->pos_list) {
+		*dir_table = malloc(cached->len);
+		*pos_list = malloc(cached->count * sizeof(u32));
+		if (!*dir_table || !*pos_list) {
+			free(*dir_table);
+			free(*pos_list);
+			*dir_table = NULL;
+			*pos_list = NULL;
+			return -ENOMEM;
+		}
+
+		memcpy(*dir_table, cached->data, cached->len);
+		memcpy(*pos_list, cached->pos_list,
+		       cached->count * sizeof(u32));
+		return cached->count;
+	}
 	/* DIRECTORY TABLE */
 	table_size = get_unaligned_le64(&sblk->fragment_table_start) -
 		get_unaligned_le64(&sblk->directory_table_start);
@@ -885,6 +951,19 @@ static int sqfs_read_directory_table(unsigned char **dir_table, u32 **pos_list)
 		src_table += src_len + SQFS_HEADER_SIZE;
 	}
 
+	cached = sqfs_cache_put(SQFS_CACHE_DIR_TABLE,
+				get_unaligned_le64(&sblk->directory_table_start),
+				*dir_table,
+				metablks_count * SQFS_METADATA_BLOCK_SIZE);
+	if (cached) {
+		cached->pos_list = malloc(metablks_count * sizeof(u32));
+		if (cached->pos_list) {
+			memcpy(cached->pos_list, *pos_list,
+			       metablks_count * sizeof(u32));
+			cached->count = metablks_count;
+		}
+	}
+
 out:
 	if (metablks_count < 1) {
 		free(*dir_table);
@@ -1147,6 +1226,8 @@ int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition
 		goto error;
 	}
 
+	sqfs_cache_mount(&ctxt);
+
 	return 0;
 error:
 	ctxt.cur_dev = NULL;
@@ -1356,6 +1437,9 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 	char *dir = NULL, *fragment_block, *datablock = NULL;
 	char *fragment = NULL, *file = NULL, *resolved, *data;
 	u64 start, n_blks, table_size, data_offset, table_offset, sparse_size;
+	struct sqfs_cache_entry *cached;
+	char *data_buffer = NULL;
+	u32 block_size, n_bytes;
 	int ret, j, i_number, datablk_count = 0;
 	struct squashfs_super_block *sblk = ctxt.sblk;
 	struct squashfs_fragment_block_entry frag_entry;
@@ -1482,80 +1566,94 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 		len = finfo.size;
 	}
 
+	block_size = get_unaligned_le32(&sblk->block_size);
 	if (datablk_count) {
 		data_offset = finfo.start;
-		datablock = malloc(get_unaligned_le32(&sblk->block_size));
-		if (!datablock) {
+		datablock = malloc(block_size);
+		data_buffer = malloc_cache_aligned((DIV_ROUND_UP(block_size,
+						ctxt.cur_dev->blksz) + 1) *
+						   ctxt.cur_dev->blksz);
+		if (!datablock || !data_buffer) {
+			/*
+			 * Possible cause: too large SquashFS block size. Tip:
+			 * re-compile the SquashFS image with mksquashfs's
+			 * -b <block_size> option.
+			 */
+			printf("Error: cannot allocate a data block buffer.\n");
 			ret = -ENOMEM;
 			goto out;
 		}
 	}
 
 	for (j = 0; j < datablk_count; j++) {
-		char *data_buffer;
-
 		start = lldiv(data_offset, ctxt.cur_dev->blksz);
 		table_size = SQFS_BLOCK_SIZE(finfo.blk_sizes[j]);
 		table_offset = data_offset - (start * ctxt.cur_dev->blksz);
 		n_blks = DIV_ROUND_UP(table_size + table_offset,
 				      ctxt.cur_dev->blksz);
 
-		/* Don't load any data for sparse blocks */
-		if (finfo.blk_sizes[j] == 0) {
-			n_blks = 0;
-			table_offset = 0;
-			data_buffer = NULL;
-			data = NULL;
-		} else {
-			data_buffer = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-
-			if (!data_buffer) {
-				ret = -ENOMEM;
-				goto out;
-			}
-
-			ret = sqfs_disk_read(start, n_blks, data_buffer);
-			if (ret < 0) {
-				/*
-				 * Possible causes: too many data blocks or too large
-				 * SquashFS block size. Tip: re-compile the SquashFS
-				 * image with mksquashfs's -b <block_size> option.
-				 */
-				printf("Error: too many data blocks to be read.\n");
-				goto out;
-			}
-
-			data = data_buffer + table_offset;
+		if (table_size > block_size) {
+			ret = -EINVAL;
+			goto out;
 		}
 
 		/* Load the data */
 		if (finfo.blk_sizes[j] == 0) {
-			/* This is a sparse block */
-			sparse_size = get_unaligned_le32(&sblk->block_size);
+			/* This is a sparse block, don't load any data */
+			sparse_size = block_size;
 			if ((*actread + sparse_size) > len)
 				sparse_size = len - *actread;
 			memset(buf + *actread, 0, sparse_size);
 			*actread += sparse_size;
 		} else if (SQFS_COMPRESSED_BLOCK(finfo.blk_sizes[j])) {
-			dest_len = get_unaligned_le32(&sblk->block_size);
-			ret = sqfs_decompress(&ctxt, datablock, &dest_len,
-					      data, table_size);
-			if (ret)
+			ret = sqfs_disk_read(start, n_blks, data_buffer);
+			if (ret < 0) {
+				printf("Error: failed to read data block %d.\n", j);
 				goto out;
+			}
+
+			data = data_buffer + table_offset;
 
-			if ((*actread + dest_len) > len)
-				dest_len = len - *actread;
-			memcpy(buf + *actread, datablock, dest_len);
+			/*
+			 * Decompress straight into the load buffer unless the
+			 * block would run past the requested length.
+			 */
+			dest_len = block_size;
+			if (*actread + block_size <= len) {
+				ret = sqfs_decompress(&ctxt, buf + *actread,
+						      &dest_len, data,
+						      table_size);
+				if (ret)
+					goto out;
+			} else {
+				ret = sqfs_decompress(&ctxt, datablock,
+						      &dest_len, data,
+						      table_size);
+				if (ret)
+					goto out;
+
+				if ((*actread + dest_len) > len)
+					dest_len = len - *actread;
+				memcpy(buf + *actread, datablock, dest_len);
+			}
 			*actread += dest_len;
 		} else {
-			if ((*actread + table_size) > len)
-				table_size = len - *actread;
-			memcpy(buf + *actread, data, table_size);
-			*actread += table_size;
+			/* Uncompressed blocks are read straight into the load buffer */
+			n_bytes = table_size;
+			if ((*actread + n_bytes) > len)
+				n_bytes = len - *actread;
+
+			if (!fs_devread(ctxt.cur_dev, &ctxt.cur_part_info,
+					start, table_offset, n_bytes,
+					buf + *actread)) {
+				printf("Error: failed to read data block %d.\n", j);
+				ret = -EIO;
+				goto out;
+			}
+			*actread += n_bytes;
 		}
 
 		data_offset += table_size;
-		free(data_buffer);
 		if (*actread >= len)
 			break;
 	}
@@ -1568,6 +1666,21 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 		goto out;
 	}
 
+	/* Fragment blocks are usually shared by several small files */
+	cached = sqfs_cache_get(SQFS_CACHE_FRAGMENT, frag_entry.start);
+	if (cached) {
+		if (finfo.offset + finfo.size - *actread > cached->len) {
+			ret = -EINVAL;
+			goto out;
+		}
+
+		memcpy(buf + *actread, cached->data + finfo.offset,
+		       finfo.size - *actread);
+		*actread = finfo.size;
+		ret = 0;
+		goto out;
+	}
+
 	start = lldiv(frag_entry.start, ctxt.cur_dev->blksz);
 	table_size = SQFS_BLOCK_SIZE(frag_entry.size);
 	table_offset = frag_entry.start - (start * ctxt.cur_dev->blksz);
@@ -1586,7 +1699,7 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 
 	/* File compressed and fragmented */
 	if (finfo.frag && finfo.comp) {
-		dest_len = get_unaligned_le32(&sblk->block_size);
+		dest_len = block_size;
 		fragment_block = malloc(dest_len);
 		if (!fragment_block) {
 			ret = -ENOMEM;
@@ -1604,6 +1717,8 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
 		*actread = finfo.size;
 
+		sqfs_cache_put(SQFS_CACHE_FRAGMENT, frag_entry.start,
+			       fragment_block, dest_len);
 		free(fragment_block);
 
 	} else if (finfo.frag && !finfo.comp) {
@@ -1611,11 +1726,15 @@ static int sqfs_read_nest(const char *filename, void *buf, loff_t offset,
 
 		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
 		*actread = finfo.size;
+
+		sqfs_cache_put(SQFS_CACHE_FRAGMENT, frag_entry.start,
+			       fragment_block, table_size);
 	}
 
 out:
 	free(fragment);
 	free(datablock);
+	free(data_buffer);
 	free(file);
 	free(dir);
 	free(finfo.blk_sizes);
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Cache of decompressed SquashFS metadata and fragment blocks
+ *
+ * The inode, directory and fragment tables are otherwise decompressed again
+ * for every open, size and read call. Entries are kept across sqfs_close() so
+ * that consecutive commands on the same image reuse them, and the whole cache
+ * is dropped as soon as a different image is probed. The total size of the
+ * cached data is bounded by CONFIG_FS_SQUASHFS_CACHE_SIZE, least recently used
+ * entries being evicted first.
+ */
+
+#include <blk.h>
+#include <log.h>
+#include <malloc.h>
+#include <part.h>
+#include <linux/string.h>
+
+#include "sqfs_cache.h"
+
+#define SQFS_CACHE_SLOTS 32
+
+static struct sqfs_cache {
+	/* identity of the image the cached data belongs to */
+	struct blk_desc *dev;
+	lbaint_t part_start;
+	struct squashfs_super_block sblk;
+
+	ulong clock;
+	size_t bytes;
+	struct sqfs_cache_entry entries[SQFS_CACHE_SLOTS];
+} cache;
+
+static void sqfs_cache_release(struct sqfs_cache_entry *e)
+{
+	cache.bytes -= e->len;
+	free(e->data);
+	free(e->pos_list);
+	e->data = NULL;
+	e->pos_list = NULL;
+	e->count = 0;
+}
+
+static struct sqfs_cache_entry *sqfs_cache_evict(void)
+{
+	struct sqfs_cache_entry *e, *victim = NULL;
+	int i;
+
+	for (i = 0; i < SQFS_CACHE_SLOTS; i++) {
+		e = &cache.entries[i];
+		if (!e->data)
+			continue;
+		if (!victim || e->stamp < victim->stamp)
+			victim = e;
+	}
+	if (victim)
+		sqfs_cache_release(victim);
+
+	return victim;
+}
+
+void sqfs_cache_mount(struct squashfs_ctxt *ctxt)
+{
+	int i;
+
+	if (cache.dev == ctxt->cur_dev &&
+	    cache.part_start == ctxt->cur_part_info.start &&
+	    !memcmp(&cache.sblk, ctxt->sblk, sizeof(cache.sblk)))
+		return;
+
+	for (i = 0; i < SQFS_CACHE_SLOTS; i++) {
+		if (cache.entries[i].data)
+			sqfs_cache_release(&cache.entries[i]);
+	}
+
+	cache.dev = ctxt->cur_dev;
+	cache.part_start = ctxt->cur_part_info.start;
+	memcpy(&cache.sblk, ctxt->sblk, sizeof(cache.sblk));
+}
+
+struct sqfs_cache_entry *sqfs_cache_get(enum sqfs_cache_kind kind, u64 pos)
+{
+	struct sqfs_cache_entry *e;
+	int i;
+
+	for (i = 0; i < SQFS_CACHE_SLOTS; i++) {
+		e = &cache.entries[i];
+		if (e->data && e->kind == kind && e->pos == pos) {
+			e->stamp = ++cache.clock;
+			return e;
+		}
+	}
+
+	return NULL;
+}
+
+struct sqfs_cache_entry *sqfs_cache_put(enum sqfs_cache_kind kind, u64 pos,
+					const void *data, size_t len)
+{
+	const size_t budget = CONFIG_FS_SQUASHFS_CACHE_SIZE;
+	struct sqfs_cache_entry *e = NULL;
+	int i;
+
+	if (!len || len > budget)
+		return NULL;
+
+	e = sqfs_cache_get(kind, pos);
+	if (e)
+		sqfs_cache_release(e);
+
+	while (cache.bytes + len > budget)
+		sqfs_cache_evict();
+
+	for (i = 0; !e && i < SQFS_CACHE_SLOTS; i++) {
+		if (!cache.entries[i].data)
+			e = &cache.entries[i];
+	}
+	if (!e)
+		e = sqfs_cache_evict();
+
+	e->data = malloc(len);
+	if (!e->data) {
+		log_debug("no memory to cache %zu bytes at %llx\n", len, pos);
+		return NULL;
+	}
+
+	memcpy(e->data, data, len);
+	e->kind = kind;
+	e->pos = pos;
+	e->len = len;
+	e->stamp = ++cache.clock;
+	cache.bytes += len;
+
+	return e;
+}
@@ -0,0 +1,63 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Cache of decompressed SquashFS metadata and fragment blocks
+ */
+
+#ifndef SQFS_CACHE_H
+#define SQFS_CACHE_H
+
+#include <linux/types.h>
+#include "sqfs_filesystem.h"
+
+enum sqfs_cache_kind {
+	SQFS_CACHE_INODE_TABLE,
+	SQFS_CACHE_DIR_TABLE,
+	SQFS_CACHE_FRAG_INDEX,
+	SQFS_CACHE_METABLOCK,
+	SQFS_CACHE_FRAGMENT,
+};
+
+/**
+ * struct sqfs_cache_entry - Cached, decompressed piece of a SquashFS image
+ *
+ * @kind: What the entry holds (enum sqfs_cache_kind)
+ * @pos: Byte offset of the data on the partition, used as lookup key
+ * @data: Decompressed data
+ * @len: Number of bytes in @data
+ * @pos_list: Metadata block positions (directory table only)
+ * @count: Number of metadata blocks (directory table only)
+ * @stamp: LRU timestamp
+ */
+struct sqfs_cache_entry {
+	enum sqfs_cache_kind kind;
+	u64 pos;
+	void *data;
+	size_t len;
+	u32 *pos_list;
+	int count;
+	ulong stamp;
+};
+
+#if IS_ENABLED(CONFIG_FS_SQUASHFS_CACHE)
+void sqfs_cache_mount(struct squashfs_ctxt *ctxt);
+struct sqfs_cache_entry *sqfs_cache_get(enum sqfs_cache_kind kind, u64 pos);
+struct sqfs_cache_entry *sqfs_cache_put(enum sqfs_cache_kind kind, u64 pos,
+					const void *data, size_t len);
+#else
+static inline void sqfs_cache_mount(struct squashfs_ctxt *ctxt) {}
+
+static inline struct sqfs_cache_entry *
+sqfs_cache_get(enum sqfs_cache_kind kind, u64 pos)
+{
+	return NULL;
+}
+
+static inline struct sqfs_cache_entry *
+sqfs_cache_put(enum sqfs_cache_kind kind, u64 pos, const void *data,
+	       size_t len)
+{
+	return NULL;
+}
+#endif
+
+#endif /* SQFS_CACHE_H */
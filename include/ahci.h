@@ -16,7 +16,7 @@
 #define AHCI_RX_FIS_SZ		256
 #define AHCI_CMD_TBL_HDR	0x80
 #define AHCI_CMD_TBL_CDB	0x40
-#define AHCI_CMD_TBL_SZ		AHCI_CMD_TBL_HDR + (AHCI_MAX_SG * 16)
+#define AHCI_CMD_TBL_SZ		(AHCI_CMD_TBL_HDR + (AHCI_MAX_SG * 16))
 #define AHCI_PORT_PRIV_DMA_SZ	(AHCI_CMD_SLOT_SZ * AHCI_MAX_CMD_SLOT + \
 				AHCI_CMD_TBL_SZ	+ AHCI_RX_FIS_SZ)
 #define AHCI_CMD_ATAPI		(1 << 5)
@@ -139,6 +139,8 @@ struct ahci_ioports {
 	struct ahci_sg		*cmd_tbl_sg;
 	ulong	cmd_tbl;
 	u32	rx_fis;
+	ulong	ncq_tbl;	/* command tables for queued commands */
+	u32	ncq_depth;	/* number of slots used for NCQ, 0 if none */
 };
 
 /**
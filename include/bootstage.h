@@ -457,6 +457,79 @@ static inline int bootstage_init(bool first)
 
 #endif /* ENABLE_BOOTSTAGE */
 
+/**
+ * enum bootstage_timing_t - Type of a timing record
+ *
+ * @BOOTSTAGE_TIMING_INITCALL: An initcall, named by its link-time address
+ * @BOOTSTAGE_TIMING_EVENT: An event sent from an initcall list
+ * @BOOTSTAGE_TIMING_PROBE: A device probe, named by the device
+ */
+enum bootstage_timing_t {
+	BOOTSTAGE_TIMING_INITCALL,
+	BOOTSTAGE_TIMING_EVENT,
+	BOOTSTAGE_TIMING_PROBE,
+
+	BOOTSTAGE_TIMING_COUNT,
+};
+
+#if !defined(USE_HOSTCC) && CONFIG_IS_ENABLED(BOOTSTAGE_TIMING)
+/**
+ * bootstage_timing_start() - Start timing an initcall or device probe
+ *
+ * Anything timed before the matching bootstage_timing_end() call is treated
+ * as nested inside this record, so its time is not counted in this record's
+ * self time.
+ *
+ * @type: Type of record
+ * @name: Name of record, which is copied (and may be truncated)
+ * Return: record number to pass to bootstage_timing_end(), or -ve if the
+ *	record could not be added, e.g. because the timer is not set up yet
+ */
+int bootstage_timing_start(enum bootstage_timing_t type, const char *name);
+
+/**
+ * bootstage_timing_end() - Finish timing an initcall or device probe
+ *
+ * @rec: Record number returned by bootstage_timing_start()
+ */
+void bootstage_timing_end(int rec);
+
+/**
+ * bootstage_timing_clear() - Drop all timing records
+ *
+ * This is intended for tests, which need room in the table. It must not be
+ * called while anything is being timed.
+ */
+void bootstage_timing_clear(void);
+
+/**
+ * bootstage_timing_report() - Show timing records, slowest first
+ *
+ * Records are sorted by self time, i.e. excluding nested records
+ *
+ * @types: Bitmask of types to show, e.g. BIT(BOOTSTAGE_TIMING_PROBE)
+ */
+void bootstage_timing_report(uint types);
+#else
+static inline int bootstage_timing_start(enum bootstage_timing_t type,
+					 const char *name)
+{
+	return -1;
+}
+
+static inline void bootstage_timing_end(int rec)
+{
+}
+
+static inline void bootstage_timing_clear(void)
+{
+}
+
+static inline void bootstage_timing_report(uint types)
+{
+}
+#endif
+
 /* helpers for SPL */
 int _bootstage_stash_default(void);
 int _bootstage_unstash_default(void);
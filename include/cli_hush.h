@@ -7,6 +7,8 @@
 #ifndef _CLI_HUSH_H_
 #define _CLI_HUSH_H_
 
+#include <linux/types.h>
+
 #define FLAG_EXIT_FROM_LOOP 1
 #define FLAG_PARSE_SEMICOLON (1 << 1)	  /* symbol ';' is special for parser */
 #define FLAG_REPARSING       (1 << 2)	  /* >=2nd pass */
@@ -64,6 +66,22 @@ static inline int set_local_var_modern(char *s, int flg_export)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(HUSH_PARSE_CACHE)
+/**
+ * hush_parse_cache_enable() - Enable or disable the cache of parsed scripts
+ *
+ * This also empties the cache, so that the next run of each script is parsed
+ * again. It is mostly useful for measuring the benefit of the cache.
+ *
+ * @enable: true to enable the cache, false to disable it
+ */
+void hush_parse_cache_enable(bool enable);
+#else
+static inline void hush_parse_cache_enable(bool enable)
+{
+}
+#endif
+
 void unset_local_var(const char *name);
 char *get_local_var(const char *s);
 
@@ -23,9 +23,10 @@
  * @delay_ns: Delay is ns after which this function shall get executed
  * @start_time_us: Start time in us, when this function started its execution
  * @cpu_time_us: Total CPU time of this function
+ * @max_cpu_time_us: Longest CPU time of a single execution of this function
  * @run_cnt: Counter of executions occurances
  * @next_call: Next time in us, when the function shall be executed again
- * @list: List node
+ * @list: List node, kept sorted by @next_call
  * @already_warned: Flag that we've warned about exceeding CPU time usage
  *
  * When !CONFIG_CYCLIC, this struct is empty.
@@ -37,6 +38,7 @@ struct cyclic_info {
 	uint64_t delay_us;
 	uint64_t start_time_us;
 	uint64_t cpu_time_us;
+	uint64_t max_cpu_time_us;
 	uint64_t run_cnt;
 	uint64_t next_call;
 	struct hlist_node list;
@@ -81,7 +83,8 @@ int cyclic_unregister_all(void);
 /**
  * cyclic_get_list() - Get cyclic list pointer
  *
- * Return the cyclic list pointer
+ * Return the cyclic list pointer. The list is ordered by the time at which
+ * each function is next due, earliest first.
  *
  * @return: pointer to cyclic_list
  */
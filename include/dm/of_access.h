@@ -541,6 +541,28 @@ int of_count_phandle_with_args(const struct device_node *np,
  */
 int of_alias_scan(void);
 
+/**
+ * of_phandle_scan() - Index the nodes of the control tree by phandle
+ *
+ * This builds the table used by of_find_node_by_phandle() to look up nodes
+ * in the control tree (gd->of_root) without searching it. If there is no
+ * table when a lookup is done, it is built then.
+ *
+ * Return: 0 if OK (or OF_PHANDLE_INDEX is not enabled), -ENOMEM if not enough
+ * memory
+ */
+int of_phandle_scan(void);
+
+/**
+ * of_phandle_invalidate() - Drop the phandle index of a tree
+ *
+ * This must be called before a node with a phandle is removed from the tree
+ * or the tree is freed.
+ *
+ * @root: Root node of the tree, or NULL to drop the index whatever the tree
+ */
+void of_phandle_invalidate(const struct device_node *root);
+
 /**
  * of_alias_get_id - Get alias id for the given device_node
  *
@@ -703,6 +703,40 @@ ofnode ofnode_get_by_phandle(uint phandle);
  */
 ofnode oftree_get_by_phandle(oftree tree, uint phandle);
 
+#if CONFIG_IS_ENABLED(OF_PHANDLE_INDEX)
+/**
+ * oftree_phandle_offset() - find the node with a phandle in a flat tree
+ *
+ * This is fdt_node_offset_by_phandle(), except that lookups in the control
+ * FDT use an index of its phandles, which is built on first use.
+ *
+ * @fdt:	flat tree to search
+ * @phandle:	phandle to look up
+ * Return: offset of the node, -ve FDT_ERR_... error if not found
+ */
+int oftree_phandle_offset(const void *fdt, uint phandle);
+
+/**
+ * oftree_phandle_invalidate() - drop the phandle index of a flat tree
+ *
+ * This should be called after the tree is changed, so that the index is
+ * built again on the next lookup. Lookups notice a stale index anyway, but
+ * then need to search the tree.
+ *
+ * @fdt:	flat tree which was changed
+ */
+void oftree_phandle_invalidate(const void *fdt);
+#else
+static inline int oftree_phandle_offset(const void *fdt, uint phandle)
+{
+	return fdt_node_offset_by_phandle(fdt, phandle);
+}
+
+static inline void oftree_phandle_invalidate(const void *fdt)
+{
+}
+#endif
+
 /**
  * ofnode_read_size() - read the size of a property
  *
@@ -28,8 +28,41 @@ struct event_spy {
 	void *ctx;
 };
 
+/* Marks an event type whose static spies are not contiguous in the list */
+#define EVENT_DISPATCH_SCAN	0xffff
+
+/**
+ * struct event_dispatch - where to find the spies for an event type
+ *
+ * @start: Index of the first static spy for this type in the evspy_info list
+ * @count: Number of static spies for this type, or EVENT_DISPATCH_SCAN if
+ *	they are not next to each other in the list, so that the whole list
+ *	must be scanned
+ * @calls: Number of times this event has been sent
+ * @time_us: Total time spent in the spies for this event, in microseconds
+ */
+struct event_dispatch {
+	u16 start;
+	u16 count;
+	u32 calls;
+#if CONFIG_IS_ENABLED(EVENT_DEBUG)
+	u64 time_us;
+#endif
+};
+
+/**
+ * struct event_state - state of the event subsystem
+ *
+ * @spy_head: List of dynamic spies for each event type
+ * @dispatch: Dispatch information for each event type
+ * @indexed: true once @dispatch has been set up from the evspy_info list
+ */
 struct event_state {
-	struct list_head spy_head;
+#if CONFIG_IS_ENABLED(EVENT_DYNAMIC)
+	struct list_head spy_head[EVT_COUNT];
+#endif
+	struct event_dispatch dispatch[EVT_COUNT];
+	bool indexed;
 };
 
 #endif
@@ -3,6 +3,8 @@
 #ifndef _FASTBOOT_INTERNAL_H_
 #define _FASTBOOT_INTERNAL_H_
 
+struct sparse_storage;
+
 /**
  * fastboot_buf_addr - base address of the fastboot download buffer
  */
@@ -18,6 +20,18 @@ extern u32 fastboot_buf_size;
  */
 extern void (*fastboot_progress_callback)(const char *msg);
 
+/**
+ * fastboot_image_crc32() - Get the CRC32 of an image in the download buffer
+ *
+ * If @buffer and @size describe the last download, this returns the CRC32
+ * calculated while it was received, otherwise it calculates it now.
+ *
+ * @buffer: Image to check
+ * @size: Size of the image in bytes
+ * Return: CRC32 of the image
+ */
+u32 fastboot_image_crc32(const void *buffer, u32 size);
+
 /**
  * fastboot_getvar_all() - Writes current variable being listed from "all" to response.
  *
@@ -40,4 +54,16 @@ void fastboot_getvar_all(char *response);
  */
 void fastboot_getvar(char *cmd_parameter, char *response);
 
+/**
+ * fastboot_flash_sparse_okay() - Complete a sparse flash with statistics
+ *
+ * @sparse: Storage which write_sparse_image() has successfully written to
+ * @response: Pointer to fastboot response buffer
+ *
+ * The per-chunk-type statistics of @sparse are sent to the host as INFO
+ * responses, followed by the final OKAY.
+ */
+void fastboot_flash_sparse_okay(const struct sparse_storage *sparse,
+				char *response);
+
 #endif
@@ -51,6 +51,7 @@ enum {
 	FASTBOOT_COMMAND_OEM_RUN,
 	FASTBOOT_COMMAND_OEM_CONSOLE,
 	FASTBOOT_COMMAND_OEM_BOARD,
+	FASTBOOT_COMMAND_OEM_STREAM,
 	FASTBOOT_COMMAND_ACMD,
 	FASTBOOT_COMMAND_UCMD,
 	FASTBOOT_COMMAND_COUNT
@@ -186,6 +187,15 @@ void fastboot_data_download(const void *fastboot_data,
  */
 void fastboot_data_complete(char *response);
 
+/**
+ * fastboot_data_flush() - Write out the data downloaded so far
+ *
+ * If 'oem stream' chose a partition for the download, this writes the data
+ * received so far to it. Transports call this once they have set up the
+ * reception of the next packet, so that the write overlaps with it.
+ */
+void fastboot_data_flush(void);
+
 /**
  * fastboot_handle_multiresponse() - Called for each response to send
  *
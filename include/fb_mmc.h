@@ -39,4 +39,56 @@ void fastboot_mmc_flash_write(const char *cmd, void *download_buffer,
  * @response: Pointer to fastboot response buffer
  */
 void fastboot_mmc_erase(const char *cmd, char *response);
+
+/**
+ * fastboot_mmc_stream_select() - Choose where to stream the next download
+ *
+ * The next raw image downloaded is written to @part_name while it is
+ * received. The 'flash' command which follows must name the same partition.
+ *
+ * @part_name: Named partition to write the image to
+ * @response: Pointer to fastboot response buffer
+ */
+void fastboot_mmc_stream_select(const char *part_name, char *response);
+
+/**
+ * fastboot_mmc_stream_start() - Start streaming a download
+ *
+ * Nothing is done if no partition was chosen for this download. A streamed
+ * download may be larger than the download buffer, which is then used as a
+ * ring.
+ *
+ * @size: Size of the download in bytes
+ * @response: Pointer to fastboot response buffer
+ * Return: 1 if the download is streamed, 0 if not, -EFBIG if it is too large
+ *	for the partition, or too large for a download buffer which does not
+ *	hold a whole number of blocks
+ */
+int fastboot_mmc_stream_start(u32 size, char *response);
+
+/**
+ * fastboot_mmc_stream_reserve() - Make room in the download buffer
+ *
+ * Before data which wraps around the download buffer is received, this
+ * writes out any data it would overwrite.
+ *
+ * @buffer: Download buffer
+ * @bytes: Number of bytes received
+ * @len: Number of bytes about to be received
+ * Return: 0 if OK, -ENOSPC if the download is not being streamed or there
+ *	is still no room, or -EIO if a write failed
+ */
+int fastboot_mmc_stream_reserve(const void *buffer, u32 bytes, u32 len);
+
+/**
+ * fastboot_mmc_stream_write() - Write the data received so far
+ *
+ * Data is written in chunks of CONFIG_FASTBOOT_MMC_STREAM_CHUNK bytes,
+ * except at the end of the download, when the rest is written.
+ *
+ * @buffer: Download buffer
+ * @bytes: Number of bytes received, which may exceed the buffer size
+ * @last: true if the download is complete
+ */
+void fastboot_mmc_stream_write(const void *buffer, u32 bytes, bool last);
 #endif
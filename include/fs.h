@@ -90,6 +90,65 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part);
  */
 void fs_close(void);
 
+/**
+ * struct fs_mount_stats - state and statistics of the filesystem mount cache
+ *
+ * @desc: Block device holding the mounted filesystem, NULL if none
+ * @part: Partition number of the mounted filesystem
+ * @name: Type of the mounted filesystem, e.g. "ext4"
+ * @hits: Number of times a mounted filesystem was reused
+ * @misses: Number of times a filesystem had to be probed
+ * @invalidations: Number of times a mounted filesystem was dropped because
+ *	its device was written, removed or reinitialised, or by fs_flush()
+ */
+struct fs_mount_stats {
+	struct blk_desc *desc;
+	int part;
+	const char *name;
+	ulong hits;
+	ulong misses;
+	ulong invalidations;
+};
+
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/**
+ * fs_invalidate() - Drop the cached mount of a block device
+ *
+ * With CONFIG_FS_MOUNT_CACHE, fs_close() keeps the filesystem mounted so
+ * that the next fs_set_blk_dev() for the same partition does not need to
+ * probe it again. This must be called whenever the contents of the device
+ * may change behind the back of the filesystem, e.g. when it is written or
+ * removed. If the filesystem is in use, it is unmounted by the next
+ * fs_close().
+ *
+ * @desc: Block device which changed, or NULL for any device
+ */
+void fs_invalidate(struct blk_desc *desc);
+
+/**
+ * fs_mount_get_stats() - Get the state and statistics of the mount cache
+ *
+ * @stats: Returns the statistics
+ */
+void fs_mount_get_stats(struct fs_mount_stats *stats);
+#else
+static inline void fs_invalidate(struct blk_desc *desc)
+{
+}
+#endif
+
+/**
+ * fs_flush() - Unmount the cached filesystem, if any
+ *
+ * This should be called before accessing a filesystem driver directly, rather
+ * than through the fs layer, since the driver only supports one mounted
+ * filesystem at a time.
+ */
+static inline void fs_flush(void)
+{
+	fs_invalidate(NULL);
+}
+
 /**
  * fs_get_type() - Get type of current filesystem
  *
@@ -120,6 +120,29 @@ int hash_command(const char *algo_name, int flags, struct cmd_tbl *cmdtp,
 int hash_block(const char *algo_name, const void *data, unsigned int len,
 	       uint8_t *output, int *output_size);
 
+/* Maximum number of algorithms which hash_multi_block() can use at once */
+#define HASH_MULTI_MAX		8
+
+/**
+ * hash_multi_block() - Hash a block with several algorithms in one pass
+ *
+ * This gives the same results as calling hash_block() for each algorithm, but
+ * reads the data only once. It is passed to each algorithm in turn, in chunks
+ * small enough to stay in the cache, and the watchdog is kicked after each
+ * chunk. An algorithm without progressive-hashing support is run separately.
+ *
+ * @algos:	Algorithms to use
+ * @count:	Number of algorithms, at most HASH_MULTI_MAX
+ * @data:	Data to hash
+ * @len:	Length of data to hash in bytes
+ * @outputs:	Place to put the hash value for each algorithm; each must have
+ *		space for the digest_size of that algorithm
+ * Return: 0 if ok, -E2BIG if there are too many algorithms, -EIO if an
+ * algorithm failed
+ */
+int hash_multi_block(struct hash_algo *const algos[], int count,
+		     const void *data, ulong len, u8 *const outputs[]);
+
 #endif /* !USE_HOSTCC */
 
 /**
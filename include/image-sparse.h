@@ -11,6 +11,36 @@
 
 #define ROUNDUP(x, y)	(((x) + ((y) - 1)) & ~((y) - 1))
 
+/**
+ * enum sparse_stat_type - kinds of output produced by write_sparse_image()
+ *
+ * @SPARSE_STAT_RAW: CHUNK_TYPE_RAW data written
+ * @SPARSE_STAT_FILL: CHUNK_TYPE_FILL with a non-zero pattern written
+ * @SPARSE_STAT_ZERO: CHUNK_TYPE_FILL with a zero pattern, erased or written
+ * @SPARSE_STAT_SKIP: CHUNK_TYPE_DONT_CARE reserved
+ */
+enum sparse_stat_type {
+	SPARSE_STAT_RAW,
+	SPARSE_STAT_FILL,
+	SPARSE_STAT_ZERO,
+	SPARSE_STAT_SKIP,
+
+	SPARSE_STAT_COUNT,
+};
+
+/**
+ * struct sparse_stat - statistics for one kind of chunk
+ *
+ * @chunks: Number of chunks processed
+ * @bytes: Number of bytes of output covered by those chunks
+ * @time_ms: Time spent processing them, in milliseconds
+ */
+struct sparse_stat {
+	uint		chunks;
+	u64		bytes;
+	ulong		time_ms;
+};
+
 struct sparse_storage {
 	lbaint_t	blksz;
 	lbaint_t	start;
@@ -26,7 +56,21 @@ struct sparse_storage {
 				 lbaint_t blk,
 				 lbaint_t blkcnt);
 
+	/*
+	 * Optional: make blkcnt blocks at blk read back as zeroes without
+	 * writing them, returning blkcnt on success. The range is always
+	 * aligned to erase_grp blocks. Zero-filled chunks are written as
+	 * normal if this is NULL or fails.
+	 */
+	lbaint_t	(*erase)(struct sparse_storage *info,
+				 lbaint_t blk,
+				 lbaint_t blkcnt);
+	lbaint_t	erase_grp;
+
 	void		(*mssg)(const char *str, char *response);
+
+	/* filled in by write_sparse_image() */
+	struct sparse_stat stats[SPARSE_STAT_COUNT];
 };
 
 static inline int is_sparse_image(void *buf)
@@ -42,3 +86,15 @@ static inline int is_sparse_image(void *buf)
 
 int write_sparse_image(struct sparse_storage *info, const char *part_name,
 		       void *data, char *response);
+
+/**
+ * sparse_stat_format() - describe the statistics for one kind of chunk
+ *
+ * @info: Storage that write_sparse_image() has been called on
+ * @type: Kind of chunk to describe
+ * @buf: Buffer for the description, e.g. "raw: 3 chunks, 8192 KiB in 20 ms"
+ * @size: Size of @buf
+ * Return: number of characters written, as snprintf()
+ */
+int sparse_stat_format(const struct sparse_storage *info,
+		       enum sparse_stat_type type, char *buf, int size);
@@ -407,7 +407,10 @@ enum log_rec_flags {
  * @flags: Flags for log record (enum log_rec_flags)
  * @file: Name of file where the log record was generated (not allocated)
  * @func: Function where the log record was generated (not allocated)
- * @msg: Log message (allocated)
+ * @msg: Log message (allocated), or NULL if it has not been formatted yet
+ * @fmt: printf()-style format string for the message (not allocated)
+ * @args: Arguments for @fmt. A driver which uses this must va_copy() it
+ *	rather than consuming it directly
  */
 struct log_rec {
 	enum log_category_t cat;
@@ -417,12 +420,15 @@ struct log_rec {
 	const char *file;
 	const char *func;
 	const char *msg;
+	const char *fmt;
+	va_list *args;
 };
 
 struct log_device;
 
 enum log_device_flags {
 	LOGDF_ENABLE		= BIT(0),	/* Device is enabled */
+	LOGDF_RAW		= BIT(1),	/* Device uses fmt/args, not msg */
 };
 
 /**
@@ -668,6 +674,86 @@ int log_remove_filter(const char *drv_name, int filter_num);
  */
 int log_device_set_enable(struct log_driver *drv, bool enable);
 
+/**
+ * struct log_binary_hdr - header of the binary log ring
+ *
+ * This is stored in the bloblist with tag %BLOBLISTT_U_BOOT_LOG and is
+ * followed by @size bytes of records. Each record starts with a
+ * struct log_binary_rec and occupies a multiple of 8 bytes. Records are
+ * written at @tail and the oldest is at @head. A record with a size of 0, or
+ * reaching the end of the buffer, means that the next one starts at offset 0.
+ *
+ * All offsets are relative to the end of this header, so the ring can be
+ * moved, or copied to another machine for decoding.
+ *
+ * @magic: %LOG_BINARY_MAGIC
+ * @size: Size of the record area in bytes
+ * @head: Offset of the oldest record
+ * @tail: Offset at which the next record will be written
+ * @count: Number of records in the ring
+ * @dropped: Number of records discarded to make space, or because they were
+ *	too large
+ */
+struct log_binary_hdr {
+	u32 magic;
+	u32 size;
+	u32 head;
+	u32 tail;
+	u32 count;
+	u32 dropped;
+};
+
+#define LOG_BINARY_MAGIC	0x4c4f4742	/* "BGOL" */
+
+/** enum log_binary_flags - Flags for a binary log record */
+enum log_binary_flags {
+	/** @LOGBF_TEXT: @args holds the formatted message, not arguments */
+	LOGBF_TEXT	= BIT(7),
+};
+
+/**
+ * struct log_binary_rec - a single record in the binary log
+ *
+ * The format string is not copied. @fmt is its address within the U-Boot image
+ * as linked, i.e. with any relocation offset removed, so a host tool can look
+ * it up in the ELF file. It must therefore be a string literal.
+ *
+ * @args starts with the function name, nul-terminated and padded to 8 bytes.
+ * Each argument consumed by @fmt follows in order. Integers and pointers take
+ * 8 bytes. Strings are copied, nul-terminated and padded to 8 bytes.
+ *
+ * @size: Size of the record in bytes, including this header
+ * @level: Log level (enum log_level_t)
+ * @flags: Record flags (enum log_rec_flags and enum log_binary_flags)
+ * @cat: Log category (enum log_category_t)
+ * @line: Line number where the record was generated
+ * @time_us: Timer value in microseconds when the record was generated
+ * @fmt: Link-time address of the format string
+ * @args: Function name and arguments, as above
+ */
+struct log_binary_rec {
+	u16 size;
+	u8 level;
+	u8 flags;
+	u16 cat;
+	u16 line;
+	u64 time_us;
+	u64 fmt;
+	u8 args[];
+};
+
+/**
+ * log_binary_dump() - Format and print the records in the binary log
+ *
+ * Return: 0 if OK, -ENOENT if there is no binary log
+ */
+int log_binary_dump(void);
+
+/**
+ * log_binary_clear() - Remove all records from the binary log
+ */
+void log_binary_clear(void);
+
 #if CONFIG_IS_ENABLED(LOG)
 /**
  * log_init() - Set up the log system ready for use
@@ -879,6 +879,34 @@ void malloc_enable_testing(int max_allocs);
 /** malloc_disable_testing() - Put malloc() into normal mode */
 void malloc_disable_testing(void);
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+/**
+ * malloc_slab_info() - Show statistics for each slab cache
+ *
+ * This shows the number of objects in use, the peak number, the pages held
+ * and the number of allocations and frees for each size class.
+ */
+void malloc_slab_info(void);
+
+/**
+ * malloc_slab_enable() - Control use of the slab caches
+ *
+ * When disabled, small requests are served from the heap directly. Objects
+ * already allocated from the slab caches can still be freed as normal.
+ *
+ * @enable: true to use the slab caches for small requests, false to not
+ */
+void malloc_slab_enable(bool enable);
+#else
+static inline void malloc_slab_info(void)
+{
+}
+
+static inline void malloc_slab_enable(bool enable)
+{
+}
+#endif
+
 #if CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
 #define malloc malloc_simple
 #define realloc realloc_simple
@@ -73,8 +73,9 @@ struct ip_udp_hdr {
 #define IP_UDP_HDR_SIZE		(sizeof(struct ip_udp_hdr))
 #define UDP_HDR_SIZE		(IP_UDP_HDR_SIZE - IP_HDR_SIZE)
 
-/* Number of packets processed together */
+/* Number of packets processed together, grown while the driver keeps up */
 #define ETH_PACKETS_BATCH_RECV	32
+#define ETH_PACKETS_BATCH_MAX	256
 
 /* ARP hardware address length */
 #define ARP_HLEN 6
@@ -292,6 +293,60 @@ struct eth_ops {
 struct udevice *eth_get_dev(void); /* get the current device */
 unsigned char *eth_get_ethaddr(void); /* get the current device MAC */
 int eth_rx(void);                      /* Check for received packets */
+
+/**
+ * struct net_stats - Statistics for packet reception and the network loop
+ *
+ * @polls: Number of times the driver was polled for a batch of packets
+ * @rx_packets: Number of packets received
+ * @rx_max_batch: Largest number of packets received in one poll
+ * @rx_full: Number of polls which used their whole budget, so that more
+ *	packets were likely waiting in the driver
+ * @rx_errors: Number of errors returned by the driver's recv() method
+ * @rx_dropped: Number of packets taken from the driver but then dropped
+ *	because there was no room or no buffer for them
+ * @rx_budget: Current number of packets allowed per poll
+ * @loops: Number of iterations of the net_loop() main loop
+ * @loop_us: Total time spent in those iterations, in microseconds
+ * @loop_max_us: Longest single iteration, in microseconds
+ */
+struct net_stats {
+	ulong polls;
+	ulong rx_packets;
+	uint rx_max_batch;
+	ulong rx_full;
+	ulong rx_errors;
+	ulong rx_dropped;
+	uint rx_budget;
+	ulong loops;
+	u64 loop_us;
+	ulong loop_max_us;
+};
+
+extern struct net_stats net_stats;
+
+/**
+ * eth_rx_budget() - Get the number of packets to process in the next poll
+ *
+ * While packets are handed to push_packet, the budget is limited to
+ * ETH_PACKETS_BATCH_RECV, which is all that its consumer can hold.
+ *
+ * Return: maximum number of packets to take from the driver
+ */
+int eth_rx_budget(void);
+
+/**
+ * eth_rx_account() - Record the result of a poll and adjust the budget
+ *
+ * The budget doubles each time a poll fills it, up to ETH_PACKETS_BATCH_MAX,
+ * so that a busy link is drained without going round the whole network loop
+ * for every few packets. It shrinks again once polls return little.
+ *
+ * @count: Number of packets received
+ * @budget: Budget which was used for this poll
+ * @ret: Last value returned by the driver's recv() method
+ */
+void eth_rx_account(int count, int budget, int ret);
 void eth_halt(void);			/* stop SCC */
 const char *eth_get_name(void);		/* get name of current device */
 int eth_get_dev_index(void);
@@ -86,7 +86,10 @@ struct ip_tcp_hdr {
 #define TCP_OPT_LEN_8	0x08
 #define TCP_OPT_LEN_A	0x0a		/* Timestamp Length		*/
 #define TCP_MSS		1460		/* Max segment size		*/
-#define TCP_SCALE	0x01		/* Scale			*/
+#define TCP_MAX_SCALE	14		/* Largest window shift, RFC 7323	*/
+
+/* Receive window offered to the server, in bytes */
+#define TCP_RX_WINDOW	(CONFIG_PROT_TCP_WINDOW_SIZE ?: PKTBUFSRX * TCP_MSS)
 
 /**
  * struct tcp_mss - TCP option structure for MSS (Max segment size)
@@ -489,6 +489,17 @@ struct part_driver {
 	 * -ve if not
 	 */
 	int (*test)(struct blk_desc *desc);
+
+	/**
+	 * @find_name:		Find a partition by name (optional)
+	 *
+	 * @find_name.desc:	Block device descriptor
+	 * @find_name.name:	Partition name, as returned by @get_info
+	 * @find_name.Return:
+	 * partition number (1 = first), -ENOENT if there is no partition with
+	 * that name, -ENOSYS if the caller should search with @get_info
+	 */
+	int (*find_name)(struct blk_desc *desc, const char *name);
 };
 
 /* Declare a new U-Boot partition 'driver' */
@@ -630,6 +641,28 @@ int get_disk_guid(struct blk_desc *desc, char *guid);
 
 #endif
 
+#if CONFIG_IS_ENABLED(EFI_PARTITION_CACHE)
+/**
+ * part_cache_invalidate() - Drop cached partition tables
+ *
+ * This must be called when blocks holding a partition table may have changed,
+ * so that the table is read again when it is next needed. Writes to blocks
+ * which cannot hold a partition table of the device leave it cached.
+ *
+ * @desc:	block device descriptor, or NULL for all devices
+ * @start:	first block written
+ * @blkcnt:	number of blocks written, or 0 if the whole device may have
+ *		changed
+ */
+void part_cache_invalidate(struct blk_desc *desc, lbaint_t start,
+			   lbaint_t blkcnt);
+#else
+static inline void part_cache_invalidate(struct blk_desc *desc,
+					 lbaint_t start, lbaint_t blkcnt)
+{
+}
+#endif
+
 #if CONFIG_IS_ENABLED(DOS_PARTITION)
 /**
  * is_valid_dos_buf() - Ensure that a DOS MBR image is valid
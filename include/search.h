@@ -56,6 +56,11 @@ struct hsearch_data {
  */
 	int (*change_ok)(const struct env_entry *item, const char *newval,
 			 enum env_op, int flag);
+/*
+ * Incremented whenever an entry is added, changed or deleted, so that callers
+ * can tell whether a pointer obtained from an earlier lookup is still valid.
+ */
+	unsigned int change_count;
 };
 
 /* Create a new hash table which will contain at most "nel" elements.  */
@@ -196,6 +196,30 @@ int submit_control_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
 int submit_int_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
 			int transfer_len, int interval, bool nonblock);
 
+/* Maximum number of transfers in a call to usb_bulk_queue() */
+#define USB_BULK_QUEUE_MAX	4
+
+/**
+ * struct usb_bulk_req - A bulk transfer queued with others
+ *
+ * @pipe:	Pipe to use for the transfer
+ * @buffer:	Buffer to read into or write from
+ * @length:	Number of bytes to transfer
+ * @act_len:	Number of bytes actually transferred
+ * @status:	Status of the transfer (USB_ST_...), 0 if OK, USB_ST_NOT_PROC
+ *		if it was not carried out
+ */
+struct usb_bulk_req {
+	unsigned long pipe;
+	void *buffer;
+	int length;
+	int act_len;
+	unsigned long status;
+};
+
+int submit_bulk_queue(struct usb_device *dev, struct usb_bulk_req *reqs,
+		      int count);
+
 #if defined CONFIG_USB_EHCI_HCD || defined CONFIG_USB_MUSB_HOST \
 	|| CONFIG_IS_ENABLED(DM_USB)
 struct int_queue *create_int_queue(struct usb_device *dev, unsigned long pipe,
@@ -275,6 +299,8 @@ int usb_control_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, unsigned short size, int timeout);
 int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, int len, int *actual_length, int timeout);
+int usb_bulk_queue(struct usb_device *dev, struct usb_bulk_req *reqs,
+		   int count, int timeout);
 int usb_int_msg(struct usb_device *dev, unsigned long pipe,
 		void *buffer, int transfer_len, int interval, bool nonblock);
 int usb_lock_async(struct usb_device *dev, int lock);
@@ -713,6 +739,22 @@ struct dm_usb_ops {
 	 */
 	int (*bulk)(struct udevice *bus, struct usb_device *udev,
 		    unsigned long pipe, void *buffer, int length);
+	/**
+	 * bulk_queue() - Send several bulk messages and wait for them
+	 *
+	 * The transfers are handed to the controller together, so that it
+	 * can run them back to back. Processing stops at the first one that
+	 * fails. This is optional; without it the transfers are sent one by
+	 * one.
+	 *
+	 * @reqs: Transfers to carry out, in order. The status and act_len
+	 *	of each is updated
+	 * @count: Number of transfers, at most USB_BULK_QUEUE_MAX
+	 * @return 0 if the transfers were processed, -ENOSYS if they cannot
+	 *	be queued together, other -ve on error
+	 */
+	int (*bulk_queue)(struct udevice *bus, struct usb_device *udev,
+			  struct usb_bulk_req *reqs, int count);
 	/**
 	 * interrupt() - Send an interrupt message
 	 *
@@ -0,0 +1,71 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Streaming decompression of images onto block devices
+ */
+
+#ifndef __ZWRITE_H
+#define __ZWRITE_H
+
+#include <blk.h>
+#include <linux/bitops.h>
+#include <linux/types.h>
+
+/**
+ * enum zwrite_flags - how all-zero output blocks are handled
+ *
+ * @ZWRITE_ZERO_SKIP: do not write all-zero blocks at all; the caller knows
+ *	that the target area already reads back as zeroes
+ * @ZWRITE_ZERO_ERASE: erase runs of all-zero blocks with blk_derase() instead
+ *	of writing them, falling back to a normal write if the device cannot
+ *	erase. Only use this on devices whose erased state reads as zeroes and
+ *	whose erase granularity is the block size
+ */
+enum zwrite_flags {
+	ZWRITE_ZERO_SKIP	= BIT(0),
+	ZWRITE_ZERO_ERASE	= BIT(1),
+};
+
+/**
+ * struct zwrite_stats - statistics about a zwrite() operation
+ *
+ * @comp: Compression type detected (IH_COMP_...)
+ * @in_size: Number of compressed bytes consumed
+ * @out_size: Number of uncompressed bytes produced
+ * @blks_written: Number of blocks written to the device
+ * @blks_zero: Number of all-zero blocks skipped or erased instead of written
+ * @time_ms: Time taken in milliseconds
+ */
+struct zwrite_stats {
+	int comp;
+	u64 in_size;
+	u64 out_size;
+	lbaint_t blks_written;
+	lbaint_t blks_zero;
+	ulong time_ms;
+};
+
+/**
+ * zwrite() - decompress an image from memory onto a block device
+ *
+ * The compression format (gzip, zstd, lzma or lz4, subject to the
+ * corresponding options being enabled) is detected from the image. The output
+ * is produced in chunks of @szwritebuf bytes which are written out as soon as
+ * they are full, so the uncompressed image never needs to fit in memory. The
+ * final partial block is padded with zeroes.
+ *
+ * @src: Compressed image
+ * @len: Length of compressed image in bytes
+ * @dev: Block device to write to
+ * @szwritebuf: Bytes per write, must be a multiple of the block size
+ * @startoffs: Offset in bytes of the first write, must be block-aligned
+ * @flags: Bitmask of enum zwrite_flags
+ * @stats: Returns statistics about the operation, may be NULL
+ * Return: 0 if OK, -EINVAL for bad arguments or corrupt data,
+ *	-EPROTONOSUPPORT if the compression format is not supported, -ENOSPC if
+ *	the image does not fit on the device, -EIO on write error, -EINTR if
+ *	interrupted with Ctrl-C, -ENOMEM if out of memory
+ */
+int zwrite(const void *src, ulong len, struct blk_desc *dev, ulong szwritebuf,
+	   ulong startoffs, uint flags, struct zwrite_stats *stats);
+
+#endif
@@ -689,12 +689,16 @@ static void efi_net_push(void *pkt, int len)
 		return;
 
 	/* Check that the buffer won't overflow */
-	if (len > PKTSIZE_ALIGN)
+	if (len > PKTSIZE_ALIGN) {
+		net_stats.rx_dropped++;
 		return;
+	}
 
 	/* Can't store more than pre-alloced buffer */
-	if (rx_packet_num >= ETH_PACKETS_BATCH_RECV)
+	if (rx_packet_num >= ETH_PACKETS_BATCH_RECV) {
+		net_stats.rx_dropped++;
 		return;
+	}
 
 	rx_packet_next = (rx_packet_idx + rx_packet_num) %
 	    ETH_PACKETS_BATCH_RECV;
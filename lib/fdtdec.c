@@ -646,7 +646,7 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = oftree_phandle_offset(blob, fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -777,8 +777,7 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = oftree_phandle_offset(blob, phandle);
 				if (node < 0) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
@@ -1499,7 +1498,7 @@ int fdtdec_get_carveout(const void *blob, const char *node,
 
 	phandle = fdt32_to_cpu(prop[index]);
 
-	offset = fdt_node_offset_by_phandle(blob, phandle);
+	offset = oftree_phandle_offset(blob, phandle);
 	if (offset < 0) {
 		debug("failed to find node for phandle %u\n", phandle);
 		return offset;
@@ -158,6 +158,7 @@ void hdestroy_r(struct hsearch_data *htab)
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
+	++htab->change_count;
 }
 
 /*
@@ -264,6 +265,7 @@ static inline int _compare_and_overwrite_entry(struct env_entry item,
 
 			free(htab->table[idx].entry.data);
 			htab->table[idx].entry.data = strdup(item.data);
+			++htab->change_count;
 			if (!htab->table[idx].entry.data) {
 				__set_errno(ENOMEM);
 				*retval = NULL;
@@ -388,6 +390,7 @@ int hsearch_r(struct env_entry item, enum env_action action,
 		}
 
 		++htab->filled;
+		++htab->change_count;
 
 		/* This is a new entry, so look up a possible callback */
 		env_callback_init(&htab->table[idx].entry);
@@ -447,6 +450,7 @@ static void _hdelete(const char *key, struct hsearch_data *htab,
 	htab->table[idx].used = USED_DELETED;
 
 	--htab->filled;
+	++htab->change_count;
 }
 
 int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
@@ -42,6 +42,7 @@
 #include <malloc.h>
 #include <part.h>
 #include <sparse_format.h>
+#include <time.h>
 #include <asm/cache.h>
 
 #include <linux/math64.h>
@@ -49,61 +50,185 @@
 
 static void default_log(const char *ignored, char *response) {}
 
+static const char *const sparse_stat_names[SPARSE_STAT_COUNT] = {
+	[SPARSE_STAT_RAW]	= "raw",
+	[SPARSE_STAT_FILL]	= "fill",
+	[SPARSE_STAT_ZERO]	= "zero",
+	[SPARSE_STAT_SKIP]	= "skip",
+};
+
+/**
+ * struct sparse_bufs - buffers shared by all chunks of an image
+ *
+ * @bounce: Aligned copy of RAW data which is not suitably aligned
+ * @fill: Buffer holding @fill_blks blocks of the pattern @fill_val
+ * @fill_blks: Size of @fill in blocks
+ * @fill_val: Pattern currently held in @fill
+ */
+struct sparse_bufs {
+	void *bounce;
+	u32 *fill;
+	lbaint_t fill_blks;
+	u32 fill_val;
+};
+
+static lbaint_t write_sparse_fail(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t n, lbaint_t write_blks,
+				  char *response)
+{
+	if (IS_ERR_VALUE(write_blks)) {
+		printf("%s: Write failed, block #" LBAFU " [" LBAFU "] (%lld)\n",
+		       __func__, blk, n, (long long)write_blks);
+		info->mssg("flash write failure", response);
+		return write_blks;
+	}
+
+	/* write_blks < n */
+	printf("%s: Write failed, block #" LBAFU " [" LBAFU "]\n",
+	       __func__, blk, n);
+	info->mssg("flash write failure(incomplete)", response);
+	return -1;
+}
+
 static lbaint_t write_sparse_chunk_raw(struct sparse_storage *info,
 				       lbaint_t blk, lbaint_t blkcnt,
-				       void *data,
+				       void *data, struct sparse_bufs *bufs,
 				       char *response)
 {
 	lbaint_t n = blkcnt, write_blks, blks = 0;
 	lbaint_t aligned_buf_blks = FASTBOOT_MAX_BLK_WRITE;
-	uint32_t *aligned_buf = NULL;
 
-	if (CONFIG_IS_ENABLED(SYS_DCACHE_OFF)) {
+	/* data that is already aligned for DMA can be written in place */
+	if (CONFIG_IS_ENABLED(SYS_DCACHE_OFF) ||
+	    IS_ALIGNED((ulong)data, ARCH_DMA_MINALIGN)) {
 		write_blks = info->write(info, blk, n, data);
 		if (write_blks < n)
-			goto write_fail;
+			return write_sparse_fail(info, blk, n, write_blks,
+						 response);
 
 		return write_blks;
 	}
 
-	aligned_buf = memalign(ARCH_DMA_MINALIGN, info->blksz * aligned_buf_blks);
-	if (!aligned_buf) {
-		info->mssg("Malloc failed for: CHUNK_TYPE_RAW", response);
-		return -ENOMEM;
+	if (!bufs->bounce) {
+		bufs->bounce = memalign(ARCH_DMA_MINALIGN,
+					info->blksz * aligned_buf_blks);
+		if (!bufs->bounce) {
+			info->mssg("Malloc failed for: CHUNK_TYPE_RAW",
+				   response);
+			return -ENOMEM;
+		}
 	}
 
 	while (blkcnt > 0) {
 		n = min(aligned_buf_blks, blkcnt);
-		memcpy(aligned_buf, data, n * info->blksz);
+		memcpy(bufs->bounce, data, n * info->blksz);
 
 		/* write_blks might be > n due to NAND bad-blocks */
-		write_blks = info->write(info, blk + blks, n, aligned_buf);
-		if (write_blks < n) {
-			free(aligned_buf);
-			goto write_fail;
-		}
+		write_blks = info->write(info, blk + blks, n, bufs->bounce);
+		if (write_blks < n)
+			return write_sparse_fail(info, blk + blks, n,
+						 write_blks, response);
 
 		blks += write_blks;
 		data += n * info->blksz;
 		blkcnt -= n;
 	}
 
-	free(aligned_buf);
 	return blks;
+}
 
-write_fail:
-	if (IS_ERR_VALUE(write_blks)) {
-		printf("%s: Write failed, block #" LBAFU " [" LBAFU "] (%lld)\n",
-		       __func__, blk + blks, n, (long long)write_blks);
-		info->mssg("flash write failure", response);
-		return write_blks;
+static lbaint_t write_sparse_chunk_fill(struct sparse_storage *info,
+					lbaint_t blk, lbaint_t blkcnt,
+					u32 fill_val, struct sparse_bufs *bufs,
+					char *response)
+{
+	lbaint_t n, write_blks, blks = 0;
+	int i;
+
+	/* the buffer is only refilled when the pattern changes */
+	if (!bufs->fill) {
+		bufs->fill_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+		bufs->fill = memalign(ARCH_DMA_MINALIGN,
+				      ROUNDUP(info->blksz * bufs->fill_blks,
+					      ARCH_DMA_MINALIGN));
+		if (!bufs->fill) {
+			info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
+				   response);
+			return -ENOMEM;
+		}
+		bufs->fill_val = ~fill_val;
+	}
+	if (bufs->fill_val != fill_val) {
+		for (i = 0; i < info->blksz * bufs->fill_blks / sizeof(fill_val);
+		     i++)
+			bufs->fill[i] = fill_val;
+		bufs->fill_val = fill_val;
 	}
 
-	/* write_blks < n */
-	printf("%s: Write failed, block #" LBAFU " [" LBAFU "]\n",
-	       __func__, blk + blks, n);
-	info->mssg("flash write failure(incomplete)", response);
-	return -1;
+	while (blkcnt > 0) {
+		n = min(bufs->fill_blks, blkcnt);
+		write_blks = info->write(info, blk + blks, n, bufs->fill);
+		/* write_blks might be > n (eg. NAND bad-blocks) */
+		if (write_blks < n)
+			return write_sparse_fail(info, blk + blks, n,
+						 write_blks, response);
+
+		blks += write_blks;
+		blkcnt -= n;
+	}
+
+	return blks;
+}
+
+static lbaint_t write_sparse_chunk_zero(struct sparse_storage *info,
+					lbaint_t blk, lbaint_t blkcnt,
+					struct sparse_bufs *bufs,
+					char *response)
+{
+	u32 grp = info->erase_grp ? info->erase_grp : 1;
+	lbaint_t head, body, blks;
+	u32 rem;
+
+	/*
+	 * Erase the part of the chunk which covers whole erase groups and
+	 * only write the unaligned ends
+	 */
+	div_u64_rem(blk, grp, &rem);
+	head = min(blkcnt, (lbaint_t)(rem ? grp - rem : 0));
+	div_u64_rem(blkcnt - head, grp, &rem);
+	body = blkcnt - head - rem;
+	if (!info->erase || !body ||
+	    info->erase(info, blk + head, body) != body)
+		return write_sparse_chunk_fill(info, blk, blkcnt, 0, bufs,
+					       response);
+
+	blks = write_sparse_chunk_fill(info, blk, head, 0, bufs, response);
+	if (IS_ERR_VALUE(blks))
+		return blks;
+	blks += body;
+	head = write_sparse_chunk_fill(info, blk + blks, blkcnt - head - body,
+				       0, bufs, response);
+	if (IS_ERR_VALUE(head))
+		return head;
+
+	return blks + head;
+}
+
+int sparse_stat_format(const struct sparse_storage *info,
+		       enum sparse_stat_type type, char *buf, int size)
+{
+	const struct sparse_stat *stat = &info->stats[type];
+	int len;
+
+	len = snprintf(buf, size, "%s: %u chunks, %llu KiB in %lu ms",
+		       sparse_stat_names[type], stat->chunks, stat->bytes >> 10,
+		       stat->time_ms);
+	if (stat->time_ms && len < size)
+		len += snprintf(buf + len, size - len, " (%llu KiB/s)",
+				div_u64(stat->bytes, stat->time_ms) * 1000 >>
+				10);
+
+	return len;
 }
 
 int write_sparse_image(struct sparse_storage *info,
@@ -116,16 +241,17 @@ int write_sparse_image(struct sparse_storage *info,
 	unsigned int chunk;
 	unsigned int offset;
 	uint64_t chunk_data_sz;
-	uint32_t *fill_buf = NULL;
 	uint32_t fill_val;
 	sparse_header_t *sparse_header;
 	chunk_header_t *chunk_header;
 	uint32_t total_blocks = 0;
-	int fill_buf_num_blks;
-	int i;
-	int j;
+	struct sparse_bufs bufs = {};
+	enum sparse_stat_type type;
+	char line[64];
+	ulong start;
+	int ret = -1;
 
-	fill_buf_num_blks = CONFIG_IMAGE_SPARSE_FILLBUF_SIZE / info->blksz;
+	memset(info->stats, '\0', sizeof(info->stats));
 
 	/* Read and skip over sparse image header */
 	sparse_header = (sparse_header_t *)data;
@@ -191,13 +317,14 @@ int write_sparse_image(struct sparse_storage *info,
 
 		chunk_data_sz = ((u64)sparse_header->blk_sz) * chunk_header->chunk_sz;
 		blkcnt = DIV_ROUND_UP_ULL(chunk_data_sz, info->blksz);
+		start = get_timer(0);
 		switch (chunk_header->chunk_type) {
 		case CHUNK_TYPE_RAW:
 			if (chunk_header->total_sz !=
 			    (sparse_header->chunk_hdr_sz + chunk_data_sz)) {
 				info->mssg("Bogus chunk size for chunk type Raw",
 					   response);
-				return -1;
+				goto out;
 			}
 
 			if (blk + blkcnt > info->start + info->size) {
@@ -206,84 +333,63 @@ int write_sparse_image(struct sparse_storage *info,
 				    __func__);
 				info->mssg("Request would exceed partition size!",
 					   response);
-				return -1;
+				goto out;
 			}
 
 			blks = write_sparse_chunk_raw(info, blk, blkcnt,
-						      data, response);
+						      data, &bufs, response);
 			if (IS_ERR_VALUE(blks))
-				return -1;
+				goto out;
 
 			blk += blks;
 			bytes_written += ((u64)blkcnt) * info->blksz;
 			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
+			type = SPARSE_STAT_RAW;
 			break;
 
 		case CHUNK_TYPE_FILL:
 			if (chunk_header->total_sz !=
 			    (sparse_header->chunk_hdr_sz + sizeof(uint32_t))) {
 				info->mssg("Bogus chunk size for chunk type FILL", response);
-				return -1;
-			}
-
-			fill_buf = (uint32_t *)
-				   memalign(ARCH_DMA_MINALIGN,
-					    ROUNDUP(
-						info->blksz * fill_buf_num_blks,
-						ARCH_DMA_MINALIGN));
-			if (!fill_buf) {
-				info->mssg("Malloc failed for: CHUNK_TYPE_FILL",
-					   response);
-				return -1;
+				goto out;
 			}
 
 			fill_val = *(uint32_t *)data;
 			data = (char *)data + sizeof(uint32_t);
 
-			for (i = 0;
-			     i < (info->blksz * fill_buf_num_blks /
-				  sizeof(fill_val));
-			     i++)
-				fill_buf[i] = fill_val;
-
 			if (blk + blkcnt > info->start + info->size) {
 				printf(
 				    "%s: Request would exceed partition size!\n",
 				    __func__);
 				info->mssg("Request would exceed partition size!",
 					   response);
-				return -1;
+				goto out;
 			}
 
-			for (i = 0; i < blkcnt;) {
-				j = blkcnt - i;
-				if (j > fill_buf_num_blks)
-					j = fill_buf_num_blks;
-				blks = info->write(info, blk, j, fill_buf);
-				/* blks might be > j (eg. NAND bad-blocks) */
-				if (blks < j) {
-					printf("%s: %s " LBAFU " [%d]\n",
-					       __func__,
-					       "Write failed, block #",
-					       blk, j);
-					info->mssg("flash write failure",
-						   response);
-					free(fill_buf);
-					return -1;
-				}
-				blk += blks;
-				i += j;
+			if (fill_val) {
+				blks = write_sparse_chunk_fill(info, blk, blkcnt,
+							       fill_val, &bufs,
+							       response);
+				type = SPARSE_STAT_FILL;
+			} else {
+				blks = write_sparse_chunk_zero(info, blk, blkcnt,
+							       &bufs, response);
+				type = SPARSE_STAT_ZERO;
 			}
+			if (IS_ERR_VALUE(blks))
+				goto out;
+
+			blk += blks;
 			bytes_written += ((u64)blkcnt) * info->blksz;
 			total_blocks += DIV_ROUND_UP_ULL(chunk_data_sz,
 							 sparse_header->blk_sz);
-			free(fill_buf);
 			break;
 
 		case CHUNK_TYPE_DONT_CARE:
 			blk += info->reserve(info, blk, blkcnt);
 			total_blocks += chunk_header->chunk_sz;
+			type = SPARSE_STAT_SKIP;
 			break;
 
 		case CHUNK_TYPE_CRC32:
@@ -291,28 +397,43 @@ int write_sparse_image(struct sparse_storage *info,
 			    sparse_header->chunk_hdr_sz + sizeof(uint32_t)) {
 				info->mssg("Bogus chunk size for chunk type CRC32",
 					   response);
-				return -1;
+				goto out;
 			}
 			total_blocks += chunk_header->chunk_sz;
 			data += chunk_data_sz;
-			break;
+			continue;
 
 		default:
 			printf("%s: Unknown chunk type: %x\n", __func__,
 			       chunk_header->chunk_type);
 			info->mssg("Unknown chunk type", response);
-			return -1;
+			goto out;
 		}
+
+		info->stats[type].chunks++;
+		info->stats[type].bytes += chunk_data_sz;
+		info->stats[type].time_ms += get_timer(start);
 	}
 
 	debug("Wrote %d blocks, expected to write %d blocks\n",
 	      total_blocks, sparse_header->total_blks);
 	printf("........ wrote %llu bytes to '%s'\n", bytes_written, part_name);
+	for (type = 0; type < SPARSE_STAT_COUNT; type++) {
+		if (!info->stats[type].chunks)
+			continue;
+		sparse_stat_format(info, type, line, sizeof(line));
+		printf("         %s\n", line);
+	}
 
 	if (total_blocks != sparse_header->total_blks) {
 		info->mssg("sparse image write failure", response);
-		return -1;
+		goto out;
 	}
+	ret = 0;
+
+out:
+	free(bufs.bounce);
+	free(bufs.fill);
 
-	return 0;
+	return ret;
 }
@@ -3,6 +3,7 @@
  * Copyright (c) 2013 The Chromium OS Authors.
  */
 
+#include <bootstage.h>
 #include <efi.h>
 #include <initcall.h>
 #include <log.h>
@@ -42,6 +43,36 @@ static int initcall_is_event(init_fnc_t func)
 	return 0;
 }
 
+/**
+ * initcall_timing_start() - Start timing an initcall, if enabled
+ *
+ * The name is the link-time address of the function, which can be looked up
+ * in u-boot.map, or the name of the event
+ *
+ * @func: Function about to be called
+ * @type: Event number, if this is an event, else 0
+ * @reloc_ofs: Relocation offset
+ * Return: timing record, or -ve if none
+ */
+static int initcall_timing_start(init_fnc_t func, enum event_t type,
+				 ulong reloc_ofs)
+{
+	char name[30];
+
+	if (!CONFIG_IS_ENABLED(BOOTSTAGE_TIMING))
+		return -1;
+	if (!type) {
+		snprintf(name, sizeof(name), "%lx", (ulong)func - reloc_ofs);
+		return bootstage_timing_start(BOOTSTAGE_TIMING_INITCALL, name);
+	}
+	if (CONFIG_IS_ENABLED(EVENT_DEBUG))
+		snprintf(name, sizeof(name), "event %s", event_type_name(type));
+	else
+		snprintf(name, sizeof(name), "event %d", type);
+
+	return bootstage_timing_start(BOOTSTAGE_TIMING_EVENT, name);
+}
+
 /*
  * To enable debugging. add #define DEBUG at the top of the including file.
  *
@@ -54,6 +85,7 @@ int initcall_run_list(const init_fnc_t init_sequence[])
 	enum event_t type;
 	init_fnc_t func;
 	int ret = 0;
+	int timing;
 
 	for (ptr = init_sequence; func = *ptr, func; ptr++) {
 		reloc_ofs = calc_reloc_ofs();
@@ -71,7 +103,9 @@ int initcall_run_list(const init_fnc_t init_sequence[])
 			debug("initcall: %p\n", (char *)func - reloc_ofs);
 		}
 
+		timing = initcall_timing_start(func, type, reloc_ofs);
 		ret = type ? event_notify_null(type) : func();
+		bootstage_timing_end(timing);
 		if (ret)
 			break;
 	}
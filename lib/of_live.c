@@ -313,6 +313,9 @@ int unflatten_device_tree(const void *blob, struct device_node **mynodes)
 		return -ENOSPC;
 	}
 
+	/* the new tree may be where an indexed one was freed */
+	of_phandle_invalidate(*mynodes);
+
 	debug(" <- unflatten_device_tree()\n");
 
 	return 0;
@@ -333,6 +336,9 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp)
 		debug("Failed to scan live tree aliases: err=%d\n", ret);
 		return ret;
 	}
+	/* lookups still work without the index, just more slowly */
+	if (of_phandle_scan())
+		debug("Failed to index live tree phandles\n");
 	debug("%s: stop\n", __func__);
 
 	return ret;
@@ -340,6 +346,8 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp)
 
 void of_live_free(struct device_node *root)
 {
+	of_phandle_invalidate(root);
+
 	/* the tree is stored as a contiguous block of memory */
 	free(root);
 }
@@ -134,17 +134,14 @@ static void montgomery_mul(const struct rsa_public_key *key,
 /**
  * num_pub_exponent_bits() - Number of bits in the public exponent
  *
- * @key:	RSA key
+ * @exponent:	Public exponent
  * @num_bits:	Storage for the number of public exponent bits
  */
-static int num_public_exponent_bits(const struct rsa_public_key *key,
-		int *num_bits)
+static int num_public_exponent_bits(uint64_t exponent, int *num_bits)
 {
-	uint64_t exponent;
 	int exponent_bits;
 	const uint max_bits = (sizeof(exponent) * 8);
 
-	exponent = key->exponent;
 	exponent_bits = 0;
 
 	if (!exponent) {
@@ -164,13 +161,38 @@ static int num_public_exponent_bits(const struct rsa_public_key *key,
 /**
  * is_public_exponent_bit_set() - Check if a bit in the public exponent is set
  *
- * @key:	RSA key
+ * @exponent:	Public exponent
  * @pos:	The bit position to check
  */
-static int is_public_exponent_bit_set(const struct rsa_public_key *key,
-		int pos)
+static int is_public_exponent_bit_set(uint64_t exponent, int pos)
+{
+	return exponent & (1ULL << pos);
+}
+
+/**
+ * check_public_exponent() - Check that a public exponent can be used
+ *
+ * @exponent:	Public exponent
+ * @num_bits:	Returns the number of bits in the exponent
+ * Return: 0 if OK, -EINVAL if not
+ */
+static int check_public_exponent(uint64_t exponent, int *num_bits)
 {
-	return key->exponent & (1ULL << pos);
+	if (0 != num_public_exponent_bits(exponent, num_bits))
+		return -EINVAL;
+
+	if (*num_bits < 2) {
+		debug("Public exponent is too short (%d bits, minimum 2)\n",
+		      *num_bits);
+		return -EINVAL;
+	}
+
+	if (!is_public_exponent_bit_set(exponent, 0)) {
+		debug("LSB of RSA public exponent must be set.\n");
+		return -EINVAL;
+	}
+
+	return 0;
 }
 
 /**
@@ -200,20 +222,9 @@ static int pow_mod(const struct rsa_public_key *key, uint32_t *inout)
 	for (i = 0, ptr = inout + key->len - 1; i < key->len; i++, ptr--)
 		val[i] = get_unaligned_be32(ptr);
 
-	if (0 != num_public_exponent_bits(key, &k))
+	if (check_public_exponent(key->exponent, &k))
 		return -EINVAL;
 
-	if (k < 2) {
-		debug("Public exponent is too short (%d bits, minimum 2)\n",
-		      k);
-		return -EINVAL;
-	}
-
-	if (!is_public_exponent_bit_set(key, 0)) {
-		debug("LSB of RSA public exponent must be set.\n");
-		return -EINVAL;
-	}
-
 	/* the bit at e[k-1] is 1 by definition, so start with: C := M */
 	montgomery_mul(key, acc, val, key->rr); /* acc = a * RR / R mod n */
 	/* retain scaled version for intermediate use */
@@ -222,7 +233,7 @@ static int pow_mod(const struct rsa_public_key *key, uint32_t *inout)
 	for (j = k - 2; j > 0; --j) {
 		montgomery_mul(key, tmp, acc, acc); /* tmp = acc^2 / R mod n */
 
-		if (is_public_exponent_bit_set(key, j)) {
+		if (is_public_exponent_bit_set(key->exponent, j)) {
 			/* acc = tmp * val / R mod n */
 			montgomery_mul(key, acc, tmp, a_scaled);
 		} else {
@@ -246,6 +257,173 @@ static int pow_mod(const struct rsa_public_key *key, uint32_t *inout)
 	return 0;
 }
 
+#ifdef __SIZEOF_INT128__
+/*
+ * Where the compiler provides a 128-bit type, a 64x64-bit multiply can be
+ * done in a single instruction (or two, for the upper half), so the
+ * Montgomery multiply uses 64-bit limbs, halving the number of steps.
+ */
+#define RSA_LIMB64
+
+typedef unsigned __int128 uint128_t;
+
+/**
+ * struct rsa_public_key64 - RSA public key with 64-bit limbs
+ *
+ * R is the same as for struct rsa_public_key, so the same R^2 is used
+ *
+ * @len:	Length of modulus[] in number of uint64_t
+ * @n0inv:	-1 / modulus[0] mod 2^64
+ * @modulus:	Modulus as little endian array
+ * @rr:		R^2 as little endian array
+ */
+struct rsa_public_key64 {
+	uint len;
+	uint64_t n0inv;
+	uint64_t *modulus;
+	uint64_t *rr;
+};
+
+static void subtract_modulus64(const struct rsa_public_key64 *key,
+			       uint64_t num[])
+{
+	uint64_t borrow = 0;
+	uint i;
+
+	for (i = 0; i < key->len; i++) {
+		uint128_t diff = (uint128_t)num[i] - key->modulus[i] - borrow;
+
+		num[i] = (uint64_t)diff;
+		borrow = (uint64_t)(diff >> 64) & 1;
+	}
+}
+
+static int greater_equal_modulus64(const struct rsa_public_key64 *key,
+				   uint64_t num[])
+{
+	int i;
+
+	for (i = (int)key->len - 1; i >= 0; i--) {
+		if (num[i] < key->modulus[i])
+			return 0;
+		if (num[i] > key->modulus[i])
+			return 1;
+	}
+
+	return 1;  /* equal */
+}
+
+/* As montgomery_mul_add_step() but with 64-bit limbs */
+static void montgomery_mul_add_step64(const struct rsa_public_key64 *key,
+				      uint64_t result[], const uint64_t a,
+				      const uint64_t b[])
+{
+	uint128_t acc_a, acc_b;
+	uint64_t d0;
+	uint i;
+
+	acc_a = (uint128_t)a * b[0] + result[0];
+	d0 = (uint64_t)acc_a * key->n0inv;
+	acc_b = (uint128_t)d0 * key->modulus[0] + (uint64_t)acc_a;
+	for (i = 1; i < key->len; i++) {
+		acc_a = (acc_a >> 64) + (uint128_t)a * b[i] + result[i];
+		acc_b = (acc_b >> 64) + (uint128_t)d0 * key->modulus[i] +
+				(uint64_t)acc_a;
+		result[i - 1] = (uint64_t)acc_b;
+	}
+
+	acc_a = (acc_a >> 64) + (acc_b >> 64);
+
+	result[i - 1] = (uint64_t)acc_a;
+
+	if (acc_a >> 64)
+		subtract_modulus64(key, result);
+}
+
+static void montgomery_mul64(const struct rsa_public_key64 *key,
+			     uint64_t result[], uint64_t a[],
+			     const uint64_t b[])
+{
+	uint i;
+
+	for (i = 0; i < key->len; ++i)
+		result[i] = 0;
+	for (i = 0; i < key->len; ++i)
+		montgomery_mul_add_step64(key, result, a[i], b);
+}
+
+/**
+ * pow_mod64() - in-place public exponentiation with 64-bit limbs
+ *
+ * @key:	RSA key
+ * @exponent:	Public exponent
+ * @inout:	Big-endian byte array containing value and result
+ */
+static int pow_mod64(const struct rsa_public_key64 *key, uint64_t exponent,
+		     uint8_t *inout)
+{
+	uint i;
+	int j, k;
+
+	if (key->len > RSA_MAX_KEY_BITS / 64)
+		return -EINVAL;
+
+	uint64_t val[key->len], acc[key->len], tmp[key->len];
+	uint64_t a_scaled[key->len];
+
+	for (i = 0; i < key->len; i++)
+		val[i] = fdt64_to_cpup(inout + (key->len - 1 - i) * 8);
+
+	if (check_public_exponent(exponent, &k))
+		return -EINVAL;
+
+	montgomery_mul64(key, acc, val, key->rr);
+	memcpy(a_scaled, acc, key->len * sizeof(a_scaled[0]));
+
+	for (j = k - 2; j > 0; --j) {
+		montgomery_mul64(key, tmp, acc, acc);
+
+		if (is_public_exponent_bit_set(exponent, j))
+			montgomery_mul64(key, acc, tmp, a_scaled);
+		else
+			memcpy(acc, tmp, key->len * sizeof(acc[0]));
+	}
+
+	montgomery_mul64(key, tmp, acc, acc);
+	montgomery_mul64(key, acc, tmp, val);
+
+	if (greater_equal_modulus64(key, acc))
+		subtract_modulus64(key, acc);
+
+	for (i = 0; i < key->len; i++) {
+		fdt64_t w = cpu_to_fdt64(acc[key->len - 1 - i]);
+
+		memcpy(inout + i * 8, &w, sizeof(w));
+	}
+
+	return 0;
+}
+#endif /* __SIZEOF_INT128__ */
+
+/**
+ * struct rsa_sw_key - RSA public key prepared for software exponentiation
+ *
+ * @num_bits:	Key length in bits
+ * @n0inv:	n0inv from struct key_prop
+ * @exponent:	Public exponent
+ * @key:	Key with 32-bit limbs, used if @key64 cannot be
+ * @key64:	Key with 64-bit limbs, used if @key64.len is not 0
+ */
+struct rsa_sw_key {
+	int num_bits;
+	uint32_t n0inv;
+	uint64_t exponent;
+	struct rsa_public_key key;
+#ifdef RSA_LIMB64
+	struct rsa_public_key64 key64;
+#endif
+};
+
 static void rsa_convert_big_endian(uint32_t *dst, const uint32_t *src, int len)
 {
 	int i;
@@ -254,52 +432,122 @@ static void rsa_convert_big_endian(uint32_t *dst, const uint32_t *src, int len)
 		dst[i] = fdt32_to_cpu(src[len - 1 - i]);
 }
 
-int rsa_mod_exp_sw(const uint8_t *sig, uint32_t sig_len,
-		struct key_prop *prop, uint8_t *out)
+/**
+ * rsa_check_key_prop() - Check that key properties can be used
+ *
+ * @prop:	Key properties
+ * @exponentp:	Returns the public exponent
+ * Return: 0 if OK, -ve on error
+ */
+static int rsa_check_key_prop(const struct key_prop *prop,
+			      uint64_t *exponentp)
 {
-	struct rsa_public_key key;
-	int ret;
-
 	if (!prop) {
 		debug("%s: Skipping invalid prop", __func__);
 		return -EBADF;
 	}
-	key.n0inv = prop->n0inv;
-	key.len = prop->num_bits;
 
 	if (!prop->public_exponent)
-		key.exponent = RSA_DEFAULT_PUBEXP;
+		*exponentp = RSA_DEFAULT_PUBEXP;
 	else
-		key.exponent = fdt64_to_cpup(prop->public_exponent);
+		*exponentp = fdt64_to_cpup(prop->public_exponent);
 
-	if (!key.len || !prop->modulus || !prop->rr) {
+	if (!prop->num_bits || !prop->modulus || !prop->rr) {
 		debug("%s: Missing RSA key info", __func__);
 		return -EFAULT;
 	}
 
 	/* Sanity check for stack size */
-	if (key.len > RSA_MAX_KEY_BITS || key.len < RSA_MIN_KEY_BITS) {
+	if (prop->num_bits > RSA_MAX_KEY_BITS ||
+	    prop->num_bits < RSA_MIN_KEY_BITS) {
 		debug("RSA key bits %u outside allowed range %d..%d\n",
-		      key.len, RSA_MIN_KEY_BITS, RSA_MAX_KEY_BITS);
+		      prop->num_bits, RSA_MIN_KEY_BITS, RSA_MAX_KEY_BITS);
 		return -EFAULT;
 	}
-	key.len /= sizeof(uint32_t) * 8;
-	uint32_t key1[key.len], key2[key.len];
-
-	key.modulus = key1;
-	key.rr = key2;
-	rsa_convert_big_endian(key.modulus, (uint32_t *)prop->modulus, key.len);
-	rsa_convert_big_endian(key.rr, (uint32_t *)prop->rr, key.len);
-	if (!key.modulus || !key.rr) {
-		debug("%s: Out of memory", __func__);
-		return -ENOMEM;
+
+	return 0;
+}
+
+/**
+ * rsa_sw_key_init() - Convert key properties for use by pow_mod()
+ *
+ * @key:	Key to set up
+ * @prop:	Key properties, already checked by rsa_check_key_prop()
+ * @exponent:	Public exponent
+ * @limbs:	Space for the modulus and R^2, prop->num_bits / 4 bytes,
+ *		aligned to 8 bytes
+ */
+static void rsa_sw_key_init(struct rsa_sw_key *key,
+			    const struct key_prop *prop, uint64_t exponent,
+			    void *limbs)
+{
+	uint len = prop->num_bits / 32;
+
+	key->num_bits = prop->num_bits;
+	key->n0inv = prop->n0inv;
+	key->exponent = exponent;
+#ifdef RSA_LIMB64
+	if (!(prop->num_bits % 64)) {
+		struct rsa_public_key64 *key64 = &key->key64;
+		const uint8_t *modulus = prop->modulus, *rr = prop->rr;
+		uint64_t inv;
+		uint i;
+
+		key64->len = prop->num_bits / 64;
+		key64->modulus = limbs;
+		key64->rr = key64->modulus + key64->len;
+		for (i = 0; i < key64->len; i++) {
+			uint ofs = (key64->len - 1 - i) * 8;
+
+			key64->modulus[i] = fdt64_to_cpup(modulus + ofs);
+			key64->rr[i] = fdt64_to_cpup(rr + ofs);
+		}
+
+		/*
+		 * Extend the inverse from 32 to 64 bits with one Newton
+		 * step: x' = x * (2 - n * x)
+		 */
+		inv = (uint32_t)-prop->n0inv;
+		inv *= 2 - key64->modulus[0] * inv;
+		key64->n0inv = -inv;
+
+		return;
 	}
+	key->key64.len = 0;
+#endif
+	key->key.len = len;
+	key->key.n0inv = prop->n0inv;
+	key->key.exponent = exponent;
+	key->key.modulus = limbs;
+	key->key.rr = key->key.modulus + len;
+	rsa_convert_big_endian(key->key.modulus, (uint32_t *)prop->modulus,
+			       len);
+	rsa_convert_big_endian(key->key.rr, (uint32_t *)prop->rr, len);
+}
+
+static int rsa_sw_key_pow_mod(struct rsa_sw_key *key, const uint8_t *sig,
+			      uint32_t sig_len, uint8_t *out)
+{
+	int ret;
+
+#ifdef RSA_LIMB64
+	if (key->key64.len) {
+		uint8_t buf[sig_len];
+
+		memcpy(buf, sig, sig_len);
+		ret = pow_mod64(&key->key64, key->exponent, buf);
+		if (ret)
+			return ret;
+		memcpy(out, buf, sig_len);
 
+		return 0;
+	}
+#endif
 	uint32_t buf[sig_len / sizeof(uint32_t)];
 
 	memcpy(buf, sig, sig_len);
 
-	ret = pow_mod(&key, buf);
+	ret = pow_mod(&key->key, buf);
 	if (ret)
 		return ret;
 
@@ -308,6 +556,24 @@ int rsa_mod_exp_sw(const uint8_t *sig, uint32_t sig_len,
 	return 0;
 }
 
+int rsa_mod_exp_sw(const uint8_t *sig, uint32_t sig_len,
+		struct key_prop *prop, uint8_t *out)
+{
+	struct rsa_sw_key key;
+	uint64_t exponent;
+	int ret;
+
+	ret = rsa_check_key_prop(prop, &exponent);
+	if (ret)
+		return ret;
+
+	uint64_t limbs[prop->num_bits / 32];
+
+	rsa_sw_key_init(&key, prop, exponent, limbs);
+
+	return rsa_sw_key_pow_mod(&key, sig, sig_len, out);
+}
+
 #if defined(CONFIG_CMD_ZYNQ_RSA)
 /**
  * zynq_pow_mod - in-place public exponentiation
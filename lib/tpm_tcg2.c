@@ -5,13 +5,11 @@
 
 #include <dm.h>
 #include <dm/of_access.h>
+#include <hash.h>
 #include <tpm_api.h>
 #include <tpm-common.h>
 #include <tpm-v2.h>
 #include <tpm_tcg2.h>
-#include <u-boot/sha1.h>
-#include <u-boot/sha256.h>
-#include <u-boot/sha512.h>
 #include <version_string.h>
 #include <asm/io.h>
 #include <linux/bitops.h>
@@ -95,63 +93,43 @@ u32 tcg2_event_get_size(struct tpml_digest_values *digest_list)
 int tcg2_create_digest(struct udevice *dev, const u8 *input, u32 length,
 		       struct tpml_digest_values *digest_list)
 {
-	u8 final[sizeof(union tpmu_ha)];
-	sha256_context ctx_256;
-	sha512_context ctx_512;
-	sha1_context ctx;
+	struct hash_algo *algos[HASH_MULTI_MAX];
+	u8 *outputs[HASH_MULTI_MAX];
 	u32 active;
 	size_t i;
-	u32 len;
+	int count;
 	int rc;
 
 	rc = tcg2_get_active_pcr_banks(dev, &active);
 	if (rc)
 		return rc;
 
-	digest_list->count = 0;
+	/* hash the input once for all active banks, rather than once per bank */
+	count = 0;
 	for (i = 0; i < ARRAY_SIZE(hash_algo_list); ++i) {
+		struct tpmt_ha *digest = &digest_list->digests[count];
+
 		if (!(active & hash_algo_list[i].hash_mask))
 			continue;
 
-		switch (hash_algo_list[i].hash_alg) {
-		case TPM2_ALG_SHA1:
-			sha1_starts(&ctx);
-			sha1_update(&ctx, input, length);
-			sha1_finish(&ctx, final);
-			len = TPM2_SHA1_DIGEST_SIZE;
-			break;
-		case TPM2_ALG_SHA256:
-			sha256_starts(&ctx_256);
-			sha256_update(&ctx_256, input, length);
-			sha256_finish(&ctx_256, final);
-			len = TPM2_SHA256_DIGEST_SIZE;
-			break;
-		case TPM2_ALG_SHA384:
-			sha384_starts(&ctx_512);
-			sha384_update(&ctx_512, input, length);
-			sha384_finish(&ctx_512, final);
-			len = TPM2_SHA384_DIGEST_SIZE;
-			break;
-		case TPM2_ALG_SHA512:
-			sha512_starts(&ctx_512);
-			sha512_update(&ctx_512, input, length);
-			sha512_finish(&ctx_512, final);
-			len = TPM2_SHA512_DIGEST_SIZE;
-			break;
-		default:
+		if (count == HASH_MULTI_MAX ||
+		    hash_lookup_algo(hash_algo_list[i].hash_name,
+				     &algos[count])) {
 			printf("%s: unsupported algorithm %x\n", __func__,
 			       hash_algo_list[i].hash_alg);
 			continue;
 		}
 
-		digest_list->digests[digest_list->count].hash_alg =
-			hash_algo_list[i].hash_alg;
-		memcpy(&digest_list->digests[digest_list->count].digest, final,
-		       len);
-		digest_list->count++;
+		digest->hash_alg = hash_algo_list[i].hash_alg;
+		outputs[count] = (u8 *)&digest->digest;
+		count++;
 	}
+	digest_list->count = count;
 
-	return 0;
+	if (!count)
+		return 0;
+
+	return hash_multi_block(algos, count, input, length, outputs);
 }
 
 void tcg2_log_append(u32 pcr_index, u32 event_type,
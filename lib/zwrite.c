@@ -0,0 +1,494 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Streaming decompression of images onto block devices
+ *
+ * Each decoder produces its output directly into a cache-aligned write buffer
+ * which is flushed to the device whenever it is full, so images much larger
+ * than the available memory can be written. Runs of all-zero blocks can
+ * optionally be skipped or erased rather than written.
+ */
+
+#define LOG_CATEGORY	LOGC_BOOT
+
+#include <blk.h>
+#include <console.h>
+#include <gzip.h>
+#include <image.h>
+#include <log.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <time.h>
+#include <watchdog.h>
+#include <zwrite.h>
+#include <asm/unaligned.h>
+#include <linux/zstd.h>
+#include <u-boot/crc.h>
+#include <u-boot/lz4.h>
+#include <u-boot/zlib.h>
+#include <lzma/LzmaTypes.h>
+#include <lzma/LzmaDec.h>
+
+#define LZ4F_BLOCKUNCOMPRESSED_FLAG	0x80000000U
+
+/**
+ * struct zwrite_ctx - state of a zwrite() operation
+ *
+ * @dev: Block device being written
+ * @buf: Write buffer
+ * @bufsize: Size of @buf in bytes, a multiple of the block size
+ * @fill: Number of bytes of @buf holding output not yet written
+ * @outblock: Next block to write
+ * @flags: Bitmask of enum zwrite_flags
+ * @stats: Statistics to update
+ */
+struct zwrite_ctx {
+	struct blk_desc *dev;
+	u8 *buf;
+	ulong bufsize;
+	ulong fill;
+	lbaint_t outblock;
+	uint flags;
+	struct zwrite_stats *stats;
+};
+
+static int zwrite_run(struct zwrite_ctx *ctx, ulong first, lbaint_t count,
+		      bool zero)
+{
+	struct blk_desc *dev = ctx->dev;
+	lbaint_t start = ctx->outblock + first;
+
+	if (zero && (ctx->flags & ZWRITE_ZERO_SKIP)) {
+		ctx->stats->blks_zero += count;
+		return 0;
+	}
+	if (zero && (ctx->flags & ZWRITE_ZERO_ERASE)) {
+		if (blk_derase(dev, start, count) == count) {
+			ctx->stats->blks_zero += count;
+			return 0;
+		}
+		/* the device cannot erase, so write the zeroes from now on */
+		ctx->flags &= ~ZWRITE_ZERO_ERASE;
+	}
+
+	if (blk_dwrite(dev, start, count, ctx->buf + first * dev->blksz) !=
+	    count) {
+		log_err("write failed at block " LBAF "\n", start);
+		return -EIO;
+	}
+	ctx->stats->blks_written += count;
+
+	return 0;
+}
+
+/**
+ * zwrite_flush() - write out the contents of the write buffer
+ *
+ * @ctx: Context
+ * Return: 0 if OK, -ve on error
+ */
+static int zwrite_flush(struct zwrite_ctx *ctx)
+{
+	struct blk_desc *dev = ctx->dev;
+	bool check = ctx->flags & (ZWRITE_ZERO_SKIP | ZWRITE_ZERO_ERASE);
+	lbaint_t count, blk, first;
+	bool zero, run_zero = false;
+	int ret;
+
+	if (!ctx->fill)
+		return 0;
+
+	count = DIV_ROUND_UP(ctx->fill, dev->blksz);
+	memset(ctx->buf + ctx->fill, '\0', count * dev->blksz - ctx->fill);
+	if (ctx->outblock + count > dev->lba) {
+		log_err("image exceeds device size\n");
+		return -ENOSPC;
+	}
+
+	/* write the buffer as runs of data blocks and all-zero blocks */
+	for (blk = 0, first = 0; blk < count; blk++) {
+		zero = check && !memchr_inv(ctx->buf + blk * dev->blksz, '\0',
+					    dev->blksz);
+		if (blk && zero != run_zero) {
+			ret = zwrite_run(ctx, first, blk - first, run_zero);
+			if (ret)
+				return ret;
+			first = blk;
+		}
+		run_zero = zero;
+	}
+	ret = zwrite_run(ctx, first, count - first, run_zero);
+	if (ret)
+		return ret;
+
+	ctx->stats->out_size += ctx->fill;
+	ctx->outblock += count;
+	ctx->fill = 0;
+	if (ctrlc()) {
+		puts("abort\n");
+		return -EINTR;
+	}
+	schedule();
+
+	return 0;
+}
+
+/**
+ * zwrite_produced() - account for output placed in the write buffer
+ *
+ * @ctx: Context
+ * @len: Number of bytes added at @ctx->buf + @ctx->fill
+ * Return: 0 if OK, -ve on error
+ */
+static int zwrite_produced(struct zwrite_ctx *ctx, ulong len)
+{
+	ctx->fill += len;
+	if (ctx->fill < ctx->bufsize)
+		return 0;
+
+	return zwrite_flush(ctx);
+}
+
+/**
+ * zwrite_copy() - copy output into the write buffer, flushing as needed
+ *
+ * @ctx: Context
+ * @data: Data to add
+ * @len: Number of bytes to add
+ * Return: 0 if OK, -ve on error
+ */
+static int zwrite_copy(struct zwrite_ctx *ctx, const u8 *data, ulong len)
+{
+	ulong chunk;
+	int ret;
+
+	while (len) {
+		chunk = min(len, ctx->bufsize - ctx->fill);
+		memcpy(ctx->buf + ctx->fill, data, chunk);
+		ret = zwrite_produced(ctx, chunk);
+		if (ret)
+			return ret;
+		data += chunk;
+		len -= chunk;
+	}
+
+	return 0;
+}
+
+static int zwrite_gzip(struct zwrite_ctx *ctx, const u8 *src, ulong len)
+{
+	u32 crc = 0, expected_crc, expected_size;
+	ulong start = ctx->stats->out_size;
+	z_stream s;
+	int hdr, r, ret;
+
+	hdr = gzip_parse_header(src, len);
+	if (hdr < 0 || hdr + 8 > len)
+		return -EINVAL;
+	expected_crc = get_unaligned_le32(src + len - 8);
+	expected_size = get_unaligned_le32(src + len - 4);
+
+	s.zalloc = gzalloc;
+	s.zfree = gzfree;
+	r = inflateInit2(&s, -MAX_WBITS);
+	if (r != Z_OK) {
+		log_err("inflateInit2() returned %d\n", r);
+		return -EINVAL;
+	}
+	s.next_in = (u8 *)src + hdr;
+	s.avail_in = len - hdr;
+
+	do {
+		ulong space = ctx->bufsize - ctx->fill;
+
+		s.next_out = ctx->buf + ctx->fill;
+		s.avail_out = space;
+		r = inflate(&s, Z_SYNC_FLUSH);
+		if (r != Z_OK && r != Z_STREAM_END) {
+			log_err("inflate() returned %d\n", r);
+			ret = -EINVAL;
+			goto out;
+		}
+		crc = crc32(crc, ctx->buf + ctx->fill, space - s.avail_out);
+		ret = zwrite_produced(ctx, space - s.avail_out);
+		if (ret)
+			goto out;
+	} while (r != Z_STREAM_END);
+
+	/* the output buffer may still hold data, so count it explicitly */
+	if (crc != expected_crc ||
+	    (u32)(ctx->stats->out_size + ctx->fill - start) != expected_size) {
+		log_err("gzip crc or size mismatch\n");
+		ret = -EINVAL;
+	}
+	len = (u8 *)s.next_in - src + 8;
+
+out:
+	ctx->stats->in_size = len;
+	inflateEnd(&s);
+
+	return ret;
+}
+
+static int zwrite_zstd(struct zwrite_ctx *ctx, const u8 *src, ulong len)
+{
+	zstd_in_buffer in = { .src = src, .size = len };
+	zstd_frame_header hdr;
+	zstd_out_buffer out;
+	zstd_dstream *ds;
+	size_t wsize, r;
+	void *workspace;
+	int ret = 0;
+
+	r = zstd_get_frame_header(&hdr, src, len);
+	if (zstd_is_error(r) || r) {
+		log_err("bad zstd frame header\n");
+		return -EINVAL;
+	}
+
+	wsize = zstd_dstream_workspace_bound(hdr.windowSize);
+	workspace = malloc(wsize);
+	if (!workspace)
+		return -ENOMEM;
+	ds = zstd_init_dstream(hdr.windowSize, workspace, wsize);
+	if (!ds) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* a return value of zero means that a frame is complete */
+	r = 1;
+	while (in.pos < in.size || r) {
+		size_t in_pos = in.pos;
+
+		out.dst = ctx->buf + ctx->fill;
+		out.size = ctx->bufsize - ctx->fill;
+		out.pos = 0;
+		r = zstd_decompress_stream(ds, &out, &in);
+		if (zstd_is_error(r)) {
+			log_err("zstd decompression failed: %d\n",
+				zstd_get_error_code(r));
+			ret = -EINVAL;
+			goto out;
+		}
+		if (r && !out.pos && in.pos == in_pos) {
+			log_err("zstd data is truncated\n");
+			ret = -EINVAL;
+			goto out;
+		}
+		ret = zwrite_produced(ctx, out.pos);
+		if (ret)
+			goto out;
+	}
+
+out:
+	ctx->stats->in_size = in.pos;
+	free(workspace);
+
+	return ret;
+}
+
+static void *zwrite_lzma_alloc(void *p, size_t size)
+{
+	return malloc(size);
+}
+
+static void zwrite_lzma_free(void *p, void *address)
+{
+	free(address);
+}
+
+static int zwrite_lzma(struct zwrite_ctx *ctx, const u8 *src, ulong len)
+{
+	const uint hdr_size = LZMA_PROPS_SIZE + sizeof(u64);
+	ISzAlloc alloc = { zwrite_lzma_alloc, zwrite_lzma_free };
+	ulong pos = hdr_size;
+	ELzmaStatus status;
+	CLzmaDec state;
+	u64 remaining;
+	bool known;
+	int ret = 0;
+
+	if (len < hdr_size)
+		return -EINVAL;
+
+	/* an all-ones size means the stream has an end marker instead */
+	remaining = get_unaligned_le64(src + LZMA_PROPS_SIZE);
+	known = remaining != ~0ULL;
+
+	LzmaDec_Construct(&state);
+	if (LzmaDec_Allocate(&state, src, LZMA_PROPS_SIZE, &alloc) != SZ_OK)
+		return -ENOMEM;
+	LzmaDec_Init(&state);
+
+	while (!known || remaining) {
+		ELzmaFinishMode mode = LZMA_FINISH_ANY;
+		SizeT out_len = ctx->bufsize - ctx->fill;
+		SizeT in_len = len - pos;
+
+		if (known && remaining <= out_len) {
+			out_len = remaining;
+			mode = LZMA_FINISH_END;
+		}
+		if (LzmaDec_DecodeToBuf(&state, ctx->buf + ctx->fill, &out_len,
+					src + pos, &in_len, mode,
+					&status) != SZ_OK) {
+			log_err("lzma decompression failed\n");
+			ret = -EINVAL;
+			break;
+		}
+		pos += in_len;
+		if (known)
+			remaining -= out_len;
+		ret = zwrite_produced(ctx, out_len);
+		if (ret || status == LZMA_STATUS_FINISHED_WITH_MARK)
+			break;
+		if (!out_len && !in_len) {
+			log_err("lzma data is truncated\n");
+			ret = -EINVAL;
+			break;
+		}
+	}
+	ctx->stats->in_size = pos;
+	LzmaDec_Free(&state, &alloc);
+
+	return ret;
+}
+
+static int zwrite_lz4(struct zwrite_ctx *ctx, const u8 *src, ulong len)
+{
+	const u8 *in = src, *end = src + len;
+	u8 flags, block_desc;
+	ulong max_block;
+	u8 *scratch;
+	int ret = 0;
+
+	if (len < 7 || get_unaligned_le32(in) != LZ4F_MAGIC)
+		return -EINVAL;
+	flags = in[4];
+	block_desc = in[5];
+	in += 7;
+
+	/* only version 1 frames with independent blocks are supported */
+	if ((flags >> 6) != 1 || (flags & 0x03) || (block_desc & 0x8f))
+		return -EINVAL;
+	if (!(flags & BIT(5)))
+		return -EPROTONOSUPPORT;
+	if (flags & BIT(3))
+		in += sizeof(u64);
+	max_block = 1UL << (8 + 2 * ((block_desc >> 4) & 7));
+
+	scratch = malloc(max_block);
+	if (!scratch)
+		return -ENOMEM;
+
+	while (1) {
+		u32 header, size;
+		int out;
+
+		if (in + sizeof(u32) > end) {
+			ret = -EINVAL;
+			break;
+		}
+		header = get_unaligned_le32(in);
+		in += sizeof(u32);
+		size = header & ~LZ4F_BLOCKUNCOMPRESSED_FLAG;
+		if (!size)
+			break;
+		if (size > end - in) {
+			ret = -EINVAL;
+			break;
+		}
+
+		if (header & LZ4F_BLOCKUNCOMPRESSED_FLAG) {
+			ret = zwrite_copy(ctx, in, size);
+		} else if (ctx->bufsize - ctx->fill >= max_block) {
+			/* there is room to decode straight into the buffer */
+			out = LZ4_decompress_safe((const char *)in,
+						  (char *)ctx->buf + ctx->fill,
+						  size, max_block);
+			ret = out < 0 ? -EINVAL : zwrite_produced(ctx, out);
+		} else {
+			out = LZ4_decompress_safe((const char *)in, scratch,
+						  size, max_block);
+			ret = out < 0 ? -EINVAL : zwrite_copy(ctx, scratch, out);
+		}
+		if (ret)
+			break;
+
+		in += size;
+		if (flags & BIT(4))
+			in += sizeof(u32);
+	}
+	if (ret == -EINVAL)
+		log_err("lz4 data is corrupt\n");
+	ctx->stats->in_size = in - src;
+	free(scratch);
+
+	return ret;
+}
+
+int zwrite(const void *src, ulong len, struct blk_desc *dev, ulong szwritebuf,
+	   ulong startoffs, uint flags, struct zwrite_stats *stats)
+{
+	struct zwrite_stats dummy;
+	struct zwrite_ctx ctx;
+	ulong start;
+	int ret;
+
+	if (!stats)
+		stats = &dummy;
+	memset(stats, '\0', sizeof(*stats));
+
+	if (!szwritebuf || szwritebuf % dev->blksz) {
+		log_err("write size %lx not a multiple of %lx\n", szwritebuf,
+			dev->blksz);
+		return -EINVAL;
+	}
+	if (startoffs % dev->blksz) {
+		log_err("start offset %lx not a multiple of %lx\n", startoffs,
+			dev->blksz);
+		return -EINVAL;
+	}
+
+	memset(&ctx, '\0', sizeof(ctx));
+	ctx.dev = dev;
+	ctx.bufsize = szwritebuf;
+	ctx.outblock = startoffs / dev->blksz;
+	ctx.flags = flags;
+	ctx.stats = stats;
+	ctx.buf = malloc_cache_aligned(szwritebuf);
+	if (!ctx.buf)
+		return -ENOMEM;
+
+	start = get_timer(0);
+	stats->comp = image_decomp_type(src, len);
+	switch (stats->comp) {
+	case IH_COMP_GZIP:
+		ret = IS_ENABLED(CONFIG_GZIP) ?
+			zwrite_gzip(&ctx, src, len) : -EPROTONOSUPPORT;
+		break;
+	case IH_COMP_ZSTD:
+		ret = IS_ENABLED(CONFIG_ZSTD) ?
+			zwrite_zstd(&ctx, src, len) : -EPROTONOSUPPORT;
+		break;
+	case IH_COMP_LZMA:
+		ret = IS_ENABLED(CONFIG_LZMA) ?
+			zwrite_lzma(&ctx, src, len) : -EPROTONOSUPPORT;
+		break;
+	case IH_COMP_LZ4:
+		ret = IS_ENABLED(CONFIG_LZ4) ?
+			zwrite_lz4(&ctx, src, len) : -EPROTONOSUPPORT;
+		break;
+	default:
+		ret = -EPROTONOSUPPORT;
+		break;
+	}
+	if (ret == -EPROTONOSUPPORT)
+		log_err("unsupported compression format\n");
+	if (!ret)
+		ret = zwrite_flush(&ctx);
+	stats->time_ms = get_timer(start);
+	free(ctx.buf);
+
+	return ret;
+}
@@ -47,6 +47,10 @@ struct eth_uclass_priv {
 
 /* eth_errno - This stores the most recent failure code from DM functions */
 static int eth_errno;
+
+struct net_stats net_stats = {
+	.rx_budget = ETH_PACKETS_BATCH_RECV,
+};
 /* Are we currently in eth_init() or eth_halt()? */
 static bool in_init_halt;
 
@@ -435,12 +439,38 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+int eth_rx_budget(void)
+{
+	/* EFI buffers pushed packets in a ring of ETH_PACKETS_BATCH_RECV */
+	if (push_packet)
+		return ETH_PACKETS_BATCH_RECV;
+
+	return net_stats.rx_budget;
+}
+
+void eth_rx_account(int count, int budget, int ret)
+{
+	net_stats.polls++;
+	net_stats.rx_packets += count;
+	net_stats.rx_max_batch = max_t(uint, net_stats.rx_max_batch, count);
+	if (ret < 0 && ret != -EAGAIN)
+		net_stats.rx_errors++;
+
+	if (count == budget) {
+		net_stats.rx_full++;
+		net_stats.rx_budget = min(budget * 2, ETH_PACKETS_BATCH_MAX);
+	} else if (count < budget / 4) {
+		net_stats.rx_budget = max(budget / 2, ETH_PACKETS_BATCH_RECV);
+	}
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
 	uchar *packet;
+	int budget;
 	int flags;
-	int ret;
+	int ret = 0;
 	int i;
 
 	current = eth_get_dev();
@@ -450,9 +480,10 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
-	/* Process up to 32 packets at one time */
+	/* Process a batch of packets at one time */
+	budget = eth_rx_budget();
 	flags = ETH_RECV_CHECK_DEVICE;
-	for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
+	for (i = 0; i < budget; i++) {
 		ret = eth_get_ops(current)->recv(current, flags, &packet);
 		flags = 0;
 		if (ret > 0)
@@ -462,6 +493,7 @@ int eth_rx(void)
 		if (ret <= 0)
 			break;
 	}
+	eth_rx_account(i, budget, ret);
 	if (ret == -EAGAIN)
 		ret = 0;
 	if (ret < 0) {
@@ -116,6 +116,21 @@ static void fastboot_tcp_handler_ipv4(uchar *pkt, u16 dport,
 			}
 			strlcpy(command, pkt, len + 1);
 			fastboot_command_id = fastboot_handle_command(command, response);
+			if (!strncmp(FASTBOOT_MULTIRESPONSE_START, response, 4)) {
+				while (1) {
+					/* Call handler to obtain next response */
+					fastboot_multiresponse(fastboot_command_id,
+							       response);
+					if (!strncmp("OKAY", response, 4) ||
+					    !strncmp("FAIL", response, 4))
+						break;
+
+					/* Each message advances our sequence number */
+					fastboot_tcp_send_message(response,
+								  strlen(response));
+					curr_tcp_ack_num += strlen(response) + 8;
+				}
+			}
 			fastboot_tcp_send_message(response, strlen(response));
 			fastboot_handle_boot(fastboot_command_id,
 					     strncmp("OKAY", response, 4) == 0);
@@ -224,6 +224,10 @@ static void fastboot_send(struct fastboot_header header, char *fastboot_data,
 	net_send_udp_packet(net_server_ethaddr, fastboot_remote_ip,
 			    fastboot_remote_port, fastboot_our_port, len);
 
+	/* write to storage while the next packet arrives */
+	if (header.id == FASTBOOT_FASTBOOT && cmd == FASTBOOT_COMMAND_DOWNLOAD)
+		fastboot_data_flush();
+
 	fastboot_handle_boot(cmd, strncmp("OKAY", response, 4) == 0);
 
 	if (!strncmp("OKAY", response, 4) || !strncmp("FAIL", response, 4))
@@ -247,15 +247,17 @@ int net_lwip_rx(struct udevice *udev, struct netif *netif)
 {
 	struct pbuf *pbuf;
 	uchar *packet;
+	int budget;
 	int flags;
-	int len;
+	int len = 0;
 	int i;
 
 	if (!eth_is_active(udev))
 		return -EINVAL;
 
+	budget = eth_rx_budget();
 	flags = ETH_RECV_CHECK_DEVICE;
-	for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
+	for (i = 0; i < budget; i++) {
 		len = eth_get_ops(udev)->recv(udev, flags, &packet);
 		flags = 0;
 
@@ -263,12 +265,15 @@ int net_lwip_rx(struct udevice *udev, struct netif *netif)
 			pbuf = alloc_pbuf_and_copy(packet, len);
 			if (pbuf)
 				netif->input(pbuf, netif);
+			else
+				net_stats.rx_dropped++;
 		}
 		if (len >= 0 && eth_get_ops(udev)->free_pkt)
 			eth_get_ops(udev)->free_pkt(udev, packet, len);
 		if (len <= 0)
 			break;
 	}
+	eth_rx_account(i, budget, len);
 	if (len == -EAGAIN)
 		len = 0;
 
@@ -8,6 +8,7 @@
 #include <image.h>
 #include <lwip/apps/http_client.h>
 #include "lwip/altcp_tls.h"
+#include <lwip/dns.h>
 #include <lwip/timeouts.h>
 #include <rng.h>
 #include <mapmem.h>
@@ -19,6 +20,12 @@
 #define HTTP_PORT_DEFAULT 80
 #define HTTPS_PORT_DEFAULT 443
 #define PROGRESS_PRINT_STEP_BYTES (100 * 1024)
+#define WGET_MAX_CONNS 8
+#define WGET_MAX_REQS 16
+#define WGET_HDR_SIZE 1024
+#define WGET_RANGE_MIN (256 * 1024)
+#define WGET_POLL_INTERVAL 1
+#define WGET_POLL_TIMEOUT 30 /* 15 seconds */
 
 enum done_state {
 	NOT_DONE = 0,
@@ -246,6 +253,614 @@ static void httpc_result_cb(void *arg, httpc_result_t httpc_result,
 	ctx->done = SUCCESS;
 }
 
+/*
+ * Persistent and parallel transfers
+ *
+ * The lwIP HTTP client used above sends one request per connection. The
+ * code below is a small HTTP/1.1 client which keeps the connection open
+ * so that a batch of files from the same server shares it, and which can
+ * split a single file into byte ranges fetched on several connections at
+ * once. Only responses with a Content-Length, or which end when the
+ * server closes the connection, are supported.
+ */
+
+struct wget_req {
+	char *url;
+	char *path;
+	ulong daddr;
+	ulong size;
+	ulong start;
+	ulong end;
+	bool ranged;
+};
+
+struct wget_job;
+
+struct wget_conn {
+	struct wget_job *job;
+	struct altcp_pcb *pcb;
+	int cur;
+	int last;
+	char hdr[WGET_HDR_SIZE];
+	uint hdr_len;
+	bool in_body;
+	bool has_len;
+	bool close;
+	bool aborted;
+	ulong remaining;
+	int idle;
+};
+
+struct wget_job {
+	char server_name[SERVER_NAME_SIZE];
+	ip_addr_t remote;
+	u16 port;
+	bool is_https;
+#if LWIP_ALTCP
+	altcp_allocator_t *allocator;
+#endif
+	struct wget_req reqs[WGET_MAX_REQS];
+	int num_reqs;
+	struct wget_conn conns[WGET_MAX_CONNS];
+	int num_conns;
+	int active;
+	bool ranged;
+	ulong size;
+	ulong prevsize;
+	ulong start_time;
+	enum done_state done;
+};
+
+static int wget_conn_open(struct wget_conn *conn);
+
+/*
+ * Detach a connection from its pcb. Return true if the pcb had to be
+ * aborted, in which case an lwIP callback must return ERR_ABRT.
+ */
+static bool wget_conn_drop(struct wget_conn *conn, bool abort)
+{
+	struct altcp_pcb *pcb = conn->pcb;
+
+	if (!pcb)
+		return false;
+
+	conn->pcb = NULL;
+	altcp_arg(pcb, NULL);
+	altcp_recv(pcb, NULL);
+	altcp_err(pcb, NULL);
+	altcp_poll(pcb, NULL, 0);
+	if (!abort && altcp_close(pcb) == ERR_OK)
+		return false;
+
+	altcp_abort(pcb);
+	conn->aborted = true;
+
+	return true;
+}
+
+static void wget_conn_fail(struct wget_conn *conn)
+{
+	wget_conn_drop(conn, true);
+	conn->job->done = FAILURE;
+}
+
+static int wget_conn_send(struct wget_conn *conn)
+{
+	struct wget_job *job = conn->job;
+	struct wget_req *req = &job->reqs[conn->cur];
+	bool keep = conn->cur < conn->last || (job->ranged && !conn->cur);
+	char host[SERVER_NAME_SIZE + 8];
+	char range[48] = "";
+	int len;
+
+	if (job->port == (job->is_https ? HTTPS_PORT_DEFAULT : HTTP_PORT_DEFAULT))
+		snprintf(host, sizeof(host), "%s", job->server_name);
+	else
+		snprintf(host, sizeof(host), "%s:%u", job->server_name,
+			 job->port);
+
+	if (req->ranged)
+		snprintf(range, sizeof(range), "Range: bytes=%lu-%lu\r\n",
+			 req->start, req->end);
+
+	len = snprintf(conn->hdr, sizeof(conn->hdr),
+		       "GET %s HTTP/1.1\r\n"
+		       "Host: %s\r\n"
+		       "User-Agent: U-Boot\r\n"
+		       "Accept: */*\r\n"
+		       "%s"
+		       "Connection: %s\r\n\r\n",
+		       req->path, host, range, keep ? "keep-alive" : "close");
+	if (len >= sizeof(conn->hdr)) {
+		log_err("\nHTTP request too long\n");
+		return -E2BIG;
+	}
+
+	conn->hdr_len = 0;
+	conn->in_body = false;
+	conn->has_len = false;
+	conn->close = false;
+	conn->remaining = 0;
+	req->size = 0;
+
+	if (altcp_write(conn->pcb, conn->hdr, len, TCP_WRITE_FLAG_COPY) ||
+	    altcp_output(conn->pcb))
+		return -EIO;
+
+	return 0;
+}
+
+/*
+ * Split what is left of the file after the first range across connections.
+ * This runs as soon as the size is known, so the other connections start
+ * while the first range is still arriving. The first range has been trimmed
+ * to what the server is actually sending.
+ */
+static void wget_job_split(struct wget_job *job, ulong total)
+{
+	struct wget_req *probe = &job->reqs[0];
+	ulong done = probe->end + 1;
+	ulong part;
+	int n, i;
+
+	if (total <= done)
+		return;
+
+	n = min_t(ulong, job->num_conns,
+		  DIV_ROUND_UP(total - done, WGET_RANGE_MIN));
+	part = DIV_ROUND_UP(total - done, n);
+
+	for (i = 0; i < n; i++) {
+		struct wget_req *req = &job->reqs[i + 1];
+
+		req->path = probe->path;
+		req->ranged = true;
+		req->start = done + i * part;
+		req->end = min(req->start + part, total) - 1;
+		req->daddr = probe->daddr + req->start;
+	}
+	job->num_reqs = n + 1;
+
+	/* The first connection carries on with the first part */
+	job->conns[0].last = 1;
+	for (i = 1; i < n; i++) {
+		struct wget_conn *conn = &job->conns[i];
+
+		conn->cur = i + 1;
+		conn->last = i + 1;
+		job->active++;
+		if (wget_conn_open(conn)) {
+			job->done = FAILURE;
+			return;
+		}
+	}
+}
+
+static int wget_parse_header(struct wget_conn *conn)
+{
+	struct wget_job *job = conn->job;
+	struct wget_req *req = &job->reqs[conn->cur];
+	ulong first = 0, last = 0, total = 0;
+	bool has_range = false;
+	char *line, *next, *val;
+	ulong status;
+
+	if (strncmp(conn->hdr, "HTTP/1.", 7) || strlen(conn->hdr) < 12) {
+		log_err("\nInvalid HTTP response\n");
+		return -EPROTO;
+	}
+	/* HTTP/1.0 servers close the connection unless told otherwise */
+	conn->close = conn->hdr[7] == '0';
+	status = simple_strtoul(conn->hdr + 9, NULL, 10);
+
+	for (line = strstr(conn->hdr, "\r\n"); line; line = next) {
+		line += 2;
+		next = strstr(line, "\r\n");
+		if (next)
+			*next = '\0';
+		val = strchr(line, ':');
+		if (!val)
+			continue;
+		for (val++; *val == ' '; val++)
+			;
+
+		if (!strncasecmp(line, "Content-Length:", 15)) {
+			conn->remaining = simple_strtoul(val, NULL, 10);
+			conn->has_len = true;
+		} else if (!strncasecmp(line, "Content-Range:", 14)) {
+			if (strncmp(val, "bytes ", 6))
+				continue;
+			first = simple_strtoul(val + 6, &val, 10);
+			if (*val++ != '-')
+				continue;
+			last = simple_strtoul(val, &val, 10);
+			if (*val++ != '/')
+				continue;
+			total = simple_strtoul(val, NULL, 10);
+			has_range = true;
+		} else if (!strncasecmp(line, "Connection:", 11)) {
+			if (strstr(val, "close"))
+				conn->close = true;
+			else if (strstr(val, "keep-alive"))
+				conn->close = false;
+		} else if (!strncasecmp(line, "Transfer-Encoding:", 18)) {
+			if (strstr(val, "chunked")) {
+				log_err("\nChunked transfer encoding is not supported\n");
+				return -EPROTONOSUPPORT;
+			}
+		}
+	}
+
+	if (status == 206 && req->ranged && has_range) {
+		/* Anything short of the range asked for would leave a hole */
+		if (first != req->start || total <= last ||
+		    last != min(req->end, total - 1) ||
+		    (conn->has_len && conn->remaining != last - first + 1)) {
+			log_err("\nHTTP server returned the wrong range\n");
+			return -EPROTO;
+		}
+		if (!conn->has_len) {
+			conn->remaining = last - first + 1;
+			conn->has_len = true;
+			conn->close = true;
+		}
+		req->end = last;
+		if (job->ranged && !conn->cur)
+			wget_job_split(job, total);
+	} else if (status == 200 && (!req->ranged || (job->ranged && !conn->cur))) {
+		/* The server ignored the range: this is the whole file */
+		req->ranged = false;
+	} else {
+		log_err("\nHTTP server error %lu\n", status);
+		return -EPROTO;
+	}
+
+	if (!conn->has_len)
+		conn->close = true;
+
+	return 0;
+}
+
+/* The current response is complete: move on to the next request, if any */
+static void wget_req_done(struct wget_conn *conn)
+{
+	struct wget_job *job = conn->job;
+	struct wget_req *req = &job->reqs[conn->cur];
+
+	if (req->ranged && req->size != req->end - req->start + 1) {
+		log_err("\nHTTP server sent %lu bytes for range %lu-%lu\n",
+			req->size, req->start, req->end);
+		wget_conn_fail(conn);
+		return;
+	}
+
+	if (conn->cur < conn->last && !job->done) {
+		conn->cur++;
+		if (conn->close) {
+			wget_conn_drop(conn, false);
+			if (wget_conn_open(conn))
+				job->done = FAILURE;
+		} else if (wget_conn_send(conn)) {
+			wget_conn_fail(conn);
+		}
+		return;
+	}
+
+	wget_conn_drop(conn, false);
+	if (!--job->active && !job->done)
+		job->done = SUCCESS;
+}
+
+static int wget_conn_input(struct wget_conn *conn, u8 *buf, uint len)
+{
+	struct wget_job *job = conn->job;
+	struct wget_req *req = &job->reqs[conn->cur];
+	uint n, used;
+	char *end;
+	void *ptr;
+
+	if (!conn->in_body) {
+		n = min_t(uint, len, sizeof(conn->hdr) - 1 - conn->hdr_len);
+		if (!n) {
+			log_err("\nHTTP header too long\n");
+			return -E2BIG;
+		}
+		memcpy(conn->hdr + conn->hdr_len, buf, n);
+		conn->hdr_len += n;
+		conn->hdr[conn->hdr_len] = '\0';
+
+		end = strstr(conn->hdr, "\r\n\r\n");
+		if (!end)
+			return n;
+
+		used = n - (conn->hdr_len - (end + 4 - conn->hdr));
+		end[2] = '\0';
+		if (wget_parse_header(conn))
+			return -EPROTO;
+		conn->in_body = true;
+		if (conn->has_len && !conn->remaining)
+			wget_req_done(conn);
+
+		return used;
+	}
+
+	n = len;
+	if (conn->has_len)
+		n = min_t(ulong, n, conn->remaining);
+	ptr = map_sysmem(req->daddr + req->size, n);
+	memcpy(ptr, buf, n);
+	unmap_sysmem(ptr);
+	req->size += n;
+	conn->remaining -= n;
+
+	job->size += n;
+	if (job->size - job->prevsize > PROGRESS_PRINT_STEP_BYTES) {
+		printf("#");
+		job->prevsize = job->size;
+	}
+
+	if (conn->has_len && !conn->remaining)
+		wget_req_done(conn);
+
+	return n;
+}
+
+static err_t wget_conn_recv(void *arg, struct altcp_pcb *pcb, struct pbuf *p,
+			    err_t err)
+{
+	struct wget_conn *conn = arg;
+	struct pbuf *q;
+	u16 off;
+	int n;
+
+	conn->aborted = false;
+	if (!p) {
+		/* The server closed the connection */
+		if (conn->in_body && !conn->has_len) {
+			wget_req_done(conn);
+		} else {
+			log_err("\nConnection closed by the server\n");
+			wget_conn_fail(conn);
+		}
+		return conn->aborted ? ERR_ABRT : ERR_OK;
+	}
+
+	conn->idle = 0;
+	altcp_recved(pcb, p->tot_len);
+
+	/*
+	 * Stop once the connection is done with: anything the server sends
+	 * after the last response is ignored.
+	 */
+	for (q = p; q && conn->pcb == pcb; q = q->next) {
+		for (off = 0; off < q->len && conn->pcb == pcb; off += n) {
+			n = wget_conn_input(conn, (u8 *)q->payload + off,
+					    q->len - off);
+			if (n < 0) {
+				pbuf_free(p);
+				wget_conn_fail(conn);
+				return ERR_ABRT;
+			}
+		}
+	}
+	pbuf_free(p);
+
+	return conn->aborted ? ERR_ABRT : ERR_OK;
+}
+
+static void wget_conn_err(void *arg, err_t err)
+{
+	struct wget_conn *conn = arg;
+
+	/* The pcb has already been freed */
+	conn->pcb = NULL;
+	log_err("\nConnection error %d\n", err);
+	conn->job->done = FAILURE;
+}
+
+static err_t wget_conn_poll(void *arg, struct altcp_pcb *pcb)
+{
+	struct wget_conn *conn = arg;
+
+	if (++conn->idle < WGET_POLL_TIMEOUT)
+		return ERR_OK;
+
+	log_err("\nConnection timed out\n");
+	wget_conn_fail(conn);
+
+	return ERR_ABRT;
+}
+
+static err_t wget_conn_connected(void *arg, struct altcp_pcb *pcb, err_t err)
+{
+	struct wget_conn *conn = arg;
+
+	if (err == ERR_OK && !wget_conn_send(conn))
+		return ERR_OK;
+
+	wget_conn_fail(conn);
+
+	return ERR_ABRT;
+}
+
+static int wget_conn_open(struct wget_conn *conn)
+{
+	struct wget_job *job = conn->job;
+
+	conn->idle = 0;
+	conn->pcb = altcp_new(job->allocator);
+	if (!conn->pcb)
+		return -ENOMEM;
+
+	altcp_arg(conn->pcb, conn);
+	altcp_recv(conn->pcb, wget_conn_recv);
+	altcp_err(conn->pcb, wget_conn_err);
+	altcp_poll(conn->pcb, wget_conn_poll, WGET_POLL_INTERVAL);
+	if (altcp_connect(conn->pcb, &job->remote, job->port,
+			  wget_conn_connected)) {
+		altcp_err(conn->pcb, NULL);
+		altcp_abort(conn->pcb);
+		conn->pcb = NULL;
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static void wget_job_start(struct wget_job *job)
+{
+	struct wget_conn *conn = &job->conns[0];
+
+	conn->cur = 0;
+	conn->last = job->num_reqs - 1;
+	job->active = 1;
+	job->start_time = get_timer(0);
+	if (wget_conn_open(conn))
+		job->done = FAILURE;
+}
+
+static void wget_dns_found(const char *name, const ip_addr_t *ipaddr,
+			   void *arg)
+{
+	struct wget_job *job = arg;
+
+	if (!ipaddr) {
+		log_err("error: %s not found\n", name);
+		job->done = FAILURE;
+		return;
+	}
+
+	job->remote = *ipaddr;
+	wget_job_start(job);
+}
+
+static int wget_job_run(struct udevice *udev, struct wget_job *job)
+{
+#if defined CONFIG_WGET_HTTPS
+	altcp_allocator_t tls_allocator;
+#endif
+	struct wget_req *req;
+	struct netif *netif;
+	ulong elapsed;
+	err_t err;
+	int i;
+
+	netif = net_lwip_new_netif(udev);
+	if (!netif)
+		return -1;
+
+#if defined CONFIG_WGET_HTTPS
+	if (job->is_https) {
+		tls_allocator.alloc = &altcp_tls_alloc;
+		tls_allocator.arg =
+			altcp_tls_create_config_client(NULL, 0,
+						       job->server_name);
+		if (!tls_allocator.arg) {
+			log_err("error: Cannot create a TLS connection\n");
+			net_lwip_remove_netif(netif);
+			return -1;
+		}
+		job->allocator = &tls_allocator;
+	}
+#endif
+
+	for (i = 0; i < WGET_MAX_CONNS; i++)
+		job->conns[i].job = job;
+
+	if (ipaddr_aton(job->server_name, &job->remote)) {
+		wget_job_start(job);
+	} else {
+		err = dns_gethostbyname(job->server_name, &job->remote,
+					wget_dns_found, job);
+		if (err == ERR_OK)
+			wget_job_start(job);
+		else if (err != ERR_INPROGRESS)
+			job->done = FAILURE;
+	}
+
+	while (!job->done) {
+		net_lwip_rx(udev, netif);
+		sys_check_timeouts();
+		if (ctrlc()) {
+			job->done = FAILURE;
+			break;
+		}
+	}
+
+	for (i = 0; i < WGET_MAX_CONNS; i++)
+		wget_conn_drop(&job->conns[i], true);
+	net_lwip_remove_netif(netif);
+
+	if (job->done != SUCCESS)
+		return -1;
+
+	elapsed = get_timer(job->start_time);
+	if (!elapsed)
+		elapsed = 1;
+	if (job->size > PROGRESS_PRINT_STEP_BYTES)
+		printf("\n");
+
+	if (job->ranged) {
+		req = &job->reqs[0];
+		req->size = job->size;
+		printf("%lu bytes transferred in %lu ms on %d connection(s) (",
+		       job->size, elapsed, max(job->num_reqs - 1, 1));
+	} else {
+		for (i = 0; i < job->num_reqs; i++)
+			printf("%s: %lu bytes at %lx\n", job->reqs[i].path,
+			       job->reqs[i].size, job->reqs[i].daddr);
+		req = &job->reqs[job->num_reqs - 1];
+		printf("%lu bytes transferred in %lu ms on one connection (",
+		       job->size, elapsed);
+	}
+	print_size(job->size / elapsed * 1000, "/s)\n");
+	printf("Bytes transferred = %lu (%lx hex)\n", req->size, req->size);
+
+	efi_set_bootdev("Net", "", req->path, map_sysmem(req->daddr, 0),
+			req->size);
+	if (env_set_hex("filesize", req->size) ||
+	    env_set_hex("fileaddr", req->daddr)) {
+		log_err("Could not set filesize or fileaddr\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static int wget_job_add(struct wget_job *job, ulong daddr, char *arg)
+{
+	char server_name[SERVER_NAME_SIZE];
+	struct wget_req *req;
+	char nurl[1024];
+	bool is_https;
+	u16 port;
+
+	if (job->num_reqs == WGET_MAX_REQS)
+		return -E2BIG;
+	if (parse_legacy_arg(arg, nurl, sizeof(nurl)))
+		return -EINVAL;
+
+	req = &job->reqs[job->num_reqs];
+	req->url = strdup(nurl);
+	if (!req->url)
+		return -ENOMEM;
+	req->daddr = daddr;
+	if (parse_url(req->url, server_name, &port, &req->path, &is_https))
+		return -EINVAL;
+
+	if (!job->num_reqs++) {
+		strcpy(job->server_name, server_name);
+		job->port = port;
+		job->is_https = is_https;
+	} else if (strcmp(job->server_name, server_name) ||
+		   job->port != port || job->is_https != is_https) {
+		log_err("error: all files must come from the same server\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static int wget_loop(struct udevice *udev, ulong dst_addr, char *uri)
 {
 	char server_name[SERVER_NAME_SIZE];
@@ -321,16 +936,91 @@ int wget_with_dns(ulong dst_addr, char *uri)
 	return wget_loop(eth_get_dev(), dst_addr, uri);
 }
 
+/*
+ * Fetch several files over one persistent connection, or a single file as
+ * byte ranges on @conns connections
+ */
+static int wget_multi(int conns, int argc, char * const argv[])
+{
+	struct wget_job *job;
+	ulong dst_addr;
+	char *end;
+	int ret = CMD_RET_FAILURE;
+	int i;
+
+	job = calloc(1, sizeof(*job));
+	if (!job)
+		return CMD_RET_FAILURE;
+
+	if (conns) {
+		dst_addr = hextoul(argv[0], &end);
+		if (*end) {
+			dst_addr = image_load_addr;
+		} else {
+			argc--;
+			argv++;
+		}
+		if (argc != 1) {
+			ret = CMD_RET_USAGE;
+			goto out;
+		}
+		if (wget_job_add(job, dst_addr, argv[0]))
+			goto out;
+		job->ranged = true;
+		job->num_conns = conns;
+		job->reqs[0].ranged = true;
+		job->reqs[0].start = 0;
+		job->reqs[0].end = WGET_RANGE_MIN - 1;
+	} else {
+		if (argc % 2) {
+			ret = CMD_RET_USAGE;
+			goto out;
+		}
+		for (i = 0; i < argc; i += 2) {
+			dst_addr = hextoul(argv[i], &end);
+			if (*end) {
+				ret = CMD_RET_USAGE;
+				goto out;
+			}
+			if (wget_job_add(job, dst_addr, argv[i + 1]))
+				goto out;
+		}
+	}
+
+	eth_set_current();
+	if (!wget_job_run(eth_get_dev(), job))
+		ret = CMD_RET_SUCCESS;
+
+out:
+	for (i = 0; i < WGET_MAX_REQS; i++)
+		free(job->reqs[i].url);
+	free(job);
+
+	return ret;
+}
+
 int do_wget(struct cmd_tbl *cmdtp, int flag, int argc, char * const argv[])
 {
 	char *end;
 	char *url;
 	ulong dst_addr;
 	char nurl[1024];
+	int conns = 0;
 
-	if (argc < 2 || argc > 3)
+	if (argc > 2 && !strcmp(argv[1], "-j")) {
+		conns = dectoul(argv[2], &end);
+		if (*end || conns < 1 || conns > WGET_MAX_CONNS)
+			return CMD_RET_USAGE;
+		argc -= 2;
+		argv += 2;
+	}
+
+	if (argc < 2)
 		return CMD_RET_USAGE;
 
+	if (conns || argc > 3)
+		return wget_multi(conns, argc - 1, argv + 1);
+
 	dst_addr = hextoul(argv[1], &end);
 	if (end == (argv[1] + strlen(argv[1]))) {
 		if (argc < 3)
@@ -435,6 +435,7 @@ int net_loop(enum proto_t protocol)
 {
 	int ret = -EINVAL;
 	enum net_loop_state prev_net_state = net_state;
+	ulong iter_start;
 
 #if defined(CONFIG_CMD_PING)
 	if (protocol != PING)
@@ -635,7 +636,16 @@ restart:
 	 *	Main packet reception loop.  Loop receiving packets until
 	 *	someone sets `net_state' to a state that terminates.
 	 */
+	iter_start = timer_get_us();
 	for (;;) {
+		ulong now = timer_get_us();
+
+		net_stats.loops++;
+		net_stats.loop_us += now - iter_start;
+		net_stats.loop_max_us = max(net_stats.loop_max_us,
+					    now - iter_start);
+		iter_start = now;
+
 		schedule();
 		if (arp_timeout_check() > 0)
 			time_start = get_timer(0);
@@ -50,12 +50,41 @@
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
+/* Most data which an NFSv2 server returns from a single READ call */
+#define NFS2_MAXDATA	8192
+
+/* Number of bytes received for each "loading" hash */
+#define NFS_BYTES_PER_HASH	(NFS_READ_SIZE / 2 * 10)
+
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
-static int nfs_len;
 static const ulong nfs_timeout = CONFIG_NFS_TIMEOUT;
 
+/**
+ * struct nfs_read_slot - a READ request waiting for its reply
+ *
+ * @id:		RPC transaction ID (XID), or 0 if the slot is free
+ * @offset:	Offset in the file
+ * @len:	Number of bytes requested
+ * @sent:	Time when the request was last sent, from get_timer()
+ * @retries:	Number of times the request has been sent again
+ */
+struct nfs_read_slot {
+	unsigned long id;
+	int offset;
+	int len;
+	ulong sent;
+	int retries;
+};
+
+static struct nfs_read_slot nfs_reads[CONFIG_NFS_READ_WINDOW];
+static int nfs_read_len;	/* number of bytes requested by each READ */
+static int nfs_read_next;	/* file offset of the next new READ */
+static int nfs_read_eof;	/* file size if known, else -1 */
+static ulong nfs_read_bytes;	/* number of bytes received */
+static int nfs_read_resends;	/* number of READs sent again */
+static ulong nfs_read_time;	/* time when the first READ was sent */
+
 static char dirfh[NFS3_FHSIZE]; /* NFSv2 / NFSv3 file handle of directory */
 static unsigned int dirfh3_length; /* (variable) length of dirfh when NFSv3 */
 static char filefh[NFS3_FHSIZE]; /* NFSv2 / NFSv3 file handle */
@@ -181,15 +210,14 @@ static uint32_t *rpc_add_credentials(uint32_t *p)
 /**************************************************************************
 RPC_LOOKUP - Lookup RPC Port numbers
 **************************************************************************/
-static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+static void rpc_send(unsigned long id, int rpc_prog, int rpc_proc,
+		     uint32_t *data, int datalen)
 {
 	struct rpc_t rpc_pkt;
-	unsigned long id;
 	uint32_t *p;
 	int pktlen;
 	int sport;
 
-	id = ++rpc_id;
 	rpc_pkt.u.call.id = htonl(id);
 	rpc_pkt.u.call.type = htonl(MSG_CALL);
 	rpc_pkt.u.call.rpcvers = htonl(2);	/* use RPC version 2 */
@@ -256,6 +284,11 @@ static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
 			    nfs_our_port, pktlen);
 }
 
+static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+{
+	rpc_send(++rpc_id, rpc_prog, rpc_proc, data, datalen);
+}
+
 /**************************************************************************
 RPC_LOOKUP - Lookup RPC Port numbers
 **************************************************************************/
@@ -395,8 +428,10 @@ static void nfs_lookup_req(char *fname)
 /**************************************************************************
 NFS_READ - Read File on NFS Server
 **************************************************************************/
-static void nfs_read_req(int offset, int readlen)
+static void nfs_read_req(struct nfs_read_slot *slot)
 {
+	int offset = slot->offset;
+	int readlen = slot->len;
 	uint32_t data[1024];
 	uint32_t *p;
 	int len;
@@ -422,7 +457,152 @@ static void nfs_read_req(int offset, int readlen)
 
 	len = (uint32_t *)p - (uint32_t *)&(data[0]);
 
-	rpc_req(PROG_NFS, NFS_READ, data, len);
+	/* a request sent again keeps its XID, so a late reply still matches */
+	rpc_send(slot->id, PROG_NFS, NFS_READ, data, len);
+	slot->sent = get_timer(0);
+}
+
+static void nfs_timeout_handler(void);
+
+/* Set the timer to expire when the first outstanding READ is due again */
+static void nfs_read_set_timer(void)
+{
+	ulong now = get_timer(0);
+	ulong wait = nfs_timeout;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nfs_reads); i++) {
+		struct nfs_read_slot *slot = &nfs_reads[i];
+		ulong due;
+
+		if (!slot->id)
+			continue;
+		due = slot->sent + nfs_timeout * (1 + slot->retries);
+		wait = min(wait, due > now ? due - now : 1);
+	}
+	net_set_timeout_handler(wait, nfs_timeout_handler);
+}
+
+/* Send new READ requests until the window is full or the end is reached */
+static void nfs_read_fill(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nfs_reads); i++) {
+		struct nfs_read_slot *slot = &nfs_reads[i];
+
+		if (slot->id)
+			continue;
+		if (nfs_read_eof >= 0 && nfs_read_next >= nfs_read_eof)
+			break;
+		slot->id = ++rpc_id;
+		slot->offset = nfs_read_next;
+		slot->len = nfs_read_len;
+		slot->retries = 0;
+		nfs_read_next += nfs_read_len;
+		nfs_read_req(slot);
+	}
+	nfs_read_set_timer();
+}
+
+static void nfs_read_start(void)
+{
+	nfs_read_len = CONFIG_NFS_READ_BLOCKSIZE;
+#ifdef CONFIG_IP_DEFRAG
+	/* the reply, with its headers, must fit in the reassembly buffer */
+	nfs_read_len = min(nfs_read_len,
+			   (int)(CONFIG_NET_MAXDEFRAG - IP_UDP_HDR_SIZE -
+				 (sizeof(struct rpc_t) - NFS_READ_SIZE)) &
+			   ~(NFS_READ_SIZE - 1));
+#endif
+	if (choosen_nfs_version != NFS_V3)
+		nfs_read_len = min(nfs_read_len, NFS2_MAXDATA);
+
+	memset(nfs_reads, '\0', sizeof(nfs_reads));
+	nfs_read_next = 0;
+	nfs_read_eof = -1;
+	nfs_read_bytes = 0;
+	nfs_read_resends = 0;
+	nfs_read_time = get_timer(0);
+	nfs_read_fill();
+}
+
+static void nfs_read_stop(void)
+{
+	memset(nfs_reads, '\0', sizeof(nfs_reads));
+	net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
+}
+
+static struct nfs_read_slot *nfs_read_find(unsigned long id)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nfs_reads); i++) {
+		if (id && nfs_reads[i].id == id)
+			return &nfs_reads[i];
+	}
+
+	return NULL;
+}
+
+/* Send again any READ which has had no reply in time */
+static void nfs_read_timeout(void)
+{
+	ulong now = get_timer(0);
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(nfs_reads); i++) {
+		struct nfs_read_slot *slot = &nfs_reads[i];
+
+		if (!slot->id ||
+		    now - slot->sent < nfs_timeout * (1 + slot->retries))
+			continue;
+		if (++slot->retries > NFS_RETRY_COUNT) {
+			puts("\nRetry count exceeded; starting again\n");
+			net_start_again();
+			return;
+		}
+		puts("T ");
+		nfs_read_resends++;
+		nfs_read_req(slot);
+	}
+	nfs_read_set_timer();
+}
+
+static void nfs_read_progress(int rlen)
+{
+	ulong hashes = nfs_read_bytes / NFS_BYTES_PER_HASH;
+
+	nfs_read_bytes += rlen;
+	for (; hashes < nfs_read_bytes / NFS_BYTES_PER_HASH; hashes++) {
+		if (hashes && !(hashes % HASHES_PER_LINE))
+			puts("\n\t ");
+		putc('#');
+	}
+}
+
+/* Check whether all data up to the end of the file has arrived */
+static bool nfs_read_done(void)
+{
+	ulong time;
+	int i;
+
+	if (nfs_read_eof < 0)
+		return false;
+	for (i = 0; i < ARRAY_SIZE(nfs_reads); i++) {
+		if (nfs_reads[i].id && nfs_reads[i].offset < nfs_read_eof)
+			return false;
+	}
+
+	time = get_timer(nfs_read_time);
+	if (time > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(nfs_read_bytes / time * 1000, "/s");
+		if (nfs_read_resends)
+			printf(", %d requests sent again", nfs_read_resends);
+	}
+
+	return true;
 }
 
 /**************************************************************************
@@ -455,7 +635,7 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		nfs_read_fill();
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
@@ -711,20 +891,26 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	return 0;
 }
 
-static int nfs_read_reply(uchar *pkt, unsigned len)
+static int nfs_read_reply(uchar *pkt, unsigned len,
+			  struct nfs_read_slot **slotp, bool *eofp)
 {
 	struct rpc_t rpc_pkt;
+	struct nfs_read_slot *slot;
 	int rlen;
 	uchar *data_ptr;
+	uint data_ofs;
 
 	debug("%s\n", __func__);
 
-	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
+	/* only the header is copied, the data is stored straight from pkt */
+	memcpy(&rpc_pkt.u.data[0], pkt,
+	       min_t(uint, len, sizeof(rpc_pkt.u.reply)));
 
-	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
-		return -NFS_RPC_ERR;
-	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
+	slot = nfs_read_find(ntohl(rpc_pkt.u.reply.id));
+	if (!slot)
 		return -NFS_RPC_DROP;
+	*slotp = slot;
+	*eofp = false;
 
 	if (rpc_pkt.u.reply.rstatus  ||
 	    rpc_pkt.u.reply.verifier ||
@@ -737,12 +923,6 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (choosen_nfs_version != NFS_V3) {
 		rlen = ntohl(rpc_pkt.u.reply.data[18]);
 		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
@@ -752,6 +932,7 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 
 		/* count value */
 		rlen = ntohl(rpc_pkt.u.reply.data[1 + nfsv3_data_offset]);
+		*eofp = rpc_pkt.u.reply.data[2 + nfsv3_data_offset];
 		/* Skip unused values :
 			EOF:		32 bits value,
 			data_size:	32 bits value,
@@ -760,11 +941,12 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 			&(rpc_pkt.u.reply.data[4 + nfsv3_data_offset]);
 	}
 
-	if (((uchar *)&(rpc_pkt.u.reply.data[0]) - (uchar *)(&rpc_pkt) + rlen) > len)
-			return -9999;
+	data_ofs = data_ptr - (uchar *)&rpc_pkt;
+	if (rlen < 0 || rlen > slot->len || data_ofs + rlen > len)
+		return -9999;
 
-	if (store_block(data_ptr, nfs_offset, rlen))
-			return -9999;
+	if (store_block(pkt + data_ofs, slot->offset, rlen))
+		return -9999;
 
 	return rlen;
 }
@@ -774,6 +956,11 @@ Interfaces of U-BOOT
 **************************************************************************/
 static void nfs_timeout_handler(void)
 {
+	if (nfs_state == STATE_READ_REQ) {
+		nfs_read_timeout();
+		return;
+	}
+
 	if (++nfs_timeout_count > NFS_RETRY_COUNT) {
 		puts("\nRetry count exceeded; starting again\n");
 		net_start_again();
@@ -789,12 +976,15 @@ static void nfs_timeout_handler(void)
 static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			unsigned src, unsigned len)
 {
+	struct nfs_read_slot *slot;
+	bool eof;
 	int rlen;
 	int reply;
 
 	debug("%s\n", __func__);
 
-	if (len > sizeof(struct rpc_t))
+	/* with CONFIG_IP_DEFRAG, READ replies may be larger than struct rpc_t */
+	if (len > sizeof(struct rpc_t) && nfs_state != STATE_READ_REQ)
 		return;
 
 	if (dest != nfs_our_port)
@@ -865,9 +1055,7 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			nfs_send();
 		} else {
 			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
-			nfs_send();
+			nfs_read_start();
 		}
 		break;
 
@@ -890,25 +1078,43 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		break;
 
 	case STATE_READ_REQ:
-		rlen = nfs_read_reply(pkt, len);
+		rlen = nfs_read_reply(pkt, len, &slot, &eof);
 		if (rlen == -NFS_RPC_DROP)
 			break;
-		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
-			nfs_send();
+		if (rlen >= 0) {
+			nfs_read_progress(rlen);
+			if (!rlen || eof) {
+				if (nfs_read_eof < 0 ||
+				    slot->offset + rlen < nfs_read_eof)
+					nfs_read_eof = slot->offset + rlen;
+				slot->id = 0;
+			} else if (rlen < slot->len) {
+				/* short read, so ask for the rest */
+				slot->id = ++rpc_id;
+				slot->offset += rlen;
+				slot->len -= rlen;
+				slot->retries = 0;
+				nfs_read_req(slot);
+			} else {
+				slot->id = 0;
+			}
+			if (!nfs_read_done()) {
+				nfs_read_fill();
+				break;
+			}
+			nfs_download_state = NETLOOP_SUCCESS;
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
+			nfs_read_stop();
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
+			break;
 		} else {
-			if (!rlen)
-				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
-				debug("NFS READ error (%d)\n", rlen);
-			nfs_state = STATE_UMOUNT_REQ;
-			nfs_send();
+			debug("NFS READ error (%d)\n", rlen);
 		}
+		nfs_read_stop();
+		nfs_state = STATE_UMOUNT_REQ;
+		nfs_send();
 		break;
 	}
 }
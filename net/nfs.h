@@ -38,8 +38,9 @@
 /*
  * Block size used for NFS read accesses.  A RPC reply packet (including  all
  * headers) must fit within a single Ethernet frame to avoid fragmentation.
- * However, if CONFIG_IP_DEFRAG is set, a bigger value could be used.  In any
- * case, most NFS servers are optimized for a power of 2.
+ * However, if CONFIG_IP_DEFRAG is set, READ uses CONFIG_NFS_READ_BLOCKSIZE,
+ * which can be bigger.  In any case, most NFS servers are optimized for a
+ * power of 2.
  */
 #define NFS_READ_SIZE	1024	/* biggest power of two that fits Ether frame */
 #define NFS_MAX_ATTRS	26
@@ -36,6 +36,9 @@ static u32 rmt_timestamp;
 static u32 tcp_seq_init;
 static u32 tcp_ack_edge;
 
+/* Window scaling is in effect only if both SYNs carried the option */
+static bool tcp_scale_ok;
+
 static int tcp_activity_count;
 
 /*
@@ -146,6 +149,38 @@ u16 tcp_set_pseudo_header(uchar *pkt, struct in_addr src, struct in_addr dest,
 	return compute_ip_checksum(pkt + PSEUDO_PAD_SIZE, checksum_len);
 }
 
+/**
+ * tcp_rx_scale() - get the window shift needed for our receive window
+ *
+ * Return: smallest shift which makes TCP_RX_WINDOW fit in 16 bits
+ */
+static u8 tcp_rx_scale(void)
+{
+	u8 shift = 0;
+
+	while ((TCP_RX_WINDOW >> shift) > 0xffff && shift < TCP_MAX_SCALE)
+		shift++;
+
+	return shift;
+}
+
+/**
+ * tcp_rx_window() - get the value of the window field for a packet
+ * @action: TCP flags of the packet
+ *
+ * The window in a SYN is never scaled, and neither is any other window
+ * unless the server sent its own window scale option in the SYN-ACK.
+ *
+ * Return: window field value, in host byte order
+ */
+static u16 tcp_rx_window(u8 action)
+{
+	if ((action & TCP_SYN) || !tcp_scale_ok)
+		return min(TCP_RX_WINDOW, 0xffff);
+
+	return TCP_RX_WINDOW >> tcp_rx_scale();
+}
+
 /**
  * net_set_ack_options() - set TCP options in acknowledge packets
  * @b: the packet
@@ -218,7 +253,7 @@ void net_set_syn_options(union tcp_build_pkt *b)
 	b->ip.mss.len = TCP_OPT_LEN_4;
 	b->ip.mss.mss = htons(TCP_MSS);
 	b->ip.scale.kind = TCP_O_SCL;
-	b->ip.scale.scale = TCP_SCALE;
+	b->ip.scale.scale = tcp_rx_scale();
 	b->ip.scale.len = TCP_OPT_LEN_3;
 	if (IS_ENABLED(CONFIG_PROT_TCP_SACK)) {
 		b->ip.sack_p.kind = TCP_P_SACK;
@@ -231,6 +266,7 @@ void net_set_syn_options(union tcp_build_pkt *b)
 	b->ip.t_opt.len = TCP_OPT_LEN_A;
 	loc_timestamp = get_ticks();
 	rmt_timestamp = 0;
+	tcp_scale_ok = false;
 	b->ip.t_opt.t_snd = 0;
 	b->ip.t_opt.t_rcv = 0;
 	b->ip.end = TCP_O_END;
@@ -337,9 +373,9 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 	 * throughput. Temporary memory use for the boot phase on modern
 	 * SOCs is may not be considered a constraint to buffer space, if
 	 * it is, then the u-boot tftp or nfs kernel netboot should be
-	 * considered.
+	 * considered. See PROT_TCP_WINDOW_SIZE.
 	 */
-	b->ip.hdr.tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	b->ip.hdr.tcp_win = htons(tcp_rx_window(action));
 
 	b->ip.hdr.tcp_xsum = 0;
 	b->ip.hdr.tcp_ugr = 0;
@@ -469,33 +505,35 @@ void tcp_hole(u32 tcp_seq_num, u32 len)
 void tcp_parse_options(uchar *o, int o_len)
 {
 	struct tcp_t_opt  *tsopt;
+	uchar *end = o + o_len;
 	uchar *p = o;
 
 	/*
 	 * NOPs are options with a zero length, and thus are special.
 	 * All other options have length fields.
 	 */
-	for (p = o; p < (o + o_len); p = p + p[1]) {
-		if (!p[1])
-			return; /* Finished processing options */
+	while (p < end) {
+		if (p[0] == TCP_O_END)
+			return;
+		if (p[0] == TCP_1_NOP) {
+			p++;
+			continue;
+		}
+		if (p + 1 >= end || p[1] < TCP_OPT_LEN_2 || p + p[1] > end)
+			return; /* Malformed option list */
 
 		switch (p[0]) {
-		case TCP_O_END:
-			return;
-		case TCP_O_MSS:
 		case TCP_O_SCL:
-		case TCP_P_SACK:
-		case TCP_V_SACK:
+			/* Only a SYN-ACK answering our SYN can enable scaling */
+			if (current_tcp_state == TCP_SYN_SENT)
+				tcp_scale_ok = true;
 			break;
 		case TCP_O_TS:
 			tsopt = (struct tcp_t_opt *)p;
 			rmt_timestamp = tsopt->t_snd;
-			return;
+			break;
 		}
-
-		/* Process optional NOPs */
-		if (p[0] == TCP_O_NOP)
-			p++;
+		p += p[1];
 	}
 }
 
@@ -532,6 +570,8 @@ static u8 tcp_state_machine(u8 tcp_flags, u32 tcp_seq_num, int payload_len)
 		debug_cond(DEBUG_INT_STATE, "TCP CLOSED %x\n", tcp_flags);
 		if (tcp_syn) {
 			action = TCP_SYN | TCP_ACK;
+			/* Our SYN-ACK carries no window scale option */
+			tcp_scale_ok = false;
 			tcp_seq_init = tcp_seq_num;
 			tcp_ack_edge = tcp_seq_num + 1;
 			current_tcp_state = TCP_SYN_RECEIVED;
@@ -514,6 +514,46 @@ static int bootflow_cmd_boot(struct unit_test_state *uts)
 }
 BOOTSTD_TEST(bootflow_cmd_boot, UTF_DM | UTF_SCAN_FDT | UTF_CONSOLE);
 
+/* Check the order in which extlinux loads files and that overlap is caught */
+static int bootflow_cmd_boot_load(struct unit_test_state *uts)
+{
+	const char *label =
+		"Fedora-Workstation-armhfp-31-1.9 (5.3.7-301.fc31.armv7hl)";
+
+	ut_assertok(env_set("fdtfile", "sandbox.dtb"));
+	ut_assertok(run_command("bootdev select 1", 0));
+	ut_assertok(run_command("bootflow scan", 0));
+	ut_assertok(run_command("bootflow select 0", 0));
+	ut_assert_console_end();
+
+	/* The FDT and initrd are loaded before the kernel */
+	ut_assertok(inject_response(uts));
+	ut_asserteq(1, run_command("bootflow boot", 0));
+	ut_assert_skip_to_line(
+		"Retrieving file: /dtb-5.3.7-301.fc31.armv7hl/sandbox.dtb");
+	ut_assert_nextline(
+		"Retrieving file: /initramfs-5.3.7-301.fc31.armv7hl.img");
+	ut_assert_nextline("Retrieving file: /vmlinuz-5.3.7-301.fc31.armv7hl");
+	ut_assert_skip_to_line("sandbox: continuing, as we cannot run Linux");
+	ut_assert_nextline("Boot failed (err=-14)");
+	ut_assert_console_end();
+
+	/* Load the initrd where the kernel goes */
+	ut_assertok(env_set("ramdisk_addr_r", "0x1000000"));
+	ut_assertok(inject_response(uts));
+	ut_asserteq(1, run_command("bootflow boot", 0));
+	ut_assert_skip_to_linen(
+		"initrd at 1000000 (7 bytes) overlaps kernel at 1000000 (");
+	ut_assert_nextline("Skipping %s", label);
+	console_record_reset_enable();
+
+	ut_assertok(env_set("ramdisk_addr_r", "0x2000000"));
+	ut_assertok(env_set("fdtfile", NULL));
+
+	return 0;
+}
+BOOTSTD_TEST(bootflow_cmd_boot_load, UTF_DM | UTF_SCAN_FDT | UTF_CONSOLE);
+
 /**
  * prep_mmc_bootdev() - Set up an mmc bootdev so we can access other distros
  *
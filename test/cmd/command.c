@@ -9,6 +9,7 @@
 #include <env.h>
 #include <log.h>
 #include <string.h>
+#include <time.h>
 #include <linux/errno.h>
 #include <test/cmd.h>
 #include <test/ut.h>
@@ -106,3 +107,67 @@ static int command_test(struct unit_test_state *uts)
 	return 0;
 }
 CMD_TEST(command_test, 0);
+
+/* Check that find_cmd() gives the same results as a search of the table */
+static int command_test_find_cmd(struct unit_test_state *uts)
+{
+	struct cmd_tbl *start = ll_entry_start(struct cmd_tbl, cmd);
+	const int count = ll_entry_count(struct cmd_tbl, cmd);
+	struct cmd_tbl *cmdtp;
+	char name[40];
+
+	for (cmdtp = start; cmdtp != start + count; cmdtp++) {
+		int len;
+
+		ut_asserteq_ptr(cmdtp, find_cmd(cmdtp->name));
+
+		/* abbreviations, which may be ambiguous */
+		strlcpy(name, cmdtp->name, sizeof(name));
+		for (len = strlen(name) - 1; len >= 0; len--) {
+			name[len] = '\0';
+			ut_asserteq_ptr(find_cmd_tbl(name, start, count),
+					find_cmd(name));
+		}
+	}
+
+	/* length modifiers */
+	ut_asserteq_str("md", find_cmd("md.b")->name);
+	ut_asserteq_str("md", find_cmd("md.")->name);
+	ut_assertnull(find_cmd("no-such-command"));
+	ut_assertnull(find_cmd(NULL));
+
+	return 0;
+}
+CMD_TEST(command_test_find_cmd, 0);
+
+/* Compare the time taken to look up every command */
+static int command_test_find_cmd_bench(struct unit_test_state *uts)
+{
+	struct cmd_tbl *start = ll_entry_start(struct cmd_tbl, cmd);
+	const int count = ll_entry_count(struct cmd_tbl, cmd);
+	ulong linear, indexed;
+	struct cmd_tbl *cmdtp;
+	ulong start_us;
+	int i;
+
+	start_us = timer_get_us();
+	for (i = 0; i < 20; i++) {
+		for (cmdtp = start; cmdtp != start + count; cmdtp++)
+			ut_assertnonnull(find_cmd_tbl(cmdtp->name, start,
+						      count));
+	}
+	linear = timer_get_us() - start_us;
+
+	start_us = timer_get_us();
+	for (i = 0; i < 20; i++) {
+		for (cmdtp = start; cmdtp != start + count; cmdtp++)
+			ut_assertnonnull(find_cmd(cmdtp->name));
+	}
+	indexed = timer_get_us() - start_us;
+
+	printf("%d commands: table search %lu us, find_cmd() %lu us\n",
+	       count, linear, indexed);
+
+	return 0;
+}
+CMD_TEST(command_test_find_cmd_bench, 0);
@@ -6,6 +6,7 @@
  */
 
 #include <command.h>
+#include <console.h>
 #include <dm.h>
 #include <dm/test.h>
 #include <test/test.h>
@@ -102,3 +103,46 @@ static int dm_test_cmd_hash_sha256(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_cmd_hash_sha256, UTF_CONSOLE);
+
+static int dm_test_cmd_hash_multi(struct unit_test_state *uts)
+{
+	char md5[100], sha256[140];
+
+	if (!CONFIG_IS_ENABLED(MD5) || !CONFIG_IS_ENABLED(SHA256))
+		return -EAGAIN;
+
+	/* use enough data to need several chunks */
+	ut_assertok(run_command("mw.b $loadaddr 5a 9000", 0));
+	ut_assertok(run_command("hash md5 $loadaddr 9000", 0));
+	console_record_readline(md5, sizeof(md5));
+	ut_assertok(run_command("hash sha256 $loadaddr 9000", 0));
+	console_record_readline(sha256, sizeof(sha256));
+	ut_assert_console_end();
+
+	/* a single pass must give the same digests */
+	ut_assertok(run_command("hash md5,sha256 $loadaddr 9000", 0));
+	ut_assert_nextline("%s", md5);
+	ut_assert_nextline("%s", sha256);
+	ut_assert_console_end();
+
+	ut_assertok(run_command("hash sha256,md5 $loadaddr 0", 0));
+	console_record_readline(uts->actual_str, sizeof(uts->actual_str));
+	ut_assert(strstr(uts->actual_str,
+			 "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+	console_record_readline(uts->actual_str, sizeof(uts->actual_str));
+	ut_assert(strstr(uts->actual_str,
+			 "d41d8cd98f00b204e9800998ecf8427e"));
+	ut_assert_console_end();
+
+	ut_asserteq(1, run_command("hash md5,bad $loadaddr 0", 0));
+	ut_assert_nextline("Unknown hash algorithm 'bad'");
+	ut_assert_skip_to_line("hash - compute hash message digest");
+	console_record_reset();
+
+	ut_asserteq(1, run_command("hash md5,sha256 $loadaddr 0 foo", 0));
+	ut_assert_nextline("Cannot verify or store several hashes");
+	ut_assert_skip_to_line("hash - compute hash message digest");
+
+	return 0;
+}
+DM_TEST(dm_test_cmd_hash_multi, UTF_CONSOLE);
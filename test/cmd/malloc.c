@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test for 'malloc' command
+ */
+
+#include <malloc.h>
+#include <test/cmd.h>
+#include <test/ut.h>
+
+/* Test 'malloc info' command */
+static int cmd_test_malloc_info(struct unit_test_state *uts)
+{
+	void *ptr;
+
+	/* make sure the smallest cache has an object in use */
+	ptr = malloc(8);
+	ut_assertnonnull(ptr);
+
+	ut_assertok(run_command("malloc info", 0));
+	ut_assert_nextlinen("Heap:   ");
+	ut_assert_nextlinen("Top:    ");
+	ut_assert_nextlinen("In use: ");
+	ut_assert_nextlinen("Free:   ");
+	if (CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)) {
+		int i;
+
+		ut_assert_nextline_empty();
+		ut_assert_nextline("  Size    In use      Peak   Pages      Allocs       Frees");
+		ut_assert_nextlinen("%6lu  ", (ulong)(3 * sizeof(size_t)));
+		for (i = 1; i < 7; i++)
+			ut_assert_skipline();
+		ut_assert_nextlinen("Pages: ");
+	}
+	ut_assert_console_end();
+	free(ptr);
+
+	return 0;
+}
+CMD_TEST(cmd_test_malloc_info, UTF_CONSOLE);
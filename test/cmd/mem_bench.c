@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the 'mem bench' command
+ */
+
+#include <command.h>
+#include <console.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Declare a new mem test */
+#define MEM_TEST(_name, _flags)	UNIT_TEST(_name, _flags, mem_test)
+
+/* Test measuring bandwidth and latency over several block sizes */
+static int mem_test_bench(struct unit_test_state *uts)
+{
+	ut_assertok(run_commandf("mem bench -t 1 %x 4000",
+				 CONFIG_SYS_LOAD_ADDR));
+	ut_assert_nextline("Benchmarking 8000 bytes at %x, data cache on",
+			   CONFIG_SYS_LOAD_ADDR);
+	ut_assert_nextline("     size  read MB/s write MB/s  copy MB/s latency ns");
+	ut_assert_nextlinen("    4 KiB ");
+	ut_assert_nextlinen("    8 KiB ");
+	ut_assert_nextlinen("   16 KiB ");
+	ut_assert_console_end();
+
+	return 0;
+}
+MEM_TEST(mem_test_bench, UTF_CONSOLE);
+
+/* Test comparing the copy and fill implementations */
+static int mem_test_bench_kernels(struct unit_test_state *uts)
+{
+	ut_assertok(run_commandf("mem bench -k -t 1 %x 1000 1000",
+				 CONFIG_SYS_LOAD_ADDR));
+	ut_assert_nextlinen("Benchmarking 2000 bytes");
+	ut_assert_nextline("     size  kernel    copy MB/s   set MB/s");
+	ut_assert_nextlinen("    4 KiB  byte ");
+	ut_assert_nextlinen("           word ");
+	ut_assert_nextlinen("           unroll ");
+	ut_assert_nextlinen("           string ");
+	ut_assert_console_end();
+
+	return 0;
+}
+MEM_TEST(mem_test_bench_kernels, UTF_CONSOLE);
+
+/* Test invalid arguments */
+static int mem_test_bench_args(struct unit_test_state *uts)
+{
+	ut_asserteq(1, run_command("mem bench 1000", 0));
+	console_record_reset_enable();
+	ut_asserteq(1, run_command("mem bench 1000 0", 0));
+	ut_assert_nextline("Invalid address or size");
+	ut_assert_console_end();
+
+	return 0;
+}
+MEM_TEST(mem_test_bench_args, UTF_CONSOLE);
@@ -72,7 +72,7 @@ static int sb_syn_handler(struct udevice *dev, void *packet,
 	tcp_send->tcp_ack = htonl(ntohl(tcp->tcp_seq) + 1);
 	tcp_send->tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(TCP_HDR_SIZE));
 	tcp_send->tcp_flags = TCP_SYN | TCP_ACK;
-	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS);
 	tcp_send->tcp_xsum = 0;
 	tcp_send->tcp_ugr = 0;
 	tcp_send->tcp_xsum = tcp_set_pseudo_header((uchar *)tcp_send,
@@ -157,7 +157,7 @@ static int sb_ack_handler(struct udevice *dev, void *packet,
 	}
 
 	tcp_send->tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(TCP_HDR_SIZE));
-	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS);
 	tcp_send->tcp_xsum = 0;
 	tcp_send->tcp_ugr = 0;
 	pkt_len = IP_TCP_HDR_SIZE + payload_len;
@@ -234,3 +234,58 @@ static int net_test_wget(struct unit_test_state *uts)
 	return 0;
 }
 CMD_TEST(net_test_wget, UTF_CONSOLE);
+
+static u16 syn_win, ack_win;
+static u8 syn_scale;
+
+static int sb_window_handler(struct udevice *dev, void *packet,
+			     unsigned int len)
+{
+	union tcp_build_pkt *b = packet + ETHER_HDR_SIZE;
+	struct ethernet_hdr *eth = packet;
+
+	if (ntohs(eth->et_protlen) == PROT_IP && b->ip.hdr.ip_p == IPPROTO_TCP) {
+		if (b->ip.hdr.tcp_flags == TCP_SYN) {
+			syn_win = ntohs(b->ip.hdr.tcp_win);
+			if (b->ip.scale.kind == TCP_O_SCL)
+				syn_scale = b->ip.scale.scale;
+		} else if (!ack_win) {
+			ack_win = ntohs(b->ip.hdr.tcp_win);
+		}
+	}
+
+	return sb_http_handler(dev, packet, len);
+}
+
+/* The server does not offer window scaling, so the window is never scaled */
+static int net_test_wget_window(struct unit_test_state *uts)
+{
+	char *prev_ethact = env_get("ethact");
+	char *prev_ethrotate = env_get("ethrotate");
+	char *prev_loadaddr = env_get("loadaddr");
+	u32 expect = min(TCP_RX_WINDOW, 0xffff);
+
+	syn_win = 0;
+	ack_win = 0;
+	syn_scale = 0xff;
+	sandbox_eth_set_tx_handler(0, sb_window_handler);
+	sandbox_eth_set_priv(0, uts);
+
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set("loadaddr", "0x20000");
+	ut_assertok(run_command("wget ${loadaddr} 1.1.2.2:/index.html", 0));
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	ut_asserteq(expect, syn_win);
+	ut_asserteq(expect, ack_win);
+	ut_assert(syn_scale <= TCP_MAX_SCALE);
+	ut_assert((TCP_RX_WINDOW >> syn_scale) <= 0xffff);
+
+	env_set("ethact", prev_ethact);
+	env_set("ethrotate", prev_ethrotate);
+	env_set("loadaddr", prev_loadaddr);
+
+	return 0;
+}
+CMD_TEST(net_test_wget_window, 0);
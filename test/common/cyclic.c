@@ -5,9 +5,11 @@
 
 #include <cyclic.h>
 #include <dm.h>
+#include <malloc.h>
 #include <test/common.h>
 #include <test/test.h>
 #include <test/ut.h>
+#include <time.h>
 #include <watchdog.h>
 #include <linux/delay.h>
 
@@ -37,3 +39,117 @@ static int dm_test_cyclic_running(struct unit_test_state *uts)
 	return 0;
 }
 COMMON_TEST(dm_test_cyclic_running, 0);
+
+/* Record the order in which cyclic functions are called */
+static struct cyclic_order {
+	struct cyclic_info cyclic;
+	char id;
+	bool once;
+} cyclic_order[3];
+
+static char cyclic_calls[10];
+static int cyclic_num_calls;
+
+static void order_cb(struct cyclic_info *c)
+{
+	struct cyclic_order *t = container_of(c, struct cyclic_order, cyclic);
+
+	if (cyclic_num_calls < sizeof(cyclic_calls) - 1)
+		cyclic_calls[cyclic_num_calls++] = t->id;
+	if (t->once)
+		cyclic_unregister(c);
+}
+
+static const char *run_schedule(ulong offset_ms)
+{
+	timer_test_add_offset(offset_ms);
+	cyclic_num_calls = 0;
+	memset(cyclic_calls, '\0', sizeof(cyclic_calls));
+	schedule();
+
+	return cyclic_calls;
+}
+
+/* Test that cyclic functions are called in deadline order */
+static int common_test_cyclic_order(struct unit_test_state *uts)
+{
+	static const uint delay_ms[] = {300, 100, 200};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cyclic_order); i++) {
+		struct cyclic_order *t = &cyclic_order[i];
+
+		t->id = 'a' + i;
+		cyclic_register(&t->cyclic, order_cb, delay_ms[i] * 1000,
+				"cyclic_order");
+		t->once = i == 2;
+	}
+
+	/* Everything runs straight away, in order of registration */
+	ut_asserteq_str("abc", run_schedule(0));
+
+	/* 'c' unregistered itself, so only 'b' is due after 150ms */
+	ut_asserteq_str("b", run_schedule(150));
+
+	/* At 250ms 'b' is due again, at 350ms 'a' and 'b' are */
+	ut_asserteq_str("b", run_schedule(100));
+	ut_asserteq_str("ab", run_schedule(100));
+
+	/* Nothing is due */
+	ut_asserteq_str("", run_schedule(0));
+
+	/* A long delay runs each function only once */
+	ut_asserteq_str("ba", run_schedule(1000));
+	ut_asserteq(5, cyclic_order[1].cyclic.run_cnt);
+
+	cyclic_unregister(&cyclic_order[0].cyclic);
+	cyclic_unregister(&cyclic_order[1].cyclic);
+
+	return 0;
+}
+COMMON_TEST(common_test_cyclic_order, 0);
+
+static void bench_cb(struct cyclic_info *c)
+{
+}
+
+/* Measure the cost of schedule() when nothing is due */
+static int common_test_cyclic_bench(struct unit_test_state *uts)
+{
+	static const int counts[] = {0, 4, 32};
+	const int calls = 100000;
+	struct cyclic_info *cyclics;
+	int i, j;
+
+	/* Make sure only our functions are registered */
+	ut_assertok(cyclic_unregister_all());
+
+	cyclics = calloc(32, sizeof(*cyclics));
+	ut_assertnonnull(cyclics);
+	for (i = 0; i < ARRAY_SIZE(counts); i++) {
+		ulong start, elapsed;
+
+		for (j = 0; j < counts[i]; j++)
+			cyclic_register(&cyclics[j], bench_cb, 1000000000ULL,
+					"cyclic_bench");
+
+		/* The first call runs each function once */
+		schedule();
+
+		start = timer_get_us();
+		for (j = 0; j < calls; j++)
+			schedule();
+		elapsed = timer_get_us() - start;
+
+		for (j = 0; j < counts[i]; j++) {
+			ut_asserteq(1, cyclics[j].run_cnt);
+			cyclic_unregister(&cyclics[j]);
+		}
+		printf("%2d cyclics: %lu ns per schedule()\n", counts[i],
+		       elapsed * 1000 / calls);
+	}
+	free(cyclics);
+
+	return 0;
+}
+COMMON_TEST(common_test_cyclic_bench, 0);
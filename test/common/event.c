@@ -8,10 +8,15 @@
 
 #include <dm.h>
 #include <event.h>
+#include <event_internal.h>
+#include <linker_lists.h>
+#include <asm/global_data.h>
 #include <test/common.h>
 #include <test/test.h>
 #include <test/ut.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 struct test_state {
 	struct udevice *dev;
 	int val;
@@ -107,3 +112,42 @@ static int test_event_probe(struct unit_test_state *uts)
 	return 0;
 }
 COMMON_TEST(test_event_probe, UTF_DM | UTF_SCAN_FDT);
+
+/* Test that events are only sent to the spies for that event type */
+static int test_event_dispatch(struct unit_test_state *uts)
+{
+	struct evspy_info *start =
+		ll_entry_start(struct evspy_info, evspy_info);
+	struct event_state *state = gd_event_state();
+	struct event_dispatch *disp;
+	struct test_state test_state;
+	u32 calls;
+	int i;
+
+	test_state.val = 0;
+	ut_assertok(event_register("other", EVT_MAIN_LOOP, h_adder,
+				   &test_state));
+
+	called = false;
+	ut_assertok(event_notify_null(EVT_TEST));
+	ut_assert(called);
+	ut_assert(state->indexed);
+
+	/* The test spies are next to each other in the list */
+	disp = &state->dispatch[EVT_TEST];
+	ut_assert(disp->count && disp->count != EVENT_DISPATCH_SCAN);
+	for (i = 0; i < disp->count; i++)
+		ut_asserteq(EVT_TEST, start[disp->start + i].type);
+
+	/* The dynamic spy for another event is not called */
+	calls = disp->calls;
+	ut_assertok(event_notify_null(EVT_TEST));
+	ut_asserteq(calls + 1, disp->calls);
+	ut_asserteq(0, test_state.val);
+
+	ut_asserteq(-EINVAL, event_notify_null(EVT_COUNT));
+	ut_asserteq(-EINVAL, event_register("bad", EVT_COUNT, h_adder, NULL));
+
+	return 0;
+}
+COMMON_TEST(test_event_dispatch, 0);
@@ -5,11 +5,14 @@
  * Copyright (c) 2013 Google, Inc
  */
 
+#include <bootstage.h>
+#include <command.h>
 #include <errno.h>
 #include <dm.h>
 #include <fdtdec.h>
 #include <log.h>
 #include <malloc.h>
+#include <time.h>
 #include <asm/global_data.h>
 #include <dm/device-internal.h>
 #include <dm/root.h>
@@ -528,6 +531,41 @@ static int dm_test_leak(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_leak, 0);
 
+/* Compare the cost of binding all devices with and without slab caches */
+static int dm_test_scan_bench(struct unit_test_state *uts)
+{
+	int pass;
+
+	if (!CONFIG_IS_ENABLED(SYS_MALLOC_SLAB))
+		return -EAGAIN;
+
+	for (pass = 0; pass < 2; pass++) {
+		ulong start, elapsed, brk;
+		struct mallinfo info;
+		bool slab = pass;
+
+		malloc_slab_enable(slab);
+		dm_leak_check_start(uts);
+		brk = mem_malloc_brk;
+
+		start = timer_get_us();
+		ut_assertok(dm_scan_plat(false));
+		ut_assertok(dm_scan_fdt(false));
+		elapsed = timer_get_us() - start;
+		info = mallinfo();
+
+		printf("slab %-3s: %lu us, %d bytes in use, heap top +%lu\n",
+		       slab ? "on" : "off", elapsed,
+		       info.uordblks - uts->start.uordblks,
+		       mem_malloc_brk - brk);
+		ut_assertok(dm_leak_check_end(uts));
+	}
+	malloc_slab_enable(true);
+
+	return 0;
+}
+DM_TEST(dm_test_scan_bench, 0);
+
 /* Test uclass init/destroy methods */
 static int dm_test_uclass(struct unit_test_state *uts)
 {
@@ -1423,3 +1461,28 @@ static int dm_test_try_first_device(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_try_first_device, 0);
+
+/* Test recording device probe times */
+static int dm_test_probe_times(struct unit_test_state *uts)
+{
+	int outer, inner;
+
+	if (!CONFIG_IS_ENABLED(BOOTSTAGE_TIMING))
+		return -EAGAIN;
+
+	/* the table may already be full from boot and earlier tests */
+	bootstage_timing_clear();
+	outer = bootstage_timing_start(BOOTSTAGE_TIMING_PROBE, "dm-test-outer");
+	inner = bootstage_timing_start(BOOTSTAGE_TIMING_PROBE, "dm-test-inner");
+	bootstage_timing_end(inner);
+	bootstage_timing_end(outer);
+	ut_asserteq(0, outer);
+	ut_asserteq(1, inner);
+
+	ut_assertok(run_command("dm probe-times", 0));
+	ut_assert_nextline("Timing in microseconds (2 records):");
+	ut_assert_nextline("       Self      Total  Name");
+
+	return 0;
+}
+DM_TEST(dm_test_probe_times, UTF_CONSOLE);
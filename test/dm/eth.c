@@ -189,6 +189,62 @@ static int dm_test_eth(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_eth, UTF_SCAN_FDT);
 
+static void dm_test_eth_push(void *packet, int len)
+{
+}
+
+/* Check that the receive budget follows the load and that polls are counted */
+static int dm_test_eth_rx_budget(struct unit_test_state *uts)
+{
+	struct net_stats old = net_stats;
+	int budget;
+
+	net_stats.rx_budget = ETH_PACKETS_BATCH_RECV;
+	budget = eth_rx_budget();
+	ut_asserteq(ETH_PACKETS_BATCH_RECV, budget);
+
+	/* a full batch doubles the budget, up to the maximum */
+	eth_rx_account(budget, budget, 1);
+	ut_asserteq(ETH_PACKETS_BATCH_RECV * 2, eth_rx_budget());
+	while (eth_rx_budget() < ETH_PACKETS_BATCH_MAX)
+		eth_rx_account(eth_rx_budget(), eth_rx_budget(), 1);
+	eth_rx_account(ETH_PACKETS_BATCH_MAX, ETH_PACKETS_BATCH_MAX, 1);
+	ut_asserteq(ETH_PACKETS_BATCH_MAX, eth_rx_budget());
+
+	/* a half-full batch leaves it alone, an almost empty one halves it */
+	eth_rx_account(ETH_PACKETS_BATCH_MAX / 2, ETH_PACKETS_BATCH_MAX, 0);
+	ut_asserteq(ETH_PACKETS_BATCH_MAX, eth_rx_budget());
+	eth_rx_account(1, ETH_PACKETS_BATCH_MAX, -EAGAIN);
+	ut_asserteq(ETH_PACKETS_BATCH_MAX / 2, eth_rx_budget());
+	while (eth_rx_budget() > ETH_PACKETS_BATCH_RECV)
+		eth_rx_account(0, eth_rx_budget(), -EAGAIN);
+	eth_rx_account(0, ETH_PACKETS_BATCH_RECV, -EAGAIN);
+	ut_asserteq(ETH_PACKETS_BATCH_RECV, eth_rx_budget());
+	ut_asserteq(ETH_PACKETS_BATCH_MAX, net_stats.rx_max_batch);
+	ut_asserteq(0, net_stats.rx_errors - old.rx_errors);
+	eth_rx_account(0, ETH_PACKETS_BATCH_RECV, -EIO);
+	ut_asserteq(1, net_stats.rx_errors - old.rx_errors);
+
+	/* pushed packets never outrun what the consumer can hold */
+	net_stats.rx_budget = ETH_PACKETS_BATCH_MAX;
+	push_packet = dm_test_eth_push;
+	ut_asserteq(ETH_PACKETS_BATCH_RECV, eth_rx_budget());
+	push_packet = NULL;
+	ut_asserteq(ETH_PACKETS_BATCH_MAX, eth_rx_budget());
+
+	/* a ping must go through the main loop and receive its reply */
+	net_stats = old;
+	net_ping_ip = string_to_ip("1.1.2.2");
+	env_set("ethact", "eth@10002000");
+	ut_assertok(net_loop(PING));
+	ut_assert(net_stats.polls > old.polls);
+	ut_assert(net_stats.rx_packets > old.rx_packets);
+	ut_assert(net_stats.loops > old.loops);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_rx_budget, UTF_SCAN_FDT);
+
 static int dm_test_eth_alias(struct unit_test_state *uts)
 {
 	net_ping_ip = string_to_ip("1.1.2.2");
@@ -92,3 +92,169 @@ static int dm_test_fastboot_mmc_part(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_fastboot_mmc_part, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+#if IS_ENABLED(CONFIG_FASTBOOT_MMC_STREAM)
+/* Check that an image is written to MMC while it downloads */
+static int dm_test_fastboot_mmc_stream(struct unit_test_state *uts)
+{
+	const u32 size = 5 * CONFIG_FASTBOOT_MMC_STREAM_CHUNK / 2;
+	char response[FASTBOOT_RESPONSE_LEN] = {0};
+	char cmd[FASTBOOT_COMMAND_LEN];
+	char str_disk_guid[UUID_STR_LEN + 1];
+	struct blk_desc *mmc_dev_desc;
+	struct disk_partition parts[2] = {
+		{
+			.start = 48,
+			.size = 64,
+			.name = "test1",
+		},
+		{
+			.start = 112,
+			.size = 64,
+			.name = "test2",
+		},
+	};
+	u8 *image, *buf, *readback;
+	u32 part_bytes, blks, i, len;
+
+	ut_assertok(blk_get_device_by_str("mmc", "0", &mmc_dev_desc));
+	part_bytes = parts[0].size * mmc_dev_desc->blksz;
+	ut_assert(size <= part_bytes);
+	if (CONFIG_IS_ENABLED(RANDOM_UUID)) {
+		gen_rand_uuid_str(parts[0].uuid, UUID_STR_FORMAT_STD);
+		gen_rand_uuid_str(parts[1].uuid, UUID_STR_FORMAT_STD);
+		gen_rand_uuid_str(str_disk_guid, UUID_STR_FORMAT_STD);
+	}
+	ut_assertok(gpt_restore(mmc_dev_desc, str_disk_guid, parts,
+				ARRAY_SIZE(parts)));
+
+	image = malloc(size);
+	buf = malloc(part_bytes + 1);
+	readback = malloc(part_bytes);
+	ut_assertnonnull(image);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(readback);
+	for (i = 0; i < size; i++)
+		image[i] = i * 7 + (i >> 8);
+	fastboot_init(buf, size);
+
+	/* nothing is written until the partition is named */
+	ut_asserteq(FASTBOOT_COMMAND_OEM_STREAM,
+		    fastboot_handle_command(strcpy(cmd, "oem stream:test1"),
+					    response));
+	ut_asserteq_str("OKAY", response);
+
+	snprintf(cmd, sizeof(cmd), "download:%08x", size);
+	ut_asserteq(FASTBOOT_COMMAND_DOWNLOAD,
+		    fastboot_handle_command(cmd, response));
+	ut_asserteq_strn("DATA", response);
+
+	/* the first chunk is written as soon as it has arrived */
+	fastboot_data_download(image, CONFIG_FASTBOOT_MMC_STREAM_CHUNK + 100,
+			       response);
+	ut_asserteq_str("", response);
+	fastboot_data_flush();
+	blks = CONFIG_FASTBOOT_MMC_STREAM_CHUNK / mmc_dev_desc->blksz;
+	ut_asserteq(blks + 1, blk_dread(mmc_dev_desc, parts[0].start, blks + 1,
+					readback));
+	ut_asserteq_mem(image, readback, CONFIG_FASTBOOT_MMC_STREAM_CHUNK);
+	ut_assert(memcmp(image + CONFIG_FASTBOOT_MMC_STREAM_CHUNK,
+			 readback + CONFIG_FASTBOOT_MMC_STREAM_CHUNK, 100));
+
+	/* the rest is written when the download completes */
+	i = CONFIG_FASTBOOT_MMC_STREAM_CHUNK + 100;
+	fastboot_data_download(image + i, size - i, response);
+	ut_asserteq_str("", response);
+	ut_asserteq(0, fastboot_data_remaining());
+	fastboot_data_complete(response);
+	ut_asserteq_str("OKAY", response);
+	fastboot_data_flush();
+	blks = DIV_ROUND_UP(size, mmc_dev_desc->blksz);
+	ut_asserteq(blks, blk_dread(mmc_dev_desc, parts[0].start, blks,
+				    readback));
+	ut_asserteq_mem(image, readback, size);
+
+	/* 'flash' only checks the result, so must name the same partition */
+	ut_asserteq(FASTBOOT_COMMAND_FLASH,
+		    fastboot_handle_command(strcpy(cmd, "flash:test1"),
+					    response));
+	ut_asserteq_str("OKAY", response);
+
+	/* without 'oem stream' the image is written by 'flash' */
+	snprintf(cmd, sizeof(cmd), "download:%08x", size);
+	fastboot_handle_command(cmd, response);
+	fastboot_data_download(image, size, response);
+	fastboot_data_complete(response);
+	fastboot_data_flush();
+	ut_asserteq(blks, blk_dread(mmc_dev_desc, parts[1].start, blks,
+				    readback));
+	ut_assert(memcmp(image, readback, size));
+	ut_asserteq(FASTBOOT_COMMAND_FLASH,
+		    fastboot_handle_command(strcpy(cmd, "flash:test2"),
+					    response));
+	ut_asserteq_str("OKAY", response);
+	ut_asserteq(blks, blk_dread(mmc_dev_desc, parts[1].start, blks,
+				    readback));
+	ut_asserteq_mem(image, readback, size);
+
+	/* a streamed image cannot be flashed to another partition */
+	fastboot_handle_command(strcpy(cmd, "oem stream:test1"), response);
+	snprintf(cmd, sizeof(cmd), "download:%08x", size);
+	fastboot_handle_command(cmd, response);
+	fastboot_data_download(image, size, response);
+	fastboot_data_complete(response);
+	fastboot_data_flush();
+	fastboot_handle_command(strcpy(cmd, "flash:test2"), response);
+	ut_asserteq_str("FAILimage was streamed to another partition",
+			response);
+
+	/* a streamed image may be larger than the buffer, which wraps */
+	fastboot_init(buf, CONFIG_FASTBOOT_MMC_STREAM_CHUNK);
+	memset(readback, '\0', part_bytes);
+	ut_asserteq(blks, blk_dwrite(mmc_dev_desc, parts[1].start, blks,
+				     readback));
+	snprintf(cmd, sizeof(cmd), "download:%08x", size);
+	fastboot_handle_command(cmd, response);
+	ut_asserteq_strn("FAIL", response);
+	ut_asserteq_str(cmd + strlen("download:"), response + 4);
+	fastboot_handle_command(strcpy(cmd, "oem stream:test2"), response);
+	snprintf(cmd, sizeof(cmd), "download:%08x", size);
+	fastboot_handle_command(cmd, response);
+	ut_asserteq_strn("DATA", response);
+	for (i = 0; i < size; i += len) {
+		len = min(size - i, 1500U);
+		fastboot_data_download(image + i, len, response);
+		ut_asserteq_str("", response);
+		fastboot_data_flush();
+	}
+	fastboot_data_complete(response);
+	fastboot_data_flush();
+	ut_asserteq(blks, blk_dread(mmc_dev_desc, parts[1].start, blks,
+				    readback));
+	ut_asserteq_mem(image, readback, size);
+	ut_asserteq(FASTBOOT_COMMAND_FLASH,
+		    fastboot_handle_command(strcpy(cmd, "flash:test2"),
+					    response));
+	ut_asserteq_str("OKAY", response);
+
+	/* the buffer does not hold it, so it cannot be flashed again */
+	fastboot_handle_command(strcpy(cmd, "flash:test2"), response);
+	ut_asserteq_str("FAILimage is not in the download buffer", response);
+
+	/* an image too large for the partition is refused at the start */
+	fastboot_handle_command(strcpy(cmd, "oem stream:test1"), response);
+	snprintf(cmd, sizeof(cmd), "download:%08x", part_bytes + 1);
+	fastboot_init(buf, part_bytes + 1);
+	fastboot_handle_command(cmd, response);
+	ut_asserteq_str("FAILtoo large for partition", response);
+	ut_asserteq(0, fastboot_data_remaining());
+
+	fastboot_init(NULL, 0);
+	free(readback);
+	free(buf);
+	free(image);
+
+	return 0;
+}
+DM_TEST(dm_test_fastboot_mmc_stream, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+#endif
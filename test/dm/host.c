@@ -198,3 +198,125 @@ static int dm_test_cmd_host(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_cmd_host, UTF_SCAN_FDT | UTF_CONSOLE);
+
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/* Check the counters of the filesystem mount cache against the baseline */
+static int check_fs_mount(struct unit_test_state *uts,
+			  struct fs_mount_stats *base, struct blk_desc *desc,
+			  ulong hits, ulong misses, ulong invalidations)
+{
+	struct fs_mount_stats stats;
+
+	fs_mount_get_stats(&stats);
+	ut_asserteq_ptr(desc, stats.desc);
+	ut_asserteq(hits, stats.hits - base->hits);
+	ut_asserteq(misses, stats.misses - base->misses);
+	ut_asserteq(invalidations, stats.invalidations - base->invalidations);
+
+	return 0;
+}
+
+/* Test that filesystems stay mounted until their device changes */
+static int dm_test_host_fs_cache(struct unit_test_state *uts)
+{
+	struct fs_mount_stats base;
+	struct udevice *dev, *blk;
+	struct blk_desc *desc;
+	char fname[256];
+	ulong mem_start;
+	loff_t actwrite, size;
+	u8 *buf;
+
+	mem_start = ut_check_delta(0);
+	ut_assertok(host_create_device("test", true, DEFAULT_BLKSZ, &dev));
+	ut_assertok(os_persistent_file(fname, sizeof(fname), "2MB.ext2.img"));
+	ut_assertok(host_attach_file(dev, fname));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(device_probe(blk));
+	desc = dev_get_uclass_plat(blk);
+
+	fs_flush();
+	fs_mount_get_stats(&base);
+
+	/* writing a file unmounts the filesystem */
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_write("/cached", 0, 0, 0x100, &actwrite));
+	ut_assertok(check_fs_mount(uts, &base, NULL, 0, 1, 1));
+
+	/* reading leaves it mounted for the next user */
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_size("/cached", &size));
+	ut_asserteq(0x100, size);
+	ut_assertok(check_fs_mount(uts, &base, desc, 0, 2, 1));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_asserteq_str("ext4", fs_get_type_name());
+	ut_assertok(fs_size("/cached", &size));
+	ut_asserteq(0x100, size);
+	ut_assertok(check_fs_mount(uts, &base, desc, 1, 2, 1));
+
+	/* opening and closing a directory reuses it each time */
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	fs_closedir(fs_opendir("/"));
+	ut_assertok(check_fs_mount(uts, &base, desc, 3, 2, 1));
+
+	/* writing to the device directly unmounts it */
+	buf = malloc(desc->blksz);
+	ut_assertnonnull(buf);
+	ut_asserteq(1, blk_dread(desc, 0, 1, buf));
+	ut_asserteq(1, blk_dwrite(desc, 0, 1, buf));
+	free(buf);
+	ut_assertok(check_fs_mount(uts, &base, NULL, 3, 2, 2));
+
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_asserteq(1, fs_exists("/cached"));
+	ut_assertok(check_fs_mount(uts, &base, desc, 3, 3, 2));
+
+	/* so does flushing */
+	fs_flush();
+	ut_assertok(check_fs_mount(uts, &base, NULL, 3, 3, 3));
+
+	/* and removing the device */
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	fs_close();
+	ut_assertok(check_fs_mount(uts, &base, desc, 3, 4, 3));
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(check_fs_mount(uts, &base, NULL, 3, 4, 4));
+	ut_assertok(device_unbind(dev));
+
+	/* check that nothing was left mounted */
+	ut_asserteq(0, ut_check_delta(mem_start));
+
+	return 0;
+}
+DM_TEST(dm_test_host_fs_cache, UTF_SCAN_FDT);
+
+/* Test the 'fs' command */
+static int dm_test_cmd_fs(struct unit_test_state *uts)
+{
+	char fname[256];
+
+	ut_assertok(os_persistent_file(fname, sizeof(fname), "1MB.fat32.img"));
+	ut_assertok(run_commandf("host bind fat %s", fname));
+	ut_assertok(run_command("fs flush", 0));
+	ut_assertok(run_command("fs stats", 0));
+	ut_assert_nextline("Mounted: none");
+	ut_assert_nextlinen("Hits: ");
+	ut_assert_console_end();
+
+	ut_assertok(run_command("ls host 0 /", 0));
+	console_record_reset_enable();
+	ut_assertok(run_command("fs stats", 0));
+	ut_assert_nextline("Mounted: host 0:0 (fat)");
+	ut_assert_nextlinen("Hits: ");
+	ut_assert_console_end();
+
+	ut_assertok(run_command("fs flush", 0));
+	ut_assertok(run_command("fs stats", 0));
+	ut_assert_nextline("Mounted: none");
+	ut_assert_nextlinen("Hits: ");
+	ut_assert_console_end();
+
+	return 0;
+}
+DM_TEST(dm_test_cmd_fs, UTF_SCAN_FDT | UTF_CONSOLE);
+#endif
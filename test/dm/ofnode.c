@@ -1530,3 +1530,99 @@ static int dm_test_bool(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_bool, UTF_SCAN_FDT);
+
+/* Collect the phandles below @parent, checking each one can be looked up */
+static int collect_phandles(struct unit_test_state *uts, ofnode parent,
+			    u32 *phandles, int *countp, int max)
+{
+	ofnode node;
+	u32 phandle;
+
+	ofnode_for_each_subnode(node, parent) {
+		if (!ofnode_read_u32(node, "phandle", &phandle)) {
+			ut_assert(ofnode_equal(node,
+					       ofnode_get_by_phandle(phandle)));
+			ut_assert(*countp < max);
+			phandles[(*countp)++] = phandle;
+		}
+		ut_assertok(collect_phandles(uts, node, phandles, countp,
+					     max));
+	}
+
+	return 0;
+}
+
+/* Search the control tree for a phandle, without using any index */
+static ofnode search_phandle(u32 phandle)
+{
+	struct device_node *np;
+
+	if (!of_live_active()) {
+		void *fdt = ofnode_to_fdt(ofnode_root());
+
+		return offset_to_ofnode(fdt_node_offset_by_phandle(fdt,
+								   phandle));
+	}
+
+	for_each_of_allnodes(np) {
+		if (np->phandle == phandle)
+			break;
+	}
+
+	return np_to_ofnode(np);
+}
+
+/* Test looking up phandles in the control tree, and measure the lookups */
+static int dm_test_ofnode_phandle_index(struct unit_test_state *uts)
+{
+	const int max = 1000, rounds = 20;
+	ulong start, indexed, searched;
+	int count = 0, i, j;
+	ofnode node, check;
+	u32 *phandles;
+
+	phandles = calloc(max, sizeof(*phandles));
+	ut_assertnonnull(phandles);
+	ut_assertok(collect_phandles(uts, ofnode_root(), phandles, &count,
+				     max));
+	ut_assert(count > 10);
+	ut_assert(!ofnode_valid(ofnode_get_by_phandle(0)));
+
+	start = timer_get_us();
+	for (i = 0; i < rounds; i++) {
+		for (j = 0; j < count; j++)
+			ofnode_get_by_phandle(phandles[j]);
+	}
+	indexed = timer_get_us() - start;
+
+	start = timer_get_us();
+	for (i = 0; i < rounds; i++) {
+		for (j = 0; j < count; j++)
+			search_phandle(phandles[j]);
+	}
+	searched = timer_get_us() - start;
+
+	printf("%d phandles: %lu ns per lookup, %lu ns searching the tree\n",
+	       count, indexed * 1000 / (rounds * count),
+	       searched * 1000 / (rounds * count));
+
+	if (!of_live_active()) {
+		/* move every node behind the index's back */
+		ut_assertok(fdt_setprop_u32(ofnode_to_fdt(ofnode_root()), 0,
+					    "phandle-test", 1));
+		count = 0;
+		ut_assertok(collect_phandles(uts, ofnode_root(), phandles,
+					     &count, max));
+
+		/* a new phandle is found once it is written */
+		ut_assertok(ofnode_add_subnode(ofnode_root(), "phandle-test",
+					       &node));
+		ut_assertok(ofnode_write_u32(node, "phandle", 0xfff0));
+		check = ofnode_path("/phandle-test");
+		ut_assert(ofnode_equal(check, ofnode_get_by_phandle(0xfff0)));
+	}
+	free(phandles);
+
+	return 0;
+}
+DM_TEST(dm_test_ofnode_phandle_index, UTF_SCAN_FDT);
@@ -194,3 +194,78 @@ static int dm_test_part_get_info_by_type(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_part_get_info_by_type, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+/* Test that the GPT is cached until it is written */
+static int dm_test_part_gpt_cache(struct unit_test_state *uts)
+{
+	char str_disk_guid[UUID_STR_LEN + 1];
+	struct disk_partition parts[3] = {
+		{
+			.start = 48,
+			.size = 1,
+			.name = "test1",
+		},
+		{
+			.start = 49,
+			.size = 1,
+			.name = "test2",
+		},
+		{
+			.start = 50,
+			.size = 1,
+			.name = "test1",
+		},
+	};
+	const struct blk_ops *ops;
+	struct disk_partition info;
+	struct blk_desc *desc;
+	u8 *buf;
+
+	if (!CONFIG_IS_ENABLED(EFI_PARTITION_CACHE))
+		return -EAGAIN;
+
+	ut_asserteq(2, blk_get_device_by_str("mmc", "2", &desc));
+	if (CONFIG_IS_ENABLED(RANDOM_UUID)) {
+		gen_rand_uuid_str(parts[0].uuid, UUID_STR_FORMAT_STD);
+		gen_rand_uuid_str(parts[1].uuid, UUID_STR_FORMAT_STD);
+		gen_rand_uuid_str(parts[2].uuid, UUID_STR_FORMAT_STD);
+		gen_rand_uuid_str(str_disk_guid, UUID_STR_FORMAT_STD);
+	}
+	ut_assertok(gpt_restore(desc, str_disk_guid, parts, ARRAY_SIZE(parts)));
+
+	/* the first partition with a name is found */
+	ut_asserteq(1, part_get_info_by_name(desc, "test1", &info));
+	ut_asserteq(48, info.start);
+	ut_asserteq(2, part_get_info_by_name(desc, "test2", &info));
+	ut_asserteq(49, info.start);
+	ut_asserteq(-ENOENT, part_get_info_by_name(desc, "test3", &info));
+
+	/*
+	 * Wipe both GPT headers behind the block layer's back, so that only
+	 * the cached GPT remains usable
+	 */
+	buf = calloc(1, desc->blksz);
+	ut_assertnonnull(buf);
+	ops = device_get_ops(desc->bdev);
+	ut_asserteq(1, ops->write(desc->bdev, 1, 1, buf));
+	ut_asserteq(1, ops->write(desc->bdev, desc->lba - 1, 1, buf));
+	ut_asserteq(2, part_get_info_by_name(desc, "test2", &info));
+	ut_assertok(part_get_info(desc, 3, &info));
+	ut_asserteq(50, info.start);
+
+	/* writing a partition leaves the GPT cached */
+	ut_asserteq(1, blk_dwrite(desc, 48, 1, buf));
+	ut_asserteq(2, part_get_info_by_name(desc, "test2", &info));
+
+	/* writing the GPT area drops it */
+	ut_asserteq(1, blk_dwrite(desc, 1, 1, buf));
+	ut_asserteq(-ENOENT, part_get_info_by_name(desc, "test2", &info));
+	ut_assert(part_get_info(desc, 3, &info));
+	free(buf);
+
+	ut_assertok(gpt_restore(desc, str_disk_guid, parts, ARRAY_SIZE(parts)));
+	ut_asserteq(2, part_get_info_by_name(desc, "test2", &info));
+
+	return 0;
+}
+DM_TEST(dm_test_part_gpt_cache, UTF_SCAN_PDATA | UTF_SCAN_FDT);
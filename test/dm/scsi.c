@@ -9,6 +9,7 @@
 #include <dm/test.h>
 #include <test/test.h>
 #include <test/ut.h>
+#include "../../drivers/ata/ahci_ncq.h"
 
 /* Test that sandbox SCSI works correctly */
 static int dm_test_scsi_base(struct unit_test_state *uts)
@@ -36,3 +37,41 @@ static int dm_test_scsi_base(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_scsi_base, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
+/* Test setting up AHCI NCQ commands and sharing a transfer between slots */
+static int dm_test_scsi_ahci_ncq(struct unit_test_state *uts)
+{
+	const u8 expect[AHCI_NCQ_FIS_LEN] = {
+		0x27, 0x80, ATA_CMD_FPDMA_WRITE, 0x34, 0x66, 0x55, 0x44, 0x40,
+		0x33, 0x22, 0x11, 0x12, 31 << 3,
+	};
+	u8 fis[AHCI_NCQ_FIS_LEN];
+	u32 counts[32];
+
+	memset(fis, 0xff, sizeof(fis));
+	ahci_ncq_fill_fis(fis, 0x112233445566, 0x1234, 31, true);
+	ut_asserteq_mem(expect, fis, sizeof(fis));
+
+	ahci_ncq_fill_fis(fis, 0x80, 0x100, 2, false);
+	ut_asserteq(ATA_CMD_FPDMA_READ, fis[2]);
+	ut_asserteq(0, fis[3]);
+	ut_asserteq(0x80, fis[4]);
+	ut_asserteq(1, fis[11]);
+	ut_asserteq(2 << 3, fis[12]);
+
+	/* the last slot takes what is left over */
+	ut_asserteq(0x7, ahci_ncq_split(0x150, 8, 0x80, counts));
+	ut_asserteq(0x80, counts[0]);
+	ut_asserteq(0x80, counts[1]);
+	ut_asserteq(0x50, counts[2]);
+
+	/* a transfer larger than all the slots fills each of them */
+	ut_asserteq(0xffffffff, ahci_ncq_split(0x10000, 32, 0x80, counts));
+	ut_asserteq(0x80, counts[0]);
+	ut_asserteq(0x80, counts[31]);
+	ut_asserteq(0xf, ahci_ncq_split(0x10000, 4, 0x80, counts));
+	ut_asserteq(0, ahci_ncq_split(0, 4, 0x80, counts));
+
+	return 0;
+}
+DM_TEST(dm_test_scsi_ahci_ncq, 0);
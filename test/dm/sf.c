@@ -10,6 +10,7 @@
 #include <os.h>
 #include <spi.h>
 #include <spi_flash.h>
+#include <time.h>
 #include <asm/state.h>
 #include <asm/test.h>
 #include <dm/test.h>
@@ -74,6 +75,52 @@ static int dm_test_spi_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_spi_flash, UTF_SCAN_PDATA | UTF_SCAN_FDT);
 
+/* Check that reads use the direct mapping and compare read sizes */
+static int dm_test_spi_flash_dirmap(struct unit_test_state *uts)
+{
+	int full_size = 0x200000;
+	struct spi_flash *flash;
+	struct udevice *dev;
+	ulong start, whole, pages;
+	u8 *src, *dst;
+	int i;
+
+	if (!CONFIG_IS_ENABLED(SPI_DIRMAP))
+		return -EAGAIN;
+
+	src = map_sysmem(0x20000, full_size);
+	ut_assertok(os_write_file("spi.bin", src, full_size));
+	ut_assertok(uclass_first_device_err(UCLASS_SPI_FLASH, &dev));
+	flash = dev_get_uclass_priv(dev);
+	ut_assertnonnull(flash->dirmap.rdesc);
+	ut_assertnonnull(flash->dirmap.wdesc);
+
+	dst = map_sysmem(0x20000 + full_size, full_size);
+	start = timer_get_us();
+	ut_assertok(spi_flash_read_dm(dev, 0, full_size, dst));
+	whole = timer_get_us() - start;
+	ut_asserteq_mem(src, dst, full_size);
+
+	memset(dst, '\0', full_size);
+	start = timer_get_us();
+	for (i = 0; i < full_size; i += 0x100)
+		ut_assertok(spi_flash_read_dm(dev, i, 0x100, dst + i));
+	pages = timer_get_us() - start;
+	ut_asserteq_mem(src, dst, full_size);
+
+	printf("read %x bytes: %lu us in one go, %lu us in pages\n",
+	       full_size, whole, pages);
+
+	/*
+	 * Since we are about to destroy all devices, we must tell sandbox
+	 * to forget the emulation device
+	 */
+	sandbox_sf_unbind_emul(state_get_current(), 0, 0);
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_dirmap, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
 /* Functional test that sandbox SPI flash works correctly */
 static int dm_test_spi_flash_func(struct unit_test_state *uts)
 {
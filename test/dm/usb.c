@@ -84,6 +84,65 @@ static int dm_test_usb_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_usb_flash, UTF_SCAN_PDATA | UTF_SCAN_FDT);
 
+/* Test that transfers show up in the statistics from 'usb storage' */
+static int dm_test_usb_flash_stats(struct unit_test_state *uts)
+{
+	struct udevice *dev, *blk;
+	char buf[1024];
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_assertok(device_find_first_child_by_uclass(dev, UCLASS_BLK, &blk));
+	ut_asserteq(2, blk_read(blk, 0, 2, buf));
+	ut_asserteq(2, blk_write(blk, 0, 2, buf));
+
+	/* probing reads the partition table, so only the writes are known */
+	console_record_reset_enable();
+	ut_assertok(run_command("usb storage", 0));
+	ut_assert_skip_to_linen("            Max transfer: ");
+	ut_assert_nextlinen("            Read: ");
+	ut_assert_nextlinen("            Write: 1 commands, 1 KiB, ");
+
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_flash_stats, UTF_SCAN_PDATA | UTF_SCAN_FDT | UTF_CONSOLE);
+
+/* Test a write whose data phase stalls, with the CSW queued behind it */
+static int dm_test_usb_flash_stall(struct unit_test_state *uts)
+{
+	struct udevice *dev, *blk, *emul;
+	char buf[512];
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_assertok(device_find_first_child_by_uclass(dev, UCLASS_BLK, &blk));
+	ut_assertok(usb_emul_find_for_dev(dev, &emul));
+
+	/*
+	 * The CSW reporting the failure arrives along with the stall, so the
+	 * write is retried without resetting the device
+	 */
+	strcpy(buf, "stalled test");
+	sandbox_flash_stall_write(emul);
+	ut_asserteq(1, blk_write(blk, 1, 1, buf));
+	memset(buf, '\0', sizeof(buf));
+	ut_asserteq(1, blk_read(blk, 1, 1, buf));
+	ut_asserteq_str("stalled test", buf);
+	ut_asserteq(0, sandbox_flash_get_resets(emul));
+
+	memset(buf, '\0', sizeof(buf));
+	ut_asserteq(1, blk_write(blk, 1, 1, buf));
+
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_flash_stall, UTF_SCAN_PDATA | UTF_SCAN_FDT);
+
 /* test that we can handle multiple storage devices */
 static int dm_test_usb_multi(struct unit_test_state *uts)
 {
@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Tests for looking up variables in the default environment
+ */
+
+#include <env.h>
+#include <env_internal.h>
+#include <test/env.h>
+#include <test/ut.h>
+
+/* Check whether a variable is also defined before entry p */
+static bool defined_before(const char *p, const char *name, int len)
+{
+	const char *q;
+
+	for (q = default_environment; q < p; q += strlen(q) + 1) {
+		if (!strncmp(q, name, len) && q[len] == '=')
+			return true;
+	}
+
+	return false;
+}
+
+static int env_test_default_lookup(struct unit_test_state *uts)
+{
+	const char *p;
+	char buf[256];
+	int found = 0;
+
+	for (p = default_environment; *p; p += strlen(p) + 1) {
+		const char *eq = strchr(p, '=');
+		char name[64];
+
+		if (!eq || eq - p >= sizeof(name) ||
+		    strlen(eq + 1) >= sizeof(buf))
+			continue;
+		strlcpy(name, p, eq - p + 1);
+
+		/* the first definition of a variable wins */
+		if (defined_before(p, name, eq - p))
+			continue;
+		ut_asserteq(strlen(eq + 1),
+			    env_get_default_into(name, buf, sizeof(buf)));
+		ut_asserteq_str(eq + 1, buf);
+		found++;
+	}
+	ut_assert(found > 0);
+
+	ut_asserteq(-1, env_get_default_into("no-such-variable", buf,
+					     sizeof(buf)));
+	ut_asserteq(-1, env_get_default_into("", buf, sizeof(buf)));
+
+	return 0;
+}
+ENV_TEST(env_test_default_lookup, 0);
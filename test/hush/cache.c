@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Tests for the cache of parsed scripts in the old hush parser
+ */
+
+#include <cli_hush.h>
+#include <command.h>
+#include <env.h>
+#include <time.h>
+#include <test/hush.h>
+#include <test/ut.h>
+#include <asm/global_data.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* A cut-down version of distro_bootcmd, which finds nothing to boot */
+static const char *const bench_env[][2] = {
+	{ "cache_targets", "mmc0 mmc1 mmc2 usb0 pxe dhcp" },
+	{ "cache_prefixes", "/ /boot/" },
+	{ "cache_scripts", "boot.scr.uimg boot.scr" },
+	{ "cache_parts", "1 2 3 4" },
+	{ "cache_bootcmd",
+	  "for target in ${cache_targets}; do run cache_boot_${target}; done" },
+	{ "cache_boot_mmc0", "cache_devnum=0; run cache_mmc_boot" },
+	{ "cache_boot_mmc1", "cache_devnum=1; run cache_mmc_boot" },
+	{ "cache_boot_mmc2", "cache_devnum=2; run cache_mmc_boot" },
+	{ "cache_boot_usb0", "cache_devnum=0; run cache_usb_boot" },
+	{ "cache_boot_pxe", "run cache_net_boot" },
+	{ "cache_boot_dhcp", "run cache_net_boot" },
+	{ "cache_mmc_boot",
+	  "if test -n \"${cache_devnum}\"; then cache_devtype=mmc; "
+	  "run cache_scan_dev; fi" },
+	{ "cache_usb_boot", "cache_devtype=usb; run cache_scan_dev" },
+	{ "cache_net_boot",
+	  "if test -n \"${cache_found}\"; then echo net; fi" },
+	{ "cache_scan_dev",
+	  "for cache_part in ${cache_parts}; do "
+	  "if test -z \"${cache_found}\"; then run cache_scan_part; fi; done" },
+	{ "cache_scan_part",
+	  "for prefix in ${cache_prefixes}; do run cache_scan_extlinux; "
+	  "run cache_scan_scripts; done" },
+	{ "cache_scan_extlinux",
+	  "if test -n \"${cache_found}\"; then "
+	  "echo ${cache_devtype} ${prefix}extlinux/extlinux.conf; fi" },
+	{ "cache_scan_scripts",
+	  "for script in ${cache_scripts}; do "
+	  "if test -n \"${cache_found}\"; then "
+	  "echo ${cache_devtype} ${prefix}${script}; fi; done" },
+};
+
+static int hush_test_cache(struct unit_test_state *uts)
+{
+	if (!(gd->flags & GD_FLG_HUSH_OLD_PARSER))
+		return -EAGAIN;
+
+	ut_assertok(env_set("cache_cmd", "echo first"));
+	ut_assertok(run_command("run cache_cmd", 0));
+	ut_assert_nextline("first");
+	ut_assertok(run_command("run cache_cmd", 0));
+	ut_assert_nextline("first");
+
+	/* changing the variable must cause it to be parsed again */
+	ut_assertok(env_set("cache_cmd", "echo second"));
+	ut_assertok(run_command("run cache_cmd", 0));
+	ut_assert_nextline("second");
+
+	/* variables changed by the script must be seen by the script */
+	ut_assertok(env_set("cache_cmd",
+			    "setenv cache_val 1; echo ${cache_val}; "
+			    "setenv cache_val 2; echo ${cache_val}"));
+	ut_assertok(run_command("run cache_cmd", 0));
+	ut_assert_nextline("1");
+	ut_assert_nextline("2");
+	ut_assertok(run_command("run cache_cmd", 0));
+	ut_assert_nextline("1");
+	ut_assert_nextline("2");
+
+	/* a script which replaces itself and runs again */
+	ut_assertok(env_set("cache_cmd",
+			    "echo old; setenv cache_cmd echo new; run cache_cmd"));
+	ut_assertok(run_command("run cache_cmd", 0));
+	ut_assert_nextline("old");
+	ut_assert_nextline("new");
+
+	/* running a loop must not change it */
+	ut_assertok(env_set("cache_cmd", "for i in a b; do echo $i; done"));
+	ut_assertok(run_command("run cache_cmd", 0));
+	ut_assert_nextline("a");
+	ut_assert_nextline("b");
+	ut_assertok(run_command("run cache_cmd", 0));
+	ut_assert_nextline("a");
+	ut_assert_nextline("b");
+	ut_assert_console_end();
+
+	ut_assertok(env_set("cache_cmd", NULL));
+	ut_assertok(env_set("cache_val", NULL));
+
+	return 0;
+}
+HUSH_TEST(hush_test_cache, UTF_CONSOLE);
+
+/* Compare the time taken to run a boot script with and without the cache */
+static int hush_test_cache_bench(struct unit_test_state *uts)
+{
+	ulong elapsed[2];
+	int pass, i;
+
+	if (!(gd->flags & GD_FLG_HUSH_OLD_PARSER))
+		return -EAGAIN;
+
+	for (i = 0; i < ARRAY_SIZE(bench_env); i++)
+		ut_assertok(env_set(bench_env[i][0], bench_env[i][1]));
+
+	for (pass = 0; pass < 2; pass++) {
+		ulong start;
+
+		hush_parse_cache_enable(pass);
+		start = timer_get_us();
+		for (i = 0; i < 20; i++)
+			ut_assertok(run_command("run cache_bootcmd", 0));
+		elapsed[pass] = timer_get_us() - start;
+	}
+	hush_parse_cache_enable(true);
+	ut_assert_console_end();
+
+	printf("cache off: %lu us, cache on: %lu us\n", elapsed[0],
+	       elapsed[1]);
+
+	for (i = 0; i < ARRAY_SIZE(bench_env); i++)
+		ut_assertok(env_set(bench_env[i][0], NULL));
+
+	return 0;
+}
+HUSH_TEST(hush_test_cache_bench, UTF_CONSOLE);
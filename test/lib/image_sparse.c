@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for writing Android sparse images
+ */
+
+#include <image-sparse.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <asm/cache.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define DISK_BLKSZ	512
+#define DISK_BLKS	64
+#define DISK_START	4
+#define SPARSE_BLKSZ	1024
+#define ERASE_GRP	8
+
+/**
+ * struct sparse_test - state of a test storage device
+ *
+ * @disk: Contents of the device
+ * @last_buf: Buffer passed to the last write
+ * @erase_start: First block passed to the erase hook
+ * @erase_count: Number of blocks passed to the erase hook
+ * @erase_calls: Number of calls to the erase hook
+ */
+struct sparse_test {
+	u8 disk[DISK_BLKS * DISK_BLKSZ];
+	const void *last_buf;
+	lbaint_t erase_start;
+	lbaint_t erase_count;
+	int erase_calls;
+};
+
+static lbaint_t test_sparse_write(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt, const void *buffer)
+{
+	struct sparse_test *st = info->priv;
+
+	memcpy(st->disk + blk * DISK_BLKSZ, buffer, blkcnt * DISK_BLKSZ);
+	st->last_buf = buffer;
+
+	return blkcnt;
+}
+
+static lbaint_t test_sparse_reserve(struct sparse_storage *info,
+				    lbaint_t blk, lbaint_t blkcnt)
+{
+	return blkcnt;
+}
+
+static lbaint_t test_sparse_erase(struct sparse_storage *info, lbaint_t blk,
+				  lbaint_t blkcnt)
+{
+	struct sparse_test *st = info->priv;
+
+	memset(st->disk + blk * DISK_BLKSZ, '\0', blkcnt * DISK_BLKSZ);
+	st->erase_start = blk;
+	st->erase_count = blkcnt;
+	st->erase_calls++;
+
+	return blkcnt;
+}
+
+static void *add_chunk(void *ptr, u16 type, u32 blks, u32 data_sz)
+{
+	chunk_header_t *hdr = ptr;
+
+	hdr->chunk_type = type;
+	hdr->reserved1 = 0;
+	hdr->chunk_sz = blks;
+	hdr->total_sz = sizeof(*hdr) + data_sz;
+
+	return ptr + sizeof(*hdr);
+}
+
+/*
+ * Build an image with an unaligned raw chunk, a fill, a zero fill, a don't
+ * care and a raw chunk whose data is aligned for DMA. Returns the address of
+ * the aligned raw data.
+ */
+static void *build_image(void *buf, void **imagep)
+{
+	const ulong last_raw = sizeof(sparse_header_t) +
+		sizeof(chunk_header_t) * 5 + 2 * SPARSE_BLKSZ + 4 + 4;
+	sparse_header_t *hdr;
+	void *ptr, *raw;
+	int i;
+
+	/* place the image so that the data of the last chunk is aligned */
+	ptr = buf + (ARCH_DMA_MINALIGN - last_raw % ARCH_DMA_MINALIGN) %
+		ARCH_DMA_MINALIGN;
+	*imagep = ptr;
+
+	hdr = ptr;
+	hdr->magic = SPARSE_HEADER_MAGIC;
+	hdr->major_version = 1;
+	hdr->minor_version = 0;
+	hdr->file_hdr_sz = sizeof(sparse_header_t);
+	hdr->chunk_hdr_sz = sizeof(chunk_header_t);
+	hdr->blk_sz = SPARSE_BLKSZ;
+	hdr->total_blks = 2 + 3 + 10 + 2 + 1;
+	hdr->total_chunks = 5;
+	hdr->image_checksum = 0;
+	ptr += sizeof(*hdr);
+
+	ptr = add_chunk(ptr, CHUNK_TYPE_RAW, 2, 2 * SPARSE_BLKSZ);
+	for (i = 0; i < 2 * SPARSE_BLKSZ; i++)
+		*(u8 *)ptr++ = i;
+	ptr = add_chunk(ptr, CHUNK_TYPE_FILL, 3, 4);
+	*(u32 *)ptr = 0x12345678;
+	ptr += 4;
+	ptr = add_chunk(ptr, CHUNK_TYPE_FILL, 10, 4);
+	*(u32 *)ptr = 0;
+	ptr += 4;
+	ptr = add_chunk(ptr, CHUNK_TYPE_DONT_CARE, 2, 0);
+	ptr = add_chunk(ptr, CHUNK_TYPE_RAW, 1, SPARSE_BLKSZ);
+	raw = ptr;
+	memset(raw, 0x5a, SPARSE_BLKSZ);
+
+	return raw;
+}
+
+static int check_disk(struct unit_test_state *uts, struct sparse_test *st)
+{
+	u8 *disk = st->disk;
+	int i;
+
+	for (i = 0; i < DISK_START * DISK_BLKSZ; i++)
+		ut_asserteq(0xaa, disk[i]);
+	disk += DISK_START * DISK_BLKSZ;
+
+	for (i = 0; i < 2 * SPARSE_BLKSZ; i++)
+		ut_asserteq((u8)i, disk[i]);
+	disk += 2 * SPARSE_BLKSZ;
+	for (i = 0; i < 3 * SPARSE_BLKSZ; i += 4)
+		ut_asserteq(0x12345678, *(u32 *)(disk + i));
+	disk += 3 * SPARSE_BLKSZ;
+	for (i = 0; i < 10 * SPARSE_BLKSZ; i++)
+		ut_asserteq(0, disk[i]);
+	disk += 10 * SPARSE_BLKSZ;
+	for (i = 0; i < 2 * SPARSE_BLKSZ; i++)
+		ut_asserteq(0xaa, disk[i]);
+	disk += 2 * SPARSE_BLKSZ;
+	for (i = 0; i < SPARSE_BLKSZ; i++)
+		ut_asserteq(0x5a, disk[i]);
+
+	return 0;
+}
+
+static int run_sparse_test(struct unit_test_state *uts, bool erase)
+{
+	struct sparse_storage info = {};
+	struct sparse_test *st;
+	void *buf, *image, *raw;
+	char line[64];
+
+	st = calloc(1, sizeof(*st));
+	ut_assertnonnull(st);
+	memset(st->disk, 0xaa, sizeof(st->disk));
+	buf = malloc_cache_aligned(20 * SPARSE_BLKSZ);
+	ut_assertnonnull(buf);
+	raw = build_image(buf, &image);
+	ut_assert(is_sparse_image(image));
+
+	info.blksz = DISK_BLKSZ;
+	info.start = DISK_START;
+	info.size = DISK_BLKS - DISK_START;
+	info.priv = st;
+	info.write = test_sparse_write;
+	info.reserve = test_sparse_reserve;
+	if (erase) {
+		info.erase = test_sparse_erase;
+		info.erase_grp = ERASE_GRP;
+	}
+	ut_assertok(write_sparse_image(&info, "test", image, NULL));
+	ut_assertok(check_disk(uts, st));
+
+	/* the aligned raw chunk is written without a copy */
+	ut_asserteq_ptr(raw, st->last_buf);
+
+	/* only the aligned middle of the zero fill is erased */
+	if (erase) {
+		ut_asserteq(1, st->erase_calls);
+		ut_asserteq(16, st->erase_start);
+		ut_asserteq(16, st->erase_count);
+	} else {
+		ut_asserteq(0, st->erase_calls);
+	}
+
+	ut_asserteq(2, info.stats[SPARSE_STAT_RAW].chunks);
+	ut_asserteq(3 * SPARSE_BLKSZ, info.stats[SPARSE_STAT_RAW].bytes);
+	ut_asserteq(1, info.stats[SPARSE_STAT_FILL].chunks);
+	ut_asserteq(3 * SPARSE_BLKSZ, info.stats[SPARSE_STAT_FILL].bytes);
+	ut_asserteq(1, info.stats[SPARSE_STAT_ZERO].chunks);
+	ut_asserteq(10 * SPARSE_BLKSZ, info.stats[SPARSE_STAT_ZERO].bytes);
+	ut_asserteq(1, info.stats[SPARSE_STAT_SKIP].chunks);
+	ut_asserteq(2 * SPARSE_BLKSZ, info.stats[SPARSE_STAT_SKIP].bytes);
+
+	info.stats[SPARSE_STAT_ZERO].time_ms = 0;
+	sparse_stat_format(&info, SPARSE_STAT_ZERO, line, sizeof(line));
+	ut_asserteq_str("zero: 1 chunks, 10 KiB in 0 ms", line);
+	info.stats[SPARSE_STAT_ZERO].time_ms = 5;
+	sparse_stat_format(&info, SPARSE_STAT_ZERO, line, sizeof(line));
+	ut_asserteq_str("zero: 1 chunks, 10 KiB in 5 ms (2000 KiB/s)", line);
+
+	free(buf);
+	free(st);
+
+	return 0;
+}
+
+/* Test writing a sparse image, with zero fills written out */
+static int lib_test_sparse_write(struct unit_test_state *uts)
+{
+	return run_sparse_test(uts, false);
+}
+LIB_TEST(lib_test_sparse_write, 0);
+
+/* Test writing a sparse image, with zero fills erased */
+static int lib_test_sparse_erase(struct unit_test_state *uts)
+{
+	return run_sparse_test(uts, true);
+}
+LIB_TEST(lib_test_sparse_erase, 0);
@@ -11,7 +11,10 @@
 #include <test/lib.h>
 #include <test/test.h>
 #include <test/ut.h>
+#include <time.h>
 #include <u-boot/rsa.h>
+#include <u-boot/rsa-mod-exp.h>
+#include <u-boot/sha256.h>
 
 #ifdef CONFIG_RSA_VERIFY_WITH_PKEY
 /*
@@ -200,4 +203,181 @@ static int lib_rsa_verify_invalid(struct unit_test_state *uts)
 	return CMD_RET_SUCCESS;
 }
 LIB_TEST(lib_rsa_verify_invalid, 0);
+#if CONFIG_IS_ENABLED(RSA_SOFTWARE_EXP)
+/*
+ * openssl genrsa 3072 -out private3072.pem
+ * openssl rsa -in private3072.pem -pubout -outform der -out public3072.der
+ * dd if=public3072.der of=public3072.raw bs=24 skip=1
+ */
+static unsigned char public_key_3072[] = {
+	0x30, 0x82, 0x01, 0x8a, 0x02, 0x82, 0x01, 0x81, 0x00, 0xc6, 0xab, 0xfd,
+	0xa7, 0x68, 0x3c, 0x85, 0x79, 0x16, 0x87, 0x18, 0x21, 0xf7, 0xd8, 0xa4,
+	0xea, 0x43, 0x99, 0x8d, 0xa1, 0x3b, 0x2c, 0xec, 0x4d, 0xa1, 0x6c, 0x75,
+	0x13, 0xe1, 0xa6, 0xa4, 0xf2, 0xc9, 0x37, 0x36, 0x23, 0x43, 0x4d, 0xe2,
+	0x63, 0x7f, 0x25, 0x41, 0x11, 0xd9, 0x6d, 0x88, 0x60, 0xb1, 0xd7, 0x02,
+	0xfb, 0x77, 0xb1, 0x9e, 0xfb, 0x0c, 0xde, 0x2a, 0x33, 0x2a, 0x90, 0x00,
+	0x37, 0x89, 0xfe, 0xe2, 0xcd, 0xfa, 0x30, 0xfa, 0xe2, 0xa7, 0xe1, 0x0c,
+	0xa5, 0xd1, 0x6e, 0xc8, 0xe5, 0xa1, 0x9b, 0x00, 0x0d, 0xcc, 0x1f, 0xb9,
+	0x09, 0x41, 0xa6, 0xf3, 0xec, 0x15, 0x1e, 0xef, 0x87, 0xd7, 0xe8, 0xc2,
+	0x15, 0x9c, 0x44, 0x18, 0xfc, 0xb6, 0x9d, 0x12, 0xd7, 0xc7, 0x81, 0x2f,
+	0x17, 0x31, 0xcc, 0x4d, 0x1f, 0xdb, 0x5a, 0x49, 0xdc, 0x5c, 0xbd, 0x5f,
+	0x0b, 0xbf, 0xf3, 0x44, 0xb1, 0x91, 0x3c, 0xd3, 0x99, 0x60, 0x8b, 0x4a,
+	0xc5, 0xc1, 0x1b, 0x9b, 0x23, 0x4b, 0x47, 0x5b, 0x09, 0x40, 0xf1, 0x46,
+	0xab, 0x2f, 0x39, 0x0c, 0xf3, 0x76, 0xb6, 0xdc, 0xb7, 0x03, 0x01, 0x70,
+	0x78, 0x69, 0x00, 0xf7, 0xc2, 0xe1, 0x63, 0x04, 0x3d, 0x56, 0x85, 0x0e,
+	0x3b, 0x38, 0xb6, 0x0e, 0x3d, 0xbf, 0xc0, 0x6a, 0x08, 0x58, 0x3d, 0xf1,
+	0xd0, 0x79, 0x1c, 0x08, 0xcb, 0x9a, 0xc1, 0x19, 0x8a, 0xfe, 0x85, 0x93,
+	0x57, 0x9d, 0xc2, 0xc1, 0xe7, 0xf4, 0xe3, 0x3a, 0xaf, 0x66, 0x67, 0x8c,
+	0x46, 0x82, 0x9f, 0x7e, 0x7a, 0x5d, 0x64, 0x7c, 0x86, 0xad, 0x22, 0xec,
+	0x68, 0xec, 0x62, 0x04, 0x1a, 0xbf, 0xf9, 0x4d, 0x3b, 0x5b, 0xae, 0xc6,
+	0xbd, 0xc4, 0xe7, 0x48, 0x17, 0xb5, 0xd7, 0x46, 0xb3, 0xd6, 0x84, 0x0d,
+	0x7e, 0xe4, 0x33, 0x25, 0x2f, 0x14, 0xb9, 0x77, 0x33, 0xad, 0x70, 0x7d,
+	0x5f, 0x06, 0x22, 0x0f, 0xfd, 0x15, 0x53, 0xe3, 0x46, 0x0a, 0x21, 0x54,
+	0x4c, 0x16, 0x5d, 0xf2, 0x77, 0x0e, 0xdc, 0x86, 0x23, 0x1d, 0x9d, 0xde,
+	0x92, 0x22, 0x50, 0xac, 0x10, 0xc9, 0x57, 0xd2, 0x77, 0xfd, 0xdd, 0xc9,
+	0x0f, 0xa7, 0xd1, 0xe7, 0x1c, 0xee, 0x02, 0x78, 0x86, 0xe8, 0x35, 0x43,
+	0xd3, 0xeb, 0xfd, 0x82, 0x06, 0xc5, 0x9c, 0x1d, 0xf9, 0x3e, 0x8c, 0xe7,
+	0x1c, 0xc8, 0xd7, 0x6b, 0xd2, 0x22, 0xe5, 0xc4, 0x0d, 0xf0, 0xa2, 0xc1,
+	0x42, 0x99, 0x33, 0x8d, 0x3e, 0xf9, 0xcc, 0x9d, 0x9d, 0x58, 0x24, 0x21,
+	0xd5, 0xfd, 0xbd, 0x1c, 0xb8, 0x69, 0x5d, 0x38, 0xd6, 0x21, 0xfe, 0x22,
+	0x5c, 0x58, 0x02, 0x4e, 0x87, 0x2a, 0x75, 0xb3, 0xb3, 0x3b, 0xd5, 0xfe,
+	0x10, 0x61, 0x32, 0xdb, 0x13, 0xb1, 0xa0, 0xdb, 0xd1, 0x76, 0x91, 0xeb,
+	0xb0, 0xe2, 0x7d, 0xa4, 0xf0, 0x77, 0x42, 0xe7, 0x29, 0x02, 0x03, 0x01,
+	0x00, 0x01
+};
+
+/*
+ * openssl genrsa 4096 -out private4096.pem
+ * openssl rsa -in private4096.pem -pubout -outform der -out public4096.der
+ * dd if=public4096.der of=public4096.raw bs=24 skip=1
+ */
+static unsigned char public_key_4096[] = {
+	0x30, 0x82, 0x02, 0x0a, 0x02, 0x82, 0x02, 0x01, 0x00, 0xae, 0xc1, 0x42,
+	0x00, 0x69, 0x87, 0x9d, 0x10, 0xbc, 0xc0, 0x4e, 0xe3, 0xf7, 0xb7, 0x05,
+	0x7d, 0x5e, 0x10, 0x94, 0x44, 0x59, 0xcc, 0x5d, 0x42, 0xe3, 0x3e, 0xac,
+	0x04, 0xd7, 0x33, 0x67, 0xcf, 0xfc, 0xc8, 0xa1, 0x3f, 0x9d, 0x3d, 0xd9,
+	0xfe, 0x40, 0x5f, 0x2b, 0x04, 0x25, 0xdc, 0x89, 0x56, 0x3d, 0x1d, 0x68,
+	0x34, 0x0a, 0x05, 0x47, 0x0f, 0x68, 0xaf, 0x6f, 0xaf, 0xe1, 0x0f, 0xbc,
+	0x1d, 0x57, 0x69, 0x27, 0x0f, 0xe3, 0xf8, 0x09, 0x2c, 0x85, 0x2b, 0x29,
+	0x4e, 0x43, 0x6f, 0xf0, 0xcf, 0x2a, 0x89, 0xaa, 0xba, 0xf2, 0x99, 0x29,
+	0xf9, 0x64, 0x45, 0x3a, 0xeb, 0xaa, 0xdd, 0x75, 0xbd, 0x7e, 0x2f, 0x60,
+	0x91, 0x3d, 0x88, 0xee, 0x11, 0xcf, 0x40, 0xa5, 0xd0, 0x25, 0xad, 0xcb,
+	0xec, 0x49, 0x51, 0x69, 0xc5, 0xb6, 0xfc, 0xf9, 0x95, 0x03, 0x72, 0xa6,
+	0x92, 0x95, 0x55, 0xc3, 0x61, 0x9d, 0x2d, 0xd5, 0x01, 0xbc, 0xc8, 0x6b,
+	0x66, 0x70, 0x64, 0x77, 0xfe, 0x78, 0x6a, 0x37, 0x72, 0x2b, 0xb7, 0x82,
+	0x0f, 0xb1, 0x32, 0x38, 0xc0, 0xac, 0xca, 0x7d, 0xb6, 0x39, 0x3d, 0xa7,
+	0x7d, 0x9f, 0xcb, 0x20, 0xd4, 0xbb, 0xbf, 0x9d, 0xdd, 0xbe, 0x7d, 0x3a,
+	0xa8, 0x57, 0xbb, 0x83, 0x60, 0x59, 0x20, 0x35, 0xb9, 0x2e, 0x95, 0x18,
+	0x52, 0x1d, 0x7a, 0x37, 0xd5, 0x06, 0x68, 0xbc, 0xc9, 0x33, 0xd4, 0x3e,
+	0x6e, 0xac, 0xcf, 0xc0, 0x56, 0xdd, 0x07, 0x16, 0xd8, 0x2d, 0x28, 0x50,
+	0xf5, 0x78, 0x74, 0x20, 0x7b, 0x67, 0xa3, 0xe1, 0x97, 0x9f, 0x8c, 0xc4,
+	0x26, 0xac, 0xf9, 0xfc, 0x01, 0x05, 0x5d, 0x3e, 0x5d, 0x99, 0xe2, 0x32,
+	0x0f, 0x49, 0xd7, 0x50, 0xc5, 0xc4, 0x43, 0x74, 0xde, 0xcb, 0x77, 0x4c,
+	0xc8, 0xa8, 0x52, 0x29, 0xd4, 0x77, 0x12, 0xa9, 0xfc, 0x91, 0xad, 0xfe,
+	0x95, 0x85, 0x28, 0x4c, 0xa3, 0x80, 0x2c, 0xab, 0xb6, 0x64, 0xf6, 0x99,
+	0x42, 0x17, 0x9c, 0x9d, 0x83, 0xb2, 0xdc, 0xd6, 0xa0, 0x40, 0x7e, 0xfd,
+	0x46, 0xeb, 0xcd, 0xfe, 0xf3, 0x11, 0xfd, 0x79, 0x92, 0x0e, 0x5a, 0xec,
+	0x4f, 0xe2, 0xf3, 0x8e, 0x7f, 0x88, 0xe6, 0x90, 0x8c, 0x58, 0xd9, 0x32,
+	0x66, 0xf5, 0xaa, 0xeb, 0xcd, 0x4d, 0x5e, 0xeb, 0x67, 0x44, 0x5c, 0x9f,
+	0xa4, 0x82, 0x1a, 0x7f, 0x63, 0xdf, 0x3a, 0x1c, 0x13, 0x89, 0x99, 0x43,
+	0xaa, 0xae, 0xac, 0x42, 0x5f, 0xc9, 0x34, 0xbc, 0x95, 0x9a, 0x7b, 0xf7,
+	0x9e, 0x86, 0x2e, 0x6c, 0xc4, 0xca, 0x65, 0x69, 0xaf, 0xfc, 0x8f, 0xb0,
+	0x4c, 0x76, 0xdf, 0x2e, 0x83, 0x93, 0x3e, 0x61, 0xf3, 0x28, 0xc2, 0x2e,
+	0x98, 0x9d, 0x75, 0x34, 0x62, 0x20, 0x5b, 0x3e, 0x04, 0x21, 0x19, 0xa6,
+	0x58, 0x24, 0x8e, 0x47, 0x6b, 0x60, 0x31, 0xeb, 0x65, 0xa3, 0xf7, 0x46,
+	0x6f, 0x6c, 0x0a, 0xad, 0x87, 0x25, 0x53, 0x7b, 0x45, 0xc6, 0x5b, 0xff,
+	0xb5, 0xcf, 0x46, 0xe2, 0x7d, 0xd6, 0x1c, 0x7d, 0x73, 0xeb, 0xe5, 0x4b,
+	0xfb, 0x44, 0x71, 0xc8, 0xb2, 0xc1, 0xaf, 0x63, 0xe8, 0xda, 0xb2, 0x2e,
+	0xaf, 0x60, 0x49, 0x88, 0x06, 0xe1, 0x4c, 0x18, 0x26, 0x1a, 0xc6, 0x8b,
+	0xcd, 0x71, 0xe1, 0xcb, 0xe2, 0xfd, 0x1e, 0xbd, 0xc6, 0x5c, 0x91, 0x75,
+	0x12, 0x35, 0x92, 0xdb, 0x3c, 0x66, 0x59, 0x51, 0x80, 0x64, 0xfe, 0x9b,
+	0x08, 0xda, 0xf9, 0x3b, 0xe4, 0x55, 0x23, 0xc6, 0xc3, 0xcc, 0xef, 0x39,
+	0xd4, 0x88, 0xfc, 0x2c, 0xc4, 0xdd, 0xfc, 0xb0, 0xea, 0x05, 0xc2, 0x74,
+	0x78, 0x5f, 0x3b, 0xbe, 0xdf, 0xd9, 0x80, 0xc5, 0xae, 0x3c, 0xde, 0x66,
+	0x34, 0x32, 0x6c, 0xed, 0x18, 0xcd, 0x22, 0x7a, 0xb0, 0xaa, 0x81, 0xfa,
+	0x19, 0xdd, 0xb5, 0xe1, 0x13, 0x02, 0x03, 0x01, 0x00, 0x01
+};
+
+/* Number of times to repeat each exponentiation when timing it */
+#define MOD_EXP_LOOPS	20
+
+/*
+ * Keys for lib_rsa_mod_exp_bench(), with the SHA256 digest of the result of
+ * exponentiating mod_exp_input() with each
+ */
+static const struct {
+	const unsigned char *key;
+	uint key_len;
+	int num_bits;
+	u8 digest[SHA256_SUM_LEN];
+} mod_exp_keys[] = {
+	{ public_key, sizeof(public_key), 2048, {
+		0x50, 0x9b, 0xb9, 0x4e, 0x05, 0x20, 0x3e, 0x79,
+		0x82, 0xbd, 0x32, 0x39, 0xb5, 0xa7, 0x18, 0x74,
+		0x97, 0x4b, 0x91, 0x31, 0xb7, 0xd0, 0x39, 0x5d,
+		0x20, 0x47, 0xcf, 0xd6, 0x76, 0xfb, 0xa2, 0x7e } },
+	{ public_key_3072, sizeof(public_key_3072), 3072, {
+		0xc7, 0x96, 0x93, 0x5a, 0x83, 0x45, 0xf8, 0x7c,
+		0xaf, 0x38, 0x26, 0x3c, 0x6b, 0x98, 0x79, 0xd1,
+		0x65, 0xc3, 0xdd, 0x45, 0x44, 0x12, 0x70, 0xb3,
+		0xcd, 0x29, 0x3d, 0x31, 0x9f, 0xd4, 0xcd, 0x5e } },
+	{ public_key_4096, sizeof(public_key_4096), 4096, {
+		0x86, 0x77, 0xac, 0xb9, 0x4d, 0x78, 0x10, 0x24,
+		0xce, 0x01, 0x3c, 0x9a, 0xa7, 0xc6, 0xc8, 0xa2,
+		0x28, 0xac, 0xde, 0x43, 0x23, 0xc0, 0x4b, 0x9e,
+		0xf1, 0xf5, 0x93, 0x5a, 0x3a, 0xfc, 0x89, 0x41 } },
+};
+
+/* Set up a value to exponentiate, which must be less than the modulus */
+static void mod_exp_input(u8 *buf, uint len)
+{
+	uint i;
+
+	buf[0] = 0;
+	for (i = 1; i < len; i++)
+		buf[i] = i * 7 + 1;
+}
+
+/**
+ * lib_rsa_mod_exp_bench() - unit test for software modular exponentiation
+ *
+ * Check the result of rsa_mod_exp_sw() for 2048, 3072 and 4096-bit keys and
+ * show the time taken by each
+ *
+ * @uts:	unit test state
+ * Return:	0 = success, 1 = failure
+ */
+static int lib_rsa_mod_exp_bench(struct unit_test_state *uts)
+{
+	u8 in[RSA_MAX_KEY_BITS / 8], out[RSA_MAX_KEY_BITS / 8];
+	u8 digest[SHA256_SUM_LEN];
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(mod_exp_keys); i++) {
+		struct key_prop *prop;
+		ulong start, elapsed;
+		uint len;
+
+		ut_assertok(rsa_gen_key_prop(mod_exp_keys[i].key,
+					     mod_exp_keys[i].key_len, &prop));
+		ut_asserteq(mod_exp_keys[i].num_bits, prop->num_bits);
+		len = prop->num_bits / 8;
+		mod_exp_input(in, len);
+
+		start = timer_get_us();
+		for (j = 0; j < MOD_EXP_LOOPS; j++)
+			ut_assertok(rsa_mod_exp_sw(in, len, prop, out));
+		elapsed = timer_get_us() - start;
+		sha256_csum_wd(out, len, digest, CHUNKSZ_SHA256);
+		ut_asserteq_mem(mod_exp_keys[i].digest, digest, sizeof(digest));
+
+		printf("rsa%d: %lu us\n", prop->num_bits,
+		       elapsed / MOD_EXP_LOOPS);
+		rsa_free_key_prop(prop);
+	}
+
+	return CMD_RET_SUCCESS;
+}
+LIB_TEST(lib_rsa_mod_exp_bench, 0);
+#endif /* RSA_SOFTWARE_EXP */
 #endif /* RSA_VERIFY_WITH_PKEY */
@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the binary log driver
+ */
+
+#include <bloblist.h>
+#include <console.h>
+#include <log.h>
+#include <test/log.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Check that records are stored and formatted later */
+static int log_test_binary(struct unit_test_state *uts)
+{
+	static const u8 mac[] = { 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc };
+
+	log_binary_clear();
+	ut_assertok(log_device_set_enable(LOG_GET_DRIVER(console), false));
+	log(LOGC_ARCH, LOGL_ERR, "val %d %s %*x %llx%%\n", -42, "str", 4, 0xab,
+	    0x123456789aULL);
+	log(LOGC_EFI, LOGL_WARNING, "mac %pM\n", mac);
+	log(LOGC_ARCH, LOGL_ERR, "part1 ");
+	log(LOGC_CONT, LOGL_CONT, "part%d\n", 2);
+	ut_assertok(log_device_set_enable(LOG_GET_DRIVER(console), true));
+
+	ut_assertok(run_command("log dump -c", 0));
+	ut_assert_nextline("Binary log: 4 records, 0 dropped");
+	ut_assert_skipline();
+	ut_assertnonnull(strstr(uts->actual_str,
+				" ERR.arch, log_test_binary() val -42 str   ab 123456789a%"));
+	ut_assert_skipline();
+	ut_assertnonnull(strstr(uts->actual_str,
+				" WARNING.efi, log_test_binary() mac 12:34:56:78:9a:bc"));
+	ut_assert_skipline();
+	ut_assertnonnull(strstr(uts->actual_str,
+				" ERR.arch, log_test_binary() part1 part2"));
+	ut_assert_console_end();
+
+	ut_assertok(run_command("log dump", 0));
+	ut_assert_nextline("Binary log: 0 records, 0 dropped");
+	ut_assert_console_end();
+
+	return 0;
+}
+LOG_TEST(log_test_binary);
+
+/* Check that a format string built at run time is stored as text */
+static int log_test_binary_runtime(struct unit_test_state *uts)
+{
+	char fmt[20];
+
+	log_binary_clear();
+	strcpy(fmt, "runtime %*.*d\n");
+	ut_assertok(log_device_set_enable(LOG_GET_DRIVER(console), false));
+	log(LOGC_ARCH, LOGL_ERR, fmt, 6, 3, 7);
+	ut_assertok(log_device_set_enable(LOG_GET_DRIVER(console), true));
+	strcpy(fmt, "overwritten\n");
+
+	ut_assertok(run_command("log dump -c", 0));
+	ut_assert_nextline("Binary log: 1 records, 0 dropped");
+	ut_assert_skipline();
+	ut_assertnonnull(strstr(uts->actual_str, "runtime    007"));
+	ut_assert_console_end();
+
+	return 0;
+}
+LOG_TEST(log_test_binary_runtime);
+
+/* Check that the oldest records are dropped when the ring is full */
+static int log_test_binary_wrap(struct unit_test_state *uts)
+{
+	struct log_binary_hdr *hdr;
+	uint count;
+	int i;
+
+	log_binary_clear();
+	hdr = bloblist_find(BLOBLISTT_U_BOOT_LOG, 0);
+	ut_assertnonnull(hdr);
+
+	ut_assertok(log_device_set_enable(LOG_GET_DRIVER(console), false));
+	for (i = 0; i < 500; i++)
+		log(LOGC_ARCH, LOGL_ERR, "record %d %s\n", i,
+		    i & 1 ? "odd" : "even");
+	ut_assertok(log_device_set_enable(LOG_GET_DRIVER(console), true));
+
+	count = hdr->count;
+	ut_assert(hdr->dropped > 0);
+	ut_asserteq(500, count + hdr->dropped);
+
+	ut_assertok(run_command("log dump -c", 0));
+	ut_assert_nextline("Binary log: %u records, %u dropped", count,
+			   500 - count);
+	for (i = 500 - count; i < 499; i++)
+		ut_assert_skipline();
+	ut_assert_skipline();
+	ut_assertnonnull(strstr(uts->actual_str, "record 499 odd"));
+	ut_assert_console_end();
+
+	return 0;
+}
+LOG_TEST(log_test_binary_wrap);
@@ -2,6 +2,7 @@
 # Copyright (C) 2022 Huang Jianan <jnhuang95@gmail.com>
 # Author: Huang Jianan <jnhuang95@gmail.com>
 
+import hashlib
 import os
 import pytest
 import shutil
@@ -161,6 +162,29 @@ def erofs_load_files_at_symlink(u_boot_console):
     address = '$kernel_addr_r'
     erofs_load_files(u_boot_console, files, sizes, address)
 
+def erofs_load_partial_files(u_boot_console):
+    """
+    Test unaligned partial loads of a compressed file, repeated so that the
+    second pass is served from the decompressed pcluster cache.
+    """
+    build_dir = u_boot_console.config.build_dir
+    original_file_path = os.path.join(build_dir, EROFS_SRC_DIR + '/f7812')
+    address = '$kernel_addr_r'
+    for _ in range(2):
+        for (size, pos) in [(100, 1), (3000, 4000), (812, 7000)]:
+            out = u_boot_console.run_command('erofsload host 0 {} f7812 {} {}'.format(
+                address, hex(size), hex(pos)))
+            assert str(size) in out
+
+            out = u_boot_console.run_command('md5sum {} {}'.format(address, hex(size)))
+            u_boot_checksum = out.split()[-1]
+
+            with open(original_file_path, 'rb') as f:
+                f.seek(pos)
+                original_checksum = hashlib.md5(f.read(size)).hexdigest()
+
+            assert u_boot_checksum == original_checksum
+
 def erofs_load_non_existent_file(u_boot_console):
     """
     Test if the EROFS support will crash when load a nonexistent file.
@@ -181,6 +205,7 @@ def erofs_run_all_tests(u_boot_console):
     erofs_load_files_at_root(u_boot_console)
     erofs_load_files_at_subdir(u_boot_console)
     erofs_load_files_at_symlink(u_boot_console)
+    erofs_load_partial_files(u_boot_console)
     erofs_load_non_existent_file(u_boot_console)
 
 @pytest.mark.boardspec('sandbox')
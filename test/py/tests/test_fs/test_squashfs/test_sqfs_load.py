@@ -2,6 +2,7 @@
 # Copyright (C) 2020 Bootlin
 # Author: Joao Marcos Costa <joaomarcos.costa@bootlin.com>
 
+import hashlib
 import os
 import subprocess
 import pytest
@@ -92,6 +93,44 @@ def sqfs_load_files_at_subdir(u_boot_console):
     address = '$kernel_addr_r'
     sqfs_load_files(u_boot_console, files, sizes, address)
 
+def sqfs_load_files_cached(u_boot_console):
+    """ Loads the same files again after listing the directory.
+
+    The inode, directory and fragment tables are then served by the metadata
+    cache filled by the previous commands, which must not change the result.
+
+    Args:
+        u_boot_console: provides the means to interact with U-Boot's console.
+    """
+    u_boot_console.run_command('sqfsls host 0')
+    files = ['f4096', 'f5096', 'f1000', 'subdir/subdir-file']
+    sizes = ['4096', '5096', '1000', '100']
+    address = '$kernel_addr_r'
+    sqfs_load_files(u_boot_console, files, sizes, address)
+
+def sqfs_load_partial_file(u_boot_console):
+    """ Loads only the beginning of a file.
+
+    The first data block is decompressed straight into the load buffer, while
+    the last byte either comes from the fragment block or from a data block
+    that does not fit in the requested length.
+
+    Args:
+        u_boot_console: provides the means to interact with U-Boot's console.
+    """
+    build_dir = u_boot_console.config.build_dir
+    address = '$kernel_addr_r'
+    size = 4097
+    out = u_boot_console.run_command('sqfsload host 0 {} f5096 {}'.format(
+        address, hex(size)))
+    assert str(size) in out
+
+    u_boot_checksum = uboot_md5sum(u_boot_console, address, hex(size))
+    original_file_path = os.path.join(build_dir, SQFS_SRC_DIR + '/f5096')
+    with open(original_file_path, 'rb') as f:
+        original_checksum = hashlib.md5(f.read(size)).hexdigest()
+    assert u_boot_checksum == original_checksum
+
 def sqfs_load_non_existent_file(u_boot_console):
     """ Calls sqfs_load_files passing an non-existent file to raise an error.
 
@@ -114,6 +153,8 @@ def sqfs_run_all_load_tests(u_boot_console):
     """
     sqfs_load_files_at_root(u_boot_console)
     sqfs_load_files_at_subdir(u_boot_console)
+    sqfs_load_files_cached(u_boot_console)
+    sqfs_load_partial_file(u_boot_console)
     sqfs_load_non_existent_file(u_boot_console)
 
 @pytest.mark.boardspec('sandbox')
@@ -82,6 +82,18 @@ env__net_pxe_readable_file = {
     'pattern': 'Linux',
 }
 
+# Details regarding a file that may be read from an HTTP server, used to
+# compare the wget transfer modes of the lwIP stack. This variable may be
+# omitted or set to None if HTTP testing is not possible or desired.
+env__net_http_readable_file = {
+    'url': 'http://10.0.0.1/ubtest-readable.bin',
+    'addr': 0x10000000,
+    'size': 5058624,
+    'crc32': 'c2244b26',
+    'timeout': 50000,
+    'connections': 4,
+}
+
 # True if a router advertisement service is connected to the network, and should
 # be tested. If router advertisement testing is not possible or desired, this
 variable may be omitted or set to False.
@@ -456,3 +468,72 @@ def test_net_tftpput(u_boot_console):
 
     output = u_boot_console.run_command("crc32 $fileaddr $filesize")
     assert expected_tftpb_crc in output
+
+@pytest.mark.buildconfigspec('cmd_wget')
+@pytest.mark.buildconfigspec('net_lwip')
+@pytest.mark.buildconfigspec('cmd_crc32')
+def test_net_wget_modes(u_boot_console):
+    """Compare the transfer modes of the wget command.
+
+    The same file is downloaded over a single connection, as byte ranges on
+    several connections, and twice in a batch sharing one persistent
+    connection. Every copy is checked against the expected CRC32 and the
+    throughput of each mode is logged.
+
+    The details of the file to download are provided by the boardenv_* file;
+    see the comment at the beginning of this file.
+    """
+
+    if not net_set_up:
+        pytest.skip('Network not initialized')
+
+    f = u_boot_console.config.env.get('env__net_http_readable_file', None)
+    if not f:
+        pytest.skip('No HTTP readable file to read')
+
+    url = f['url']
+    addr = f['addr']
+    sz = f['size']
+    expected_crc = f['crc32']
+    timeout = f.get('timeout', 50000)
+    conns = f.get('connections', 4)
+    addr2 = addr + ((sz + 0xfffff) & ~0xfffff)
+
+    def fetch(args):
+        u_boot_console.run_command('mw.b %x 0 %x' % (addr, sz))
+        u_boot_console.run_command('mw.b %x 0 %x' % (addr2, sz))
+        with u_boot_console.temporary_timeout(timeout):
+            output = u_boot_console.run_command('wget %s' % args)
+        m = re.search(r'(\d+) bytes transferred in (\d+) ms', output)
+        assert m
+        return output, int(m.group(1)), max(int(m.group(2)), 1)
+
+    def check(file_addr):
+        output = u_boot_console.run_command('crc32 %x %x' % (file_addr, sz))
+        assert expected_crc in output
+
+    def report(mode, total, ms):
+        u_boot_console.log.info('%s: %d bytes in %d ms (%d KiB/s)' %
+                                (mode, total, ms, total * 1000 // ms // 1024))
+
+    output, total, ms = fetch('%x %s' % (addr, url))
+    assert 'Bytes transferred = %d' % sz in output
+    check(addr)
+    report('single connection', total, ms)
+    single_ms = ms
+
+    output, total, ms = fetch('-j %d %x %s' % (conns, addr, url))
+    assert 'Bytes transferred = %d' % sz in output
+    assert total == sz
+    check(addr)
+    report('%d ranged connections' % conns, total, ms)
+
+    output, total, ms = fetch('%x %s %x %s' % (addr, url, addr2, url))
+    assert 'on one connection' in output
+    assert 'Bytes transferred = %d' % sz in output
+    assert total == 2 * sz
+    check(addr)
+    check(addr2)
+    report('two files, one connection', total, ms)
+    u_boot_console.log.info('two files, separate connections: %d ms' %
+                            (2 * single_ms))
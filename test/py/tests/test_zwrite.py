@@ -0,0 +1,147 @@
+# SPDX-License-Identifier: GPL-2.0+
+
+"""Test the zwrite command, which writes compressed images to block devices"""
+
+import gzip
+import lzma
+import os
+import shutil
+import pytest
+import u_boot_utils
+
+DISK_SIZE = 1 << 20
+ZERO_SIZE = 256 << 10
+WBUF = 0x10000
+
+
+def make_payload():
+    """Create an image with data at both ends and a zero run in between
+
+    Returns:
+        tuple: image data, offset of the zero run
+    """
+    text = b''.join(b'line %d of the zwrite test image\n' % i
+                    for i in range(2000))
+    return text + b'\0' * ZERO_SIZE + text[:12345], len(text)
+
+
+def compress(cons, fmt, data, path):
+    """Compress data into a file, using a host tool where Python cannot
+
+    Returns:
+        True if the file was written, False if the tool is not available
+    """
+    if fmt == 'gzip':
+        with open(path, 'wb') as outf:
+            outf.write(gzip.compress(data))
+    elif fmt == 'lzma':
+        with open(path, 'wb') as outf:
+            outf.write(lzma.compress(data, format=lzma.FORMAT_ALONE))
+    else:
+        if not shutil.which(fmt):
+            return False
+        raw = path + '.raw'
+        with open(raw, 'wb') as outf:
+            outf.write(data)
+        u_boot_utils.run_and_log(cons, [fmt, '-q', '-f', raw, '-o', path]
+                                 if fmt == 'zstd' else
+                                 [fmt, '-q', '-f', raw, path])
+        os.remove(raw)
+    return True
+
+
+def setup_disk(cons, fill):
+    """Create a disk image full of a fill byte and bind it as host 0"""
+    path = os.path.join(cons.config.result_dir, 'zwrite.img')
+    with open(path, 'wb') as outf:
+        outf.write(bytes([fill]) * DISK_SIZE)
+    cons.run_command('host bind 0 %s' % path)
+    return path
+
+
+def run_zwrite(cons, fmt, data, opts=''):
+    """Compress data, write it to host 0 and return the command output"""
+    comp = os.path.join(cons.config.result_dir, 'zwrite.%s' % fmt)
+    if not compress(cons, fmt, data, comp):
+        pytest.skip('%s tool not available' % fmt)
+    addr = u_boot_utils.find_ram_base(cons)
+    cons.run_command('host load hostfs - %x %s' % (addr, comp))
+    output = cons.run_command('zwrite %s host 0 %x $filesize %x' %
+                              (opts, addr, WBUF))
+    cons.run_command('host unbind 0')
+    return output
+
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_zwrite')
+@pytest.mark.parametrize('fmt', ['gzip', 'lzma', 'zstd', 'lz4'])
+def test_zwrite(u_boot_console, fmt):
+    """Write each compression format and check the device contents"""
+    cons = u_boot_console
+    data, _ = make_payload()
+    path = setup_disk(cons, 0xff)
+    output = run_zwrite(cons, fmt, data)
+    assert '%d bytes written' % len(data) in output
+
+    with open(path, 'rb') as inf:
+        disk = inf.read()
+    assert disk[:len(data)] == data
+    # the final partial block is padded with zeroes
+    pad = -len(data) % 512
+    assert disk[len(data):len(data) + pad] == b'\0' * pad
+    assert disk[len(data) + pad:] == b'\xff' * (DISK_SIZE - len(data) - pad)
+
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_zwrite')
+def test_zwrite_zero_skip(u_boot_console):
+    """Check that all-zero blocks are left alone with -s"""
+    cons = u_boot_console
+    data, head = make_payload()
+    path = setup_disk(cons, 0xff)
+    output = run_zwrite(cons, 'gzip', data, '-s')
+    assert 'zero blocks skipped' in output
+
+    with open(path, 'rb') as inf:
+        disk = inf.read()
+    assert disk[:head] == data[:head]
+    # whole blocks inside the zero run were skipped, so still hold 0xff
+    first = (head + 511) // 512 * 512
+    last = (head + ZERO_SIZE) // 512 * 512
+    assert disk[first:last] == b'\xff' * (last - first)
+    assert disk[head + ZERO_SIZE:len(data)] == data[head + ZERO_SIZE:]
+
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_zwrite')
+def test_zwrite_zero_erase(u_boot_console):
+    """Check that -e falls back to writing on a device that cannot erase"""
+    cons = u_boot_console
+    data, _ = make_payload()
+    path = setup_disk(cons, 0xff)
+    output = run_zwrite(cons, 'gzip', data, '-e')
+    assert ', 0 zero blocks erased' in output
+
+    with open(path, 'rb') as inf:
+        disk = inf.read()
+    assert disk[:len(data)] == data
+
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_zwrite')
+def test_zwrite_corrupt(u_boot_console):
+    """Check that a corrupt image is reported"""
+    cons = u_boot_console
+    data = bytearray(gzip.compress(make_payload()[0]))
+    data[len(data) // 2] ^= 0xff
+    comp = os.path.join(cons.config.result_dir, 'zwrite.bad')
+    with open(comp, 'wb') as outf:
+        outf.write(data)
+    setup_disk(cons, 0)
+    addr = u_boot_utils.find_ram_base(cons)
+    cons.run_command('host load hostfs - %x %s' % (addr, comp))
+    output = cons.run_command('zwrite host 0 %x $filesize; echo rc=$?' %
+                              addr)
+    cons.run_command('host unbind 0')
+    assert 'zwrite failed' in output
+    assert 'rc=1' in output
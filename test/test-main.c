@@ -119,6 +119,7 @@ static int dm_test_post_run(struct unit_test_state *uts)
 		switch (fdt_action()) {
 		case FDTCHK_COPY:
 			memcpy((void *)gd->fdt_blob, uts->fdt_copy, uts->fdt_size);
+			oftree_phandle_invalidate(gd->fdt_blob);
 			break;
 		case FDTCHK_CHECKSUM: {
 			uint chksum;